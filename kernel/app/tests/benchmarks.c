@@ -162,6 +162,76 @@ __NO_INLINE static void bench_memcpy(void)
     free(buf);
 }
 
+__NO_INLINE static void bench_memcpy_per_page(void)
+{
+    uint8_t *buf = memalign(PAGE_SIZE, BUFSIZE);
+    memset(buf, 0, BUFSIZE);
+
+    uint64_t count = arch_cycle_count();
+    for (uint i = 0; i < ITER; i++) {
+        for (uint j = 0; j < BUFSIZE / 2; j += PAGE_SIZE) {
+            memcpy(buf + j, buf + BUFSIZE / 2 + j, PAGE_SIZE);
+        }
+    }
+    count = arch_cycle_count() - count;
+
+    uint64_t bytes_cycle = (BUFSIZE / 2 * ITER * 1000ULL) / count;
+    printf("took %" PRIu64 " cycles to per-page memcpy a buffer of size %zu %d times (%zu source bytes), %llu.%03llu source bytes/cycle\n",
+           count, BUFSIZE / 2, ITER, BUFSIZE / 2 * ITER, bytes_cycle / 1000, bytes_cycle % 1000);
+
+    free(buf);
+}
+
+// The sizes used by the small memcpy and memset benchmarks, which are the
+// sizes most syscall arguments and channel messages are copied in.
+static const size_t small_sizes[] = { 1, 3, 8, 15, 16, 24, 64, 100, 128, 256, 1024, 2000 };
+
+#define SMALL_ITER (ITER * 256)
+
+__NO_INLINE static void bench_memcpy_small(void)
+{
+    uint8_t *buf = memalign(PAGE_SIZE, 2 * PAGE_SIZE);
+    memset(buf, 0, 2 * PAGE_SIZE);
+
+    for (uint s = 0; s < countof(small_sizes); s++) {
+        size_t len = small_sizes[s];
+        uint64_t count = arch_cycle_count();
+        for (uint i = 0; i < SMALL_ITER; i++) {
+            // Keep the compiler from inlining a copy of a known size.
+            __asm__ volatile("" : "+r"(len));
+            memcpy(buf, buf + PAGE_SIZE + (i & 7), len);
+        }
+        count = arch_cycle_count() - count;
+
+        printf("took %" PRIu64 " cycles to memcpy %zu bytes %d times (%" PRIu64 " cycles per)\n",
+               count, len, SMALL_ITER, count / SMALL_ITER);
+    }
+
+    free(buf);
+}
+
+__NO_INLINE static void bench_memset_small(void)
+{
+    uint8_t *buf = memalign(PAGE_SIZE, PAGE_SIZE);
+
+    for (uint s = 0; s < countof(small_sizes); s++) {
+        size_t len = small_sizes[s];
+        uint64_t count = arch_cycle_count();
+        for (uint i = 0; i < SMALL_ITER; i++) {
+            __asm__ volatile("" : "+r"(len));
+            memset(buf + (i & 7), 0, len);
+        }
+        count = arch_cycle_count() - count;
+
+        printf("took %" PRIu64 " cycles to memset %zu bytes %d times (%" PRIu64 " cycles per)\n",
+               count, len, SMALL_ITER, count / SMALL_ITER);
+    }
+
+    free(buf);
+}
+
+#undef SMALL_ITER
+
 __NO_INLINE static void bench_spinlock(void)
 {
     spin_lock_saved_state_t state;
@@ -231,7 +301,10 @@ void benchmarks(void)
 {
     bench_set_overhead();
     bench_memcpy();
+    bench_memcpy_per_page();
+    bench_memcpy_small();
     bench_memset();
+    bench_memset_small();
 
     bench_memset_per_page();
     bench_zero_page();
@@ -0,0 +1,145 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <arch/ops.h>
+#include <kernel/atomic.h>
+#include <kernel/event.h>
+#include <kernel/thread.h>
+#include <unittest.h>
+
+// Every thread in these tests is pinned to one cpu, so the order in which
+// they run there is the order in which they take their turns.
+
+typedef struct handoff_waiter {
+    event_t wake;
+    volatile int* turns;
+    // the turn it ran in, -1 until then
+    int turn;
+    thread_t* thread;
+} handoff_waiter_t;
+
+static int waiter_thread(void* arg) {
+    handoff_waiter_t* w = arg;
+    event_wait(&w->wake);
+    w->turn = atomic_add(w->turns, 1);
+    return 0;
+}
+
+// Pins the current thread to the cpu it is running on. Returns the cpu
+// it was pinned to before.
+static int pin_current_thread(void) {
+    thread_t* current_thread = get_current_thread();
+    arch_disable_ints();
+    int old = thread_pinned_cpu(current_thread);
+    thread_set_pinned_cpu(current_thread, arch_curr_cpu_num());
+    arch_enable_ints();
+    return old;
+}
+
+// Starts a thread on the current cpu which takes a turn once |w->wake| is
+// signaled, and waits until it has blocked.
+static bool start_waiter(handoff_waiter_t* w, volatile int* turns, const char* name) {
+    event_init(&w->wake, false, 0);
+    w->turns = turns;
+    w->turn = -1;
+    w->thread = thread_create(name, waiter_thread, w, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    if (!w->thread)
+        return false;
+    thread_set_pinned_cpu(w->thread, arch_curr_cpu_num());
+    thread_resume(w->thread);
+    while (w->thread->state != THREAD_BLOCKED)
+        thread_sleep_relative(LK_MSEC(1));
+    return true;
+}
+
+static void finish_waiter(handoff_waiter_t* w) {
+    thread_join(w->thread, NULL, INFINITE_TIME);
+    event_destroy(&w->wake);
+}
+
+static bool handoff_on_block(void* context) {
+    BEGIN_TEST;
+
+    int old_cpu = pin_current_thread();
+    volatile int turns = 0;
+    handoff_waiter_t target, bystander;
+    REQUIRE_TRUE(start_waiter(&target, &turns, "handoff target"), "");
+    REQUIRE_TRUE(start_waiter(&bystander, &turns, "handoff bystander"), "");
+
+    // The bystander is woken last, so it is at the head of the run queue,
+    // but blocking switches to the target.
+    thread_handoff_begin();
+    event_signal(&target.wake, false);
+    event_signal(&bystander.wake, false);
+    finish_waiter(&target);
+    finish_waiter(&bystander);
+
+    EXPECT_EQ(0, target.turn, "target not scheduled next");
+    EXPECT_EQ(1, bystander.turn, "");
+    EXPECT_FALSE(get_current_thread()->handoff_pending, "handoff left pending");
+
+    thread_set_pinned_cpu(get_current_thread(), old_cpu);
+    END_TEST;
+}
+
+static bool handoff_on_yield(void* context) {
+    BEGIN_TEST;
+
+    int old_cpu = pin_current_thread();
+    volatile int turns = 0;
+    handoff_waiter_t target, bystander;
+    REQUIRE_TRUE(start_waiter(&target, &turns, "handoff target"), "");
+    REQUIRE_TRUE(start_waiter(&bystander, &turns, "handoff bystander"), "");
+
+    // The current thread stays runnable and gets back to the cpu.
+    thread_handoff_begin();
+    event_signal(&target.wake, false);
+    event_signal(&bystander.wake, false);
+    thread_handoff_yield();
+    EXPECT_EQ(0, target.turn, "target not scheduled next");
+    EXPECT_FALSE(get_current_thread()->handoff_pending, "handoff left pending");
+
+    finish_waiter(&target);
+    finish_waiter(&bystander);
+    EXPECT_EQ(1, bystander.turn, "");
+
+    thread_set_pinned_cpu(get_current_thread(), old_cpu);
+    END_TEST;
+}
+
+static bool handoff_target_not_runnable(void* context) {
+    BEGIN_TEST;
+
+    int old_cpu = pin_current_thread();
+    volatile int turns = 0;
+    handoff_waiter_t target, bystander;
+    REQUIRE_TRUE(start_waiter(&target, &turns, "handoff target"), "");
+    REQUIRE_TRUE(start_waiter(&bystander, &turns, "handoff bystander"), "");
+
+    // Let the target run and exit before blocking, so the handoff finds
+    // it gone and the next thread in the run queue is scheduled instead.
+    thread_handoff_begin();
+    event_signal(&target.wake, false);
+    while (target.thread->state != THREAD_DEATH)
+        thread_yield();
+    EXPECT_EQ(0, target.turn, "");
+
+    event_signal(&bystander.wake, false);
+    finish_waiter(&bystander);
+    EXPECT_EQ(1, bystander.turn, "");
+    EXPECT_FALSE(get_current_thread()->handoff_pending, "handoff left pending");
+
+    finish_waiter(&target);
+
+    thread_set_pinned_cpu(get_current_thread(), old_cpu);
+    END_TEST;
+}
+
+UNITTEST_START_TESTCASE(handoff_tests)
+UNITTEST("block switches to the handoff target", handoff_on_block)
+UNITTEST("yield switches to the handoff target", handoff_on_yield)
+UNITTEST("handoff target no longer runnable", handoff_target_not_runnable)
+UNITTEST_END_TESTCASE(handoff_tests, "handoff", "directed handoff tests", NULL, NULL);
@@ -445,6 +445,60 @@ static void join_test(void)
     printf("thread_join returns err %d, retval %d (should be 0 and 55)\n", err, ret);
 }
 
+static thread_t *pi_owner;
+static event_t pi_owner_event;
+static event_t pi_waiter_event;
+
+static int pi_owner_thread(void *arg)
+{
+    event_wait(&pi_owner_event);
+    return 0;
+}
+
+// Lends |pi_owner| this thread's priority for as long as it is blocked, the
+// way a futex waiter naming its owner does.
+static int pi_waiter_thread(void *arg)
+{
+    thread_set_inherited_priority(pi_owner, thread_get_effective_priority(get_current_thread()));
+    event_wait(&pi_waiter_event);
+    thread_set_inherited_priority(pi_owner, LOWEST_PRIORITY);
+    return 0;
+}
+
+static void priority_inherit_test(void)
+{
+    printf("testing priority inheritance:\n");
+
+    event_init(&pi_owner_event, false, 0);
+    event_init(&pi_waiter_event, false, 0);
+
+    pi_owner = thread_create("pi owner", &pi_owner_thread, NULL, LOW_PRIORITY, DEFAULT_STACK_SIZE);
+    thread_resume(pi_owner);
+    ASSERT(thread_get_effective_priority(pi_owner) < HIGH_PRIORITY);
+
+    thread_t *waiter = thread_create("pi waiter", &pi_waiter_thread, NULL, HIGH_PRIORITY,
+                                     DEFAULT_STACK_SIZE);
+    thread_resume(waiter);
+
+    // The owner runs at no lower than the waiter while the waiter is blocked.
+    lk_time_t deadline = current_time() + LK_SEC(5);
+    while (thread_get_effective_priority(pi_owner) < HIGH_PRIORITY) {
+        ASSERT(current_time() < deadline);
+        thread_sleep_relative(LK_MSEC(1));
+    }
+
+    event_signal(&pi_waiter_event, true);
+    thread_join(waiter, NULL, INFINITE_TIME);
+    ASSERT(thread_get_effective_priority(pi_owner) < HIGH_PRIORITY);
+
+    event_signal(&pi_owner_event, true);
+    thread_join(pi_owner, NULL, INFINITE_TIME);
+
+    event_destroy(&pi_waiter_event);
+    event_destroy(&pi_owner_event);
+    printf("seems to work\n");
+}
+
 static void spinlock_test(void)
 {
     spin_lock_saved_state_t state;
@@ -599,6 +653,7 @@ int thread_tests(void)
 
     spinlock_test();
     atomic_test();
+    priority_inherit_test();
 
     thread_sleep_relative(LK_MSEC(200));
     context_switch_test();
@@ -21,6 +21,9 @@
 
 #if WITH_LIB_MAGENTA
 #include <lib/user_copy.h>
+#if WITH_LIB_MTRACE
+#include <lib/mtrace.h>
+#endif
 #include <magenta/exception.h>
 #endif
 
@@ -349,9 +352,22 @@ extern "C" uint32_t arm64_irq(struct arm64_iframe_short *iframe, uint exception_
             exit_flags |= ARM64_IRQ_EXIT_THREAD_SIGNALED;
         if (ret != INT_NO_RESCHEDULE)
             exit_flags |= ARM64_IRQ_EXIT_RESCHEDULE;
+#if WITH_LIB_MTRACE
+        /* the user's frame pointer is only saved in the long iframe */
+        if (mtrace_profile_sample_pending(arch_curr_cpu_num()))
+            exit_flags |= ARM64_IRQ_EXIT_PROFILE;
+#endif
         return exit_flags;
     }
 
+#if WITH_LIB_MTRACE
+    if (mtrace_profile_sample_pending(arch_curr_cpu_num())) {
+        /* our caller saved no frame, so ours links to the interrupted one */
+        uintptr_t fp = reinterpret_cast<uintptr_t*>(__GET_FRAME())[0];
+        mtrace_profile_sample(iframe->elr, fp, false);
+    }
+#endif
+
     /* preempt the thread if the interrupt has signaled it */
     if (ret != INT_NO_RESCHEDULE)
         thread_preempt();
@@ -370,6 +386,13 @@ extern "C" void arm64_finish_user_irq(uint32_t exit_flags, struct arm64_iframe_l
     // we came from a lower level, so restore the per cpu pointer
     arm64_restore_percpu_pointer();
 
+#if WITH_LIB_MTRACE
+    if (exit_flags & ARM64_IRQ_EXIT_PROFILE) {
+        DEBUG_ASSERT(iframe != nullptr);
+        mtrace_profile_sample(iframe->elr, iframe->r[29], true);
+    }
+#endif
+
     /* in the case of receiving a kill signal, this function may not return,
      * but the scheduler would have been invoked so it's fine.
      */
@@ -9,3 +9,4 @@
 // Flags passed back from arm64_irq() to the calling assembler.
 #define ARM64_IRQ_EXIT_THREAD_SIGNALED 1
 #define ARM64_IRQ_EXIT_RESCHEDULE 2
+#define ARM64_IRQ_EXIT_PROFILE 4
@@ -22,6 +22,9 @@
 #include <mxtl/auto_call.h>
 
 #include <lib/ktrace.h>
+#if WITH_LIB_MTRACE
+#include <lib/mtrace.h>
+#endif
 #include <lib/user_copy.h>
 
 #if WITH_LIB_MAGENTA
@@ -437,6 +440,11 @@ void x86_exception_handler(x86_iframe_t *frame)
     /* at this point we're able to be rescheduled, so we're 'outside' of the int handler */
     arch_set_in_int_handler(false);
 
+#if WITH_LIB_MTRACE
+    if (mtrace_profile_sample_pending(arch_curr_cpu_num()))
+        mtrace_profile_sample(frame->ip, frame->rbp, from_user);
+#endif
+
     /* if we came from user space, check to see if we have any signals to handle */
     if (unlikely(from_user)) {
         /* in the case of receiving a kill signal, this function may not return,
@@ -13,6 +13,7 @@
 #include <trace.h>
 
 #include <arch/ops.h>
+#include <arch/x86/memops.h>
 
 #include <mxtl/algorithm.h>
 
@@ -26,6 +27,8 @@ uint32_t max_ext_cpuid = 0;
 enum x86_vendor_list x86_vendor;
 enum x86_microarch_list x86_microarch;
 
+uint32_t x86_memops_flags;
+
 static struct x86_model_info model_info;
 
 static int initialized = 0;
@@ -102,6 +105,14 @@ void x86_feature_init(void)
 
         x86_microarch = get_microarch(&model_info);
     }
+
+    /* pick the string routines' strategy now that we can test for features */
+    uint32_t memops_flags = 0;
+    if (x86_feature_test(X86_FEATURE_ERMS))
+        memops_flags |= X86_MEMOPS_ERMS;
+    if (x86_feature_test(X86_FEATURE_FSRM))
+        memops_flags |= X86_MEMOPS_FSRM;
+    x86_memops_flags = memops_flags;
 }
 
 static enum x86_microarch_list get_microarch(struct x86_model_info* info) {
@@ -203,6 +214,8 @@ void x86_feature_debug(void)
         { X86_FEATURE_TSC_ADJUST, "tsc_adj" },
         { X86_FEATURE_SMEP, "smep" },
         { X86_FEATURE_SMAP, "smap" },
+        { X86_FEATURE_ERMS, "erms" },
+        { X86_FEATURE_FSRM, "fsrm" },
         { X86_FEATURE_RDRAND, "rdrand" },
         { X86_FEATURE_RDSEED, "rdseed" },
         { X86_FEATURE_PKU, "pku" },
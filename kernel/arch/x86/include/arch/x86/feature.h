@@ -126,10 +126,12 @@ void x86_feature_debug(void);
 #define X86_FEATURE_TSC_ADJUST   X86_CPUID_BIT(0x7, 1, 1)
 #define X86_FEATURE_AVX2         X86_CPUID_BIT(0x7, 1, 5)
 #define X86_FEATURE_SMEP         X86_CPUID_BIT(0x7, 1, 7)
+#define X86_FEATURE_ERMS         X86_CPUID_BIT(0x7, 1, 9)
 #define X86_FEATURE_RDSEED       X86_CPUID_BIT(0x7, 1, 18)
 #define X86_FEATURE_SMAP         X86_CPUID_BIT(0x7, 1, 20)
 #define X86_FEATURE_PT           X86_CPUID_BIT(0x7, 1, 25)
 #define X86_FEATURE_PKU          X86_CPUID_BIT(0x7, 2, 3)
+#define X86_FEATURE_FSRM         X86_CPUID_BIT(0x7, 3, 4)
 #define X86_FEATURE_AMD_TOPO     X86_CPUID_BIT(0x80000001, 2, 22)
 #define X86_FEATURE_SYSCALL      X86_CPUID_BIT(0x80000001, 3, 11)
 #define X86_FEATURE_NX           X86_CPUID_BIT(0x80000001, 3, 20)
@@ -0,0 +1,38 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+/* How memcpy, memset, arch_zero_page and the user copy routines move bytes.
+ * x86_feature_init() sets x86_memops_flags once at boot from cpuid; until
+ * then the routines use rep movsq/stosq, which is reasonable everywhere. */
+
+/* Enhanced rep movsb/stosb: the byte string instructions are the fastest
+ * way to move anything but short runs. */
+#define X86_MEMOPS_ERMS (1 << 0)
+/* Fast short rep movsb: they are also fast for short runs. */
+#define X86_MEMOPS_FSRM (1 << 1)
+
+/* Below this many bytes, ERMS parts without FSRM use rep movsq/stosq, as
+ * the byte instructions take a while to start. */
+#define X86_MEMOPS_ERMS_THRESHOLD 128
+
+/* memcpy and memset of at least this many bytes use non-temporal stores,
+ * so that they do not push everything else out of the caches. */
+#define X86_MEMOPS_NONTEMPORAL_THRESHOLD (256 * 1024)
+
+#ifndef ASSEMBLY
+
+#include <magenta/compiler.h>
+#include <stdint.h>
+
+__BEGIN_CDECLS
+
+extern uint32_t x86_memops_flags;
+
+__END_CDECLS
+
+#endif // !ASSEMBLY
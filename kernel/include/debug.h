@@ -75,7 +75,11 @@ static inline void hexdump8(const void *ptr, size_t len)
     hexdump8_ex(ptr, len, (uint64_t)((addr_t)ptr));
 }
 
+#if !DISABLE_DEBUG_OUTPUT
+#define dprintf(level, x...) do { if ((level) <= LK_DEBUGLEVEL) { _dprintf(x); } } while (0)
+#else
 #define dprintf(level, x...) do { if ((level) <= LK_DEBUGLEVEL) { printf(x); } } while (0)
+#endif
 
 /* systemwide halts */
 void _panic(void *caller, void *frame, const char *fmt, ...) __PRINTFLIKE(3, 4) __NO_RETURN;
@@ -20,6 +20,10 @@ void sched_unblock_list(struct list_node *list);
 void sched_yield(void);
 void sched_preempt(void);
 void sched_reschedule(void);
+void sched_handoff_yield(void);
+void sched_handoff_end(void);
+int sched_effective_priority(const thread_t *t);
+void sched_inherit_priority(thread_t *t, int priority);
 
 /* the low level reschedule routine, called from the scheduler */
 void _thread_resched_internal(void);
@@ -10,25 +10,38 @@
 #include <magenta/compiler.h>
 #include <magenta/thread_annotations.h>
 #include <arch/spinlock.h>
+#include <lib/lockstat.h>
 
 __BEGIN_CDECLS
 
 /* interrupts should already be disabled */
 static inline void spin_lock(spin_lock_t *lock)
 {
+#if WITH_LIB_LOCKSTAT
+    lockstat_spin_lock(lock);
+#else
     arch_spin_lock(lock);
+#endif
 }
 
 /* Returns 0 on success, non-0 on failure */
 static inline int spin_trylock(spin_lock_t *lock)
 {
+#if WITH_LIB_LOCKSTAT
+    return lockstat_spin_trylock(lock);
+#else
     return arch_spin_trylock(lock);
+#endif
 }
 
 /* interrupts should already be disabled */
 static inline void spin_unlock(spin_lock_t *lock)
 {
+#if WITH_LIB_LOCKSTAT
+    lockstat_spin_unlock(lock);
+#else
     arch_spin_unlock(lock);
+#endif
 }
 
 static inline void spin_lock_init(spin_lock_t *lock)
@@ -16,6 +16,7 @@
 #include <kernel/wait.h>
 #include <kernel/spinlock.h>
 #include <debug.h>
+#include <lib/lockstat.h>
 
 __BEGIN_CDECLS
 
@@ -83,10 +84,17 @@ typedef struct thread {
 
     int base_priority;
     int priority_boost;
+    /* the highest priority of the threads blocked on futexes this thread
+     * owns, or LOWEST_PRIORITY if none. see thread_set_inherited_priority() */
+    int inherited_priority;
 
     uint last_cpu; /* last/current cpu the thread is running on */
     int pinned_cpu; /* only run on pinned_cpu if >= 0 */
 
+    /* directed handoff state, see thread_handoff_begin() */
+    bool handoff_pending;
+    struct thread *handoff_target;
+
     /* pointer to the kernel address space this thread is associated with */
     struct vmm_aspace *aspace;
 
@@ -140,6 +148,11 @@ typedef struct thread {
     int linebuffer_pos;
     char linebuffer[THREAD_LINEBUFFER_LENGTH];
 #endif
+#if WITH_LIB_LOCKSTAT
+    /* mutexes held, for lock statistics */
+    lockstat_held_t lockstat_held[LOCKSTAT_MAX_HELD];
+    uint32_t lockstat_depth;
+#endif
 } thread_t;
 
 static inline uint thread_last_cpu(const thread_t* t) {
@@ -185,6 +198,8 @@ void thread_construct_first(thread_t *t, const char *name);
 thread_t *thread_create_idle_thread(uint cpu_num);
 void thread_set_name(const char *name);
 void thread_set_priority(int priority);
+int thread_get_effective_priority(thread_t *t);
+void thread_set_inherited_priority(thread_t *t, int priority);
 void thread_set_user_callback(thread_t *t, thread_user_callback_t cb);
 thread_t *thread_create(const char *name, thread_start_routine entry, void *arg, int priority, size_t stack_size);
 thread_t *thread_create_etc(thread_t *t, const char *name, thread_start_routine entry, void *arg, int priority, void *stack, void *unsafe_stack, size_t stack_size, thread_trampoline_routine alt_trampoline);
@@ -206,6 +221,23 @@ void thread_preempt(void);    /* get preempted at irq time */
 void thread_reschedule(void); /* revaluate the run queue on the current cpu,
                                  can be used after waking up threads */
 
+/* Directed handoff for synchronous IPC.
+ *
+ * A thread that is about to wake a peer and then immediately block waiting
+ * for an answer calls thread_handoff_begin() before the wakeup. The first
+ * thread it wakes is not sent to another cpu; instead, when the caller next
+ * blocks, it switches straight to that thread and donates the remainder of
+ * its time slice. While a handoff is pending, thread_reschedule() is a no-op.
+ *
+ * thread_handoff_yield() switches to the woken thread immediately while
+ * leaving the caller runnable, and thread_handoff_end() abandons a handoff
+ * that was not consumed by blocking. Both fall back to the regular wakeup
+ * path if the target has already run or is no longer the best choice.
+ */
+void thread_handoff_begin(void);
+void thread_handoff_yield(void);
+void thread_handoff_end(void);
+
 void thread_owner_name(thread_t *t, char out_name[THREAD_NAME_LENGTH]);
 
 #define THREAD_BACKTRACE_DEPTH 10
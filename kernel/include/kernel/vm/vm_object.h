@@ -131,6 +131,11 @@ public:
     // Sets the value returned by |user_id()|. May only be called once.
     void set_user_id(uint64_t user_id);
 
+    // Marks the object as backing memory the kernel has committed and mapped
+    // for its own use, such as a shared ring. The pages of such an object
+    // can never be taken or replaced. May not be undone.
+    void set_kernel_owned();
+
     virtual void Dump(uint depth, bool verbose) = 0;
 
     // cache maintainence operations.
@@ -155,6 +160,23 @@ public:
         return MX_ERR_NOT_SUPPORTED;
     }
 
+    // Move the pages backing the page-aligned range out of the object and
+    // onto the tail of |pages|, in offset order. Afterwards the range reads
+    // as zeros, as if freshly decommitted. Fails without side effects unless
+    // every page in the range is committed and unpinned and the object has
+    // no copy-on-write parent or children and is not kernel owned.
+    virtual status_t TakePages(uint64_t offset, uint64_t len, list_node* pages) {
+        return MX_ERR_NOT_SUPPORTED;
+    }
+
+    // Replace the pages backing the page-aligned range with the pages on
+    // |pages|, in offset order, freeing any pages previously committed
+    // there. The pages must have been allocated from the pmm and are only
+    // consumed on success.
+    virtual status_t SupplyPages(uint64_t offset, uint64_t len, list_node* pages) {
+        return MX_ERR_NOT_SUPPORTED;
+    }
+
     // create a copy-on-write clone vmo at the page-aligned offset and length
     // note: it's okay to start or extend past the size of the parent
     virtual status_t CloneCOW(uint64_t offset, uint64_t size, bool copy_name,
@@ -256,6 +278,9 @@ protected:
 
     uint64_t user_id_ TA_GUARDED(lock_) = 0;
 
+    // set once the kernel relies on the pages staying put; see set_kernel_owned()
+    bool kernel_owned_ TA_GUARDED(lock_) = false;
+
     // The user-friendly VMO name. For debug purposes only. That
     // is, there is no mechanism to get access to a VMO via this name.
     mxtl::Name<MX_MAX_NAME_LEN> name_;
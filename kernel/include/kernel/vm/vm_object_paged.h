@@ -48,6 +48,9 @@ public:
     status_t Pin(uint64_t offset, uint64_t len) override;
     void Unpin(uint64_t offset, uint64_t len) override;
 
+    status_t TakePages(uint64_t offset, uint64_t len, list_node* pages) override;
+    status_t SupplyPages(uint64_t offset, uint64_t len, list_node* pages) override;
+
     status_t Read(void* ptr, uint64_t offset, size_t len, size_t* bytes_read) override;
     status_t Write(const void* ptr, uint64_t offset, size_t len, size_t* bytes_written) override;
     status_t Lookup(uint64_t offset, uint64_t len, uint pf_flags,
@@ -188,6 +188,8 @@ public:
 
     status_t AddPage(vm_page*, uint64_t offset);
     vm_page* GetPage(uint64_t offset);
+    // Removes the page at |offset| from the list without freeing it.
+    vm_page* RemovePage(uint64_t offset);
     status_t FreePage(uint64_t offset);
     size_t FreeAllPages();
 
@@ -22,33 +22,32 @@ struct ktrace_probe_info {
     uint32_t num;
 } __ALIGNED(16); // align on multiple of 16 to match linker packing of the ktrace_probe section
 
-void* ktrace_open(uint32_t tag);
+// Writes a record with up to KTRACE_LEN(tag) - KTRACE_HDRSIZE bytes of
+// arguments. Returns MX_ERR_UNAVAILABLE if the record was not written.
+status_t ktrace_write(uint32_t tag, const uint32_t* args, uint32_t num_args);
 void ktrace_tiny(uint32_t tag, uint32_t arg);
 static inline void ktrace(uint32_t tag, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
-    uint32_t* data = (uint32_t*) ktrace_open(tag);
-    if (data) {
-        data[0] = a; data[1] = b; data[2] = c; data[3] = d;
-    }
+    const uint32_t args[4] = { a, b, c, d };
+    ktrace_write(tag, args, 4);
 }
 #define ktrace_probe0(_name) {                                  \
     __USED __SECTION("ktrace_probe")                            \
     static ktrace_probe_info_t info = { .name = _name };        \
-    ktrace_open(TAG_PROBE_16(info.num));                        \
+    ktrace_write(TAG_PROBE_16(info.num), NULL, 0);              \
 }
 #define ktrace_probe2(_name,arg0,arg1) {                     \
     __USED __SECTION("ktrace_probe")                         \
     static ktrace_probe_info_t info = { .name = _name };     \
-    uint32_t* args = ktrace_open(TAG_PROBE_24(info.num));    \
-    if (args) {                                              \
-      args[0] = arg0;                                        \
-      args[1] = arg1;                                        \
-    }                                                        \
+    const uint32_t args[2] = { arg0, arg1 };                 \
+    ktrace_write(TAG_PROBE_24(info.num), args, 2);           \
 }
 void ktrace_name(uint32_t tag, uint32_t id, uint32_t arg, const char* name);
 int ktrace_read_user(void* ptr, uint32_t off, uint32_t len);
 status_t ktrace_control(uint32_t action, uint32_t options, void* ptr);
 #else
-static inline void* ktrace_open(uint32_t tag) { return NULL; }
+static inline status_t ktrace_write(uint32_t tag, const uint32_t* args, uint32_t num_args) {
+    return MX_ERR_UNAVAILABLE;
+}
 static inline void ktrace_tiny(uint32_t tag, uint32_t arg) {}
 static inline void ktrace(uint32_t tag, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {}
 static inline void ktrace_probe0(const char* name) {}
@@ -73,3 +72,28 @@ void ktrace_report_live_threads(void);
 void ktrace_report_live_processes(void);
 
 __END_CDECLS
+
+#ifdef __cplusplus
+#include <mxtl/ref_ptr.h>
+
+class Dispatcher;
+class VmObject;
+
+#if WITH_LIB_KTRACE
+// Starts streaming records into a ring of |size| bytes, laid out as
+// ktrace_stream_header_t describes, until tracing is stopped. |event| gets
+// MX_EVENT_SIGNALED while at least |watermark| bytes are in the ring.
+status_t ktrace_stream_start(uint32_t size, uint32_t watermark,
+                             mxtl::RefPtr<Dispatcher> event, mxtl::RefPtr<VmObject>* vmo);
+// Hands the consumer whatever is left and lets go of the ring. Stopping
+// tracing also does this.
+void ktrace_stream_stop();
+#else
+static inline status_t ktrace_stream_start(uint32_t size, uint32_t watermark,
+                                           mxtl::RefPtr<Dispatcher> event,
+                                           mxtl::RefPtr<VmObject>* vmo) {
+    return MX_ERR_NOT_SUPPORTED;
+}
+static inline void ktrace_stream_stop() {}
+#endif
+#endif
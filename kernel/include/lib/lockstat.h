@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <arch/spinlock.h>
+#include <magenta/compiler.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS
+
+// Lock statistics, built when ENABLE_LOCK_STATS=true adds this module.
+//
+// Statistics are kept per lock class. A lock in the kernel's data or bss
+// is a class of its own. Any other lock, such as one inside a dispatcher
+// or VMO, is classed by the call site that acquires it, which groups the
+// locks of all objects of one kind.
+
+#if WITH_LIB_LOCKSTAT
+
+// The most locks of each kind whose hold times are tracked at once, per
+// thread for mutexes and per cpu for spin locks.
+#define LOCKSTAT_MAX_HELD 8
+
+typedef struct lockstat_held {
+    const void* lock;
+    uint32_t index;
+    lk_time_t since;
+} lockstat_held_t;
+
+// Called by mutex_acquire() once it owns |m|, with the time it first
+// found it held or 0 if it did not.
+void lockstat_mutex_acquired(const void* m, void* caller, lk_time_t contended_since);
+// Called by mutex_release() before it lets go of |m|.
+void lockstat_mutex_released(const void* m);
+
+void lockstat_spin_lock(spin_lock_t* lock);
+int lockstat_spin_trylock(spin_lock_t* lock);
+void lockstat_spin_unlock(spin_lock_t* lock);
+
+// The number of class slots, some of which may be unused.
+#define LOCKSTAT_CLASSES 512
+
+typedef struct mx_info_lock_stats mx_info_lock_stats_t;
+
+// Fills in |info| from class slot |slot|. Returns false if it is unused.
+bool lockstat_get_class(uint32_t slot, mx_info_lock_stats_t* info);
+
+// Starts or stops counting. Returns whether it was counting before.
+bool lockstat_set_enabled(bool enabled);
+
+// Zeroes the statistics of every class. Classes keep their slots, since
+// the locks held at the time still refer to them.
+void lockstat_reset(void);
+
+#endif // WITH_LIB_LOCKSTAT
+
+__END_CDECLS
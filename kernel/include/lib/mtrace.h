@@ -16,6 +16,7 @@
 #include <lib/user_copy/user_ptr.h>
 #include <magenta/compiler.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 status_t mtrace_control(uint32_t kind, uint32_t action, uint32_t options,
                         user_ptr<void> arg, uint32_t size);
@@ -24,3 +25,21 @@ status_t mtrace_control(uint32_t kind, uint32_t action, uint32_t options,
 status_t mtrace_ipt_control(uint32_t action, uint32_t options,
                             user_ptr<void> arg, uint32_t size);
 #endif
+
+status_t mtrace_profile_control(uint32_t action, uint32_t options,
+                                user_ptr<void> arg, uint32_t size);
+
+// The sampling profiler's timers set the flag of their cpu here. The arch
+// interrupt code checks it on the way out of an interrupt and, if set,
+// calls mtrace_profile_sample() with the interrupted pc and frame pointer.
+// Only a cpu itself sets or clears its flag.
+extern bool mtrace_profile_pending[SMP_MAX_CPUS];
+
+static inline bool mtrace_profile_sample_pending(uint cpu) {
+    return unlikely(__atomic_load_n(&mtrace_profile_pending[cpu], __ATOMIC_RELAXED));
+}
+
+// Must be called with interrupts disabled, but not from within the
+// interrupt handler: a |user| sample enables interrupts while it reads the
+// user's stack.
+void mtrace_profile_sample(uintptr_t pc, uintptr_t fp, bool user);
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <magenta/compiler.h>
+#include <stdbool.h>
 #include <sys/types.h>
 
 __BEGIN_CDECLS
@@ -20,4 +21,11 @@ void     platform_stop_timer(void);
 
 enum handler_return timer_tick(lk_time_t now);
 
+struct fp_32_64;
+
+// If current_time() is the counter read by mx_ticks_get() in user mode times
+// a fixed scale, stores the scale in |ns_per_tick| and returns true. The vDSO
+// then computes the time without entering the kernel.
+bool platform_user_ticks_to_nanos(struct fp_32_64* ns_per_tick);
+
 __END_CDECLS
@@ -23,6 +23,7 @@
 #include <inttypes.h>
 #include <kernel/thread.h>
 #include <kernel/sched.h>
+#include <platform.h>
 #include <trace.h>
 
 #define LOCAL_TRACE 0
@@ -72,15 +73,26 @@ void mutex_acquire(mutex_t *m) TA_NO_THREAD_SAFETY_ANALYSIS
 
     thread_t *ct = get_current_thread();
     uintptr_t oldval;
+#if WITH_LIB_LOCKSTAT
+    lk_time_t contended_since = 0;
+#endif
 
 retry:
     // fast path: assume its unheld, try to grab it
     oldval = 0;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct))) {
         // acquired it cleanly
+#if WITH_LIB_LOCKSTAT
+        lockstat_mutex_acquired(m, __GET_CALLER(), contended_since);
+#endif
         return;
     }
 
+#if WITH_LIB_LOCKSTAT
+    if (contended_since == 0)
+        contended_since = current_time();
+#endif
+
 #if LK_DEBUGLEVEL > 0
     if (unlikely(ct == mutex_holder(m)))
         panic("mutex_acquire: thread %p (%s) tried to acquire mutex %p it already owns.\n",
@@ -117,6 +129,10 @@ retry:
     DEBUG_ASSERT(ct == mutex_holder(m));
 
     THREAD_UNLOCK(state);
+
+#if WITH_LIB_LOCKSTAT
+    lockstat_mutex_acquired(m, __GET_CALLER(), contended_since);
+#endif
 }
 
 // shared implementation of release
@@ -126,6 +142,10 @@ static inline void mutex_release_internal(mutex_t *m, bool reschedule, bool thre
     thread_t *ct = get_current_thread();
     uintptr_t oldval;
 
+#if WITH_LIB_LOCKSTAT
+    lockstat_mutex_released(m);
+#endif
+
     // in case there's no contention, try the fast path
     oldval = (uintptr_t)ct;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, 0))) {
@@ -44,11 +44,18 @@ static uint32_t run_queue_bitmap;
 /* make sure the bitmap is large enough to cover our number of priorities */
 static_assert(NUM_PRIORITIES <= sizeof(run_queue_bitmap) * CHAR_BIT, "");
 
+/* the thread each cpu has chosen to switch to directly, consumed by the next
+ * call to sched_get_top_thread() on that cpu. protected by THREAD_LOCK. */
+static thread_t *handoff_next[SMP_MAX_CPUS];
+
 /* compute the effective priority of a thread */
 static int effec_priority(const thread_t *t)
 {
     int ep = t->base_priority + t->priority_boost;
     DEBUG_ASSERT(ep >= LOWEST_PRIORITY && ep <= HIGHEST_PRIORITY);
+    /* never run below a thread waiting for us to release a futex */
+    if (unlikely(t->inherited_priority > ep))
+        ep = t->inherited_priority;
     return ep;
 }
 
@@ -189,15 +196,99 @@ static void insert_in_run_queue_tail(thread_t *t)
     run_queue_bitmap |= (1u << ep);
 }
 
+/* the highest priority run queue with a thread in it */
+static uint top_run_queue(uint32_t bitmap)
+{
+    return HIGHEST_PRIORITY - __builtin_clz(bitmap)
+           - (sizeof(run_queue_bitmap) * CHAR_BIT - NUM_PRIORITIES);
+}
+
+/* directed handoff support, see thread_handoff_begin() */
+
+/* if the current thread has a handoff pending without a target yet, make
+ * |t| the target and hold off on waking another cpu for it */
+static bool handoff_capture(thread_t *t)
+{
+    /* wakeups from interrupt context have nothing to do with the current thread */
+    if (arch_in_int_handler())
+        return false;
+
+    thread_t *current_thread = get_current_thread();
+    if (likely(!current_thread->handoff_pending) || current_thread->handoff_target)
+        return false;
+
+    if (t->pinned_cpu >= 0 && (uint)t->pinned_cpu != arch_curr_cpu_num())
+        return false;
+
+    current_thread->handoff_target = t;
+    return true;
+}
+
+/* complete the current thread's pending handoff, if any.
+ *
+ * If |take| is set and the target is still in the run queue at the highest
+ * runnable priority, remove it from the queue and return it. If it is still
+ * queued but not taken, wake a cpu for it as sched_unblock() would have.
+ *
+ * The target may have been picked up by another cpu, and may even have
+ * exited, since it was captured, so it is only dereferenced once it has
+ * been found in the run queue.
+ */
+static thread_t *handoff_finish(bool take, uint cpu)
+{
+    thread_t *current_thread = get_current_thread();
+    thread_t *target = current_thread->handoff_target;
+
+    current_thread->handoff_pending = false;
+    current_thread->handoff_target = NULL;
+
+    if (!target)
+        return NULL;
+
+    uint32_t local_run_queue_bitmap = run_queue_bitmap;
+    bool top = true;
+    while (local_run_queue_bitmap) {
+        uint queue = top_run_queue(local_run_queue_bitmap);
+
+        thread_t *t;
+        list_for_every_entry(&run_queue[queue], t, thread_t, queue_node) {
+            if (t != target)
+                continue;
+
+            if (take && top && (t->pinned_cpu < 0 || (uint)t->pinned_cpu == cpu)) {
+                list_delete(&t->queue_node);
+                if (list_is_empty(&run_queue[queue]))
+                    run_queue_bitmap &= ~(1u << queue);
+
+                LOCAL_KTRACE2("sched_handoff", t->priority_boost, t->base_priority);
+                return t;
+            }
+
+            mp_reschedule(find_cpu(t), 0);
+            return NULL;
+        }
+
+        local_run_queue_bitmap &= ~(1u << queue);
+        top = false;
+    }
+    return NULL;
+}
+
 thread_t *sched_get_top_thread(uint cpu)
 {
     thread_t *newthread;
     uint32_t local_run_queue_bitmap = run_queue_bitmap;
 
+    /* a thread chosen by directed handoff takes precedence */
+    if (unlikely(handoff_next[cpu])) {
+        newthread = handoff_next[cpu];
+        handoff_next[cpu] = NULL;
+        return newthread;
+    }
+
     while (local_run_queue_bitmap) {
         /* find the first (remaining) queue with a thread in it */
-        uint next_queue = HIGHEST_PRIORITY - __builtin_clz(local_run_queue_bitmap)
-                          - (sizeof(run_queue_bitmap) * CHAR_BIT - NUM_PRIORITIES);
+        uint next_queue = top_run_queue(local_run_queue_bitmap);
 
         list_for_every_entry(&run_queue[next_queue], newthread, thread_t, queue_node) {
             if (likely(newthread->pinned_cpu < 0) || (uint)newthread->pinned_cpu == cpu) {
@@ -222,13 +313,25 @@ void sched_block(void)
 {
     DEBUG_ASSERT(spin_lock_held(&thread_lock));
 
-    __UNUSED thread_t *current_thread = get_current_thread();
+    thread_t *current_thread = get_current_thread();
 
     DEBUG_ASSERT(current_thread->magic == THREAD_MAGIC);
     DEBUG_ASSERT(current_thread->state != THREAD_RUNNING);
 
     LOCAL_KTRACE0("sched_block");
 
+    if (unlikely(current_thread->handoff_pending)) {
+        uint cpu = arch_curr_cpu_num();
+        thread_t *t = handoff_finish(true, cpu);
+        if (t) {
+            /* switch straight to the thread we woke, donating the rest of our time slice */
+            t->remaining_time_slice = MAX(t->remaining_time_slice,
+                                          current_thread->remaining_time_slice);
+            current_thread->remaining_time_slice = 0;
+            handoff_next[cpu] = t;
+        }
+    }
+
     /* we are blocking on something. the blocking code should have already stuck us on a queue */
     _thread_resched_internal();
 }
@@ -248,6 +351,9 @@ void sched_unblock(thread_t *t)
     t->state = THREAD_READY;
     insert_in_run_queue_head(t);
 
+    if (handoff_capture(t))
+        return;
+
     mp_reschedule(find_cpu(t), 0);
 }
 
@@ -271,6 +377,9 @@ void sched_unblock_list(struct list_node *list)
         t->state = THREAD_READY;
         insert_in_run_queue_head(t);
 
+        if (handoff_capture(t))
+            continue;
+
         mp_reschedule(find_cpu(t), 0);
     }
 }
@@ -346,6 +455,93 @@ void sched_reschedule(void)
     _thread_resched_internal();
 }
 
+/* the current thread switches to the target of its pending handoff, staying runnable */
+void sched_handoff_yield(void)
+{
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    thread_t *current_thread = get_current_thread();
+    uint cpu = arch_curr_cpu_num();
+
+    LOCAL_KTRACE0("sched_handoff_yield");
+
+    thread_t *t = handoff_finish(true, cpu);
+    if (!t) {
+        sched_reschedule();
+        return;
+    }
+
+    current_thread->state = THREAD_READY;
+
+    if (likely(!thread_is_idle(current_thread))) {
+        deboost_thread(current_thread, false);
+
+        if (current_thread->remaining_time_slice > 0) {
+            insert_in_run_queue_head(current_thread);
+        } else {
+            insert_in_run_queue_tail(current_thread);
+        }
+
+        /* let an idle cpu pick us up rather than wait for the target to block */
+        mp_cpu_mask_t idle_cpu_mask = mp_get_idle_mask() & ~(1u << cpu);
+        if (idle_cpu_mask)
+            mp_reschedule(rand_cpu(idle_cpu_mask), 0);
+    }
+
+    handoff_next[cpu] = t;
+    _thread_resched_internal();
+}
+
+/* the current thread abandons its pending handoff */
+void sched_handoff_end(void)
+{
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    LOCAL_KTRACE0("sched_handoff_end");
+
+    handoff_finish(false, arch_curr_cpu_num());
+}
+
+int sched_effective_priority(const thread_t *t)
+{
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    return effec_priority(t);
+}
+
+/* change the priority |t| inherits from the threads blocked on it. if it is
+ * waiting to run it moves to its new run queue, and a cpu is kicked if it
+ * went up */
+void sched_inherit_priority(thread_t *t, int priority)
+{
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+    DEBUG_ASSERT(priority >= LOWEST_PRIORITY && priority <= HIGHEST_PRIORITY);
+
+    if (t->inherited_priority == priority)
+        return;
+
+    if (unlikely(thread_is_idle(t)))
+        return;
+
+    LOCAL_KTRACE2("sched_inherit", t->inherited_priority, priority);
+
+    int old_ep = effec_priority(t);
+    bool queued = (t->state == THREAD_READY) && list_in_list(&t->queue_node);
+    if (queued) {
+        list_delete(&t->queue_node);
+        if (list_is_empty(&run_queue[old_ep]))
+            run_queue_bitmap &= ~(1u << old_ep);
+    }
+
+    t->inherited_priority = priority;
+
+    if (queued) {
+        insert_in_run_queue_head(t);
+        if (effec_priority(t) > old_ep)
+            mp_reschedule(find_cpu(t), 0);
+    }
+}
+
 void sched_init_early(void)
 {
     /* initialize the run queues */
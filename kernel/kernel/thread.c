@@ -63,6 +63,71 @@ spin_lock_t thread_lock = SPIN_LOCK_INITIAL_VALUE;
 static int idle_thread_routine(void *) __NO_RETURN;
 static void thread_exit_locked(thread_t *current_thread, int retcode) __NO_RETURN;
 static void thread_do_suspend(void);
+/**
+ * @brief Start a directed handoff
+ *
+ * The next thread woken by the current thread is held on this cpu and
+ * switched to directly when the current thread blocks or calls
+ * thread_handoff_yield(). See thread.h.
+ */
+void thread_handoff_begin(void)
+{
+    thread_t *current_thread = get_current_thread();
+
+    DEBUG_ASSERT(current_thread->magic == THREAD_MAGIC);
+    DEBUG_ASSERT(!arch_in_int_handler());
+
+    /* only ever touched by the owning thread, outside of interrupt context.
+     * A handoff that is already pending keeps its target: the wakeup of a
+     * captured thread has been held back, so dropping it here would leave
+     * that thread queued without anyone to switch to it. This happens when
+     * one mx_channel_write_many() replies to several calls. */
+    if (current_thread->handoff_pending)
+        return;
+    current_thread->handoff_pending = true;
+    current_thread->handoff_target = NULL;
+}
+
+/**
+ * @brief Switch to the thread woken during a directed handoff
+ *
+ * The current thread stays runnable. If no thread was woken, or it cannot
+ * be switched to directly, this behaves like thread_reschedule().
+ */
+void thread_handoff_yield(void)
+{
+    thread_t *current_thread = get_current_thread();
+
+    DEBUG_ASSERT(current_thread->magic == THREAD_MAGIC);
+    DEBUG_ASSERT(current_thread->state == THREAD_RUNNING);
+    DEBUG_ASSERT(!arch_in_int_handler());
+
+    THREAD_LOCK(state);
+
+    sched_handoff_yield();
+
+    THREAD_UNLOCK(state);
+}
+
+/**
+ * @brief Abandon a directed handoff that was not consumed by blocking
+ *
+ * A thread woken during the handoff is sent to another cpu as usual.
+ */
+void thread_handoff_end(void)
+{
+    thread_t *current_thread = get_current_thread();
+
+    if (likely(!current_thread->handoff_pending))
+        return;
+
+    THREAD_LOCK(state);
+
+    sched_handoff_end();
+
+    THREAD_UNLOCK(state);
+}
+
 static enum handler_return thread_timer_tick(struct timer *t, lk_time_t now, void *arg);
 
 static void init_thread_struct(thread_t *t, const char *name)
@@ -945,6 +1010,10 @@ void thread_reschedule(void)
     DEBUG_ASSERT(current_thread->state == THREAD_RUNNING);
     DEBUG_ASSERT(!arch_in_int_handler());
 
+    /* we are about to hand the cpu off directly, don't get in its way */
+    if (current_thread->handoff_pending)
+        return;
+
     THREAD_LOCK(state);
 
     sched_reschedule();
@@ -1190,6 +1259,32 @@ void thread_set_priority(int priority)
     THREAD_UNLOCK(state);
 }
 
+/**
+ * @brief Return the priority the scheduler currently runs |t| at
+ *
+ * This includes any boost and any inherited priority.
+ */
+int thread_get_effective_priority(thread_t *t)
+{
+    THREAD_LOCK(state);
+    int priority = sched_effective_priority(t);
+    THREAD_UNLOCK(state);
+    return priority;
+}
+
+/**
+ * @brief Set the priority |t| inherits from the threads blocked on it
+ *
+ * The thread runs at no lower than |priority| until this is called again.
+ * Pass LOWEST_PRIORITY to drop the inherited priority.
+ */
+void thread_set_inherited_priority(thread_t *t, int priority)
+{
+    THREAD_LOCK(state);
+    sched_inherit_priority(t, priority);
+    THREAD_UNLOCK(state);
+}
+
 /**
  * @brief  Become an idle thread
  *
@@ -1331,9 +1426,9 @@ void dump_thread(thread_t *t, bool full_dump)
     if (full_dump) {
         dprintf(INFO, "dump_thread: t %p (%s:%s)\n", t, oname, t->name);
         dprintf(INFO, "\tstate %s, last_cpu %u, pinned_cpu %d, priority %d:%d, "
-                "remaining time slice %" PRIu64 "\n",
+                "inherited priority %d, remaining time slice %" PRIu64 "\n",
                 thread_state_to_str(t->state), t->last_cpu, t->pinned_cpu, t->base_priority,
-                t->priority_boost, t->remaining_time_slice);
+                t->priority_boost, t->inherited_priority, t->remaining_time_slice);
         dprintf(INFO, "\truntime_ns %" PRIu64 ", runtime_s %" PRIu64 "\n",
                 runtime, runtime / 1000000000);
         dprintf(INFO, "\tstack %p, stack_size %zu\n", t->stack, t->stack_size);
@@ -590,7 +590,7 @@ size_t VmAspace::AllocatedPages() const {
 void VmAspace::InitializeAslr() {
     aslr_enabled_ = is_user() && !cmdline_get_bool("aslr.disable", false);
 
-    crypto::GlobalPRNG::GetInstance()->Draw(aslr_seed_, sizeof(aslr_seed_));
+    crypto::GlobalPRNG::Draw(aslr_seed_, sizeof(aslr_seed_));
     aslr_prng_.AddEntropy(aslr_seed_, sizeof(aslr_seed_));
 }
 
@@ -88,6 +88,12 @@ void VmObject::set_user_id(uint64_t user_id) {
     user_id_ = user_id;
 }
 
+void VmObject::set_kernel_owned() {
+    canary_.Assert();
+    AutoLock a(&lock_);
+    kernel_owned_ = true;
+}
+
 uint64_t VmObject::user_id() const {
     canary_.Assert();
     AutoLock a(&lock_);
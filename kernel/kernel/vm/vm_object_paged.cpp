@@ -627,6 +627,84 @@ status_t VmObjectPaged::DecommitRange(uint64_t offset, uint64_t len, uint64_t* d
     return MX_OK;
 }
 
+status_t VmObjectPaged::TakePages(uint64_t offset, uint64_t len, list_node* pages) {
+    canary_.Assert();
+    LTRACEF("offset %#" PRIx64 ", len %#" PRIx64 "\n", offset, len);
+
+    if (!IS_PAGE_ALIGNED(offset) || !IS_PAGE_ALIGNED(len))
+        return MX_ERR_INVALID_ARGS;
+
+    AutoLock a(&lock_);
+
+    // the whole range must be within the object
+    if (unlikely(!InRange(offset, len, size_)))
+        return MX_ERR_OUT_OF_RANGE;
+    const uint64_t end = offset + len;
+
+    // pages shared with a parent or children can't be pulled out from under them
+    if (parent_ || children_list_len_ > 0)
+        return MX_ERR_NOT_SUPPORTED;
+
+    // the kernel writes through its own mapping of these pages
+    if (kernel_owned_)
+        return MX_ERR_BAD_STATE;
+
+    // every page must be present and unpinned
+    size_t count = 0;
+    page_list_.ForEveryPageInRange(
+            [&count](const auto p, uint64_t off) {
+                if (p->object.pin_count > 0)
+                    return MX_ERR_STOP;
+                count++;
+                return MX_ERR_NEXT;
+            }, offset, end);
+    if (count != len / PAGE_SIZE)
+        return MX_ERR_BAD_STATE;
+
+    // unmap all of the pages in this range on all the mapping regions
+    RangeChangeUpdateLocked(offset, len);
+
+    for (uint64_t off = offset; off < end; off += PAGE_SIZE) {
+        vm_page_t* p = page_list_.RemovePage(off);
+        DEBUG_ASSERT(p && p->state == VM_PAGE_STATE_OBJECT);
+        p->state = VM_PAGE_STATE_ALLOC;
+        list_add_tail(pages, &p->free.node);
+    }
+
+    return MX_OK;
+}
+
+status_t VmObjectPaged::SupplyPages(uint64_t offset, uint64_t len, list_node* pages) {
+    canary_.Assert();
+    LTRACEF("offset %#" PRIx64 ", len %#" PRIx64 "\n", offset, len);
+
+    if (!IS_PAGE_ALIGNED(offset) || !IS_PAGE_ALIGNED(len) || list_length(pages) < len / PAGE_SIZE)
+        return MX_ERR_INVALID_ARGS;
+
+    AutoLock a(&lock_);
+
+    if (unlikely(!InRange(offset, len, size_)))
+        return MX_ERR_OUT_OF_RANGE;
+    const uint64_t end = offset + len;
+
+    if (kernel_owned_ || AnyPagesPinnedLocked(offset, len))
+        return MX_ERR_BAD_STATE;
+
+    // unmap all of the pages in this range on all the mapping regions
+    RangeChangeUpdateLocked(offset, len);
+
+    for (uint64_t off = offset; off < end; off += PAGE_SIZE) {
+        page_list_.FreePage(off);
+
+        vm_page_t* p = list_remove_head_type(pages, vm_page_t, free.node);
+        InitializeVmPage(p);
+        __UNUSED status_t status = page_list_.AddPage(p, off);
+        DEBUG_ASSERT(status == MX_OK);
+    }
+
+    return MX_OK;
+}
+
 status_t VmObjectPaged::Pin(uint64_t offset, uint64_t len) {
     canary_.Assert();
 
@@ -6,13 +6,16 @@
 
 #include <lib/crypto/global_prng.h>
 
+#include <arch/ops.h>
 #include <assert.h>
 #include <ctype.h>
 #include <err.h>
 #include <explicit-memory/bytes.h>
 #include <kernel/auto_lock.h>
 #include <kernel/cmdline.h>
+#include <kernel/mp.h>
 #include <kernel/mutex.h>
+#include <kernel/spinlock.h>
 #include <lib/crypto/cryptolib.h>
 #include <lib/crypto/entropy/collector.h>
 #include <lib/crypto/entropy/hw_rng_collector.h>
@@ -21,6 +24,8 @@
 #include <mxcpp/new.h>
 #include <mxtl/algorithm.h>
 #include <lk/init.h>
+#include <openssl/chacha.h>
+#include <platform.h>
 #include <string.h>
 
 namespace crypto {
@@ -34,6 +39,81 @@ PRNG* GetInstance() {
     return kGlobalPrng;
 }
 
+// How long a cpu's generator may go without being reseeded from its parent,
+// even if no entropy has been added to it.
+static constexpr lk_time_t kReseedInterval = LK_SEC(60);
+
+static_assert(sizeof(CpuGenerators::Generator::key) == clSHA256_DIGEST_SIZE, "");
+
+// Set once the global PRNG is thread-safe; until then Draw goes straight to
+// it.
+static CpuGenerators* cpu_generators = nullptr;
+
+void CpuGenerators::Reseed() {
+    // Read the count first, so that entropy added while we draw causes
+    // another reseed rather than being missed.
+    const uint64_t reseed_count = parent_->reseed_count();
+    uint8_t key[sizeof(Generator::key)];
+    parent_->Draw(key, sizeof(key));
+
+    // We may have moved since the caller looked; the key is as good for
+    // whichever cpu we are on now.
+    spin_lock_saved_state_t state;
+    arch_interrupt_save(&state, SPIN_LOCK_FLAG_INTERRUPTS);
+    Generator* gen = &generators_[arch_curr_cpu_num()];
+    memcpy(gen->key, key, sizeof(key));
+    gen->nonce = 0;
+    gen->reseed_count = reseed_count;
+    gen->reseed_deadline = current_time() + kReseedInterval;
+    gen->seeded = true;
+    arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+
+    mandatory_memset(key, 0, sizeof(key));
+}
+
+void CpuGenerators::Draw(void* out, size_t size) {
+    DEBUG_ASSERT(out || size == 0);
+    ASSERT(size < PRNG::kMaxDrawLen);
+
+    // Take a key and a nonce that no other draw will use, then generate the
+    // output with interrupts enabled.
+    uint8_t key[sizeof(Generator::key)];
+    union {
+        uint64_t u64;
+        uint8_t u8[12];
+    } nonce = {};
+    for (;;) {
+        spin_lock_saved_state_t state;
+        arch_interrupt_save(&state, SPIN_LOCK_FLAG_INTERRUPTS);
+        Generator* gen = &generators_[arch_curr_cpu_num()];
+        if (likely(gen->seeded &&
+                   gen->reseed_count == parent_->reseed_count() &&
+                   gen->nonce != UINT64_MAX &&
+                   current_time() < gen->reseed_deadline)) {
+            memcpy(key, gen->key, sizeof(key));
+            nonce.u64 = gen->nonce++;
+            arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+            break;
+        }
+        arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+        Reseed();
+    }
+
+    uint8_t* buf = static_cast<uint8_t*>(out);
+    memset(buf, 0, size);
+    CRYPTO_chacha_20(buf, buf, size, key, nonce.u8, 0);
+    mandatory_memset(key, 0, sizeof(key));
+}
+
+void Draw(void* out, size_t size) {
+    CpuGenerators* gens = __atomic_load_n(&cpu_generators, __ATOMIC_ACQUIRE);
+    if (unlikely(gens == nullptr)) {
+        GetInstance()->Draw(out, size);
+        return;
+    }
+    gens->Draw(out, size);
+}
+
 // Returns true if the kernel cmdline provided at least PRNG::kMinEntropy bytes
 // of entropy, and false otherwise.
 //
@@ -140,6 +220,11 @@ static void EarlyBootSeed(uint level) {
 // Migrate the global PRNG to enter thread-safe mode.
 static void BecomeThreadSafe(uint level) {
     GetInstance()->BecomeThreadSafe();
+
+    // As with the global PRNG, the generators are constructed in place.
+    alignas(alignof(CpuGenerators))static uint8_t generators_space[sizeof(CpuGenerators)];
+    __atomic_store_n(&cpu_generators, new (&generators_space) CpuGenerators(GetInstance()),
+                     __ATOMIC_RELEASE);
 }
 
 } //namespace GlobalPRNG
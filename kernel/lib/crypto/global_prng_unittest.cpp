@@ -7,6 +7,7 @@
 #include <lib/crypto/global_prng.h>
 
 #include <stdint.h>
+#include <string.h>
 #include <unittest.h>
 
 namespace crypto {
@@ -24,10 +25,53 @@ bool identical(void*) {
     END_TEST;
 }
 
+bool cpu_draws_differ(void*) {
+    BEGIN_TEST;
+
+    static const size_t kDrawSize = 32;
+    uint8_t out1[kDrawSize];
+    uint8_t out2[kDrawSize];
+    GlobalPRNG::Draw(out1, sizeof(out1));
+    GlobalPRNG::Draw(out2, sizeof(out2));
+    EXPECT_NE(0, memcmp(out1, out2, sizeof(out1)), "repeated output");
+
+    END_TEST;
+}
+
+bool cpu_draws_reseed(void*) {
+    BEGIN_TEST;
+
+    // A PRNG of our own, so that the global one is left alone.
+    static const uint8_t kSeed[PRNG::kMinEntropy] = {'a', 'b', 'c'};
+    static const uint8_t kEntropy[PRNG::kMinEntropy] = {'1', '2', '3'};
+    PRNG prng(kSeed, sizeof(kSeed));
+    GlobalPRNG::CpuGenerators gens(&prng);
+
+    static const size_t kDrawSize = 32;
+    uint8_t out1[kDrawSize];
+    uint8_t out2[kDrawSize];
+    gens.Draw(out1, sizeof(out1));
+    gens.Draw(out2, sizeof(out2));
+    EXPECT_NE(0, memcmp(out1, out2, sizeof(out1)), "repeated output");
+
+    // Adding entropy makes the cpu generators reseed; draws must still work
+    // and differ afterwards.
+    const uint64_t reseed_count = prng.reseed_count();
+    prng.AddEntropy(kEntropy, sizeof(kEntropy));
+    EXPECT_GT(prng.reseed_count(), reseed_count, "reseed not counted");
+
+    gens.Draw(out1, sizeof(out1));
+    EXPECT_NE(0, memcmp(out1, out2, sizeof(out1)), "repeated output");
+
+    END_TEST;
+}
+
 } // namespace
 
 UNITTEST_START_TESTCASE(global_prng_tests)
 UNITTEST("Identical", identical)
+UNITTEST("CpuDrawsDiffer", cpu_draws_differ)
+UNITTEST("CpuDrawsReseed", cpu_draws_reseed)
 UNITTEST_END_TESTCASE(global_prng_tests, "global_prng",
                       "Validate global PRNG singleton",
                       nullptr, nullptr);
@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <arch/ops.h>
 #include <lib/crypto/prng.h>
+#include <sys/types.h>
 
 namespace crypto {
 
@@ -16,6 +18,50 @@ namespace GlobalPRNG {
 // guaranteed to be non-null.
 PRNG* GetInstance();
 
+// Fills |out| with |size| bytes of pseudo-random output from a generator
+// kept for the calling cpu.  Each cpu's generator is seeded from the global
+// PRNG, and reseeded when entropy is added to it and at least once a
+// minute, so draws do not contend on the global PRNG's lock.  Blocks
+// like PRNG::Draw until the global PRNG has been seeded with
+// PRNG::kMinEntropy bytes.  Must be called from thread context.
+void Draw(void* out, size_t size);
+
+// A ChaCha20 generator for each cpu, each seeded from |parent| and reseeded
+// when entropy is added to it and at least once a minute.  Draw() uses a set
+// seeded from the global PRNG; tests can make their own.
+class CpuGenerators {
+public:
+    explicit CpuGenerators(PRNG* parent) : parent_(parent) {}
+
+    // Fills |out| with |size| bytes from the calling cpu's generator.  Blocks
+    // like PRNG::Draw until |parent| has been seeded.  Must be called from
+    // thread context.
+    void Draw(void* out, size_t size);
+
+    // Only touched by its own cpu with interrupts disabled, which is what
+    // makes it safe without a lock.
+    struct Generator {
+        uint8_t key[32];
+        // The low 8 bytes of the ChaCha20 nonce; the rest are zero.  Each
+        // key is only used for as many draws as this can count.
+        uint64_t nonce;
+        // The parent's reseed_count() when |key| was drawn from it.
+        uint64_t reseed_count;
+        lk_time_t reseed_deadline;
+        bool seeded;
+    } __CPU_ALIGN;
+
+private:
+    CpuGenerators(const CpuGenerators&) = delete;
+    CpuGenerators& operator=(const CpuGenerators&) = delete;
+
+    // Gives the current cpu's generator a new key drawn from |parent_|.
+    void Reseed();
+
+    PRNG* const parent_;
+    Generator generators_[SMP_MAX_CPUS] = {};
+};
+
 } //namespace GlobalPRNG
 
 } // namespace crypto
@@ -11,6 +11,7 @@
 
 #include <kernel/event.h>
 #include <lib/crypto/cryptolib.h>
+#include <mxtl/atomic.h>
 #include <mxtl/mutex.h>
 
 namespace crypto {
@@ -55,6 +56,12 @@ public:
     // Inspect if this PRNG is threadsafe.  Only really useful for test code.
     bool is_thread_safe() const { return is_thread_safe_; }
 
+    // The number of times AddEntropy has been called.  Generators seeded from
+    // this PRNG's output compare it to tell when they should reseed.
+    uint64_t reseed_count() const {
+        return reseed_count_.load(mxtl::memory_order_acquire);
+    }
+
     // The minimum amount of entropy (in bytes) the generator requires before
     // Draw will return data.
     static constexpr uint64_t kMinEntropy = 32;
@@ -98,6 +105,7 @@ private:
     bool is_thread_safe_;
     mxtl::Mutex lock_;
     uint64_t total_entropy_added_;
+    mxtl::atomic<uint64_t> reseed_count_;
     event_t ready_;
 };
 
@@ -24,7 +24,7 @@ PRNG::PRNG(const void* data, size_t size)
 }
 
 PRNG::PRNG(const void* data, size_t size, NonThreadSafeTag tag)
-    : is_thread_safe_(false), lock_(), total_entropy_added_(0) {
+    : is_thread_safe_(false), lock_(), total_entropy_added_(0), reseed_count_(0) {
     memset(key_, 0, sizeof(key_));
     memset(nonce_.u8, 0, sizeof(nonce_.u8));
     AddEntropy(data, size);
@@ -60,6 +60,7 @@ void PRNG::AddEntropyInternal(const void* data, size_t size) {
     static_assert(clSHA256_DIGEST_SIZE <= sizeof(key_), "key too small");
     memcpy(key_, clHASH_final(&ctx), clSHA256_DIGEST_SIZE);
     total_entropy_added_ += size;
+    reseed_count_.fetch_add(1, mxtl::memory_order_release);
 }
 
 void PRNG::Draw(void* out, size_t size) {
@@ -8,6 +8,7 @@
 
 #include <err.h>
 #include <dev/udisplay.h>
+#include <kernel/atomic.h>
 #include <kernel/spinlock.h>
 #include <kernel/thread.h>
 #include <lib/user_copy.h>
@@ -17,56 +18,58 @@
 #include <platform.h>
 #include <string.h>
 
-#define DLOG_SIZE (128u * 1024u)
-#define DLOG_MASK (DLOG_SIZE - 1u)
+#define DLOG_SLOT_MASK (DLOG_SLOTS - 1u)
 
-static_assert((DLOG_SIZE & DLOG_MASK) == 0u, "must be power of two");
-static_assert(DLOG_MAX_RECORD <= DLOG_SIZE, "wat");
+static_assert((DLOG_SLOTS & DLOG_SLOT_MASK) == 0u, "must be power of two");
 static_assert((DLOG_MAX_RECORD & 3) == 0, "E_DONT_DO_THAT");
+static_assert(sizeof(const char*) + DLOG_MAX_ARGS * sizeof(uint64_t) <= DLOG_MAX_DATA, "");
+static_assert(sizeof(long) == sizeof(uint64_t), "");
 
-static uint8_t DLOG_DATA[DLOG_SIZE];
+// The debug log is a ring of DLOG_SLOTS fixed size slots, each holding
+// one record. Writers never wait for each other or for readers:
+//
+// - a writer reserves record n by atomically incrementing the head,
+//   which puts it in slot n % DLOG_SLOTS, overwriting the oldest record
+// - it claims the slot by moving the slot's sequence word forward to
+//   2n+1 while it fills the slot in, and commits it by setting the word
+//   to 2n+2; if a newer record already claimed the slot, record n is
+//   dropped, and likewise if one claims it before the commit
+//
+// Interrupts are disabled from reserving a slot to committing it, so
+// a slot is never left half written for long. A reader that reaches a
+// slot that is not yet committed stops there and picks the record up on
+// the next notification, which the commit triggers. A reader checks the
+// sequence word again after copying a record out, and drops the record
+// if a writer lapped it meanwhile.
+//
+// A record either holds text or, if |num_args| is not zero, a format
+// string pointer followed by its arguments, which are formatted when
+// the record is read.
+struct dlog_slot {
+    uint64_t seq;
+    uint16_t datalen;
+    uint16_t flags;
+    uint32_t num_args;
+    uint64_t timestamp;
+    uint64_t pid;
+    uint64_t tid;
+    uint8_t data[DLOG_MAX_DATA];
+};
+
+static dlog_slot_t DLOG_DATA[DLOG_SLOTS];
 
 static dlog_t DLOG = {
-    .lock = SPIN_LOCK_INITIAL_VALUE,
     .head = 0,
-    .tail = 0,
-    .data = DLOG_DATA,
+    .slots = DLOG_DATA,
     .event = EVENT_INITIAL_VALUE(DLOG.event, 0, EVENT_FLAG_AUTOUNSIGNAL),
 
     .readers_lock = MUTEX_INITIAL_VALUE(DLOG.readers_lock),
     .readers = LIST_INITIAL_VALUE(DLOG.readers),
 };
 
-// The debug log maintains a circular buffer of debug log records,
-// consisting of a common header (dlog_header_t) followed by up
-// to 224 bytes of textual log message.  Records are aligned on
-// uint32_t boundaries, so the header word which indicates the
-// true size of the record and the space it takes in the fifo
-// can always be read with a single uint32_t* read (the header
-// or body may wrap but the initial header word never does).
-//
-// The ring buffer position is maintained by continuously incrementing
-// head and tail pointers (type size_t, so uint64_t on 64bit systems),
-//
-// This allows readers to trivial compute if their local tail
-// pointer has "fallen out" of the fifo (an entire fifo's worth
-// of messages were written since they last tried to read) and then
-// they can snap their tail to the global tail and restart
-//
-//
-// Tail indicates the oldest message in the debug log to read
-// from, Head indicates the next space in the debug log to write
-// a new message to.  They are clipped to the actual buffer by
-// DLOG_MASK.
-//
-//       T                     T
-//  [....XXXX....]  [XX........XX]
-//           H         H
-
-
 #define ALIGN4(n) (((n) + 3) & (~3))
 
-status_t dlog_write(uint32_t flags, const void* ptr, size_t len) {
+static status_t dlog_write_etc(uint32_t flags, uint32_t num_args, const void* ptr, size_t len) {
     dlog_t* log = &DLOG;
 
     if (len > DLOG_MAX_DATA) {
@@ -77,70 +80,293 @@ status_t dlog_write(uint32_t flags, const void* ptr, size_t len) {
         return MX_ERR_BAD_STATE;
     }
 
-    // Our size "on the wire" must be a multiple of 4, so we know
-    // that worst case there will be room for a header skipping
-    // the last n bytes when the fifo wraps
-    size_t wiresize = DLOG_MIN_RECORD + ALIGN4(len);
-
-    // Prepare the record header before taking the lock
-    dlog_header_t hdr;
-    hdr.header = DLOG_HDR_SET(wiresize, DLOG_MIN_RECORD + len);
-    hdr.datalen = len;
-    hdr.flags = flags;
-    hdr.timestamp = current_time();
+    lk_time_t now = current_time();
     thread_t *t = get_current_thread();
-    if (t) {
-        hdr.pid = t->user_pid;
-        hdr.tid = t->user_tid;
+
+    spin_lock_saved_state_t state;
+    arch_interrupt_save(&state, SPIN_LOCK_FLAG_INTERRUPTS);
+
+    uint64_t n = atomic_add_u64(&log->head, 1);
+    dlog_slot_t* slot = &log->slots[n & DLOG_SLOT_MASK];
+    uint64_t writing = 2 * n + 1;
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    do {
+        // A writer DLOG_SLOTS or more records ahead already has the
+        // slot, and it must not go back to this record.
+        if (seq >= writing) {
+            arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+            return MX_OK;
+        }
+    } while (!__atomic_compare_exchange_n(&slot->seq, &seq, writing, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    // Readers must see the slot as being written before any of it changes.
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->datalen = (uint16_t)len;
+    slot->flags = (uint16_t)flags;
+    slot->num_args = num_args;
+    slot->timestamp = now;
+    slot->pid = t ? t->user_pid : 0;
+    slot->tid = t ? t->user_tid : 0;
+    memcpy(slot->data, ptr, len);
+
+    // If DLOG_SLOTS other records were written meanwhile, the slot
+    // belongs to a newer one and this record is lost.
+    __atomic_compare_exchange_n(&slot->seq, &writing, writing + 1, false,
+                                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+
+    // Only wake the notifier if it has not already been asked to run.
+    if (atomic_swap(&log->notify_pending, 1) == 0) {
+        // if we happen to be called from within the global thread lock, use a
+        // special version of event signal
+        if (spin_lock_holder_cpu(&thread_lock) == arch_curr_cpu_num()) {
+            event_signal_thread_locked(&log->event);
+        } else {
+            event_signal(&log->event, false);
+        }
+    }
+
+    arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+
+    return MX_OK;
+}
+
+status_t dlog_write(uint32_t flags, const void* ptr, size_t len) {
+    return dlog_write_etc(flags, 0, ptr, len);
+}
+
+// The type of argument a printf conversion takes.
+enum {
+    DLOG_ARG_NONE,      // "%%"
+    DLOG_ARG_INT,       // int, or anything that is promoted to it
+    DLOG_ARG_LONG,      // long, size_t, ptrdiff_t or intmax_t
+    DLOG_ARG_LLONG,     // long long
+    DLOG_ARG_PTR,       // void*
+};
+
+// The longest conversion specification a record takes, with the '%',
+// and the most text such a conversion formats to.
+#define DLOG_MAX_SPEC (16u)
+#define DLOG_MAX_CONV_TEXT (32u)
+
+// Parses the conversion specification that starts with the '%' at |fmt|.
+// Returns its length and sets |kind| to the argument it takes, or returns
+// zero if a record can't hold it: strings, floating point, '*' widths and
+// widths or precisions over 24 are left to printf().
+static size_t dlog_parse_conversion(const char* fmt, int* kind) {
+    const char* p = fmt + 1;
+    if (*p == '%') {
+        *kind = DLOG_ARG_NONE;
+        return 2;
+    }
+
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        p++;
+    }
+    // width, then precision
+    for (int i = 0; i < 2; i++) {
+        if (i == 1) {
+            if (*p != '.') {
+                break;
+            }
+            p++;
+        }
+        unsigned n = 0;
+        while (*p >= '0' && *p <= '9') {
+            n = n * 10 + (unsigned)(*p++ - '0');
+            if (n > 24) {
+                return 0;
+            }
+        }
+    }
+
+    int k = DLOG_ARG_INT;
+    bool modified = true;
+    if (p[0] == 'h') {
+        p += (p[1] == 'h') ? 2 : 1;
+    } else if (p[0] == 'l' && p[1] == 'l') {
+        k = DLOG_ARG_LLONG;
+        p += 2;
+    } else if (p[0] == 'l' || p[0] == 'z' || p[0] == 'j' || p[0] == 't') {
+        k = DLOG_ARG_LONG;
+        p++;
     } else {
-        hdr.pid = 0;
-        hdr.tid = 0;
+        modified = false;
     }
 
-    spin_lock_saved_state_t state;
-    spin_lock_irqsave(&log->lock, state);
+    switch (*p++) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        break;
+    case 'c':
+        if (modified) {
+            return 0;
+        }
+        break;
+    case 'p':
+        if (modified) {
+            return 0;
+        }
+        k = DLOG_ARG_PTR;
+        break;
+    default:
+        return 0;
+    }
 
-    // Discard records at tail until there is enough
-    // space for the new record.
-    while ((log->head - log->tail) > (DLOG_SIZE - wiresize)) {
-        uint32_t header = *((uint32_t*) (log->data + (log->tail & DLOG_MASK)));
-        log->tail += DLOG_HDR_GET_FIFOLEN(header);
+    if ((size_t)(p - fmt) >= DLOG_MAX_SPEC) {
+        return 0;
     }
+    *kind = k;
+    return p - fmt;
+}
 
-    size_t offset = (log->head & DLOG_MASK);
+status_t dlog_write_args(uint32_t flags, const char* fmt, const uint64_t* args, size_t num_args) {
+    if (num_args > DLOG_MAX_ARGS) {
+        return MX_ERR_OUT_OF_RANGE;
+    }
 
-    size_t fifospace = DLOG_SIZE - offset;
+    uint8_t data[sizeof(fmt) + DLOG_MAX_ARGS * sizeof(uint64_t)];
+    memcpy(data, &fmt, sizeof(fmt));
+    memcpy(data + sizeof(fmt), args, num_args * sizeof(uint64_t));
+    return dlog_write_etc(flags, (uint32_t)num_args + 1, data,
+                          sizeof(fmt) + num_args * sizeof(uint64_t));
+}
 
-    if (fifospace >= wiresize) {
-        // everything fits in one write, simple case!
-        memcpy(log->data + offset, &hdr, sizeof(hdr));
-        memcpy(log->data + offset + sizeof(hdr), ptr, len);
-    } else if (fifospace < sizeof(hdr)) {
-        // the wrap happens in the header
-        memcpy(log->data + offset, &hdr, fifospace);
-        memcpy(log->data, ((void*) &hdr) + fifospace, sizeof(hdr) - fifospace);
-        memcpy(log->data + (sizeof(hdr) - fifospace), ptr, len);
-    } else {
-        // the wrap happens in the data
-        memcpy(log->data + offset, &hdr, sizeof(hdr));
-        offset += sizeof(hdr);
-        fifospace -= sizeof(hdr);
-        memcpy(log->data + offset, ptr, fifospace);
-        memcpy(log->data, ptr + fifospace, len - fifospace);
+status_t dlog_vprintf(uint32_t flags, const char* fmt, va_list ap) {
+    uint64_t args[DLOG_MAX_ARGS];
+    size_t num_args = 0;
+    // an upper bound on the length of the formatted text
+    size_t textlen = 0;
+
+    va_list aq;
+    va_copy(aq, ap);
+    for (const char* p = fmt; *p != 0;) {
+        if (*p != '%') {
+            p++;
+            textlen++;
+            continue;
+        }
+        int kind;
+        size_t n = dlog_parse_conversion(p, &kind);
+        if (n == 0 || (kind != DLOG_ARG_NONE && num_args == DLOG_MAX_ARGS)) {
+            va_end(aq);
+            return MX_ERR_NOT_SUPPORTED;
+        }
+        p += n;
+
+        switch (kind) {
+        case DLOG_ARG_NONE:
+            textlen++;
+            continue;
+        case DLOG_ARG_INT:
+            args[num_args] = (uint64_t)(int64_t)va_arg(aq, int);
+            break;
+        case DLOG_ARG_LONG:
+            args[num_args] = (uint64_t)va_arg(aq, long);
+            break;
+        case DLOG_ARG_LLONG:
+            args[num_args] = (uint64_t)va_arg(aq, long long);
+            break;
+        case DLOG_ARG_PTR:
+            args[num_args] = (uintptr_t)va_arg(aq, void*);
+            break;
+        }
+        num_args++;
+        textlen += DLOG_MAX_CONV_TEXT;
     }
-    log->head += wiresize;
+    va_end(aq);
 
-    // if we happen to be called from within the global thread lock, use a
-    // special version of event signal
-    if (spin_lock_holder_cpu(&thread_lock) == arch_curr_cpu_num()) {
-        event_signal_thread_locked(&log->event);
-    } else {
-        event_signal(&log->event, false);
+    // The text would be cut short when the record is read.
+    if (textlen > DLOG_MAX_DATA) {
+        return MX_ERR_OUT_OF_RANGE;
     }
+    return dlog_write_args(flags, fmt, args, num_args);
+}
 
-    spin_unlock_irqrestore(&log->lock, state);
+// Formats one conversion. Its specification was checked by
+// dlog_parse_conversion(), since the compiler can't check it.
+static int dlog_format_conversion(char* out, size_t len, const char* spec, ...) {
+    va_list ap;
+    va_start(ap, spec);
+    int n = vsnprintf(out, len, spec, ap);
+    va_end(ap);
+    return n;
+}
 
-    return MX_OK;
+// Formats |fmt| with the arguments of a format string record into |out|,
+// which has room for |len| bytes. Each conversion is formatted on its own,
+// so that it is passed its argument as the type it takes. Returns the
+// length of the text.
+static size_t dlog_format_args(char* out, size_t len, const char* fmt,
+                               const uint64_t* args, size_t num_args) {
+    size_t pos = 0;
+    size_t next = 0;
+    while (*fmt != 0 && pos < len) {
+        if (*fmt != '%') {
+            out[pos++] = *fmt++;
+            continue;
+        }
+
+        int kind;
+        size_t n = dlog_parse_conversion(fmt, &kind);
+        if (n == 0 || (kind != DLOG_ARG_NONE && next == num_args)) {
+            break;
+        }
+        char spec[DLOG_MAX_SPEC];
+        memcpy(spec, fmt, n);
+        spec[n] = 0;
+        fmt += n;
+
+        char text[DLOG_MAX_CONV_TEXT + 1];
+        int m = 0;
+        switch (kind) {
+        case DLOG_ARG_NONE:
+            out[pos++] = '%';
+            continue;
+        case DLOG_ARG_INT:
+            m = dlog_format_conversion(text, sizeof(text), spec, (int)args[next]);
+            break;
+        case DLOG_ARG_LONG:
+            m = dlog_format_conversion(text, sizeof(text), spec, (long)args[next]);
+            break;
+        case DLOG_ARG_LLONG:
+            m = dlog_format_conversion(text, sizeof(text), spec, (long long)args[next]);
+            break;
+        case DLOG_ARG_PTR:
+            m = dlog_format_conversion(text, sizeof(text), spec, (void*)(uintptr_t)args[next]);
+            break;
+        }
+        next++;
+        if (m > 0) {
+            size_t copy = MIN(MIN((size_t)m, sizeof(text) - 1), len - pos);
+            memcpy(out + pos, text, copy);
+            pos += copy;
+        }
+    }
+    return pos;
+}
+
+// Turns a copy of a slot into a dlog_record_t, formatting it if it is a
+// format string record. Returns the size of the record.
+static size_t dlog_format(const dlog_slot_t* slot, dlog_record_t* rec) {
+    size_t len = slot->datalen;
+    if (slot->num_args == 0) {
+        memcpy(rec->data, slot->data, len);
+    } else {
+        const char* fmt;
+        uint64_t args[DLOG_MAX_ARGS];
+        memcpy(&fmt, slot->data, sizeof(fmt));
+        memcpy(args, slot->data + sizeof(fmt), (slot->num_args - 1) * sizeof(uint64_t));
+        len = dlog_format_args(rec->data, sizeof(rec->data), fmt, args, slot->num_args - 1);
+    }
+
+    size_t readlen = DLOG_MIN_RECORD + len;
+    rec->hdr.header = DLOG_HDR_SET(ALIGN4(readlen), readlen);
+    rec->hdr.datalen = (uint16_t)len;
+    rec->hdr.flags = slot->flags;
+    rec->hdr.timestamp = slot->timestamp;
+    rec->hdr.pid = slot->pid;
+    rec->hdr.tid = slot->tid;
+    return readlen;
 }
 
 // TODO: support reading multiple messages at a time
@@ -152,46 +378,47 @@ status_t dlog_read(dlog_reader_t* rdr, uint32_t flags, void* ptr, size_t len, si
     }
 
     dlog_t* log = rdr->log;
-    status_t status = MX_ERR_SHOULD_WAIT;
-
-    spin_lock_saved_state_t state;
-    spin_lock_irqsave(&log->lock, state);
 
-    size_t rtail = rdr->tail;
+    for (;;) {
+        uint64_t head = atomic_load_u64(&log->head);
 
-    // If the read-tail is not within the range of log-tail..log-head
-    // this reader has been lapped by a writer and we reset our read-tail
-    // to the current log-tail.
-    //
-    if ((log->head - log->tail) < (log->head - rtail)) {
-        rtail = log->tail;
-    }
+        // If the reader has been lapped by the writers, skip ahead to
+        // the oldest record still in the ring.
+        if (head - rdr->tail > DLOG_SLOTS) {
+            rdr->tail = head - DLOG_SLOTS;
+        }
 
-    if (rtail != log->head) {
-        size_t offset = (rtail & DLOG_MASK);
-        uint32_t header = *((uint32_t*) (log->data + offset));
+        if (rdr->tail == head) {
+            return MX_ERR_SHOULD_WAIT;
+        }
 
-        size_t actual = DLOG_HDR_GET_READLEN(header);
-        size_t fifospace = DLOG_SIZE - offset;
+        const dlog_slot_t* slot = &log->slots[rdr->tail & DLOG_SLOT_MASK];
+        uint64_t committed = 2 * rdr->tail + 2;
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq < committed) {
+            // Still being written.
+            return MX_ERR_SHOULD_WAIT;
+        }
 
-        if (fifospace >= actual) {
-            memcpy(ptr, log->data + offset, actual);
-        } else {
-            memcpy(ptr, log->data + offset, fifospace);
-            memcpy(ptr + fifospace, log->data, actual - fifospace);
+        dlog_slot_t copy;
+        if (seq == committed) {
+            memcpy(&copy, slot, sizeof(copy));
+            // The copy is only good if the slot was not reused during it.
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        }
+        if (seq != committed) {
+            // Lapped while we looked.
+            continue;
         }
 
+        rdr->tail++;
+        dlog_record_t rec;
+        size_t actual = dlog_format(&copy, &rec);
+        memcpy(ptr, &rec, actual);
         *_actual = actual;
-        status = MX_OK;
-
-        rtail += DLOG_HDR_GET_FIFOLEN(header);
+        return MX_OK;
     }
-
-    rdr->tail = rtail;
-
-    spin_unlock_irqrestore(&log->lock, state);
-
-    return status;
 }
 
 void dlog_reader_init(dlog_reader_t* rdr, void (*notify)(void*), void* cookie) {
@@ -204,13 +431,10 @@ void dlog_reader_init(dlog_reader_t* rdr, void (*notify)(void*), void* cookie) {
     mutex_acquire(&log->readers_lock);
     list_add_tail(&log->readers, &rdr->node);
 
-    bool do_notify = false;
-
-    spin_lock_saved_state_t state;
-    spin_lock_irqsave(&log->lock, state);
-    rdr->tail = log->tail;
-    do_notify = (log->tail != log->head);
-    spin_unlock_irqrestore(&log->lock, state);
+    // start from the oldest record still in the ring
+    uint64_t head = atomic_load_u64(&log->head);
+    rdr->tail = (head > DLOG_SLOTS) ? head - DLOG_SLOTS : 0;
+    bool do_notify = (rdr->tail != head);
 
     // simulate notify callback for events that arrived
     // before we were initialized
@@ -239,6 +463,10 @@ static int debuglog_notifier(void* arg) {
     for (;;) {
         event_wait(&log->event);
 
+        // records written from here on need another wakeup; the ones
+        // written since the last one are all handled by this pass
+        atomic_store(&log->notify_pending, 0);
+
         // notify readers that new log items were posted
         mutex_acquire(&log->readers_lock);
         dlog_reader_t* rdr;
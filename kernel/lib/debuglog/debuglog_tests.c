@@ -0,0 +1,241 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/debuglog.h>
+
+#include <err.h>
+#include <kernel/atomic.h>
+#include <kernel/thread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unittest.h>
+
+#define TEST_PREFIX "dlog-test "
+#define NUM_WRITERS 2u
+
+static status_t write_record(uint32_t writer, uint32_t index) {
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), TEST_PREFIX "%u %u\n", writer, index);
+    return dlog_write(DLOG_LEVEL_INFO, buf, n);
+}
+
+static bool parse_uint(const char** s, const char* end, uint32_t* value) {
+    const char* p = *s;
+    uint32_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (uint32_t)(*p++ - '0');
+    }
+    if (p == *s) {
+        return false;
+    }
+    *s = p;
+    *value = v;
+    return true;
+}
+
+// Reads the next record written by write_record(), skipping those of
+// other writers. Returns false if there are none left, and sets |ok| to
+// false if a record was torn.
+static bool read_record(dlog_reader_t* rdr, uint32_t* writer, uint32_t* index, bool* ok) {
+    dlog_record_t rec;
+    size_t actual;
+    while (dlog_read(rdr, 0, &rec, sizeof(rec), &actual) == MX_OK) {
+        const size_t prefix = sizeof(TEST_PREFIX) - 1;
+        if (rec.hdr.datalen < prefix || memcmp(rec.data, TEST_PREFIX, prefix) != 0) {
+            continue;
+        }
+        const char* p = rec.data + prefix;
+        const char* end = rec.data + rec.hdr.datalen;
+        if (actual != DLOG_MIN_RECORD + rec.hdr.datalen ||
+            !parse_uint(&p, end, writer) || p == end || *p++ != ' ' ||
+            !parse_uint(&p, end, index) || p + 1 != end || *p != '\n') {
+            *ok = false;
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+static void drain(dlog_reader_t* rdr) {
+    dlog_record_t rec;
+    size_t actual;
+    while (dlog_read(rdr, 0, &rec, sizeof(rec), &actual) == MX_OK) {
+    }
+}
+
+// Writes more records than the log holds before reading any of them.
+static bool wraparound_test(void* context) {
+    BEGIN_TEST;
+
+    dlog_reader_t rdr;
+    dlog_reader_init(&rdr, NULL, NULL);
+    drain(&rdr);
+
+    const uint32_t count = DLOG_SLOTS + 16u;
+    for (uint32_t i = 0; i < count; i++) {
+        EXPECT_EQ(MX_OK, write_record(0, i), "");
+    }
+
+    // The oldest records were overwritten, and the reader skips ahead
+    // to the ones that are left.
+    uint32_t writer, index;
+    uint32_t seen = 0;
+    uint32_t last = 0;
+    bool ok = true;
+    while (read_record(&rdr, &writer, &index, &ok)) {
+        EXPECT_EQ(0u, writer, "");
+        if (seen == 0) {
+            EXPECT_GE(index, count - DLOG_SLOTS, "overwritten record was read");
+        } else {
+            EXPECT_EQ(last + 1, index, "records out of order");
+        }
+        last = index;
+        seen++;
+    }
+    EXPECT_TRUE(ok, "torn record");
+    EXPECT_GT(seen, 0u, "");
+    EXPECT_LE(seen, DLOG_SLOTS, "");
+    EXPECT_EQ(count - 1, last, "newest record missing");
+
+    dlog_reader_destroy(&rdr);
+    END_TEST;
+}
+
+static int writers_done;
+
+static int writer_thread(void* arg) {
+    uint32_t writer = (uint32_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < 4 * DLOG_SLOTS; i++) {
+        write_record(writer, i);
+    }
+    atomic_add(&writers_done, 1);
+    return 0;
+}
+
+// Reads while several threads write enough records to lap the reader.
+static bool concurrent_test(void* context) {
+    BEGIN_TEST;
+
+    dlog_reader_t rdr;
+    dlog_reader_init(&rdr, NULL, NULL);
+    drain(&rdr);
+
+    atomic_store(&writers_done, 0);
+    thread_t* threads[NUM_WRITERS];
+    for (uint32_t i = 0; i < NUM_WRITERS; i++) {
+        threads[i] = thread_create("dlog writer", writer_thread, (void*)(uintptr_t)i,
+                                   DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+        REQUIRE_NONNULL(threads[i], "");
+        thread_resume(threads[i]);
+    }
+
+    // Records of each writer come out in order, even if some are lost.
+    uint32_t next[NUM_WRITERS] = {0};
+    uint32_t seen = 0;
+    bool ok = true;
+    bool done = false;
+    while (!done) {
+        done = (atomic_load(&writers_done) == NUM_WRITERS);
+
+        uint32_t writer, index;
+        while (read_record(&rdr, &writer, &index, &ok)) {
+            if (writer >= NUM_WRITERS) {
+                ok = false;
+                continue;
+            }
+            EXPECT_GE(index, next[writer], "records out of order");
+            next[writer] = index + 1;
+            seen++;
+        }
+        thread_yield();
+    }
+    EXPECT_TRUE(ok, "torn record");
+    EXPECT_GT(seen, 0u, "");
+
+    for (uint32_t i = 0; i < NUM_WRITERS; i++) {
+        thread_join(threads[i], NULL, INFINITE_TIME);
+    }
+    dlog_reader_destroy(&rdr);
+    END_TEST;
+}
+
+static status_t __PRINTFLIKE(1, 2) log_printf(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    status_t status = dlog_vprintf(DLOG_LEVEL_INFO, fmt, ap);
+    va_end(ap);
+    return status;
+}
+
+// Reads the next record that starts with TEST_PREFIX into |rec|,
+// skipping those the rest of the kernel writes meanwhile.
+static bool read_test_record(dlog_reader_t* rdr, dlog_record_t* rec, size_t* actual) {
+    const size_t prefix = sizeof(TEST_PREFIX) - 1;
+    while (dlog_read(rdr, 0, rec, sizeof(*rec), actual) == MX_OK) {
+        if (rec->hdr.datalen >= prefix && memcmp(rec->data, TEST_PREFIX, prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reads the next test record and checks it holds |expected|.
+static bool expect_record(dlog_reader_t* rdr, const char* expected) {
+    dlog_record_t rec;
+    size_t actual;
+    if (!read_test_record(rdr, &rec, &actual)) {
+        return false;
+    }
+    size_t len = strlen(expected);
+    return actual == DLOG_MIN_RECORD + len && rec.hdr.datalen == len &&
+           memcmp(rec.data, expected, len) == 0;
+}
+
+// Format string records read back the same as the text printf() makes.
+static bool format_test(void* context) {
+    BEGIN_TEST;
+
+    dlog_reader_t rdr;
+    dlog_reader_init(&rdr, NULL, NULL);
+    drain(&rdr);
+
+    const uint64_t args[] = {(uint64_t)-7, 0xabcdef, 42};
+    EXPECT_EQ(MX_OK, dlog_write_args(DLOG_LEVEL_INFO, TEST_PREFIX "%d %#lx %5llu%%\n",
+                                     args, 3), "");
+    EXPECT_TRUE(expect_record(&rdr, TEST_PREFIX "-7 0xabcdef    42%\n"), "");
+
+    char expected[64];
+    int i = -1;
+    unsigned char c = 200;
+    size_t size = 1234567;
+    void* ptr = &rdr;
+    snprintf(expected, sizeof(expected), TEST_PREFIX "%d %hhu %zu %p %c\n", i, c, size, ptr, 'x');
+    EXPECT_EQ(MX_OK, log_printf(TEST_PREFIX "%d %hhu %zu %p %c\n", i, c, size, ptr, 'x'), "");
+    EXPECT_TRUE(expect_record(&rdr, expected), "");
+
+    // Anything a record can't hold is left to the caller.
+    EXPECT_EQ(MX_ERR_NOT_SUPPORTED, log_printf(TEST_PREFIX "%s\n", "str"), "");
+    EXPECT_EQ(MX_ERR_NOT_SUPPORTED, log_printf(TEST_PREFIX "%*d\n", 4, 1), "");
+    EXPECT_EQ(MX_ERR_NOT_SUPPORTED,
+              log_printf(TEST_PREFIX "%d %d %d %d %d %d %d\n", 1, 2, 3, 4, 5, 6, 7), "");
+    EXPECT_EQ(MX_ERR_OUT_OF_RANGE,
+              log_printf(TEST_PREFIX "%d %d %d %d %d %d "
+                         "........................................\n", 1, 2, 3, 4, 5, 6), "");
+    dlog_record_t rec;
+    size_t actual;
+    EXPECT_FALSE(read_test_record(&rdr, &rec, &actual), "rejected line was logged");
+
+    dlog_reader_destroy(&rdr);
+    END_TEST;
+}
+
+UNITTEST_START_TESTCASE(debuglog_tests)
+UNITTEST("wraparound", wraparound_test)
+UNITTEST("concurrent readers and writers", concurrent_test)
+UNITTEST("format string records", format_test)
+UNITTEST_END_TESTCASE(debuglog_tests, "debuglog", "debuglog tests", NULL, NULL);
@@ -10,6 +10,8 @@
 #include <kernel/event.h>
 #include <kernel/mutex.h>
 #include <list.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 
 __BEGIN_CDECLS
@@ -34,17 +36,20 @@ typedef struct dlog dlog_t;
 typedef struct dlog_header dlog_header_t;
 typedef struct dlog_record dlog_record_t;
 typedef struct dlog_reader dlog_reader_t;
+typedef struct dlog_slot dlog_slot_t;
 
 struct dlog {
-    spin_lock_t lock;
+    // The number of records ever reserved. Record n goes in
+    // slot n % DLOG_SLOTS.
+    uint64_t head;
 
-    size_t head;
-    size_t tail;
-
-    void* data;
+    dlog_slot_t* slots;
 
     bool panic;
 
+    // Set by the first writer after the notifier last ran, so that
+    // a burst of records wakes the notifier once.
+    int notify_pending;
     event_t event;
 
     mutex_t readers_lock;
@@ -55,7 +60,8 @@ struct dlog_reader {
     struct list_node node;
 
     dlog_t* log;
-    size_t tail;
+    // The number of the next record to read.
+    uint64_t tail;
 
     void (*notify)(void* cookie);
     void *cookie;
@@ -71,6 +77,10 @@ struct dlog_reader {
 #define DLOG_MAX_DATA            (224u)
 #define DLOG_MAX_RECORD          (DLOG_MIN_RECORD + DLOG_MAX_DATA)
 
+// The number of most recent records the log keeps. Every record takes a
+// whole slot, however short it is.
+#define DLOG_SLOTS               (1024u)
+
 struct dlog_header {
     uint32_t header;
     uint16_t datalen;
@@ -91,6 +101,19 @@ static_assert(sizeof(dlog_record_t) == DLOG_MAX_RECORD, "");
 void dlog_reader_init(dlog_reader_t* rdr, void (*notify)(void*), void* cookie);
 void dlog_reader_destroy(dlog_reader_t* rdr);
 status_t dlog_write(uint32_t flags, const void* ptr, size_t len);
+
+// Logs |fmt| with up to DLOG_MAX_ARGS integer or pointer arguments, each
+// widened to 64 bits, leaving the formatting to whoever reads the record.
+// |fmt| is kept by reference, so it must be a string literal, and it may
+// not take strings, floating point or '*' widths.
+#define DLOG_MAX_ARGS            (6u)
+status_t dlog_write_args(uint32_t flags, const char* fmt, const uint64_t* args, size_t num_args);
+
+// Like dlog_write_args(), but takes the arguments the way vprintf() does.
+// Returns MX_ERR_NOT_SUPPORTED if |fmt| takes arguments a record can't
+// hold, and MX_ERR_OUT_OF_RANGE if the text might not fit in one; nothing
+// is logged in either case.
+status_t dlog_vprintf(uint32_t flags, const char* fmt, va_list ap);
 status_t dlog_read(dlog_reader_t* rdr, uint32_t flags, void* ptr, size_t len, size_t* actual);
 
 // bluescreen_init should be called at the "start" of a fatal fault or
@@ -11,8 +11,10 @@ MODULE := $(LOCAL_DIR)
 
 MODULE_SRCS := \
     $(LOCAL_DIR)/debuglog.c \
+    $(LOCAL_DIR)/debuglog_tests.c \
 
 MODULE_DEPS := \
+    kernel/lib/unittest \
     kernel/lib/version
 
 include make/module.mk
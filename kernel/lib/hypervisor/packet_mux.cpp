@@ -31,6 +31,10 @@ private:
     mx_signals_t watched_signals_;
     event_t event_;
 
+    virtual mx_signals_t watched_signals() const {
+        return watched_signals_;
+    }
+
     virtual Flags OnInitialize(mx_signals_t initial_state, const CountInfo* cinfo) {
         return 0;
     }
@@ -153,3 +153,33 @@ int __printf_output_func(const char *s, size_t len, void *state)
     return len;
 }
 
+#if WITH_LIB_DEBUGLOG && !ENABLE_KERNEL_LL_DEBUG
+extern char __rodata_start[];
+extern char __rodata_end[];
+#endif
+
+bool __printf_defer_func(const char *fmt, va_list ap)
+{
+#if WITH_LIB_DEBUGLOG && !ENABLE_KERNEL_LL_DEBUG
+    /* the record only keeps a pointer to the format string */
+    if (fmt < __rodata_start || fmt >= __rodata_end)
+        return false;
+
+    /* only whole lines, so that they come out the same as printed ones */
+    size_t len = strlen(fmt);
+    if (len == 0 || fmt[len - 1] != '\n')
+        return false;
+
+#if WITH_DEBUG_LINEBUFFER
+    /* don't jump ahead of a line this thread has started printing */
+    thread_t *t = get_current_thread();
+    if (t != NULL && t->linebuffer_pos != 0)
+        return false;
+#endif
+
+    return dlog_vprintf(DLOG_FLAG_KERNEL, fmt, ap) == MX_OK;
+#else
+    return false;
+#endif
+}
+
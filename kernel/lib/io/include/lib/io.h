@@ -9,6 +9,8 @@
 
 #include <magenta/compiler.h>
 #include <list.h>
+#include <stdarg.h>
+#include <stdbool.h>
 #include <sys/types.h>
 
 /* LK specific calls to register to get input/output of the main console */
@@ -33,4 +35,8 @@ void __kernel_console_write(const char *str, size_t len);
 /* path from printf() to kernel debug output */
 int __printf_output_func(const char *s, size_t len, void *state);
 
+/* path from dprintf() to the debug log for lines it can format later;
+ * returns false if the caller has to format and print the line itself */
+bool __printf_defer_func(const char *fmt, va_list ap);
+
 __END_CDECLS
@@ -12,11 +12,15 @@
 #include <arch/ops.h>
 #include <arch/user_copy.h>
 #include <kernel/cmdline.h>
+#include <kernel/spinlock.h>
 #include <kernel/vm/vm_aspace.h>
 #include <lib/ktrace.h>
 #include <lk/init.h>
+#include <kernel/vm/vm_object_paged.h>
+#include <magenta/dispatcher.h>
 #include <magenta/thread_annotations.h>
 #include <magenta/thread_dispatcher.h>
+#include <mxtl/auto_call.h>
 
 #if __x86_64__
 #define ktrace_timestamp() rdtsc();
@@ -82,84 +86,643 @@ static void ktrace_report_probes(void) {
     mutex_release(&probe_list_lock);
 }
 
+// Each cpu appends its records to its own slice of the trace buffer, so
+// that tracing never bounces a cache line between cpus. Name records and
+// the two metadata records carry no timestamp and go to a separate slice
+// at the start of the buffer, which all cpus share. Reading the trace
+// returns the name slice followed by the records of every cpu merged by
+// timestamp.
+//
+// In circular mode a full cpu slice drops its oldest records to make room,
+// so that it always holds the most recent ones. A record that does not fit
+// before the end of the slice goes to its start instead, and the space it
+// leaves at the end begins with a zero tag.
+typedef struct ktrace_cpu {
+    // held, with interrupts disabled, to add or remove records
+    spin_lock_t lock;
+
+    // this cpu's slice of the trace buffer
+    uint8_t* buffer;
+    uint32_t size;
+
+    // offset of the oldest record and of where the next one will go
+    uint32_t head;
+    uint32_t tail;
+
+    // bytes from head to tail, of which skipped are the unused
+    // space left at the end of the slice
+    uint32_t used;
+    uint32_t skipped;
+
+    // records lost because a streamed slice was full
+    uint64_t dropped;
+} __CPU_ALIGN ktrace_cpu_t;
+
 typedef struct ktrace_state {
-    // where the next record will be written
+    // where the next name record will be written
     int offset;
 
     // mask of groups we allow, 0 == tracing disabled
     int grpmask;
 
-    // total size of the trace buffer
+    // whether full cpu slices drop their oldest records
+    bool circular;
+
+    // whether the cpu slices are to be emptied on the next start
+    bool rewound;
+
+    // whether records are being streamed, see ktrace_stream_start()
+    bool streaming;
+
+    // total size of the name slice
     uint32_t bufsize;
 
-    // offset where tracing was stopped, 0 if tracing active
+    // offset in the name slice where tracing was stopped, 0 if tracing active
     uint32_t marker;
 
+    // name records lost because the name slice was full while streaming,
+    // guarded by names_lock
+    uint64_t names_dropped;
+
     // raw trace buffer
     uint8_t* buffer;
+
+    uint32_t num_cpus;
+    ktrace_cpu_t cpu[SMP_MAX_CPUS];
 } ktrace_state_t;
 
 static ktrace_state_t KTRACE_STATE;
 
+// held, with interrupts disabled, to add name records
+static spin_lock_t names_lock = SPIN_LOCK_INITIAL_VALUE;
+
+// Where a reader left off in the merged records, so that reading the
+// whole trace in order takes linear time.
+typedef struct ktrace_reader {
+    bool valid;
+
+    // offset of the next record, counted from the end of the name slice
+    uint32_t offset;
+
+    // offset of the next record of each cpu, and the bytes left after it
+    uint32_t pos[SMP_MAX_CPUS];
+    uint32_t left[SMP_MAX_CPUS];
+} ktrace_reader_t;
+
+static mutex_t reader_lock = MUTEX_INITIAL_VALUE(reader_lock);
+static ktrace_reader_t KTRACE_READER TA_GUARDED(reader_lock);
+
+static void ktrace_reader_invalidate(void) {
+    mutex_acquire(&reader_lock);
+    KTRACE_READER.valid = false;
+    mutex_release(&reader_lock);
+}
+
+// held to move records out of the cpu slices into a stream, and to
+// empty the slices, so that a stream never puts back stale offsets
+static mutex_t stream_lock = MUTEX_INITIAL_VALUE(stream_lock);
+
+// Empties the cpu slices. Writers may still be adding records, possibly
+// under the old mode, so each slice is emptied under its lock.
+static void ktrace_reset_cpus(ktrace_state_t* ks) TA_REQ(stream_lock) {
+    for (uint32_t i = 0; i < ks->num_cpus; i++) {
+        ktrace_cpu_t* cpu = &ks->cpu[i];
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&cpu->lock, state);
+        cpu->head = 0;
+        cpu->tail = 0;
+        cpu->used = 0;
+        cpu->skipped = 0;
+        spin_unlock_irqrestore(&cpu->lock, state);
+    }
+}
+
+// Returns the number of unused bytes at off, up to the end of the slice,
+// or 0 if a record starts there.
+static uint32_t ktrace_cpu_skip(const ktrace_cpu_t* cpu, uint32_t off) {
+    uint32_t rem = cpu->size - off;
+    if ((rem < KTRACE_HDRSIZE) || (*(uint32_t*)(cpu->buffer + off) == 0)) {
+        return rem;
+    }
+    return 0;
+}
+
+// Drops the oldest records until len bytes are free after the tail.
+static void ktrace_cpu_evict(ktrace_cpu_t* cpu, uint32_t len) {
+    while (cpu->size - cpu->used < len) {
+        uint32_t n = ktrace_cpu_skip(cpu, cpu->head);
+        if (n) {
+            cpu->skipped -= n;
+        } else {
+            n = KTRACE_LEN(*(uint32_t*)(cpu->buffer + cpu->head));
+        }
+        cpu->head = (cpu->head + n) % cpu->size;
+        cpu->used -= n;
+    }
+}
+
+// Returns space for a record of len bytes after the newest one, or
+// nullptr if the slice is full and tracing is not circular.
+// Must be called with the cpu's lock held.
+static void* ktrace_cpu_reserve(ktrace_state_t* ks, ktrace_cpu_t* cpu, uint32_t len) {
+    // a record that does not fit before the end of the slice
+    // also takes up the space left there
+    uint32_t rem = cpu->size - cpu->tail;
+    uint32_t need = (rem < len) ? rem + len : len;
+    if (ks->circular) {
+        ktrace_cpu_evict(cpu, need);
+    } else if (cpu->size - cpu->used < need) {
+        return nullptr;
+    }
+
+    if (rem < len) {
+        *(uint32_t*)(cpu->buffer + cpu->tail) = 0;
+        cpu->used += rem;
+        cpu->skipped += rem;
+        cpu->tail = 0;
+    }
+    void* ptr = cpu->buffer + cpu->tail;
+    cpu->tail = (cpu->tail + len) % cpu->size;
+    cpu->used += len;
+    return ptr;
+}
+
+static status_t ktrace_write_etc(ktrace_state_t* ks, uint32_t tag, uint32_t tid,
+                                 const uint32_t* args, uint32_t num_args) {
+    uint32_t len = KTRACE_LEN(tag);
+    if (len < KTRACE_HDRSIZE) {
+        return MX_ERR_UNAVAILABLE;
+    }
+    uint32_t args_len = num_args * (uint32_t)sizeof(uint32_t);
+    if (args_len > len - KTRACE_HDRSIZE) {
+        args_len = len - KTRACE_HDRSIZE;
+    }
+
+    // The whole record is written under the lock, so that a streaming
+    // reader never sees it half done.
+    spin_lock_saved_state_t state;
+    arch_interrupt_save(&state, SPIN_LOCK_FLAG_INTERRUPTS);
+    ktrace_cpu_t* cpu = &ks->cpu[arch_curr_cpu_num()];
+    spin_lock(&cpu->lock);
+    ktrace_header_t* hdr = (ktrace_header_t*) ktrace_cpu_reserve(ks, cpu, len);
+    if (hdr != nullptr) {
+        hdr->ts = ktrace_timestamp();
+        hdr->tag = tag;
+        hdr->tid = tid;
+        if (args_len) {
+            memcpy(hdr + 1, args, args_len);
+        }
+    } else if (ks->streaming) {
+        cpu->dropped++;
+    }
+    spin_unlock(&cpu->lock);
+    arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+
+    if (hdr == nullptr) {
+        // if we arrive at the end, stop, unless the
+        // stream is expected to catch up
+        if (!ks->streaming) {
+            atomic_store(&ks->grpmask, 0);
+        }
+        return MX_ERR_UNAVAILABLE;
+    }
+    return MX_OK;
+}
+
+// Returns the next record of a cpu for the reader, or nullptr if there
+// are no more.
+static ktrace_header_t* ktrace_reader_peek(const ktrace_cpu_t* cpu, uint32_t* pos,
+                                           uint32_t* left, uint32_t* skipped) {
+    if (*left == 0) {
+        return nullptr;
+    }
+    uint32_t skip = ktrace_cpu_skip(cpu, *pos);
+    if (skip) {
+        if (skip >= *left) {
+            *left = 0;
+            return nullptr;
+        }
+        *left -= skip;
+        *pos = 0;
+        if (skipped != nullptr) {
+            *skipped += skip;
+        }
+    }
+    ktrace_header_t* hdr = (ktrace_header_t*) (cpu->buffer + *pos);
+    uint32_t len = KTRACE_LEN(hdr->tag);
+    if ((len < KTRACE_HDRSIZE) || (len > *left)) {
+        // torn by a concurrent writer
+        *left = 0;
+        return nullptr;
+    }
+    return hdr;
+}
+
 int ktrace_read_user(void* ptr, uint32_t off, uint32_t len) {
     ktrace_state_t* ks = &KTRACE_STATE;
 
-    // Buffer size is limited by the marker if set,
-    // otherwise limited by offset (last written point).
-    // Offset can end up pointing past the end, so clip
-    // it to the actual buffer size to be safe.
-    uint32_t max;
-    if (ks->marker) {
-        max = ks->marker;
-    } else {
-        max = ks->offset;
-        if (max > ks->bufsize) {
-            max = ks->bufsize;
-        }
+    // The name slice is limited by the marker if set,
+    // otherwise by offset (last written point).
+    uint32_t names = ks->marker ? ks->marker : atomic_load(&ks->offset);
+
+    // a streamed trace is only read through the stream, and what is
+    // left in the buffer is not what the stream has delivered
+    if (ks->streaming) {
+        return MX_ERR_BAD_STATE;
     }
 
     // null read is a query for trace buffer size
     if (ptr == nullptr) {
-        return max;
+        uint32_t size = names;
+        for (uint32_t i = 0; i < ks->num_cpus; i++) {
+            size += ks->cpu[i].used - ks->cpu[i].skipped;
+        }
+        return size;
+    }
+
+    // a circular trace overwrites records as it goes, so it
+    // can only be read once stopped
+    if (ks->circular && atomic_load(&ks->grpmask)) {
+        return MX_ERR_BAD_STATE;
+    }
+
+    uint32_t actual = 0;
+    if (off < names) {
+        actual = (len < names - off) ? len : names - off;
+        if (arch_copy_to_user(ptr, ks->buffer + off, actual) != MX_OK) {
+            return MX_ERR_INVALID_ARGS;
+        }
+    }
+    if (actual == len) {
+        return actual;
     }
 
-    // constrain read to available buffer
-    if (off >= max) {
-        return 0;
+    mutex_acquire(&reader_lock);
+    ktrace_reader_t* rd = &KTRACE_READER;
+
+    // start over unless continuing from the last read
+    uint32_t merged_off = off + actual - names;
+    if (!rd->valid || (merged_off == 0) || (merged_off < rd->offset)) {
+        rd->valid = true;
+        rd->offset = 0;
+        for (uint32_t i = 0; i < ks->num_cpus; i++) {
+            rd->pos[i] = ks->cpu[i].head;
+            rd->left[i] = ks->cpu[i].used;
+        }
     }
-    if (len > (max - off)) {
-        len = max - off;
+
+    status_t status = MX_OK;
+    while (actual < len) {
+        // find the oldest record not yet read
+        ktrace_header_t* next = nullptr;
+        uint32_t next_cpu = 0;
+        for (uint32_t i = 0; i < ks->num_cpus; i++) {
+            ktrace_header_t* hdr = ktrace_reader_peek(&ks->cpu[i], &rd->pos[i], &rd->left[i],
+                                                      nullptr);
+            if ((hdr != nullptr) && ((next == nullptr) || (hdr->ts < next->ts))) {
+                next = hdr;
+                next_cpu = i;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+
+        // copy whatever part of it the read covers
+        uint32_t rec_len = KTRACE_LEN(next->tag);
+        uint32_t from = merged_off - rd->offset;
+        if (from < rec_len) {
+            uint32_t n = rec_len - from;
+            if (n > len - actual) {
+                n = len - actual;
+            }
+            if (arch_copy_to_user((uint8_t*)ptr + actual, (uint8_t*)next + from, n) != MX_OK) {
+                status = MX_ERR_INVALID_ARGS;
+                break;
+            }
+            actual += n;
+            merged_off += n;
+            if (from + n < rec_len) {
+                break;
+            }
+        }
+
+        const ktrace_cpu_t* cpu = &ks->cpu[next_cpu];
+        rd->pos[next_cpu] = (rd->pos[next_cpu] + rec_len) % cpu->size;
+        rd->left[next_cpu] -= rec_len;
+        rd->offset += rec_len;
     }
+    mutex_release(&reader_lock);
+
+    return (status != MX_OK) ? status : actual;
+}
 
-    if (arch_copy_to_user(ptr, ks->buffer + off, len) != MX_OK) {
+// A stream moves records out of the cpu slices into a ring shared with
+// a userspace consumer. The records are written from any context, with
+// spinlocks held, where the consumer cannot be woken, so a kernel thread
+// moves them over every kStreamPeriod instead. Each pass takes only the
+// records older than the time it started, which every cpu has finished
+// writing by then, so the stream is in timestamp order.
+static constexpr lk_time_t kStreamPeriod = LK_MSEC(10);
+
+typedef struct ktrace_stream {
+    mxtl::RefPtr<VmMapping> mapping;
+    mxtl::RefPtr<Dispatcher> event;
+
+    ktrace_stream_header_t* header;
+    uint8_t* data;
+    uint32_t size;
+    uint32_t watermark;
+
+    // bytes of the name slice already streamed
+    uint32_t names_sent;
+
+    // bytes ever written to the ring
+    uint64_t head;
+} ktrace_stream_t;
+
+static ktrace_stream_t KTRACE_STREAM TA_GUARDED(stream_lock);
+static thread_t* stream_thread;
+
+static void ktrace_stream_copy(ktrace_stream_t* st, const void* src, uint32_t len) {
+    uint32_t off = (uint32_t)(st->head % st->size);
+    uint32_t first = (len < st->size - off) ? len : st->size - off;
+    memcpy(st->data + off, src, first);
+    memcpy(st->data, (const uint8_t*)src + first, len - first);
+    st->head += len;
+}
+
+// Moves what it can from the cpu slices to the stream, and signals
+// the consumer if the ring is filled up to the watermark.
+static void ktrace_stream_pass(ktrace_state_t* ks, ktrace_stream_t* st) TA_REQ(stream_lock) {
+    // The consumer owns the tail and may set it to anything; a bad
+    // one only stops the stream.
+    uint64_t tail = __atomic_load_n(&st->header->tail, __ATOMIC_ACQUIRE);
+    uint32_t avail = (st->head - tail <= st->size) ? (uint32_t)(st->size - (st->head - tail)) : 0;
+
+    // Name records first, so that the consumer can resolve
+    // the ids in the events that follow.
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&names_lock, state);
+    uint32_t names = ks->offset;
+    spin_unlock_irqrestore(&names_lock, state);
+    if (names < st->names_sent) {
+        // rewound
+        st->names_sent = 0;
+    }
+    if (names - st->names_sent > avail) {
+        return;
+    }
+    ktrace_stream_copy(st, ks->buffer + st->names_sent, names - st->names_sent);
+    avail -= names - st->names_sent;
+
+    // Make room for more names by moving those added since the snapshot
+    // down to just after the metadata, which has been streamed already.
+    uint64_t names_dropped;
+    spin_lock_irqsave(&names_lock, state);
+    uint32_t offset = ks->offset;
+    if (offset >= names) {
+        memmove(ks->buffer + KTRACE_RECSIZE * 2, ks->buffer + names, offset - names);
+        atomic_store(&ks->offset, KTRACE_RECSIZE * 2 + (offset - names));
+        st->names_sent = KTRACE_RECSIZE * 2;
+    } else {
+        // rewound meanwhile; the next pass starts over
+        st->names_sent = names;
+    }
+    names_dropped = ks->names_dropped;
+    spin_unlock_irqrestore(&names_lock, state);
+
+    uint64_t cutoff = ktrace_timestamp();
+    uint32_t pos[SMP_MAX_CPUS];
+    uint32_t left[SMP_MAX_CPUS];
+    uint32_t used[SMP_MAX_CPUS];
+    uint32_t skipped[SMP_MAX_CPUS];
+    uint64_t dropped = names_dropped;
+    for (uint32_t i = 0; i < ks->num_cpus; i++) {
+        ktrace_cpu_t* cpu = &ks->cpu[i];
+        spin_lock_irqsave(&cpu->lock, state);
+        pos[i] = cpu->head;
+        used[i] = left[i] = cpu->used;
+        dropped += cpu->dropped;
+        spin_unlock_irqrestore(&cpu->lock, state);
+        skipped[i] = 0;
+    }
+
+    // The records up to each snapshot stay put until the heads are
+    // moved past them below.
+    for (;;) {
+        ktrace_header_t* next = nullptr;
+        uint32_t next_cpu = 0;
+        for (uint32_t i = 0; i < ks->num_cpus; i++) {
+            ktrace_header_t* hdr = ktrace_reader_peek(&ks->cpu[i], &pos[i], &left[i],
+                                                      &skipped[i]);
+            if ((hdr != nullptr) && (hdr->ts < cutoff) &&
+                ((next == nullptr) || (hdr->ts < next->ts))) {
+                next = hdr;
+                next_cpu = i;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+        uint32_t len = KTRACE_LEN(next->tag);
+        if (len > avail) {
+            break;
+        }
+        ktrace_stream_copy(st, next, len);
+        avail -= len;
+        pos[next_cpu] = (pos[next_cpu] + len) % ks->cpu[next_cpu].size;
+        left[next_cpu] -= len;
+    }
+
+    for (uint32_t i = 0; i < ks->num_cpus; i++) {
+        ktrace_cpu_t* cpu = &ks->cpu[i];
+        spin_lock_irqsave(&cpu->lock, state);
+        cpu->head = pos[i];
+        cpu->used -= used[i] - left[i];
+        cpu->skipped -= skipped[i];
+        spin_unlock_irqrestore(&cpu->lock, state);
+    }
+
+    __atomic_store_n(&st->header->dropped, dropped, __ATOMIC_RELAXED);
+    __atomic_store_n(&st->header->head, st->head, __ATOMIC_RELEASE);
+
+    if (st->head - tail >= st->watermark) {
+        st->event->user_signal(0u, MX_EVENT_SIGNALED, false);
+    } else {
+        st->event->user_signal(MX_EVENT_SIGNALED, 0u, false);
+    }
+}
+
+static int ktrace_stream_thread(void* arg) {
+    ktrace_state_t* ks = &KTRACE_STATE;
+    for (;;) {
+        thread_sleep_relative(kStreamPeriod);
+        mutex_acquire(&stream_lock);
+        if (ks->streaming) {
+            ktrace_stream_pass(ks, &KTRACE_STREAM);
+        }
+        mutex_release(&stream_lock);
+    }
+    return 0;
+}
+
+status_t ktrace_stream_start(uint32_t size, uint32_t watermark,
+                             mxtl::RefPtr<Dispatcher> event, mxtl::RefPtr<VmObject>* vmo_out) {
+    ktrace_state_t* ks = &KTRACE_STATE;
+    if (ks->buffer == nullptr) {
+        return MX_ERR_BAD_STATE;
+    }
+    if ((size == 0) || (size > KTRACE_STREAM_MAX_SIZE) || !IS_PAGE_ALIGNED(size) ||
+        (watermark == 0) || (watermark > size)) {
         return MX_ERR_INVALID_ARGS;
     }
-    return len;
+
+    mutex_acquire(&stream_lock);
+    auto cleanup = mxtl::MakeAutoCall([]() { mutex_release(&stream_lock); });
+
+    // a circular trace drops records the stream has not taken
+    if (ks->streaming || (ks->circular && atomic_load(&ks->grpmask))) {
+        return MX_ERR_BAD_STATE;
+    }
+
+    if (stream_thread == nullptr) {
+        stream_thread = thread_create("ktrace-stream", ktrace_stream_thread, nullptr,
+                                      LOW_PRIORITY, DEFAULT_STACK_SIZE);
+        if (stream_thread == nullptr) {
+            return MX_ERR_NO_MEMORY;
+        }
+        thread_resume(stream_thread);
+    }
+
+    // As with shared fifos, the ring is committed and mapped into the
+    // kernel up front so that writing it never faults.
+    const size_t vmo_size = KTRACE_STREAM_DATA_OFFSET + size;
+    mxtl::RefPtr<VmObject> vmo;
+    status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, vmo_size, &vmo);
+    if (status != MX_OK) {
+        return status;
+    }
+
+    uint64_t committed;
+    status = vmo->CommitRange(0, vmo_size, &committed);
+    if (status != MX_OK) {
+        return status;
+    }
+    vmo->set_kernel_owned();
+
+    mxtl::RefPtr<VmMapping> mapping;
+    status = VmAspace::kernel_aspace()->RootVmar()->CreateVmMapping(
+            0 /* ignored */, vmo_size, 0 /* align pow2 */, 0 /* vmar flags */,
+            vmo, 0, ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE,
+            "ktrace_stream", &mapping);
+    if (status != MX_OK) {
+        return status;
+    }
+
+    status = mapping->MapRange(0, vmo_size, true);
+    if (status != MX_OK) {
+        mapping->Destroy();
+        return status;
+    }
+
+    if (ks->rewound || ks->circular) {
+        ks->circular = false;
+        ks->rewound = false;
+        ktrace_reset_cpus(ks);
+    }
+
+    ktrace_stream_t* st = &KTRACE_STREAM;
+    st->mapping = mapping;
+    st->event = mxtl::move(event);
+    st->header = reinterpret_cast<ktrace_stream_header_t*>(mapping->base());
+    st->data = reinterpret_cast<uint8_t*>(mapping->base()) + KTRACE_STREAM_DATA_OFFSET;
+    st->size = size;
+    st->watermark = watermark;
+    st->names_sent = 0;
+    st->head = 0;
+    st->header->size = size;
+    st->header->watermark = watermark;
+    for (uint32_t i = 0; i < ks->num_cpus; i++) {
+        ktrace_cpu_t* cpu = &ks->cpu[i];
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&cpu->lock, state);
+        cpu->dropped = 0;
+        spin_unlock_irqrestore(&cpu->lock, state);
+    }
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&names_lock, state);
+    ks->names_dropped = 0;
+    spin_unlock_irqrestore(&names_lock, state);
+    ks->streaming = true;
+
+    *vmo_out = mxtl::move(vmo);
+    return MX_OK;
+}
+
+void ktrace_stream_stop() {
+    ktrace_state_t* ks = &KTRACE_STATE;
+    mutex_acquire(&stream_lock);
+    if (ks->streaming) {
+        ktrace_stream_t* st = &KTRACE_STREAM;
+        ktrace_stream_pass(ks, st);
+        ks->streaming = false;
+        st->event->user_signal(0u, MX_EVENT_SIGNALED, false);
+        st->event.reset();
+        st->mapping->Destroy();
+        st->mapping.reset();
+        st->header = nullptr;
+        st->data = nullptr;
+    }
+    mutex_release(&stream_lock);
 }
 
 status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
     ktrace_state_t* ks = &KTRACE_STATE;
     switch (action) {
     case KTRACE_ACTION_START:
+    case KTRACE_ACTION_START_CIRCULAR: {
+        if (ks->buffer == nullptr) {
+            return MX_ERR_BAD_STATE;
+        }
+        bool circular = (action == KTRACE_ACTION_START_CIRCULAR);
+        if (circular && ks->streaming) {
+            return MX_ERR_BAD_STATE;
+        }
         options = KTRACE_GRP_TO_MASK(options);
+        if (ks->rewound || (circular != ks->circular)) {
+            atomic_store(&ks->grpmask, 0);
+            mutex_acquire(&stream_lock);
+            ks->circular = circular;
+            ks->rewound = false;
+            ktrace_reset_cpus(ks);
+            mutex_release(&stream_lock);
+        }
+        ktrace_reader_invalidate();
         ks->marker = 0;
         atomic_store(&ks->grpmask, options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
         ktrace_report_live_processes();
         ktrace_report_live_threads();
         break;
-    case KTRACE_ACTION_STOP: {
+    }
+    case KTRACE_ACTION_STOP:
         atomic_store(&ks->grpmask, 0);
-        uint32_t n = ks->offset;
-        if (n > ks->bufsize) {
-            ks->marker = ks->bufsize;
-        } else {
-            ks->marker = n;
-        }
+        // the last pass of a stream moves the names it leaves behind
+        ktrace_stream_stop();
+        ks->marker = atomic_load(&ks->offset);
         break;
-    }
     case KTRACE_ACTION_REWIND:
-        // roll back to just after the metadata
+        // roll back to just after the metadata, keeping a stopped
+        // trace readable until tracing starts again
         atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+        if (atomic_load(&ks->grpmask)) {
+            mutex_acquire(&stream_lock);
+            ktrace_reset_cpus(ks);
+            mutex_release(&stream_lock);
+            ktrace_reader_invalidate();
+        } else {
+            ks->rewound = true;
+        }
         ktrace_report_syscalls(kt_syscall_info);
         ktrace_report_probes();
         break;
@@ -210,11 +773,19 @@ void ktrace_init(unsigned level) {
         return;
     }
 
-    // The last packet written can overhang the end of the buffer,
-    // so we reduce the reported size by the max size of a record
-    ks->bufsize = mb - 256;
+    // Name records are rare next to events, so they get a sixteenth
+    // of the buffer and the cpus share the rest.
+    ks->bufsize = mb / 16;
+    ks->num_cpus = arch_max_num_cpus();
+    uint32_t cpu_size = ((mb - ks->bufsize) / ks->num_cpus) & ~7u;
+    for (uint32_t i = 0; i < ks->num_cpus; i++) {
+        ks->cpu[i].buffer = ks->buffer + ks->bufsize + i * cpu_size;
+        ks->cpu[i].size = cpu_size;
+    }
+    ks->circular = cmdline_get_bool("ktrace.circular", false);
 
-    dprintf(INFO, "ktrace: buffer at %p (%u bytes)\n", ks->buffer, mb);
+    dprintf(INFO, "ktrace: buffer at %p (%u bytes, %u per cpu%s)\n", ks->buffer, mb, cpu_size,
+            ks->circular ? ", circular" : "");
 
     // register all static probes
     ktrace_probe_info_t *probe;
@@ -246,38 +817,17 @@ void ktrace_init(unsigned level) {
 void ktrace_tiny(uint32_t tag, uint32_t arg) {
     ktrace_state_t* ks = &KTRACE_STATE;
     if (tag & atomic_load(&ks->grpmask)) {
-        tag = (tag & 0xFFFFFFF0) | 2;
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_HDRSIZE)) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
-            hdr->ts = ktrace_timestamp();
-            hdr->tag = tag;
-            hdr->tid = arg;
-        }
+        ktrace_write_etc(ks, (tag & 0xFFFFFFF0) | 2, arg, nullptr, 0);
     }
 }
 
-void* ktrace_open(uint32_t tag) {
+status_t ktrace_write(uint32_t tag, const uint32_t* args, uint32_t num_args) {
     ktrace_state_t* ks = &KTRACE_STATE;
     if (!(tag & atomic_load(&ks->grpmask))) {
-        return nullptr;
+        return MX_ERR_UNAVAILABLE;
     }
 
-    int off;
-    if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-        // if we arrive at the end, stop
-        atomic_store(&ks->grpmask, 0);
-        return nullptr;
-    }
-
-    ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
-    hdr->ts = ktrace_timestamp();
-    hdr->tag = tag;
-    hdr->tid = (uint32_t)get_current_thread()->user_tid;
-    return hdr + 1;
+    return ktrace_write_etc(ks, tag, (uint32_t)get_current_thread()->user_tid, args, num_args);
 }
 
 static void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char* name, bool always) {
@@ -288,18 +838,33 @@ static void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char*
         // set size to: sizeof(hdr) + len + 1, round up to multiple of 8
         tag = (tag & 0xFFFFFFF0) | ((KTRACE_NAMESIZE + len + 1 + 7) >> 3);
 
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->buffer + off);
-            rec->tag = tag;
-            rec->id = id;
-            rec->arg = arg;
-            memcpy(rec->name, name, len);
-            rec->name[len] = 0;
+        // Never let the name slice overhang its end, so that it reads
+        // back as whole records. Names are rare enough to take a lock,
+        // which keeps a stream from seeing them half written.
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&names_lock, state);
+        uint32_t off = ks->offset;
+        if (off + KTRACE_LEN(tag) > ks->bufsize) {
+            // a circular or streamed trace keeps going without the name,
+            // and a stream reports it as dropped
+            if (ks->streaming) {
+                ks->names_dropped++;
+            }
+            spin_unlock_irqrestore(&names_lock, state);
+            if (!ks->circular && !ks->streaming) {
+                atomic_store(&ks->grpmask, 0);
+            }
+            return;
         }
+
+        ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->buffer + off);
+        rec->tag = tag;
+        rec->id = id;
+        rec->arg = arg;
+        memcpy(rec->name, name, len);
+        rec->name[len] = 0;
+        atomic_store(&ks->offset, off + KTRACE_LEN(tag));
+        spin_unlock_irqrestore(&names_lock, state);
     }
 }
 
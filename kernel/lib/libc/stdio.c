@@ -8,6 +8,7 @@
 #include <debug.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <string.h>
 #include <sys/types.h>
 #include <platform/debug.h>
@@ -35,6 +36,7 @@ int getchar(void)
 }
 
 extern int __printf_output_func(const char *str, size_t len, void *state);
+extern bool __printf_defer_func(const char *fmt, va_list ap);
 
 int _printf(const char *fmt, ...)
 {
@@ -53,3 +55,13 @@ int _vprintf(const char *fmt, va_list ap)
 {
     return _printf_engine(__printf_output_func, NULL, fmt, ap);
 }
+
+void _dprintf(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    if (!__printf_defer_func(fmt, ap))
+        _printf_engine(__printf_output_func, NULL, fmt, ap);
+    va_end(ap);
+}
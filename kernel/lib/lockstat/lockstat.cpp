@@ -0,0 +1,382 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/lockstat.h>
+
+#include <arch/ops.h>
+#include <debug.h>
+#include <err.h>
+#include <inttypes.h>
+#include <platform.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/thread.h>
+#include <lib/console.h>
+#include <lk/init.h>
+#include <magenta/syscalls/object.h>
+#include <mxtl/algorithm.h>
+
+// The hooks below run inside every lock and unlock, so they take no locks
+// themselves and update the statistics with relaxed atomics. Readers may
+// see a class half updated, which is fine for statistics.
+
+extern int __data_start;
+extern int _end;
+
+namespace {
+
+constexpr uint32_t kNoClass = LOCKSTAT_CLASSES;
+
+struct Site {
+    uintptr_t site;
+    uint64_t count;
+};
+
+struct Class {
+    // lock or call site address, 0 if the slot is unused
+    uintptr_t key;
+    uint32_t kind;
+    uint32_t flags;
+
+    uint64_t acquisitions;
+    uint64_t contentions;
+    uint64_t wait_total;
+    uint64_t wait_max;
+    uint64_t hold_total;
+    uint64_t hold_max;
+    uint64_t wait_histogram[MX_INFO_LOCK_STATS_BUCKETS];
+    uint64_t hold_histogram[MX_INFO_LOCK_STATS_BUCKETS];
+    Site sites[MX_INFO_LOCK_STATS_SITES];
+};
+
+struct HeldSpinLocks {
+    lockstat_held_t held[LOCKSTAT_MAX_HELD];
+    uint32_t depth;
+} __CPU_ALIGN;
+
+Class classes[LOCKSTAT_CLASSES];
+
+// acquisitions not counted because every class slot was taken
+uint64_t lost;
+
+HeldSpinLocks held_spin_locks[SMP_MAX_CPUS];
+
+// Off until the kernel is far enough along to tell cpus apart, and
+// switched by the console command.
+bool enabled;
+
+inline bool is_enabled() {
+    return __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+}
+
+inline uint64_t load(const uint64_t* p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+inline void add(uint64_t* p, uint64_t v) {
+    __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+}
+
+inline void raise(uint64_t* p, uint64_t v) {
+    uint64_t old = load(p);
+    while (v > old &&
+           !__atomic_compare_exchange_n(p, &old, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+uint32_t bucket(lk_time_t t) {
+    if (t < 256)
+        return 0;
+    uint32_t b = 63 - __builtin_clzll(t) - 7;
+    return mxtl::min(b, MX_INFO_LOCK_STATS_BUCKETS - 1);
+}
+
+// Finds the class slot for |key|, taking a free one if it is new.
+uint32_t lookup(uintptr_t key, uint32_t kind, uint32_t flags) {
+    uint32_t hash = static_cast<uint32_t>(((key >> 3) * 0x9E3779B97F4A7C15ull) >> 32);
+    for (uint32_t i = 0; i < LOCKSTAT_CLASSES; i++) {
+        Class* c = &classes[(hash + i) % LOCKSTAT_CLASSES];
+        uintptr_t cur = __atomic_load_n(&c->key, __ATOMIC_RELAXED);
+        if (cur == 0 && __atomic_compare_exchange_n(&c->key, &cur, key, false,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            c->kind = kind;
+            c->flags = flags;
+            return static_cast<uint32_t>(c - classes);
+        }
+        // Static locks and call sites never share an address.
+        if (cur == key)
+            return static_cast<uint32_t>(c - classes);
+    }
+    add(&lost, 1);
+    return kNoClass;
+}
+
+// Counts a contention from |site|. The least frequent of the sites kept
+// gives way to a new one, which inherits its count, so that a site which
+// keeps contending works its way in.
+void note_site(Class* c, uintptr_t site) {
+    Site* least = nullptr;
+    for (auto& s : c->sites) {
+        uintptr_t cur = __atomic_load_n(&s.site, __ATOMIC_RELAXED);
+        if (cur == 0 && __atomic_compare_exchange_n(&s.site, &cur, site, false,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            cur = site;
+        }
+        if (cur == site) {
+            add(&s.count, 1);
+            return;
+        }
+        if (least == nullptr || load(&s.count) < load(&least->count))
+            least = &s;
+    }
+    __atomic_store_n(&least->site, site, __ATOMIC_RELAXED);
+    add(&least->count, 1);
+}
+
+uint32_t acquired(const void* lock, uint32_t kind, uintptr_t site, bool contended,
+                  lk_time_t wait) {
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(lock);
+    const bool by_site = addr < reinterpret_cast<uintptr_t>(&__data_start) ||
+                         addr >= reinterpret_cast<uintptr_t>(&_end);
+    uint32_t index = by_site ? lookup(site, kind, MX_INFO_LOCK_STATS_FLAG_SITE)
+                             : lookup(addr, kind, 0u);
+    if (index == kNoClass)
+        return index;
+
+    Class* c = &classes[index];
+    add(&c->acquisitions, 1);
+    if (contended) {
+        add(&c->contentions, 1);
+        add(&c->wait_total, wait);
+        raise(&c->wait_max, wait);
+        add(&c->wait_histogram[bucket(wait)], 1);
+        note_site(c, site);
+    }
+    return index;
+}
+
+void push(lockstat_held_t* held, uint32_t* depth, const void* lock, uint32_t index,
+          lk_time_t now) {
+    if (*depth == LOCKSTAT_MAX_HELD) {
+        // forget the oldest
+        memmove(&held[0], &held[1], sizeof(held[0]) * (LOCKSTAT_MAX_HELD - 1));
+        (*depth)--;
+    }
+    held[(*depth)++] = {lock, index, now};
+}
+
+void pop(lockstat_held_t* held, uint32_t* depth, const void* lock, lk_time_t now) {
+    for (uint32_t i = *depth; i-- > 0;) {
+        if (held[i].lock != lock)
+            continue;
+        Class* c = &classes[held[i].index];
+        lk_time_t hold = now - held[i].since;
+        add(&c->hold_total, hold);
+        raise(&c->hold_max, hold);
+        add(&c->hold_histogram[bucket(hold)], 1);
+        memmove(&held[i], &held[i + 1], sizeof(held[0]) * (*depth - i - 1));
+        (*depth)--;
+        return;
+    }
+}
+
+void spin_acquired(spin_lock_t* lock, void* caller, bool contended, lk_time_t since) {
+    lk_time_t now = current_time();
+    uint32_t index = acquired(lock, MX_INFO_LOCK_KIND_SPIN, reinterpret_cast<uintptr_t>(caller),
+                              contended, now - since);
+    if (index == kNoClass)
+        return;
+    HeldSpinLocks* cpu = &held_spin_locks[arch_curr_cpu_num()];
+    push(cpu->held, &cpu->depth, lock, index, now);
+}
+
+} // namespace
+
+void lockstat_mutex_acquired(const void* m, void* caller, lk_time_t contended_since) {
+    if (!is_enabled())
+        return;
+    lk_time_t now = current_time();
+    bool contended = contended_since != 0;
+    uint32_t index = acquired(m, MX_INFO_LOCK_KIND_MUTEX, reinterpret_cast<uintptr_t>(caller),
+                              contended, contended ? now - contended_since : 0);
+    if (index == kNoClass)
+        return;
+    thread_t* t = get_current_thread();
+    push(t->lockstat_held, &t->lockstat_depth, m, index, now);
+}
+
+void lockstat_mutex_released(const void* m) {
+    if (!is_enabled())
+        return;
+    thread_t* t = get_current_thread();
+    pop(t->lockstat_held, &t->lockstat_depth, m, current_time());
+}
+
+void lockstat_spin_lock(spin_lock_t* lock) {
+    if (!is_enabled()) {
+        arch_spin_lock(lock);
+        return;
+    }
+    if (arch_spin_trylock(lock) == 0) {
+        spin_acquired(lock, __GET_CALLER(), false, current_time());
+        return;
+    }
+    lk_time_t since = current_time();
+    arch_spin_lock(lock);
+    spin_acquired(lock, __GET_CALLER(), true, since);
+}
+
+int lockstat_spin_trylock(spin_lock_t* lock) {
+    int ret = arch_spin_trylock(lock);
+    if (ret == 0 && is_enabled())
+        spin_acquired(lock, __GET_CALLER(), false, current_time());
+    return ret;
+}
+
+void lockstat_spin_unlock(spin_lock_t* lock) {
+    if (is_enabled()) {
+        HeldSpinLocks* cpu = &held_spin_locks[arch_curr_cpu_num()];
+        pop(cpu->held, &cpu->depth, lock, current_time());
+    }
+    arch_spin_unlock(lock);
+}
+
+bool lockstat_get_class(uint32_t slot, mx_info_lock_stats_t* info) {
+    if (slot >= LOCKSTAT_CLASSES)
+        return false;
+    const Class* c = &classes[slot];
+    uintptr_t key = __atomic_load_n(&c->key, __ATOMIC_RELAXED);
+    if (key == 0)
+        return false;
+
+    *info = {};
+    info->key = key;
+    info->kind = c->kind;
+    info->flags = c->flags;
+    info->acquisitions = load(&c->acquisitions);
+    info->contentions = load(&c->contentions);
+    info->wait_total = load(&c->wait_total);
+    info->wait_max = load(&c->wait_max);
+    info->hold_total = load(&c->hold_total);
+    info->hold_max = load(&c->hold_max);
+    for (uint32_t i = 0; i < MX_INFO_LOCK_STATS_BUCKETS; i++) {
+        info->wait_histogram[i] = load(&c->wait_histogram[i]);
+        info->hold_histogram[i] = load(&c->hold_histogram[i]);
+    }
+    for (uint32_t i = 0; i < MX_INFO_LOCK_STATS_SITES; i++) {
+        info->contending_sites[i] = __atomic_load_n(&c->sites[i].site, __ATOMIC_RELAXED);
+        info->contending_counts[i] = load(&c->sites[i].count);
+    }
+    return true;
+}
+
+bool lockstat_set_enabled(bool enable) {
+    return __atomic_exchange_n(&enabled, enable, __ATOMIC_RELAXED);
+}
+
+void lockstat_reset() {
+    // Counting while clearing could leave a class half cleared.
+    bool was_enabled = lockstat_set_enabled(false);
+    for (auto& c : classes) {
+        __atomic_store_n(&c.acquisitions, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c.contentions, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c.wait_total, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c.wait_max, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c.hold_total, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c.hold_max, 0, __ATOMIC_RELAXED);
+        for (uint32_t i = 0; i < MX_INFO_LOCK_STATS_BUCKETS; i++) {
+            __atomic_store_n(&c.wait_histogram[i], 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c.hold_histogram[i], 0, __ATOMIC_RELAXED);
+        }
+        for (auto& site : c.sites) {
+            __atomic_store_n(&site.site, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&site.count, 0, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&lost, 0, __ATOMIC_RELAXED);
+    lockstat_set_enabled(was_enabled);
+}
+
+static void lockstat_init(uint level) {
+    lockstat_set_enabled(true);
+}
+
+LK_INIT_HOOK(lockstat, lockstat_init, LK_INIT_LEVEL_THREADING);
+
+static void lockstat_dump(uint32_t count) {
+    // Show the classes that waited longest, most first.
+    printf("%-5s %-18s %12s %12s %14s %12s %14s %12s\n", "kind", "key", "acquired",
+           "contended", "wait total ns", "wait max", "hold total ns", "hold max");
+    uint64_t below = UINT64_MAX;
+    uint32_t shown = 0;
+    while (shown < count) {
+        mx_info_lock_stats_t best = {};
+        bool found = false;
+        for (uint32_t slot = 0; slot < LOCKSTAT_CLASSES; slot++) {
+            mx_info_lock_stats_t info;
+            if (!lockstat_get_class(slot, &info) || info.wait_total >= below)
+                continue;
+            if (!found || info.wait_total > best.wait_total) {
+                best = info;
+                found = true;
+            }
+        }
+        if (!found)
+            break;
+
+        // Ties are shown together.
+        below = best.wait_total;
+        for (uint32_t slot = 0; slot < LOCKSTAT_CLASSES && shown < count; slot++) {
+            mx_info_lock_stats_t info;
+            if (!lockstat_get_class(slot, &info) || info.wait_total != below)
+                continue;
+            printf("%-5s %s%#-17" PRIx64 " %12" PRIu64 " %12" PRIu64 " %14" PRIu64
+                   " %12" PRIu64 " %14" PRIu64 " %12" PRIu64 "\n",
+                   info.kind == MX_INFO_LOCK_KIND_SPIN ? "spin" : "mutex",
+                   (info.flags & MX_INFO_LOCK_STATS_FLAG_SITE) ? "@" : " ", info.key,
+                   info.acquisitions, info.contentions, info.wait_total, info.wait_max,
+                   info.hold_total, info.hold_max);
+            for (uint32_t i = 0; i < MX_INFO_LOCK_STATS_SITES; i++) {
+                if (info.contending_sites[i] != 0) {
+                    printf("      contended at %#" PRIx64 " %" PRIu64 " times\n",
+                           info.contending_sites[i], info.contending_counts[i]);
+                }
+            }
+            shown++;
+        }
+    }
+    printf("keys with @ are call sites; %" PRIu64 " acquisitions not counted\n", load(&lost));
+}
+
+static int cmd_lockstat(int argc, const cmd_args* argv, uint32_t flags) {
+    if (argc < 2) {
+usage:
+        printf("usage:\n");
+        printf("%s dump [count]    : show the locks waited on longest\n", argv[0].str);
+        printf("%s reset           : clear the statistics\n", argv[0].str);
+        printf("%s on|off          : start or stop counting\n", argv[0].str);
+        return MX_ERR_INTERNAL;
+    }
+
+    if (!strcmp(argv[1].str, "dump")) {
+        lockstat_dump(argc > 2 ? static_cast<uint32_t>(argv[2].u) : 10u);
+    } else if (!strcmp(argv[1].str, "reset")) {
+        lockstat_reset();
+    } else if (!strcmp(argv[1].str, "on")) {
+        lockstat_set_enabled(true);
+    } else if (!strcmp(argv[1].str, "off")) {
+        lockstat_set_enabled(false);
+    } else {
+        printf("unknown command\n");
+        goto usage;
+    }
+    return MX_OK;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("lockstat", "kernel lock contention statistics", &cmd_lockstat)
+STATIC_COMMAND_END(lockstat);
@@ -0,0 +1,139 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/lockstat.h>
+
+#include <kernel/mutex.h>
+#include <kernel/thread.h>
+#include <magenta/syscalls/object.h>
+#include <platform.h>
+#include <unittest.h>
+
+namespace {
+
+// In the kernel's bss, so it is a class of its own.
+mutex_t test_lock;
+
+// Finds the statistics of |lock|'s class.
+bool find_class(const void* lock, mx_info_lock_stats_t* info) {
+    for (uint32_t slot = 0; slot < LOCKSTAT_CLASSES; slot++) {
+        if (lockstat_get_class(slot, info) && info->key == reinterpret_cast<uintptr_t>(lock))
+            return true;
+    }
+    return false;
+}
+
+int contender(void* arg) {
+    mutex_acquire(&test_lock);
+    mutex_release(&test_lock);
+    return 0;
+}
+
+bool acquire(void*) {
+    BEGIN_TEST;
+
+    bool was_enabled = lockstat_set_enabled(true);
+    mutex_init(&test_lock);
+    lockstat_reset();
+
+    for (int i = 0; i < 3; i++) {
+        mutex_acquire(&test_lock);
+        mutex_release(&test_lock);
+    }
+
+    mx_info_lock_stats_t info;
+    EXPECT_TRUE(find_class(&test_lock, &info), "lock not counted");
+    EXPECT_EQ(MX_INFO_LOCK_KIND_MUTEX, info.kind, "");
+    EXPECT_EQ(0u, info.flags & MX_INFO_LOCK_STATS_FLAG_SITE, "classed by call site");
+    EXPECT_EQ(3u, info.acquisitions, "");
+    EXPECT_EQ(0u, info.contentions, "");
+    EXPECT_EQ(0u, info.wait_total, "");
+
+    uint64_t holds = 0;
+    for (auto count : info.hold_histogram)
+        holds += count;
+    EXPECT_EQ(3u, holds, "");
+
+    mutex_destroy(&test_lock);
+    lockstat_set_enabled(was_enabled);
+
+    END_TEST;
+}
+
+bool contend(void*) {
+    BEGIN_TEST;
+
+    bool was_enabled = lockstat_set_enabled(true);
+    mutex_init(&test_lock);
+    lockstat_reset();
+
+    // Hold the lock until the contender has queued up behind it.
+    mutex_acquire(&test_lock);
+    thread_t* t = thread_create("lockstat contender", contender, nullptr,
+                                DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    if (t != nullptr) {
+        thread_resume(t);
+        while (!(mutex_val(&test_lock) & MUTEX_FLAG_QUEUED))
+            thread_sleep_relative(LK_MSEC(1));
+        thread_sleep_relative(LK_MSEC(1));
+    }
+    mutex_release(&test_lock);
+    REQUIRE_NONNULL(t, "thread_create failed");
+    thread_join(t, nullptr, INFINITE_TIME);
+
+    mx_info_lock_stats_t info;
+    EXPECT_TRUE(find_class(&test_lock, &info), "lock not counted");
+    EXPECT_EQ(2u, info.acquisitions, "");
+    EXPECT_EQ(1u, info.contentions, "");
+    EXPECT_LE(LK_MSEC(1), info.wait_total, "waited less than the lock was held");
+    EXPECT_EQ(info.wait_total, info.wait_max, "");
+    EXPECT_NE(0u, info.contending_sites[0], "no contending site");
+    EXPECT_EQ(1u, info.contending_counts[0], "");
+
+    mutex_destroy(&test_lock);
+    lockstat_set_enabled(was_enabled);
+
+    END_TEST;
+}
+
+bool reset(void*) {
+    BEGIN_TEST;
+
+    bool was_enabled = lockstat_set_enabled(true);
+    mutex_init(&test_lock);
+
+    // A reset while the lock is held leaves its class where the release
+    // will look for it.
+    mutex_acquire(&test_lock);
+    lockstat_reset();
+
+    mx_info_lock_stats_t info;
+    EXPECT_TRUE(find_class(&test_lock, &info), "class forgotten");
+    EXPECT_EQ(0u, info.acquisitions, "");
+    EXPECT_EQ(0u, info.hold_total, "");
+
+    mutex_release(&test_lock);
+
+    EXPECT_TRUE(find_class(&test_lock, &info), "class forgotten");
+    EXPECT_EQ(0u, info.acquisitions, "");
+    uint64_t holds = 0;
+    for (auto count : info.hold_histogram)
+        holds += count;
+    EXPECT_EQ(1u, holds, "release not counted");
+
+    mutex_destroy(&test_lock);
+    lockstat_set_enabled(was_enabled);
+
+    END_TEST;
+}
+
+} // namespace
+
+UNITTEST_START_TESTCASE(lockstat_tests)
+UNITTEST("acquire", acquire)
+UNITTEST("contend", contend)
+UNITTEST("reset", reset)
+UNITTEST_END_TESTCASE(lockstat_tests, "lockstat", "Lock statistics tests", nullptr, nullptr);
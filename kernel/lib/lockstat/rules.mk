@@ -0,0 +1,18 @@
+# Copyright 2017 The Fuchsia Authors
+#
+# Use of this source code is governed by a MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/lockstat.cpp \
+	$(LOCAL_DIR)/lockstat_tests.cpp
+
+MODULE_DEPS += \
+	kernel/lib/unittest
+
+include make/module.mk
@@ -0,0 +1,146 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <magenta/call_ring_dispatcher.h>
+
+#include <string.h>
+
+#include <kernel/vm.h>
+#include <kernel/vm/vm_aspace.h>
+#include <kernel/vm/vm_object_paged.h>
+#include <magenta/rights.h>
+#include <mxtl/algorithm.h>
+#include <mxtl/alloc_checker.h>
+#include <mxtl/auto_lock.h>
+
+using mxtl::AutoLock;
+
+static_assert(sizeof(mx_call_ring_t) <= MX_CALL_RING_SQ_OFFSET, "");
+static_assert(MX_CALL_RING_SQ_OFFSET % PAGE_SIZE == 0, "");
+
+namespace {
+
+uint32_t LoadIndex(const uint32_t* index) {
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+void StoreIndex(uint32_t* index, uint32_t value) {
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+} // namespace
+
+// static
+status_t CallRingDispatcher::Create(uint32_t options, uint32_t entries,
+                                    mxtl::RefPtr<Dispatcher>* dispatcher,
+                                    mx_rights_t* rights) {
+    if (options != 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (!entries || (entries & (entries - 1)) || entries > MX_CALL_RING_MAX_ENTRIES)
+        return MX_ERR_OUT_OF_RANGE;
+
+    const size_t cq_offset =
+        MX_CALL_RING_SQ_OFFSET + ROUNDUP(entries * sizeof(mx_call_sqe_t), PAGE_SIZE);
+    const size_t size = cq_offset + ROUNDUP(entries * sizeof(mx_call_cqe_t), PAGE_SIZE);
+
+    // As with shared fifos, the ring is committed and mapped into the kernel
+    // up front so that Enter() never faults on it, and userspace only gets
+    // mappings of it, never a handle to the VMO.
+    mxtl::RefPtr<VmObject> vmo;
+    status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, size, &vmo);
+    if (status != MX_OK)
+        return status;
+
+    uint64_t committed;
+    status = vmo->CommitRange(0, size, &committed);
+    if (status != MX_OK)
+        return status;
+    vmo->set_kernel_owned();
+
+    mxtl::RefPtr<VmMapping> mapping;
+    status = VmAspace::kernel_aspace()->RootVmar()->CreateVmMapping(
+            0 /* ignored */, size, 0 /* align pow2 */, 0 /* vmar flags */,
+            vmo, 0, ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE,
+            "call_ring", &mapping);
+    if (status != MX_OK)
+        return status;
+
+    status = mapping->MapRange(0, size, true);
+    if (status != MX_OK) {
+        mapping->Destroy();
+        return status;
+    }
+
+    auto ring = reinterpret_cast<mx_call_ring_t*>(mapping->base());
+    ring->entries = entries;
+    ring->cq_offset = static_cast<uint32_t>(cq_offset);
+
+    mxtl::AllocChecker ac;
+    auto disp = new (&ac) CallRingDispatcher(entries, static_cast<uint32_t>(cq_offset),
+                                             mxtl::move(vmo), mapping);
+    if (!ac.check()) {
+        mapping->Destroy();
+        return MX_ERR_NO_MEMORY;
+    }
+
+    *rights = MX_DEFAULT_CALL_RING_RIGHTS;
+    *dispatcher = mxtl::AdoptRef<Dispatcher>(disp);
+    return MX_OK;
+}
+
+CallRingDispatcher::CallRingDispatcher(uint32_t entries, uint32_t cq_offset,
+                                       mxtl::RefPtr<VmObject> vmo,
+                                       mxtl::RefPtr<VmMapping> mapping)
+    : entries_(entries), mask_(entries - 1),
+      vmo_(mxtl::move(vmo)), mapping_(mxtl::move(mapping)),
+      ring_(reinterpret_cast<mx_call_ring_t*>(mapping_->base())),
+      sq_(reinterpret_cast<const mx_call_sqe_t*>(mapping_->base() + MX_CALL_RING_SQ_OFFSET)),
+      cq_(reinterpret_cast<mx_call_cqe_t*>(mapping_->base() + cq_offset)) {
+}
+
+CallRingDispatcher::~CallRingDispatcher() {
+    mapping_->Destroy();
+}
+
+mx_status_t CallRingDispatcher::Enter(uint32_t count, call_ring_exec_fn_t exec,
+                                      uint32_t* actual) {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+
+    // A scribbled index makes one of the unsigned differences exceed the
+    // ring size.
+    const uint32_t pending = LoadIndex(&ring_->sq_tail) - sq_head_;
+    const uint32_t used = cq_tail_ - LoadIndex(&ring_->cq_head);
+    if (pending > entries_ || used > entries_)
+        return MX_ERR_BAD_STATE;
+
+    const uint32_t n = mxtl::min(count, mxtl::min(pending, entries_ - used));
+    if (n == 0u && pending > 0u && count > 0u)
+        return MX_ERR_SHOULD_WAIT;
+
+    for (uint32_t i = 0; i < n; i++) {
+        // Work from a private copy so userspace cannot change the entry
+        // between validation and use.
+        mx_call_sqe_t sqe;
+        memcpy(&sqe, &sq_[sq_head_ & mask_], sizeof(sqe));
+        sq_head_++;
+
+        mx_call_cqe_t* cqe = &cq_[cq_tail_ & mask_];
+        cqe->user_data = sqe.user_data;
+        cqe->status = (sqe.flags == 0u) ? exec(sqe) : MX_ERR_INVALID_ARGS;
+        cqe->reserved = 0u;
+        cq_tail_++;
+    }
+
+    // Publish the submissions consumed and the completions posted together,
+    // once all of them are written.
+    StoreIndex(&ring_->sq_head, sq_head_);
+    StoreIndex(&ring_->cq_tail, cq_tail_);
+
+    *actual = n;
+    return MX_OK;
+}
@@ -163,6 +163,44 @@ status_t ChannelDispatcher::Read(uint32_t* msg_size,
     return rv;
 }
 
+status_t ChannelDispatcher::ReadMany(uint32_t count, void* const* bufs,
+                                     uint32_t* msg_sizes, uint32_t* msg_handle_counts,
+                                     MessageList* msgs) {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+
+    if (messages_.is_empty())
+        return other_ ? MX_ERR_SHOULD_WAIT : MX_ERR_PEER_CLOSED;
+
+    status_t rv = MX_OK;
+    for (uint32_t i = 0; i < count && !messages_.is_empty(); ++i) {
+        auto max_size = msg_sizes[i];
+        auto max_handle_count = msg_handle_counts[i];
+        msg_sizes[i] = messages_.front().data_size();
+        msg_handle_counts[i] = messages_.front().num_handles();
+        if (msg_sizes[i] > max_size || msg_handle_counts[i] > max_handle_count) {
+            rv = MX_ERR_BUFFER_TOO_SMALL;
+            break;
+        }
+        // Copying under the lock keeps a concurrent reader from taking the
+        // messages behind this one first if the copy fails.
+        if (msg_sizes[i] > 0u && messages_.front().MoveDataTo(make_user_ptr(bufs[i])) != MX_OK) {
+            rv = MX_ERR_INVALID_ARGS;
+            break;
+        }
+        msgs->push_back(messages_.pop_front());
+    }
+
+    if (msgs->is_empty())
+        return rv;
+
+    if (messages_.is_empty())
+        state_tracker_.UpdateState(MX_CHANNEL_READABLE, 0u);
+
+    return MX_OK;
+}
+
 status_t ChannelDispatcher::Write(mxtl::unique_ptr<MessagePacket> msg) {
     canary_.Assert();
 
@@ -178,8 +216,39 @@ status_t ChannelDispatcher::Write(mxtl::unique_ptr<MessagePacket> msg) {
         other = other_;
     }
 
-    if (other->WriteSelf(mxtl::move(msg)) > 0)
-        thread_reschedule();
+    // A reply to a pending call starts a directed handoff to the caller; see
+    // DeliverLocked().
+    if (other->WriteSelf(mxtl::move(msg)) > 0) {
+        thread_handoff_yield();
+    } else {
+        thread_handoff_end();
+    }
+
+    return MX_OK;
+}
+
+status_t ChannelDispatcher::WriteMany(MessageList* msgs) {
+    canary_.Assert();
+
+    mxtl::RefPtr<ChannelDispatcher> other;
+    {
+        AutoLock lock(&lock_);
+        if (!other_) {
+            // The messages will be destroyed by the caller but we want to keep
+            // the handles alive since the caller should put them back into the
+            // process table.
+            for (auto& msg : *msgs)
+                msg.set_owns_handles(false);
+            return MX_ERR_PEER_CLOSED;
+        }
+        other = other_;
+    }
+
+    if (other->WriteSelfMany(msgs) > 0) {
+        thread_handoff_yield();
+    } else {
+        thread_handoff_end();
+    }
 
     return MX_OK;
 }
@@ -216,12 +285,20 @@ status_t ChannelDispatcher::Call(mxtl::unique_ptr<MessagePacket> msg,
         waiters_.push_back(waiter);
     }
 
-    // (1) Write outbound message to opposing endpoint.
+    // (1) Write outbound message to opposing endpoint. The server is most
+    // likely blocked waiting for it, and we are about to block waiting for
+    // the reply, so rather than waking the server on another cpu, switch to
+    // it directly once we block and give it the rest of our time slice.
+    thread_handoff_begin();
     other->WriteSelf(mxtl::move(msg));
 
     // Reuse the code from the half-call used for retrying a Call after thread
     // suspend.
-    return ResumeInterruptedCall(waiter, deadline, reply);
+    status_t status = ResumeInterruptedCall(waiter, deadline, reply);
+
+    // The handoff is consumed if we blocked; otherwise let the server run.
+    thread_handoff_end();
+    return status;
 }
 
 status_t ChannelDispatcher::ResumeInterruptedCall(MessageWaiter* waiter,
@@ -264,6 +341,28 @@ int ChannelDispatcher::WriteSelf(mxtl::unique_ptr<MessagePacket> msg) {
 
     AutoLock lock(&lock_);
 
+    bool queued = false;
+    int woken = DeliverLocked(mxtl::move(msg), &queued);
+    if (queued)
+        state_tracker_.UpdateState(0u, MX_CHANNEL_READABLE);
+    return woken;
+}
+
+int ChannelDispatcher::WriteSelfMany(MessageList* msgs) {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+
+    bool queued = false;
+    int woken = 0;
+    while (!msgs->is_empty())
+        woken += DeliverLocked(msgs->pop_front(), &queued);
+    if (queued)
+        state_tracker_.UpdateState(0u, MX_CHANNEL_READABLE);
+    return woken;
+}
+
+int ChannelDispatcher::DeliverLocked(mxtl::unique_ptr<MessagePacket> msg, bool* queued) {
     if (!waiters_.is_empty()) {
         // If the far side is waiting for replies to messages
         // send via "call", see if this message has a matching
@@ -274,14 +373,15 @@ int ChannelDispatcher::WriteSelf(mxtl::unique_ptr<MessagePacket> msg) {
             // Remove waiter from list.
             if (waiter.get_txid() == txid) {
                 waiters_.erase(waiter);
-                // we return how many threads have been woken up, or zero.
+                // The caller can run as soon as it has its reply; have our
+                // caller switch to it directly (see Write()).
+                thread_handoff_begin();
                 return waiter.Deliver(mxtl::move(msg));
             }
         }
     }
     messages_.push_back(mxtl::move(msg));
-
-    state_tracker_.UpdateState(0u, MX_CHANNEL_READABLE);
+    *queued = true;
     return 0;
 }
 
@@ -16,6 +16,7 @@
 
 #include <magenta/job_dispatcher.h>
 #include <magenta/magenta.h>
+#include <magenta/message_packet.h>
 #include <magenta/process_dispatcher.h>
 #include <magenta/vm_object_dispatcher.h>
 #include <mxtl/auto_lock.h>
@@ -59,7 +60,7 @@ static void DumpProcessListKeyMap() {
 }
 
 static const char* ObjectTypeToString(mx_obj_type_t type) {
-    static_assert(MX_OBJ_TYPE_LAST == 23, "need to update switch below");
+    static_assert(MX_OBJ_TYPE_LAST == 25, "need to update switch below");
 
     switch (type) {
         case MX_OBJ_TYPE_PROCESS: return "process";
@@ -80,6 +81,8 @@ static const char* ObjectTypeToString(mx_obj_type_t type) {
         case MX_OBJ_TYPE_GUEST: return "guest";
         case MX_OBJ_TYPE_VCPU: return "vcpu";
         case MX_OBJ_TYPE_TIMER: return "timer";
+        case MX_OBJ_TYPE_WAIT_SET: return "waitset";
+        case MX_OBJ_TYPE_CALL_RING: return "call-ring";
         default: return "???";
     }
 }
@@ -766,6 +769,7 @@ static int cmd_diagnostics(int argc, const cmd_args* argv, uint32_t flags) {
         printf("%s asd  <pid>|kernel : dump process/kernel address space\n",
                argv[0].str);
         printf("%s htinfo            : handle table info\n", argv[0].str);
+        printf("%s msginfo           : channel message arena info\n", argv[0].str);
         return -1;
     }
 
@@ -834,6 +838,10 @@ static int cmd_diagnostics(int argc, const cmd_args* argv, uint32_t flags) {
         if (argc != 2)
             goto usage;
         DumpHandleTable();
+    } else if (strcmp(argv[1].str, "msginfo") == 0) {
+        if (argc != 2)
+            goto usage;
+        MessagePacket::DumpArenas();
     } else {
         printf("unrecognized subcommand '%s'\n", argv[1].str);
         goto usage;
@@ -8,6 +8,9 @@
 
 #include <string.h>
 
+#include <kernel/vm.h>
+#include <kernel/vm/vm_aspace.h>
+#include <kernel/vm/vm_object_paged.h>
 #include <lib/user_copy/user_ptr.h>
 #include <magenta/handle.h>
 #include <magenta/rights.h>
@@ -16,36 +19,84 @@
 
 using mxtl::AutoLock;
 
+static_assert(sizeof(mx_fifo_ring_t) <= MX_FIFO_RING_DATA_OFFSET, "");
+static_assert(MX_FIFO_RING_DATA_OFFSET % PAGE_SIZE == 0, "");
+
+namespace {
+
+uint32_t LoadIndex(const uint32_t* index) {
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+void StoreIndex(uint32_t* index, uint32_t value) {
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+} // namespace
+
 // static
 status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t options,
                                 mxtl::RefPtr<Dispatcher>* dispatcher0,
                                 mxtl::RefPtr<Dispatcher>* dispatcher1,
                                 mx_rights_t* rights) {
+    const bool shared = (options & MX_FIFO_SHARED) != 0;
+    const uint32_t max_size = shared ? kMaxSharedSizeBytes : kMaxSizeBytes;
+
     // count and elemsize must be nonzero
     // count must be a power of two
-    // total size must be <= kMaxSizeBytes
+    // total size must be <= max_size
     if (!count || !elemsize || (count & (count - 1)) ||
-        (count > kMaxSizeBytes) || (elemsize > kMaxSizeBytes) ||
-        ((count * elemsize) > kMaxSizeBytes)) {
+        (count > max_size) || (elemsize > max_size) ||
+        ((count * elemsize) > max_size)) {
         return MX_ERR_OUT_OF_RANGE;
     }
+    if (options & ~MX_FIFO_SHARED)
+        return MX_ERR_INVALID_ARGS;
 
     mxtl::AllocChecker ac;
-    auto data0 = mxtl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
-    if (!ac.check())
-        return MX_ERR_NO_MEMORY;
-
-    auto fifo0 = mxtl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize, mxtl::move(data0)));
-    if (!ac.check())
-        return MX_ERR_NO_MEMORY;
+    mxtl::unique_ptr<uint8_t[]> data0;
+    mxtl::unique_ptr<uint8_t[]> data1;
+    mxtl::RefPtr<VmObject> vmo0;
+    mxtl::RefPtr<VmObject> vmo1;
+    mxtl::RefPtr<VmMapping> mapping0;
+    mxtl::RefPtr<VmMapping> mapping1;
+    if (shared) {
+        status_t status = CreateSharedRing(count, elemsize, &vmo0, &mapping0);
+        if (status != MX_OK)
+            return status;
+        status = CreateSharedRing(count, elemsize, &vmo1, &mapping1);
+        if (status != MX_OK) {
+            mapping0->Destroy();
+            return status;
+        }
+    } else {
+        data0.reset(new (&ac) uint8_t[count * elemsize]);
+        if (!ac.check())
+            return MX_ERR_NO_MEMORY;
+        data1.reset(new (&ac) uint8_t[count * elemsize]);
+        if (!ac.check())
+            return MX_ERR_NO_MEMORY;
+    }
 
-    auto data1 = mxtl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
-    if (!ac.check())
+    auto fifo0 = mxtl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize,
+                                                         mxtl::move(data0), mxtl::move(vmo0),
+                                                         mapping0));
+    if (!ac.check()) {
+        if (mapping0)
+            mapping0->Destroy();
+        if (mapping1)
+            mapping1->Destroy();
         return MX_ERR_NO_MEMORY;
+    }
 
-    auto fifo1 = mxtl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize, mxtl::move(data1)));
-    if (!ac.check())
+    auto fifo1 = mxtl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize,
+                                                         mxtl::move(data1), mxtl::move(vmo1),
+                                                         mapping1));
+    if (!ac.check()) {
+        if (mapping1)
+            mapping1->Destroy();
         return MX_ERR_NO_MEMORY;
+    }
 
     fifo0->Init(fifo1);
     fifo1->Init(fifo0);
@@ -56,14 +107,66 @@ status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t opti
     return MX_OK;
 }
 
+// static
+status_t FifoDispatcher::CreateSharedRing(uint32_t elem_count, uint32_t elem_size,
+                                          mxtl::RefPtr<VmObject>* vmo,
+                                          mxtl::RefPtr<VmMapping>* mapping) {
+    const size_t size = MX_FIFO_RING_DATA_OFFSET + ROUNDUP(elem_count * elem_size, PAGE_SIZE);
+
+    // The ring is committed and mapped into the kernel up front so that
+    // reads and writes through the syscalls never fault. Userspace only
+    // ever gets mappings of it, never a handle, so it cannot be resized
+    // or decommitted underneath the kernel mapping, and it is marked
+    // kernel owned so a moving channel write cannot take its pages either.
+    mxtl::RefPtr<VmObject> ring_vmo;
+    status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, size, &ring_vmo);
+    if (status != MX_OK)
+        return status;
+
+    uint64_t committed;
+    status = ring_vmo->CommitRange(0, size, &committed);
+    if (status != MX_OK)
+        return status;
+    ring_vmo->set_kernel_owned();
+
+    mxtl::RefPtr<VmMapping> ring_mapping;
+    status = VmAspace::kernel_aspace()->RootVmar()->CreateVmMapping(
+            0 /* ignored */, size, 0 /* align pow2 */, 0 /* vmar flags */,
+            ring_vmo, 0, ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE,
+            "fifo_ring", &ring_mapping);
+    if (status != MX_OK)
+        return status;
+
+    status = ring_mapping->MapRange(0, size, true);
+    if (status != MX_OK) {
+        ring_mapping->Destroy();
+        return status;
+    }
+
+    auto ring = reinterpret_cast<mx_fifo_ring_t*>(ring_mapping->base());
+    ring->elem_count = elem_count;
+    ring->elem_size = elem_size;
+
+    *vmo = mxtl::move(ring_vmo);
+    *mapping = mxtl::move(ring_mapping);
+    return MX_OK;
+}
+
 FifoDispatcher::FifoDispatcher(uint32_t /*options*/, uint32_t count, uint32_t elem_size,
-                               mxtl::unique_ptr<uint8_t[]> data)
+                               mxtl::unique_ptr<uint8_t[]> data,
+                               mxtl::RefPtr<VmObject> vmo, mxtl::RefPtr<VmMapping> mapping)
     : elem_count_(count), elem_size_(elem_size), mask_(count - 1),
       peer_koid_(0u), state_tracker_(MX_FIFO_WRITABLE),
-      head_(0u), tail_(0u), data_(mxtl::move(data)) {
+      ring_(mapping ? reinterpret_cast<mx_fifo_ring_t*>(mapping->base()) : &local_ring_),
+      data_(mapping ? reinterpret_cast<uint8_t*>(mapping->base()) + MX_FIFO_RING_DATA_OFFSET
+                    : data.get()),
+      local_ring_{}, heap_data_(mxtl::move(data)),
+      vmo_(mxtl::move(vmo)), mapping_(mxtl::move(mapping)) {
 }
 
 FifoDispatcher::~FifoDispatcher() {
+    if (mapping_)
+        mapping_->Destroy();
 }
 
 // Thread safety analysis disabled as this happens during creation only,
@@ -113,6 +216,66 @@ void FifoDispatcher::on_zero_handles() {
         fifo->OnPeerZeroHandles();
 }
 
+mx_status_t FifoDispatcher::GetRingVmo(bool write_ring, mxtl::RefPtr<VmObject>* vmo) {
+    canary_.Assert();
+
+    if (!vmo_)
+        return MX_ERR_NOT_SUPPORTED;
+
+    if (!write_ring) {
+        *vmo = vmo_;
+        return MX_OK;
+    }
+
+    AutoLock lock(&lock_);
+    if (!other_)
+        return MX_ERR_PEER_CLOSED;
+    *vmo = other_->vmo_;
+    return MX_OK;
+}
+
+mx_status_t FifoDispatcher::Doorbell() {
+    canary_.Assert();
+
+    if (!vmo_)
+        return MX_ERR_NOT_SUPPORTED;
+
+    mxtl::RefPtr<FifoDispatcher> other;
+    {
+        AutoLock lock(&lock_);
+        UpdateSignalsLocked();
+        other = other_;
+    }
+    if (other)
+        other->DoorbellSelf();
+    return MX_OK;
+}
+
+void FifoDispatcher::DoorbellSelf() {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+    UpdateSignalsLocked();
+}
+
+void FifoDispatcher::UpdateSignalsLocked() {
+    // A shared ring may have been scribbled on; the unsigned difference
+    // then exceeds elem_count_, which reads as full here.
+    uint32_t used = LoadIndex(&ring_->head) - LoadIndex(&ring_->tail);
+
+    if (used == 0)
+        state_tracker_.UpdateState(MX_FIFO_READABLE, 0u);
+    else
+        state_tracker_.UpdateState(0u, MX_FIFO_READABLE);
+
+    if (!other_)
+        return;
+    if (used >= elem_count_)
+        other_->state_tracker_.UpdateState(MX_FIFO_WRITABLE, 0u);
+    else
+        other_->state_tracker_.UpdateState(0u, MX_FIFO_WRITABLE);
+}
+
 void FifoDispatcher::OnPeerZeroHandles() {
     canary_.Assert();
 
@@ -176,21 +339,23 @@ mx_status_t FifoDispatcher::WriteSelf(const uint8_t* ptr, size_t bytelen, uint32
 
     AutoLock lock(&lock_);
 
-    uint32_t old_head = head_;
+    const uint32_t old_head = LoadIndex(&ring_->head);
+    uint32_t head = old_head;
+    uint32_t used = head - LoadIndex(&ring_->tail);
+    if (used > elem_count_)
+        return MX_ERR_BAD_STATE;
 
     // total number of available empty slots in the fifo
-    size_t avail = elem_count_ - (head_ - tail_);
+    size_t avail = elem_count_ - used;
 
     if (avail == 0)
         return MX_ERR_SHOULD_WAIT;
 
-    bool was_empty = (avail == elem_count_);
-
     if (count > avail)
         count = avail;
 
     while (count > 0) {
-        uint32_t offset = (head_ & mask_);
+        uint32_t offset = (head & mask_);
 
         // number of slots from target to end, inclusive
         uint32_t n = elem_count_ - offset;
@@ -200,27 +365,22 @@ mx_status_t FifoDispatcher::WriteSelf(const uint8_t* ptr, size_t bytelen, uint32
 
         mx_status_t status = copy_from_fn(ptr, &data_[offset * elem_size_], to_copy * elem_size_);
         if (status != MX_OK) {
-            // roll back, in case this is the second copy
-            head_ = old_head;
+            // nothing has been published yet, so there is nothing to roll back
             return MX_ERR_INVALID_ARGS;
         }
 
         // adjust head and count
         // due to size limitations on fifo, to_copy will always fit in a u32
-        head_ += static_cast<uint32_t>(to_copy);
+        head += static_cast<uint32_t>(to_copy);
         count -= to_copy;
         ptr += to_copy * elem_size_;
     }
 
-    // if was empty, we've become readable
-    if (was_empty)
-        state_tracker_.UpdateState(0u, MX_FIFO_READABLE);
-
-    // if now full, we're no longer writable
-    if (elem_count_ == (head_ - tail_))
-        other_->state_tracker_.UpdateState(MX_FIFO_WRITABLE, 0u);
+    // publish the new elements only once they have all been copied
+    StoreIndex(&ring_->head, head);
+    UpdateSignalsLocked();
 
-    *actual = (head_ - old_head);
+    *actual = (head - old_head);
     return MX_OK;
 }
 
@@ -234,21 +394,22 @@ mx_status_t FifoDispatcher::Read(uint8_t* ptr, size_t bytelen, uint32_t* actual,
 
     AutoLock lock(&lock_);
 
-    uint32_t old_tail = tail_;
+    const uint32_t old_tail = LoadIndex(&ring_->tail);
+    uint32_t tail = old_tail;
 
     // total number of available entries to read from the fifo
-    size_t avail = (head_ - tail_);
+    size_t avail = LoadIndex(&ring_->head) - tail;
+    if (avail > elem_count_)
+        return MX_ERR_BAD_STATE;
 
     if (avail == 0)
         return MX_ERR_SHOULD_WAIT;
 
-    bool was_full = (avail == elem_count_);
-
     if (count > avail)
         count = avail;
 
     while (count > 0) {
-        uint32_t offset = (tail_ & mask_);
+        uint32_t offset = (tail & mask_);
 
         // number of slots from target to end, inclusive
         uint32_t n = elem_count_ - offset;
@@ -258,27 +419,21 @@ mx_status_t FifoDispatcher::Read(uint8_t* ptr, size_t bytelen, uint32_t* actual,
 
         mx_status_t status = copy_to_fn(ptr, &data_[offset * elem_size_], to_copy * elem_size_);
         if (status != MX_OK) {
-            // roll back, in case this is the second copy
-            tail_ = old_tail;
+            // nothing has been consumed yet, so there is nothing to roll back
             return MX_ERR_INVALID_ARGS;
         }
 
         // adjust tail and count
         // due to size limitations on fifo, to_copy will always fit in a u32
-        tail_ += static_cast<uint32_t>(to_copy);
+        tail += static_cast<uint32_t>(to_copy);
         count -= to_copy;
         ptr += to_copy * elem_size_;
 
     }
 
-    // if we were full, we have become writable
-    if (was_full && other_)
-        other_->state_tracker_.UpdateState(0u, MX_FIFO_WRITABLE);
-
-    // if we've become empty, we're no longer readable
-    if ((head_ - tail_) == 0)
-        state_tracker_.UpdateState(MX_FIFO_READABLE, 0u);
+    StoreIndex(&ring_->tail, tail);
+    UpdateSignalsLocked();
 
-    *actual = (tail_ - old_tail);
+    *actual = (tail - old_tail);
     return MX_OK;
 }
@@ -11,13 +11,18 @@
 #include <lib/user_copy/user_ptr.h>
 #include <magenta/user_copy.h>
 #include <magenta/thread_dispatcher.h>
+#include <kernel/thread.h>
 #include <mxtl/auto_lock.h>
+#include <mxtl/algorithm.h>
 #include <trace.h>
 
 using mxtl::AutoLock;
 
 #define LOCAL_TRACE 0
 
+constexpr uint32_t FutexContext::kShardBits;
+constexpr uint32_t FutexContext::kNumShards;
+
 FutexContext::FutexContext() {
     LTRACE_ENTRY;
 }
@@ -27,16 +32,38 @@ FutexContext::~FutexContext() {
 
     // All of the threads should have removed themselves from wait queues
     // by the time the process has exited.
-    DEBUG_ASSERT(futex_table_.is_empty());
+    for (auto& shard : shards_) {
+        DEBUG_ASSERT(shard.waiters.load() == 0u);
+        DEBUG_ASSERT(shard.futex_table.is_empty());
+    }
+    DEBUG_ASSERT(pi_waiters_.load() == 0u);
+}
+
+FutexContext::Shard* FutexContext::ShardForKey(uintptr_t futex_key) {
+    // Futexes are often packed together in user structures, so mix the
+    // address before picking the shard rather than using its low bits.
+    const uint64_t hash = static_cast<uint64_t>(futex_key >> 2) * 0x9E3779B97F4A7C15ull;
+    return &shards_[hash >> (64 - kShardBits)];
 }
 
-status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline) {
+bool FutexContext::HasNoWaiters(Shard* shard) {
+    // FutexWait() counts itself in |waiters| before it reads the futex
+    // value. The fence orders our caller's earlier change to the futex
+    // value before the load below, so either that read sees the new value
+    // or we see the waiter.
+    mxtl::atomic_thread_fence();
+    return shard->waiters.load(mxtl::memory_order_relaxed) == 0u;
+}
+
+status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline,
+                                 mxtl::RefPtr<ThreadDispatcher> owner) {
     LTRACE_ENTRY;
 
     uintptr_t futex_key = reinterpret_cast<uintptr_t>(value_ptr.get());
     if (futex_key % sizeof(int))
         return MX_ERR_INVALID_ARGS;
 
+    Shard* shard = ShardForKey(futex_key);
     FutexNode* node;
 
     // FutexWait() checks that the address value_ptr still contains
@@ -45,16 +72,25 @@ status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_
     // If a FutexWake() operation could occur between them, a userland mutex
     // operation built on top of futexes would have a race condition that
     // could miss wakeups.
-    lock_.Acquire();
+    shard->lock.Acquire();
+
+    // This must happen before the value is read; see HasNoWaiters(). The
+    // fence pairs with the one there: the copy_from_user() read below is a
+    // plain load, so the seq_cst increment alone does not keep it from
+    // being reordered ahead of the store into |waiters|.
+    shard->waiters.fetch_add(1u);
+    mxtl::atomic_thread_fence();
 
     int value;
     status_t result = value_ptr.copy_from_user(&value);
     if (result != MX_OK) {
-        lock_.Release();
+        shard->waiters.fetch_sub(1u);
+        shard->lock.Release();
         return result;
     }
     if (value != current_value) {
-        lock_.Release();
+        shard->waiters.fetch_sub(1u);
+        shard->lock.Release();
         return MX_ERR_BAD_STATE;
     }
 
@@ -62,11 +98,19 @@ status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_
     node = thread->futex_node();
     node->set_hash_key(futex_key);
     node->SetAsSingletonList();
+    node->pi_thread_ = thread;
 
-    QueueNodesLocked(node);
+    if (owner) {
+        node->pi_priority_ = thread_get_effective_priority(get_current_thread());
+        AutoLock pi_lock(&pi_lock_);
+        AttachPiWaiterLocked(node, mxtl::move(owner));
+    }
 
-    // Block current thread.  This releases lock_ and does not reacquire it.
-    result = node->BlockThread(&lock_, deadline);
+    QueueNodesLocked(shard, node, 0u);
+
+    // Block current thread.  This releases the shard lock and does not
+    // reacquire it.
+    result = node->BlockThread(&shard->lock, deadline);
     if (result == MX_OK) {
         DEBUG_ASSERT(!node->IsInQueue());
         // All the work necessary for removing us from the hash table was done by FutexWake()
@@ -79,8 +123,7 @@ status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_
     //
     // We need to ensure that the thread's node is removed from the wait
     // queue, because FutexWake() probably didn't do that.
-    AutoLock lock(&lock_);
-    if (UnqueueNodeLocked(node)) {
+    if (UnqueueNode(node)) {
         return result;
     }
     // The current thread was not found on the wait queue.  This means
@@ -115,22 +158,33 @@ status_t FutexContext::FutexWake(user_ptr<const int> value_ptr,
     if (futex_key % sizeof(int))
         return MX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
+    Shard* shard = ShardForKey(futex_key);
+    if (HasNoWaiters(shard))
+        return MX_OK;
+
+    AutoLock lock(&shard->lock);
 
-    FutexNode* node = futex_table_.erase(futex_key);
+    FutexNode* node = shard->futex_table.erase(futex_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return MX_OK;
     }
     DEBUG_ASSERT(node->GetKey() == futex_key);
 
+    if (pi_waiters_.load(mxtl::memory_order_relaxed) != 0u) {
+        AutoLock pi_lock(&pi_lock_);
+        HandOffPiWaitersLocked(node, count);
+    }
+
     bool any_woken = false;
+    uint32_t removed = 0u;
     FutexNode* remaining_waiters =
-        FutexNode::WakeThreads(node, count, futex_key, &any_woken);
+        FutexNode::WakeThreads(node, count, futex_key, &any_woken, &removed);
+    shard->waiters.fetch_sub(removed);
 
     if (remaining_waiters) {
         DEBUG_ASSERT(remaining_waiters->GetKey() == futex_key);
-        futex_table_.insert(remaining_waiters);
+        shard->futex_table.insert(remaining_waiters);
     }
 
     if (any_woken) {
@@ -142,37 +196,90 @@ status_t FutexContext::FutexWake(user_ptr<const int> value_ptr,
 }
 
 status_t FutexContext::FutexRequeue(user_ptr<int> wake_ptr, uint32_t wake_count, int current_value,
-                                    user_ptr<int> requeue_ptr, uint32_t requeue_count) {
+                                    user_ptr<int> requeue_ptr, uint32_t requeue_count)
+    TA_NO_THREAD_SAFETY_ANALYSIS {
     LTRACE_ENTRY;
 
     if ((requeue_ptr.get() == nullptr) && requeue_count)
         return MX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
+    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
+    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
+    if (wake_key == requeue_key) return MX_ERR_INVALID_ARGS;
+    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
+        return MX_ERR_INVALID_ARGS;
+
+    Shard* wake_shard = ShardForKey(wake_key);
+
+    // Condition variables requeue one waiter at a time as each woken
+    // thread leaves, usually before the next one has blocked, so this is
+    // worth doing without any lock. The value is still checked so that
+    // callers see the same result as they would from the slow path.
+    if (HasNoWaiters(wake_shard)) {
+        int value;
+        status_t result = wake_ptr.copy_from_user(&value);
+        if (result != MX_OK) return result;
+        return (value == current_value) ? MX_OK : MX_ERR_BAD_STATE;
+    }
+
+    // Take both shard locks, lowest address first, so that requeues in
+    // opposite directions cannot deadlock.
+    Shard* requeue_shard = requeue_count ? ShardForKey(requeue_key) : wake_shard;
+    Shard* first = (wake_shard < requeue_shard) ? wake_shard : requeue_shard;
+    Shard* second = (wake_shard < requeue_shard) ? requeue_shard : wake_shard;
+    first->lock.Acquire();
+    if (second != first)
+        second->lock.Acquire();
+
+    bool any_woken = false;
+    status_t result = RequeueLocked(wake_shard, wake_ptr, wake_count, current_value,
+                                    requeue_shard, requeue_key, requeue_count, &any_woken);
+
+    if (second != first)
+        second->lock.Release();
+    first->lock.Release();
+
+    if (any_woken)
+        thread_reschedule();
 
+    return result;
+}
+
+status_t FutexContext::RequeueLocked(Shard* wake_shard, user_ptr<int> wake_ptr,
+                                     uint32_t wake_count, int current_value,
+                                     Shard* requeue_shard, uintptr_t requeue_key,
+                                     uint32_t requeue_count, bool* any_woken) {
     int value;
     status_t result = wake_ptr.copy_from_user(&value);
     if (result != MX_OK) return result;
     if (value != current_value) return MX_ERR_BAD_STATE;
 
     uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
-    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
-    if (wake_key == requeue_key) return MX_ERR_INVALID_ARGS;
-    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
-        return MX_ERR_INVALID_ARGS;
 
     // This must happen before RemoveFromHead() calls set_hash_key() on
-    // nodes below, because operations on futex_table_ look at the GetKey
+    // nodes below, because operations on futex_table look at the GetKey
     // field of the list head nodes for wake_key and requeue_key.
-    FutexNode* node = futex_table_.erase(wake_key);
+    FutexNode* node = wake_shard->futex_table.erase(wake_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return MX_OK;
     }
 
-    bool any_woken = false;
+    // Whoever owns the requeue futex is not known, so the threads leaving
+    // this futex stop boosting its owner.
+    if (pi_waiters_.load(mxtl::memory_order_relaxed) != 0u) {
+        uint32_t leaving = (wake_count > UINT32_MAX - requeue_count)
+                               ? UINT32_MAX : wake_count + requeue_count;
+        AutoLock pi_lock(&pi_lock_);
+        node->ForEach(leaving, [this](FutexNode* leaving_node) {
+            DetachPiWaiterLocked(leaving_node);
+        });
+    }
+
     if (wake_count > 0) {
-        node = FutexNode::WakeThreads(node, wake_count, wake_key, &any_woken);
+        uint32_t removed = 0u;
+        node = FutexNode::WakeThreads(node, wake_count, wake_key, any_woken, &removed);
+        wake_shard->waiters.fetch_sub(removed);
     }
 
     // node is now the head of wake_ptr futex after possibly removing some threads to wake
@@ -180,31 +287,32 @@ status_t FutexContext::FutexRequeue(user_ptr<int> wake_ptr, uint32_t wake_count,
         if (requeue_count > 0) {
             // head and tail of list of nodes to requeue
             FutexNode* requeue_head = node;
+            uint32_t removed = 0u;
             node = FutexNode::RemoveFromHead(node, requeue_count,
-                                             wake_key, requeue_key);
+                                             wake_key, requeue_key, &removed);
 
             // now requeue our nodes to requeue_ptr mutex
             DEBUG_ASSERT(requeue_head->GetKey() == requeue_key);
-            QueueNodesLocked(requeue_head);
+            wake_shard->waiters.fetch_sub(removed);
+            QueueNodesLocked(requeue_shard, requeue_head, removed);
         }
     }
 
     // add any remaining nodes back to wake_key futex
     if (node != nullptr) {
         DEBUG_ASSERT(node->GetKey() == wake_key);
-        futex_table_.insert(node);
-    }
-
-    if (any_woken) {
-        lock.release();
-        thread_reschedule();
+        wake_shard->futex_table.insert(node);
     }
 
     return MX_OK;
 }
 
-void FutexContext::QueueNodesLocked(FutexNode* head) {
-    DEBUG_ASSERT(lock_.IsHeld());
+// Adds the list of nodes starting at |head| to its futex's queue, and
+// |count| to the shard's waiters.
+void FutexContext::QueueNodesLocked(Shard* shard, FutexNode* head, uint32_t count) {
+    DEBUG_ASSERT(shard->lock.IsHeld());
+
+    shard->waiters.fetch_add(count);
 
     FutexNode::HashTable::iterator iter;
 
@@ -212,29 +320,95 @@ void FutexContext::QueueNodesLocked(FutexNode* head) {
     // succeeds, then the current thread is first to block on this futex and we
     // are finished.  If the insert fails, then there is already a thread
     // waiting on this futex.  Add ourselves to that thread's list.
-    if (!futex_table_.insert_or_find(head, &iter))
+    if (!shard->futex_table.insert_or_find(head, &iter))
         iter->AppendList(head);
 }
 
 // This attempts to unqueue a thread (which may or may not be waiting on a
 // futex), given its FutexNode.  This returns whether the FutexNode was
 // found and removed from a futex wait queue.
-bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
-    DEBUG_ASSERT(lock_.IsHeld());
-
-    if (!node->IsInQueue())
-        return false;
-
+bool FutexContext::UnqueueNode(FutexNode* node) {
     // Note: When UnqueueNode() is called from FutexWait(), it might be
     // tempting to reuse the futex key that was passed to FutexWait().
     // However, that could be out of date if the thread was requeued by
     // FutexRequeue(), so we need to re-get the hash table key here.
-    uintptr_t futex_key = node->GetKey();
-
-    FutexNode* old_head = futex_table_.erase(futex_key);
-    DEBUG_ASSERT(old_head);
-    FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
-    if (new_head)
-        futex_table_.insert(new_head);
-    return true;
+    //
+    // FutexRequeue() only changes the key while holding the locks of both
+    // the old and the new key's shards, so once we hold the lock of the
+    // shard the current key maps to, the key cannot move to another shard.
+    for (;;) {
+        Shard* shard = ShardForKey(node->GetKey());
+        AutoLock lock(&shard->lock);
+        if (ShardForKey(node->GetKey()) != shard)
+            continue;
+
+        if (!node->IsInQueue())
+            return false;
+
+        uintptr_t futex_key = node->GetKey();
+        FutexNode* old_head = shard->futex_table.erase(futex_key);
+        DEBUG_ASSERT(old_head);
+        FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
+        if (new_head)
+            shard->futex_table.insert(new_head);
+        shard->waiters.fetch_sub(1u);
+
+        if (node->pi_owner_) {
+            AutoLock pi_lock(&pi_lock_);
+            DetachPiWaiterLocked(node);
+        }
+        return true;
+    }
+}
+
+void FutexContext::AttachPiWaiterLocked(FutexNode* node, mxtl::RefPtr<ThreadDispatcher> owner) {
+    DEBUG_ASSERT(pi_lock_.IsHeld());
+    DEBUG_ASSERT(!node->pi_owner_);
+
+    ThreadDispatcher* raw_owner = owner.get();
+    raw_owner->futex_node()->pi_waiters_.push_back(node);
+    node->pi_owner_ = mxtl::move(owner);
+    pi_waiters_.fetch_add(1u);
+    UpdateInheritedPriority(raw_owner);
+}
+
+void FutexContext::DetachPiWaiterLocked(FutexNode* node) {
+    DEBUG_ASSERT(pi_lock_.IsHeld());
+
+    if (!node->pi_owner_)
+        return;
+
+    mxtl::RefPtr<ThreadDispatcher> owner = mxtl::move(node->pi_owner_);
+    owner->futex_node()->pi_waiters_.erase(*node);
+    pi_waiters_.fetch_sub(1u);
+    UpdateInheritedPriority(owner.get());
+}
+
+// Called before waking |wake_count| threads from the futex whose list of
+// waiters starts at |head|. The woken threads stop boosting the futex's
+// owner, which is about to release it. If a single thread is being woken it
+// is the likeliest next owner, so the threads left waiting boost it instead.
+void FutexContext::HandOffPiWaitersLocked(FutexNode* head, uint32_t wake_count) {
+    DEBUG_ASSERT(pi_lock_.IsHeld());
+
+    mxtl::RefPtr<ThreadDispatcher> next_owner;
+    if (wake_count == 1u)
+        next_owner = mxtl::WrapRefPtr(head->pi_thread_);
+
+    uint32_t index = 0u;
+    head->ForEach(UINT32_MAX, [&](FutexNode* node) {
+        const bool woken = index++ < wake_count;
+        if (!node->pi_owner_)
+            return;
+        DetachPiWaiterLocked(node);
+        if (!woken && next_owner)
+            AttachPiWaiterLocked(node, next_owner);
+    });
+}
+
+void FutexContext::UpdateInheritedPriority(ThreadDispatcher* owner) {
+    int priority = LOWEST_PRIORITY;
+    for (const auto& waiter : owner->futex_node()->pi_waiters_)
+        priority = mxtl::max(priority, waiter.pi_priority_);
+    owner->SetInheritedPriority(priority);
 }
@@ -0,0 +1,68 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <stdint.h>
+
+#include <kernel/vm/vm_address_region.h>
+#include <kernel/vm/vm_object.h>
+#include <magenta/dispatcher.h>
+#include <magenta/syscalls/call_ring.h>
+#include <magenta/types.h>
+
+#include <mxtl/canary.h>
+#include <mxtl/mutex.h>
+#include <mxtl/ref_ptr.h>
+
+// Runs one submission on behalf of the current thread and returns the status
+// to post as its completion.
+typedef mx_status_t (*call_ring_exec_fn_t)(const mx_call_sqe_t& sqe);
+
+// A call ring is a pair of submission and completion queues in a committed
+// VMO which userspace maps and the kernel keeps mapped. Submissions are only
+// run from CallRingDispatcher::Enter(), on the thread that calls it, so that
+// they see that thread's process and address space exactly as the
+// corresponding syscalls would.
+//
+// The kernel keeps its own copies of the indices it advances and validates
+// the ones userspace advances, since userspace can write to the control
+// block at any time.
+class CallRingDispatcher final : public Dispatcher {
+public:
+    static status_t Create(uint32_t options, uint32_t entries,
+                           mxtl::RefPtr<Dispatcher>* dispatcher, mx_rights_t* rights);
+
+    ~CallRingDispatcher() final;
+    mx_obj_type_t get_type() const final { return MX_OBJ_TYPE_CALL_RING; }
+
+    const mxtl::RefPtr<VmObject>& vmo() const { return vmo_; }
+
+    // Runs up to |count| queued submissions through |exec| in order and
+    // posts a completion for each. Stops early when the submission queue
+    // runs out or the completion queue fills up. On success |*actual| is
+    // the number of submissions consumed.
+    mx_status_t Enter(uint32_t count, call_ring_exec_fn_t exec, uint32_t* actual);
+
+private:
+    CallRingDispatcher(uint32_t entries, uint32_t cq_offset, mxtl::RefPtr<VmObject> vmo,
+                       mxtl::RefPtr<VmMapping> mapping);
+
+    mxtl::Canary<mxtl::magic("CRNG")> canary_;
+    const uint32_t entries_;
+    const uint32_t mask_;
+
+    const mxtl::RefPtr<VmObject> vmo_;
+    const mxtl::RefPtr<VmMapping> mapping_;
+    mx_call_ring_t* const ring_;
+    const mx_call_sqe_t* const sq_;
+    mx_call_cqe_t* const cq_;
+
+    // Serializes Enter() calls.
+    mxtl::Mutex lock_;
+    uint32_t sq_head_ TA_GUARDED(lock_) = 0u;
+    uint32_t cq_tail_ TA_GUARDED(lock_) = 0u;
+};
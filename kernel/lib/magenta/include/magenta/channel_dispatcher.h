@@ -25,6 +25,8 @@ class ChannelDispatcher final : public Dispatcher {
 public:
     class MessageWaiter;
 
+    using MessageList = mxtl::DoublyLinkedList<mxtl::unique_ptr<MessagePacket>>;
+
     static status_t Create(uint32_t flags, mxtl::RefPtr<Dispatcher>* dispatcher0,
                            mxtl::RefPtr<Dispatcher>* dispatcher1, mx_rights_t* rights);
 
@@ -47,8 +49,32 @@ public:
                   mxtl::unique_ptr<MessagePacket>* msg,
                   bool may_disard);
 
+    // Read up to |count| messages from this endpoint's message queue under a
+    // single lock acquisition. |msg_sizes| and |msg_handle_counts| are arrays
+    // of |count| in-out parameters with the same meaning as in Read().
+    // Messages are taken in order until one does not fit its buffers; that
+    // message stays queued and its size is written to the corresponding
+    // entries, but only the entries of the messages taken are reported to
+    // userspace. Returns MX_ERR_BUFFER_TOO_SMALL only if the very first
+    // message does not fit, in which case its size is reported.
+    //
+    // The payload of each message is copied to the user buffer in |bufs|
+    // before the message is dequeued, so one that cannot be copied stays at
+    // the head of the queue along with everything after it. The messages
+    // taken are appended to |msgs| for the caller to hand over their
+    // handles. Returns MX_ERR_INVALID_ARGS if the very first message cannot
+    // be copied.
+    status_t ReadMany(uint32_t count, void* const* bufs, uint32_t* msg_sizes,
+                      uint32_t* msg_handle_counts, MessageList* msgs);
+
     // Write to the opposing endpoint's message queue.
     status_t Write(mxtl::unique_ptr<MessagePacket> msg);
+
+    // Write every message in |msgs|, in order, to the opposing endpoint's
+    // message queue under a single lock acquisition. On failure nothing is
+    // written and |msgs| is left intact.
+    status_t WriteMany(MessageList* msgs);
+
     status_t Call(mxtl::unique_ptr<MessagePacket> msg,
                   mx_time_t deadline, bool* return_handles,
                   mxtl::unique_ptr<MessagePacket>* reply);
@@ -95,7 +121,6 @@ public:
     };
 
 private:
-    using MessageList = mxtl::DoublyLinkedList<mxtl::unique_ptr<MessagePacket>>;
     using WaiterList = mxtl::DoublyLinkedList<MessageWaiter*>;
 
     void RemoveWaiter(MessageWaiter* waiter);
@@ -103,6 +128,10 @@ private:
     ChannelDispatcher(uint32_t flags);
     void Init(mxtl::RefPtr<ChannelDispatcher> other);
     int WriteSelf(mxtl::unique_ptr<MessagePacket> msg);
+    int WriteSelfMany(MessageList* msgs);
+    // Hands |msg| to a matching call waiter or appends it to |messages_|.
+    // Returns how many threads have been woken up, or zero.
+    int DeliverLocked(mxtl::unique_ptr<MessagePacket> msg, bool* queued) TA_REQ(lock_);
     status_t UserSignalSelf(uint32_t clear_mask, uint32_t set_mask);
     void OnPeerZeroHandles();
 
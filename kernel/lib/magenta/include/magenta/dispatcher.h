@@ -44,6 +44,8 @@ DECLARE_DISPTAG(FifoDispatcher, MX_OBJ_TYPE_FIFO)
 DECLARE_DISPTAG(GuestDispatcher, MX_OBJ_TYPE_GUEST)
 DECLARE_DISPTAG(VcpuDispatcher, MX_OBJ_TYPE_VCPU)
 DECLARE_DISPTAG(TimerDispatcher, MX_OBJ_TYPE_TIMER)
+DECLARE_DISPTAG(WaitSetDispatcher, MX_OBJ_TYPE_WAIT_SET)
+DECLARE_DISPTAG(CallRingDispatcher, MX_OBJ_TYPE_CALL_RING)
 
 #undef DECLARE_DISPTAG
 
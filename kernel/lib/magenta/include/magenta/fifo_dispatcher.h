@@ -8,8 +8,11 @@
 
 #include <stdint.h>
 
+#include <kernel/vm/vm_address_region.h>
+#include <kernel/vm/vm_object.h>
 #include <magenta/dispatcher.h>
 #include <magenta/state_tracker.h>
+#include <magenta/syscalls/fifo.h>
 #include <magenta/types.h>
 
 #include <mxtl/canary.h>
@@ -40,9 +43,21 @@ public:
     mx_status_t WriteFromUser(const uint8_t* src, size_t len, uint32_t* actual);
     mx_status_t ReadToUser(uint8_t* dst, size_t len, uint32_t* actual);
 
+    // For MX_FIFO_SHARED fifos, returns the VMO holding the ring this
+    // endpoint reads from or, if |write_ring|, the one it writes to.
+    mx_status_t GetRingVmo(bool write_ring, mxtl::RefPtr<VmObject>* vmo);
+
+    // Recomputes the READABLE and WRITABLE signals of both endpoints from
+    // the indices in the shared rings.
+    mx_status_t Doorbell();
+
 private:
     FifoDispatcher(uint32_t options, uint32_t elem_count, uint32_t elem_size,
-                   mxtl::unique_ptr<uint8_t[]> data);
+                   mxtl::unique_ptr<uint8_t[]> data,
+                   mxtl::RefPtr<VmObject> vmo, mxtl::RefPtr<VmMapping> mapping);
+    static status_t CreateSharedRing(uint32_t elem_count, uint32_t elem_size,
+                                     mxtl::RefPtr<VmObject>* vmo,
+                                     mxtl::RefPtr<VmMapping>* mapping);
     void Init(mxtl::RefPtr<FifoDispatcher> other);
     mx_status_t Write(const uint8_t* ptr, size_t len, uint32_t* actual,
                       fifo_copy_from_fn_t copy_from_fn);
@@ -51,6 +66,11 @@ private:
     mx_status_t Read(uint8_t* ptr, size_t len, uint32_t* actual,
                      fifo_copy_to_fn_t copy_to_fn);
     mx_status_t UserSignalSelf(uint32_t clear_mask, uint32_t set_mask);
+    void DoorbellSelf();
+
+    // Updates READABLE on this endpoint and WRITABLE on the peer to match
+    // the number of elements in the ring this endpoint reads from.
+    void UpdateSignalsLocked() TA_REQ(lock_);
 
     void OnPeerZeroHandles();
 
@@ -63,9 +83,19 @@ private:
 
     mxtl::Mutex lock_;
     mxtl::RefPtr<FifoDispatcher> other_ TA_GUARDED(lock_);
-    uint32_t head_ TA_GUARDED(lock_);
-    uint32_t tail_ TA_GUARDED(lock_);
-    mxtl::unique_ptr<uint8_t[]> data_ TA_GUARDED(lock_);
+
+    // The ring this endpoint reads from and its peer writes to. For shared
+    // fifos |ring_| and |data_| point into a kernel mapping of |vmo_| that
+    // userspace may also map, so |head| and |tail| can change at any time
+    // and must be accessed atomically and validated. Otherwise |ring_|
+    // points at |local_ring_| and |data_| at |heap_data_|.
+    mx_fifo_ring_t* const ring_;
+    uint8_t* const data_;
+    mx_fifo_ring_t local_ring_;
+    const mxtl::unique_ptr<uint8_t[]> heap_data_;
+    const mxtl::RefPtr<VmObject> vmo_;
+    const mxtl::RefPtr<VmMapping> mapping_;
 
     static constexpr uint32_t kMaxSizeBytes = PAGE_SIZE;
+    static constexpr uint32_t kMaxSharedSizeBytes = MX_FIFO_MAX_SHARED_SIZE;
 };
@@ -9,7 +9,11 @@
 #include <lib/user_copy/user_ptr.h>
 #include <magenta/futex_node.h>
 #include <magenta/types.h>
+#include <mxtl/atomic.h>
 #include <mxtl/mutex.h>
+#include <mxtl/ref_ptr.h>
+
+class ThreadDispatcher;
 
 // FutexContext is a class that encapsulates support for futex operations.
 // FutexContext uses a hash table keyed on the futex address (a pointer to integer in userspace)
@@ -23,6 +27,16 @@
 // When the thread at the head of the futex's blocked thread list is resumed,
 // The FutexNode for the new head of the blocked thread list is set as the hash table value
 // for the futex.
+//
+// The table is split into shards by a hash of the futex address, each with its own lock,
+// so that threads using unrelated futexes do not contend. Each shard also counts the
+// threads queued on it, which lets FutexWake() and FutexRequeue() return without taking
+// any lock when nobody can be waiting.
+//
+// A waiter may name the thread which owns the futex (e.g. holds the mutex built on it).
+// While it waits, the owner runs at no lower than the waiter's priority. Waking such a
+// futex passes the remaining waiters' priority on to the woken thread, which is expected
+// to become the next owner.
 class FutexContext {
 public:
     FutexContext();
@@ -33,7 +47,10 @@ public:
     // Otherwise it will block the current thread until the |deadline| passes,
     // or until the thread is woken by a FutexWake or FutexRequeue operation
     // on the same |value_ptr| futex.
-    status_t FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline);
+    // If |owner| is not null, it must be another thread of this process, and it
+    // inherits the current thread's priority until the current thread stops waiting.
+    status_t FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline,
+                       mxtl::RefPtr<ThreadDispatcher> owner);
 
     // FutexWake will wake up to |count| number of threads blocked on the |value_ptr| futex.
     status_t FutexWake(user_ptr<const int> value_ptr, uint32_t count);
@@ -51,14 +68,55 @@ private:
     FutexContext(const FutexContext&) = delete;
     FutexContext& operator=(const FutexContext&) = delete;
 
-    void QueueNodesLocked(FutexNode* head) TA_REQ(lock_);
+    struct Shard {
+        // protects futex_table
+        mxtl::Mutex lock;
+
+        // The number of threads queued on the futexes in this shard. Only
+        // changed with |lock| held, but read without it.
+        mxtl::atomic<uint32_t> waiters{0u};
+
+        // Hash table for the futexes in this shard.
+        // Key is futex address, value is the FutexNode for the head of futex's blocked
+        // thread list.
+        FutexNode::HashTable futex_table TA_GUARDED(lock);
+    };
+
+    static constexpr uint32_t kShardBits = 3u;
+    static constexpr uint32_t kNumShards = 1u << kShardBits;
+
+    Shard* ShardForKey(uintptr_t futex_key);
+
+    // Returns true if no thread can be waiting on the futexes in |shard|.
+    // The caller must have changed the futex value before calling this.
+    static bool HasNoWaiters(Shard* shard);
+
+    status_t RequeueLocked(Shard* wake_shard, user_ptr<int> wake_ptr,
+                           uint32_t wake_count, int current_value,
+                           Shard* requeue_shard, uintptr_t requeue_key,
+                           uint32_t requeue_count, bool* any_woken)
+        TA_REQ(wake_shard->lock) TA_REQ(requeue_shard->lock);
+
+    static void QueueNodesLocked(Shard* shard, FutexNode* head, uint32_t count)
+        TA_REQ(shard->lock);
+
+    bool UnqueueNode(FutexNode* node);
+
+    // Priority inheritance. A node with an owner is on the owner's list of
+    // waiters, and is only attached to or detached from it with both the
+    // lock of the shard it is queued in and |pi_lock_| held.
+    // These are called from FutexNode::ForEach() callbacks, so they check
+    // that |pi_lock_| is held rather than being annotated.
+    void AttachPiWaiterLocked(FutexNode* node, mxtl::RefPtr<ThreadDispatcher> owner);
+    void DetachPiWaiterLocked(FutexNode* node);
+    void HandOffPiWaitersLocked(FutexNode* head, uint32_t wake_count);
+    static void UpdateInheritedPriority(ThreadDispatcher* owner);
 
-    bool UnqueueNodeLocked(FutexNode* node) TA_REQ(lock_);
+    Shard shards_[kNumShards];
 
-    // protects futex_table_
-    mxtl::Mutex lock_;
+    mxtl::Mutex pi_lock_;
 
-    // Hash table for futexes in this context.
-    // Key is futex address, value is the FutexNode for the head of futex's blocked thread list.
-    FutexNode::HashTable futex_table_ TA_GUARDED(lock_);
+    // The number of nodes which have an owner. Wakes skip |pi_lock_| while
+    // there are none.
+    mxtl::atomic<uint32_t> pi_waiters_{0u};
 };
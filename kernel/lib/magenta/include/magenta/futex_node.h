@@ -10,8 +10,12 @@
 #include <kernel/wait.h>
 #include <list.h>
 #include <magenta/types.h>
+#include <mxtl/intrusive_double_list.h>
 #include <mxtl/intrusive_hash_table.h>
 #include <mxtl/mutex.h>
+#include <mxtl/ref_ptr.h>
+
+class ThreadDispatcher;
 
 // Node for linked list of threads blocked on a futex
 // Intended to be embedded within a ThreadDispatcher Instance
@@ -19,6 +23,13 @@ class FutexNode : public mxtl::SinglyLinkedListable<FutexNode*> {
 public:
     using HashTable = mxtl::HashTable<uintptr_t, FutexNode*>;
 
+    struct PiWaiterListTraits {
+        static mxtl::DoublyLinkedListNodeState<FutexNode*>& node_state(FutexNode& node) {
+            return node.pi_list_node_state_;
+        }
+    };
+    using PiWaiterList = mxtl::DoublyLinkedList<FutexNode*, PiWaiterListTraits>;
+
     FutexNode();
     ~FutexNode();
 
@@ -34,12 +45,14 @@ public:
     static FutexNode* RemoveNodeFromList(FutexNode* list_head, FutexNode* node);
 
     static FutexNode* WakeThreads(FutexNode* node, uint32_t count,
-                                  uintptr_t old_hash_key, bool* out_any_woken);
+                                  uintptr_t old_hash_key, bool* out_any_woken,
+                                  uint32_t* out_removed);
 
     static FutexNode* RemoveFromHead(FutexNode* list_head,
                                      uint32_t count,
                                      uintptr_t old_hash_key,
-                                     uintptr_t new_hash_key);
+                                     uintptr_t new_hash_key,
+                                     uint32_t* out_removed);
 
     // This must be called with |mutex| held and returns without |mutex| held.
     status_t BlockThread(mxtl::Mutex* mutex, mx_time_t deadline) TA_REL(mutex);
@@ -52,7 +65,35 @@ public:
     uintptr_t GetKey() const { return hash_key_; }
     static size_t GetHash(uintptr_t key) { return (key >> 3); }
 
+    // Calls |func| on up to |count| nodes of the list whose head is this
+    // node, from the head. |func| must not unlink the nodes.
+    template <typename Func>
+    void ForEach(uint32_t count, Func func) {
+        FutexNode* node = this;
+        for (uint32_t i = 0; i < count; i++) {
+            FutexNode* next = node->queue_next_;
+            func(node);
+            if (next == this)
+                break;
+            node = next;
+        }
+    }
+
 private:
+    // Priority inheritance state, used by FutexContext with its pi lock held.
+    friend class FutexContext;
+
+    // The thread owning the futex this node's thread waits on, if it was
+    // named by FutexWait(). This node is then on the owner's |pi_waiters_|.
+    mxtl::RefPtr<ThreadDispatcher> pi_owner_;
+    // The ThreadDispatcher this node is embedded in, and its priority as of
+    // its last FutexWait().
+    ThreadDispatcher* pi_thread_ = nullptr;
+    int pi_priority_ = 0;
+    mxtl::DoublyLinkedListNodeState<FutexNode*> pi_list_node_state_;
+    // The nodes of the threads waiting on futexes this node's thread owns.
+    PiWaiterList pi_waiters_;
+
     static void RelinkAsAdjacent(FutexNode* node1, FutexNode* node2);
     static void SpliceNodes(FutexNode* node1, FutexNode* node2);
 
@@ -61,8 +102,9 @@ private:
     void MarkAsNotInQueue();
 
     // hash_key_ contains the futex address.  This field has two roles:
-    //  * It is used by FutexWait() to determine which queue to remove the
-    //    thread from when a wait operation times out.
+    //  * It is used by FutexWait() to determine which queue, and which
+    //    shard's lock, to remove the thread from when a wait operation
+    //    times out.  It is only changed with that shard's lock held.
     //  * Additionally, when this FutexNode is the head of a futex wait
     //    queue, this field is used by the HashTable (because it uses
     //    intrusive SinglyLinkedLists).
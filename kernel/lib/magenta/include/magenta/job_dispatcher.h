@@ -13,6 +13,7 @@
 #include <magenta/policy_manager.h>
 #include <magenta/process_dispatcher.h>
 #include <magenta/state_tracker.h>
+#include <magenta/syscall_stats.h>
 #include <magenta/types.h>
 
 #include <mxtl/array.h>
@@ -84,6 +85,13 @@ public:
     status_t get_importance(mx_job_importance_t* out) const;
     status_t set_importance(mx_job_importance_t importance);
 
+    // Counting of the syscalls made by every process under this job. See
+    // MX_PROP_SYSCALL_STATS.
+    SyscallStats* syscall_stats() { return &syscall_stats_; }
+    // Charges a syscall to this job and its ancestors. Must be called with
+    // interrupts disabled.
+    void RecordSyscall(uint cpu, uint64_t num, lk_time_t duration);
+
     // TODO(dbort): Consider adding a get_capped_importance() so that userspace
     // doesn't need to check all ancestor jobs to find the value (which is the
     // minimum importance value of this job and its ancestors). Could also be
@@ -163,6 +171,8 @@ private:
     // is, there is no mechanism to mint a handle to a job via this name.
     mxtl::Name<MX_MAX_NAME_LEN> name_;
 
+    SyscallStats syscall_stats_;
+
     // The |lock_| protects all members below.
     mutable mxtl::Mutex lock_;
     State state_ TA_GUARDED(lock_);
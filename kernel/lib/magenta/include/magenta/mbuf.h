@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 
+#include <kernel/vm/page.h>
 #include <lib/user_copy/user_ptr.h>
 #include <magenta/types.h>
 #include <mxtl/intrusive_single_list.h>
@@ -17,23 +18,29 @@ public:
     MBufChain() = default;
     ~MBufChain();
 
-    mx_status_t WriteStream(user_ptr<const void> src, size_t len, size_t* written);
-    mx_status_t WriteDatagram(user_ptr<const void> src, size_t len, size_t* written);
-    size_t Read(user_ptr<void> dst, size_t len, bool datagram);
+    // The write and read methods gather from and scatter to the |num_iov|
+    // user buffers described by |iov|, in order. With |move_pages| a stream
+    // write may take whole pages out of page-aligned source buffers
+    // instead of copying them.
+    mx_status_t WriteStream(const mx_iovec_t* iov, size_t num_iov, bool move_pages,
+                            size_t* written);
+    mx_status_t WriteDatagram(const mx_iovec_t* iov, size_t num_iov, size_t* written);
+    size_t Read(const mx_iovec_t* iov, size_t num_iov, bool datagram);
     bool is_full() const;
     bool is_empty() const;
     size_t size() const { return size_; }
 
 private:
-    // An MBuf is a small fixed-size chainable memory buffer.
+    class IovecCursor;
+
+    // An MBuf is a chainable buffer holding up to one page of data. The
+    // header lives on the heap and the data in a page from the PMM, so
+    // that whole pages can be passed in and out of user VMOs.
     struct MBuf : public mxtl::SinglyLinkedListable<MBuf*> {
-        // 8 for the linked list and 4 for the explicit uint32_t fields.
-        static constexpr size_t kHeaderSize = 8 + (4 * 4);
-        // 16 is for the malloc header.
-        static constexpr size_t kMallocSize = 2048 - 16;
-        static constexpr size_t kPayloadSize = kMallocSize - kHeaderSize;
+        static constexpr size_t kPayloadSize = PAGE_SIZE;
 
         size_t rem() const;
+        char* data() const;
 
         uint32_t off_ = 0u;
         uint32_t len_ = 0u;
@@ -43,19 +50,35 @@ private:
         //
         // Always 0 in MX_SOCKET_STREAM mode.
         uint32_t pkt_len_ = 0u;
-        uint32_t unused_;
-        char data_[kPayloadSize] = {0};
-        // TODO: maybe union data_ with char* blocks for large messages
+        // True if |page_| was taken from the writer's VMO and may be handed
+        // to the reader's VMO as is.
+        bool moved_ = false;
+        vm_page_t* page_ = nullptr;
     };
-    static_assert(sizeof(MBuf) == MBuf::kMallocSize, "");
 
-    static constexpr size_t kSizeMax = 128 * MBuf::kPayloadSize;
+    static constexpr size_t kSizeMax = 64 * MBuf::kPayloadSize;
+    // Every mbuf pins a page however little it holds, so small datagrams
+    // are limited by count as well as by size: a datagram socket fills up
+    // at kMBufMax datagrams, well before kSizeMax bytes of small ones.
+    // Bounding them by bytes alone would let one socket pin a page for
+    // every byte queued.
+    static constexpr size_t kMBufMax = 4 * (kSizeMax / MBuf::kPayloadSize);
+    // The most idle mbufs (and so pages) kept around for reuse.
+    static constexpr size_t kFreeListMax = 4;
+    // Below this many whole pages, copying is cheaper than remapping.
+    static constexpr size_t kMinMovedPages = 4;
 
-    MBuf* AllocMBuf();
+    MBuf* AllocMBuf(bool with_page = true);
     void FreeMBuf(MBuf* buf);
+    void AppendMBuf(MBuf* buf);
+    MBuf* PopMBuf();
+    size_t MoveInPages(IovecCursor* src);
+    size_t MoveOutPages(IovecCursor* dst);
 
     mxtl::SinglyLinkedList<MBuf*> freelist_;
+    size_t freelist_size_ = 0u;
+    size_t mbuf_count_ = 0u;
     mxtl::SinglyLinkedList<MBuf*> tail_;
-    MBuf* head_ = nullptr;;
+    MBuf* head_ = nullptr;
     size_t size_ = 0u;
 };
@@ -6,27 +6,47 @@
 
 #pragma once
 
+#include <list.h>
 #include <stdint.h>
 
 #include <lib/user_copy/user_ptr.h>
 #include <magenta/types.h>
 #include <mxtl/intrusive_double_list.h>
+#include <mxtl/ref_ptr.h>
 #include <mxtl/unique_ptr.h>
 
 constexpr uint32_t kMaxMessageSize = 65536u;
 constexpr uint32_t kMaxMessageHandles = 64u;
+constexpr uint32_t kMaxMessageBatch = 16u;
+constexpr uint32_t kMaxMovedMessageSize = 1024 * 1024u;
+
+// The maximum number of bytes of message memory that a single process may
+// have queued in channels at any one time, counting each message's whole
+// arena slot and payload pages. Writes that would exceed this fail with
+// MX_ERR_NO_RESOURCES.
+constexpr size_t kMaxChannelBytesPerProcess = 64 * 1024 * 1024u;
 
 // ensure public constants are aligned
 static_assert(MX_CHANNEL_MAX_MSG_BYTES == kMaxMessageSize, "");
 static_assert(MX_CHANNEL_MAX_MSG_HANDLES == kMaxMessageHandles, "");
+static_assert(MX_CHANNEL_MAX_BATCH == kMaxMessageBatch, "");
+static_assert(MX_CHANNEL_MAX_MOVED_MSG_BYTES == kMaxMovedMessageSize, "");
 
 class Handle;
+class ProcessCharges;
 
 class MessagePacket : public mxtl::DoublyLinkedListable<mxtl::unique_ptr<MessagePacket>> {
 public:
+    // Sets up the size-bucketed arenas that packets are allocated from.
+    // Must be called once before any packet is created.
+    static void Init();
+
     // Creates a message packet containing the provided data and space for
     // |num_handles| handles. The handles array is uninitialized and must
     // be completely overwritten by clients.
+    //
+    // The variant taking a user_ptr charges the packet's memory against
+    // the calling process's ProcessCharges until the packet is destroyed.
     static mx_status_t Create(user_ptr<const void> data, uint32_t data_size,
                               uint32_t num_handles,
                               mxtl::unique_ptr<MessagePacket>* msg);
@@ -34,13 +54,26 @@ public:
                               uint32_t num_handles,
                               mxtl::unique_ptr<MessagePacket>* msg);
 
+    // Like the user_ptr variant of Create(), but for MX_CHANNEL_WRITE_MOVE_PAGES:
+    // when |data| is page aligned, the whole pages of a large enough payload
+    // are moved out of the caller's address space rather than copied, leaving
+    // that range zero-filled. Anything that can't be moved is copied.
+    static mx_status_t CreateMovingPages(user_ptr<const void> data, uint32_t data_size,
+                                         uint32_t num_handles,
+                                         mxtl::unique_ptr<MessagePacket>* msg);
+
     uint32_t data_size() const { return data_size_; }
 
     // Copies the packet's |data_size()| bytes to |buf|.
     // Returns an error if |buf| points to a bad user address.
-    mx_status_t CopyDataTo(user_ptr<void> buf) const {
-        return buf.copy_array_to_user(data(), data_size_);
-    }
+    mx_status_t CopyDataTo(user_ptr<void> buf) const;
+
+    // Delivers the packet's |data_size()| bytes to |buf|. Whole pages of a
+    // packet created by CreateMovingPages() are moved into the caller's
+    // address space when |buf| is suitably aligned, which consumes them;
+    // the packet must be discarded after a successful call. On failure the
+    // packet is left intact.
+    mx_status_t MoveDataTo(user_ptr<void> buf);
 
     uint32_t num_handles() const { return num_handles_; }
     Handle* const* handles() const { return handles_; }
@@ -50,35 +83,48 @@ public:
 
     // mx_channel_call treats the leading bytes of the payload as
     // a transaction id of type mx_txid_t.
-    mx_txid_t get_txid() const {
-        if (data_size_ < sizeof(mx_txid_t)) {
-            return 0;
-        } else {
-            return *(reinterpret_cast<const mx_txid_t*>(data()));
-        }
-    }
+    mx_txid_t get_txid() const;
+
+    // Dumps the state of the packet arenas using printf().
+    static void DumpArenas();
 
 private:
-    MessagePacket(uint32_t data_size, uint32_t num_handles, Handle** handles);
+    MessagePacket(uint32_t data_size, uint32_t num_handles, Handle** handles,
+                  char* inline_data);
     ~MessagePacket();
 
     // Allocates a new packet that can hold the specified amount of
-    // data/handles.
+    // data/handles. If |charge| is not null, the packet's payload is
+    // accounted against it.
+    // If |moved| is set, a payload of up to kMaxMovedMessageSize bytes is
+    // allowed and no pages are allocated for it; the caller fills |pages_|.
     static mx_status_t NewPacket(uint32_t data_size, uint32_t num_handles,
+                                 ProcessCharges* charge, bool moved,
                                  mxtl::unique_ptr<MessagePacket>* msg);
 
-    // Create() uses malloc(), so we must delete using free().
-    static void operator delete(void* ptr) {
-        free(ptr);
-    }
+    // Packets live in arena slots, so they must be returned to the
+    // arena they came from.
+    static void operator delete(void* ptr);
     friend class mxtl::unique_ptr<MessagePacket>;
 
-    // Handles and data are stored in the same buffer: num_handles_ Handle*
-    // entries first, then the data buffer.
-    void* data() const { return static_cast<void*>(handles_ + num_handles_); }
-
+    // Calls |func(char* chunk, size_t offset, size_t len)| over every
+    // contiguous piece of the payload in order, stopping at the first
+    // non-MX_OK return.
+    template <typename F>
+    mx_status_t ForEachChunk(F func) const;
+
+    // The header and the Handle* array are always stored together in one
+    // arena slot. Payloads that fit in the remainder of the largest slot
+    // follow the handles inline; larger payloads are stored in a list of
+    // whole pages, |pages_|. Packets created by CreateMovingPages() have
+    // |moved_pages_| set, and some of their pages came from the writer's
+    // address space.
     Handle** const handles_;
+    char* const inline_data_;
+    list_node pages_;
+    mxtl::RefPtr<ProcessCharges> charges_;
     const uint32_t data_size_;
     const uint16_t num_handles_;
     bool owns_handles_;
+    bool moved_pages_;
 };
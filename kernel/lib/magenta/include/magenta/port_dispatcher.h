@@ -7,11 +7,13 @@
 #pragma once
 
 #include <magenta/dispatcher.h>
+#include <magenta/process_charges.h>
 #include <magenta/semaphore.h>
 #include <magenta/state_observer.h>
 #include <magenta/syscalls/port.h>
 #include <magenta/types.h>
 
+#include <mxtl/atomic.h>
 #include <mxtl/canary.h>
 #include <mxtl/intrusive_double_list.h>
 #include <mxtl/mutex.h>
@@ -88,6 +90,12 @@ public:
     mx_port_packet_t packet;
     const void* const handle;
     PortObserver* observer;
+    // Non-zero while a signal packet is on its port's list. Written under the
+    // port lock and read by the observer without it.
+    mxtl::atomic<uint32_t> queued;
+    // For a packet from QueueUser(), the process it is charged to until it
+    // is dequeued.
+    mxtl::RefPtr<ProcessCharges> charges;
 
     explicit PortPacket(const void* handle);
     PortPacket(const PortPacket&) = delete;
@@ -120,6 +128,7 @@ private:
     PortObserver& operator=(const PortObserver&) = delete;
 
     // StateObserver overrides.
+    mx_signals_t watched_signals() const final { return trigger_; }
     Flags OnInitialize(mx_signals_t initial_state, const StateObserver::CountInfo* cinfo) final;
     Flags OnStateChange(mx_signals_t new_state) final;
     Flags OnCancel(Handle* handle) final;
@@ -139,6 +148,15 @@ private:
     PortPacket packet_;
 };
 
+// Maximum number of packets dequeued by a single DeQueueMany().
+constexpr uint32_t kMaxPortBatch = 16u;
+static_assert(MX_PORT_MAX_BATCH == kMaxPortBatch, "");
+
+// The most packets queued with mx_port_queue() that a single process may
+// have outstanding across all ports, so that it cannot use up every
+// packet in the system.
+constexpr uint32_t kMaxUserPortPacketsPerProcess = 2048u;
+
 class PortDispatcher final : public Dispatcher {
 public:
     static void Init() TA_NO_THREAD_SAFETY_ANALYSIS;
@@ -155,6 +173,12 @@ public:
     mx_status_t QueueUser(const mx_port_packet_t& packet);
     mx_status_t DeQueue(mx_time_t deadline, mx_port_packet_t* packet);
 
+    // Waits like DeQueue() until at least one packet is available and then
+    // dequeues up to |count| packets (at most kMaxPortBatch) under a single
+    // hold of the port lock. |actual| receives the number dequeued.
+    mx_status_t DeQueueMany(mx_time_t deadline, mx_port_packet_t* packets,
+                            uint32_t count, uint32_t* actual);
+
     // Decides who is going to destroy the observer. If it returns |true| it
     // is the duty of the caller. If it is false it is the duty of the port.
     bool CanReap(PortObserver* observer, PortPacket* port_packet);
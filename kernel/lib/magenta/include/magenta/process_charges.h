@@ -0,0 +1,46 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <magenta/types.h>
+#include <mxtl/atomic.h>
+#include <mxtl/ref_counted.h>
+#include <mxtl/ref_ptr.h>
+
+#include <sys/types.h>
+
+// The kernel memory that a process has left queued in other objects, such
+// as the channel messages it has written and the packets it has queued on
+// ports.
+//
+// Each process has one of these, and the objects holding its memory keep a
+// reference to it rather than to the process. A dead process's messages
+// left in a long-lived channel then keep only this alive, and go on being
+// counted until they are read or discarded.
+class ProcessCharges : public mxtl::RefCounted<ProcessCharges> {
+public:
+    static mx_status_t Create(mxtl::RefPtr<ProcessCharges>* charges);
+
+    // Fails with MX_ERR_NO_RESOURCES if the charge would exceed
+    // kMaxChannelBytesPerProcess.
+    mx_status_t ChargeChannelMemory(size_t bytes);
+    void UnchargeChannelMemory(size_t bytes);
+    size_t channel_memory() const { return channel_bytes_.load(); }
+
+    // Fails with MX_ERR_SHOULD_WAIT if the process already has
+    // kMaxUserPortPacketsPerProcess packets queued.
+    mx_status_t ChargePortPacket();
+    void UnchargePortPacket();
+
+private:
+    ProcessCharges() = default;
+
+    // Bytes of channel messages still queued.
+    mxtl::atomic<size_t> channel_bytes_{0u};
+    // Packets from mx_port_queue() not yet dequeued, on any port.
+    mxtl::atomic<uint32_t> port_packets_{0u};
+};
@@ -15,12 +15,15 @@
 #include <magenta/handle_owner.h>
 #include <magenta/magenta.h>
 #include <magenta/policy_manager.h>
+#include <magenta/process_charges.h>
 #include <magenta/state_tracker.h>
+#include <magenta/syscall_stats.h>
 #include <magenta/syscalls/object.h>
 #include <magenta/types.h>
 #include <magenta/thread_dispatcher.h>
 
 #include <mxtl/array.h>
+#include <mxtl/atomic.h>
 #include <mxtl/canary.h>
 #include <mxtl/intrusive_double_list.h>
 #include <mxtl/mutex.h>
@@ -214,6 +217,10 @@ public:
     // |eport| can either be the process's eport or that of any parent job.
     void OnExceptionPortRemoval(const mxtl::RefPtr<ExceptionPort>& eport);
 
+    // The kernel memory this process has queued in other objects. Every
+    // queued channel message is charged here until it is read or discarded.
+    const mxtl::RefPtr<ProcessCharges>& charges() const { return charges_; }
+
     // The following two methods can be slow and inaccurate and should only be
     // called from diagnostics code.
     uint32_t ThreadCount() const;
@@ -230,6 +237,12 @@ public:
     uintptr_t get_debug_addr() const;
     mx_status_t set_debug_addr(uintptr_t addr);
 
+    // Counting of the syscalls made by this process. See MX_PROP_SYSCALL_STATS.
+    SyscallStats* syscall_stats() { return &syscall_stats_; }
+    // Charges a syscall to this process and the jobs above it. Must be
+    // called with interrupts disabled.
+    void RecordSyscall(uint cpu, uint64_t num, lk_time_t duration);
+
     // Checks the |condition| against the parent job's policy.
     //
     // Must be called by syscalls before performing an action represented by an
@@ -318,6 +331,9 @@ private:
 
     FutexContext futex_context_;
 
+    // Set by Create(), and never changed after that.
+    mxtl::RefPtr<ProcessCharges> charges_;
+
     // our state
     State state_ TA_GUARDED(state_lock_) = State::INITIAL;
     mutable mxtl::Mutex state_lock_;
@@ -334,6 +350,8 @@ private:
     // See third_party/ulib/musl/ldso/dynlink.c.
     uintptr_t debug_addr_ TA_GUARDED(state_lock_) = 0;
 
+    SyscallStats syscall_stats_;
+
     // This is a cache of aspace()->vdso_code_address().
     uintptr_t vdso_code_address_ = 0;
 
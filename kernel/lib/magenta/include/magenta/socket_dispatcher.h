@@ -35,20 +35,39 @@ public:
     status_t user_signal(uint32_t clear_mask, uint32_t set_mask, bool peer) final;
 
     // Socket methods.
-    mx_status_t Write(user_ptr<const void> src, size_t len, size_t* written);
+    // Gathers from the user buffers described by the kernel copy of |iov|.
+    // |move_pages| lets a stream socket take page-aligned runs of whole
+    // pages from the writer instead of copying them.
+    mx_status_t WriteV(const mx_iovec_t* iov, size_t num_iov, bool move_pages,
+                       size_t* written);
 
     status_t HalfClose();
 
     mx_status_t Read(user_ptr<void> dst, size_t len, size_t* nread);
+    mx_status_t ReadV(const mx_iovec_t* iov, size_t num_iov, size_t* nread);
+
+    // A socket holds up to 256KB of data. Each datagram takes at least one
+    // page of it however small it is, so a datagram socket also holds no
+    // more than 256 datagrams; see MBufChain.
+    //
+    // Datagram sockets only. WriteMany queues one datagram per entry of
+    // |dgrams|, in order, stopping at the first that does not fit. ReadMany
+    // fills one nonempty entry per datagram until the socket is empty, and
+    // sets each entry's size to the number of bytes read into it.
+    mx_status_t WriteMany(const mx_iovec_t* dgrams, size_t num_dgrams, size_t* nwritten);
+    mx_status_t ReadMany(mx_iovec_t* dgrams, size_t num_dgrams, size_t* nread);
 
     void OnPeerZeroHandles();
 
 private:
     SocketDispatcher(uint32_t flags);
     void Init(mxtl::RefPtr<SocketDispatcher> other);
-    mx_status_t WriteSelf(user_ptr<const void> src, size_t len, size_t* nwritten);
+    mx_status_t WriteSelf(const mx_iovec_t* iov, size_t num_iov, bool move_pages,
+                          size_t* nwritten);
+    mx_status_t WriteManySelf(const mx_iovec_t* dgrams, size_t num_dgrams, size_t* nwritten);
     status_t UserSignalSelf(uint32_t clear_mask, uint32_t set_mask);
     status_t HalfCloseOther();
+    static bool TotalSize(const mx_iovec_t* iov, size_t num_iov, size_t* total);
 
     bool is_full() const TA_REQ(lock_) { return data_.is_full(); }
     bool is_empty() const TA_REQ(lock_) { return data_.is_empty(); }
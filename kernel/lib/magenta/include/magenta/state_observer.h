@@ -37,13 +37,21 @@ public:
     static constexpr Flags kNeedRemoval = 2;
     static constexpr Flags kHandled = 4;
 
+    static constexpr mx_signals_t kAllSignals = ~static_cast<mx_signals_t>(0u);
+
+    // The signals whose changes this observer needs to see. OnStateChange() is
+    // only called when one of them changes (though |new_state| always carries
+    // every signal), so an observer which needs to see every change must keep
+    // the default. Queried once, when the observer is added.
+    virtual mx_signals_t watched_signals() const { return kAllSignals; }
+
     // Called when this object is added to a StateTracker, to give it the initial state.
     // Note that |cinfo| might be null.
     // May return flags: kWokeThreads, kNeedRemoval
     // WARNING: This is called under StateTracker's mutex.
     virtual Flags OnInitialize(mx_signals_t initial_state, const CountInfo* cinfo) = 0;
 
-    // Called whenever the state changes, to give it the new state.
+    // Called whenever one of watched_signals() changes, to give it the new state.
     // May return flags: kWokeThreads, kNeedRemoval
     // WARNING: This is called under StateTracker's mutex
     virtual Flags OnStateChange(mx_signals_t new_state) = 0;
@@ -77,6 +85,12 @@ private:
 
     friend struct StateObserverListTraits;
     mxtl::DoublyLinkedListNodeState<StateObserver*> state_observer_list_node_state_;
+
+    // Set and used by StateTracker, under its lock, to find the list this
+    // observer is on.
+    friend class StateTracker;
+    mx_signals_t tracked_signals_ = 0u;
+    uint32_t list_index_ = 0u;
 };
 
 // For use by StateTracker to maintain a list of StateObservers. (We don't use the default traits so
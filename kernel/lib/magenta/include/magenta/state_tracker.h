@@ -34,8 +34,10 @@ public:
     // Add an observer.
     void AddObserver(StateObserver* observer, const StateObserver::CountInfo* cinfo);
 
-    // Remove an observer (which must have been added).
-    void RemoveObserver(StateObserver* observer);
+    // Remove an observer which was added. Returns false, doing nothing, if
+    // the observer already removed itself by returning kNeedRemoval; its
+    // OnRemoved() is then called, or will be, by whoever removed it.
+    bool RemoveObserver(StateObserver* observer);
 
     // Called when observers of the handle's state (e.g., waits on the handle) should be
     // "cancelled", i.e., when a handle (for the object that owns this StateTracker) is being
@@ -70,14 +72,25 @@ public:
     mx_status_t InvalidateCookie(CookieJar *cookiejar);
 
 private:
+    // Active observers are indexed by signal bit, so that a state change
+    // only visits the observers interested in it. An observer is kept on the
+    // list for the lowest signal it watches, if that is one of the first
+    // kIndexedSignals, else on kOtherList. |watched_| holds the union of the
+    // signals watched by the observers on each list since it was last empty.
+    static constexpr uint32_t kIndexedSignals = 4u;
+    static constexpr uint32_t kNumLists = kIndexedSignals + 1u;
+    static constexpr uint32_t kOtherList = kIndexedSignals;
+
     // Returns flag kHandled if one of the observers have been signaled.
-    StateObserver::Flags UpdateInternalLocked(ObserverList* obs_to_remove, mx_signals_t signals) TA_REQ(lock_);
+    // Only observers watching one of the |changed| signals are called.
+    StateObserver::Flags UpdateInternalLocked(ObserverList* obs_to_remove, mx_signals_t signals,
+                                              mx_signals_t changed) TA_REQ(lock_);
 
     mxtl::Canary<mxtl::magic("STRK")> canary_;
 
     mx_signals_t signals_;
     mxtl::Mutex lock_;
 
-    // Active observers are elements in |observers_|.
-    ObserverList observers_ TA_GUARDED(lock_);
+    ObserverList observers_[kNumLists] TA_GUARDED(lock_);
+    mx_signals_t watched_[kNumLists] TA_GUARDED(lock_) = {};
 };
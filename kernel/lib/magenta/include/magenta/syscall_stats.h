@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <magenta/syscalls/object.h>
+#include <magenta/types.h>
+#include <mxtl/atomic.h>
+#include <mxtl/mutex.h>
+#include <mxtl/unique_ptr.h>
+
+#include <sys/types.h>
+
+// Per-syscall counts and latency histograms for a process or job, kept
+// while MX_PROP_SYSCALL_STATS is set on it.
+//
+// Each cpu counts into its own array with plain stores, since Record() runs
+// with interrupts disabled. Readers sum the arrays without stopping the
+// writers, so a record read while calls are being made may be slightly off.
+class SyscallStats {
+public:
+    SyscallStats() = default;
+    ~SyscallStats();
+
+    // True if any process or job is counting, so that syscalls need not
+    // be timed otherwise.
+    static bool Active() { return active_.load(mxtl::memory_order_relaxed) > 0; }
+
+    // The counters are allocated the first time counting starts and are
+    // kept, stopped or not, until the object goes away.
+    status_t SetEnabled(bool enabled);
+    bool enabled() const { return enabled_.load(mxtl::memory_order_acquire) != 0; }
+
+    // Counts one call of |num| that took |duration|. Must be called with
+    // interrupts disabled.
+    void Record(uint cpu, uint64_t num, lk_time_t duration);
+
+    // Fills in |info| for syscall |num|. Returns false if it has not been
+    // counted.
+    bool GetInfo(uint32_t num, mx_info_syscall_stats_t* info) const;
+
+    // suppress default constructors
+    SyscallStats(const SyscallStats&) = delete;
+    SyscallStats& operator=(const SyscallStats&) = delete;
+
+private:
+    struct Counter {
+        uint64_t count;
+        uint64_t total;
+        uint64_t max;
+        uint64_t histogram[MX_INFO_SYSCALL_STATS_BUCKETS];
+    };
+
+    // Counting processes and jobs, system wide.
+    static mxtl::atomic<int> active_;
+
+    mutable mxtl::Mutex lock_;
+    // [cpu][syscall], set once by SetEnabled() before |enabled_| is set.
+    mxtl::unique_ptr<Counter[]> counters_;
+    uint num_cpus_ = 0;
+    mxtl::atomic<int> enabled_{0};
+};
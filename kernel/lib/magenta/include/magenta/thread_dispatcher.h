@@ -111,6 +111,11 @@ public:
     ProcessDispatcher* process() { return process_.get(); }
 
     FutexNode* futex_node() { return &futex_node_; }
+    // Runs the thread at no lower than |priority|, for priority inheritance
+    // by the threads blocked on futexes it owns.
+    void SetInheritedPriority(int priority) {
+        thread_set_inherited_priority(&thread_, priority);
+    }
     status_t set_name(const char* name, size_t len) final;
     void get_name(char out_name[MX_MAX_NAME_LEN]) const final;
     uint64_t runtime_ns() const { return thread_runtime(&thread_); }
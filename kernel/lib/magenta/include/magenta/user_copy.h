@@ -8,7 +8,9 @@
 
 #include <stddef.h>
 
+#include <kernel/vm/vm_object.h>
 #include <magenta/types.h>
+#include <mxtl/ref_ptr.h>
 #include <mxtl/string_piece.h>
 
 mx_status_t magenta_copy_from_user(const void* src, void* dest, size_t len);
@@ -17,3 +19,9 @@ mx_status_t magenta_copy_from_user(const void* src, void* dest, size_t len);
 // If src_len == buf_len, the last character will be replaced with a NULL (see MG-1025).
 mx_status_t magenta_copy_user_string(const char* src, size_t src_len, char* buf, size_t buf_len,
                                      mxtl::StringPiece* sp);
+
+// magenta_lookup_user_range finds the VMO and offset backing the |len| bytes at |va| in the
+// current process. The range must lie within a single writable mapping, since moving pages in
+// or out of it is as visible as writing to it.
+mx_status_t magenta_lookup_user_range(vaddr_t va, size_t len, mxtl::RefPtr<VmObject>* vmo,
+                                      uint64_t* offset);
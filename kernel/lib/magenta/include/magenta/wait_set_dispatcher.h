@@ -0,0 +1,132 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <kernel/event.h>
+
+#include <magenta/dispatcher.h>
+#include <magenta/state_observer.h>
+#include <magenta/state_tracker.h>
+#include <magenta/types.h>
+#include <mxtl/canary.h>
+#include <mxtl/intrusive_double_list.h>
+#include <mxtl/intrusive_wavl_tree.h>
+#include <mxtl/mutex.h>
+#include <mxtl/ref_counted.h>
+#include <mxtl/ref_ptr.h>
+
+#include <sys/types.h>
+
+// A wait set is a persistent set of (handle, signals) entries, each named by
+// a user chosen cookie. Every entry stays registered with its object's
+// StateTracker for as long as it is in the set, and entries whose signals
+// are satisfied are kept on a ready list, so that waiting costs O(ready)
+// rather than O(members).
+//
+// In level-triggered mode an entry is ready for as long as any of its
+// signals are asserted. In edge-triggered mode (MX_WAITSET_EDGE_TRIGGERED)
+// it becomes ready when one of its signals goes from deasserted to asserted
+// and stops being ready once reported.
+//
+// If the entry's handle is closed or transferred the entry is reported with
+// status MX_ERR_CANCELED until it is removed.
+//
+// An entry holds no reference to its object, only to the handle it was added
+// with, so that a wait set can be sent through a channel that is one of its
+// own members without the two keeping each other alive. The entry leaves the
+// object's StateTracker when that handle is canceled, and until then the
+// handle keeps the object alive.
+//
+// Lock ordering: |members_lock_| is taken before any member's StateTracker
+// lock, which is taken before |lock_|, which is taken before the wait set's
+// own StateTracker lock.
+class WaitSetDispatcher final : public Dispatcher {
+public:
+    static status_t Create(uint32_t options, mxtl::RefPtr<Dispatcher>* dispatcher,
+                           mx_rights_t* rights);
+
+    ~WaitSetDispatcher() final;
+    mx_obj_type_t get_type() const final { return MX_OBJ_TYPE_WAIT_SET; }
+    StateTracker* get_state_tracker() final { return &state_tracker_; }
+
+    // Adds |handle| to the set under |cookie|. Must be called with the
+    // owning process' handle table lock held.
+    status_t AddEntry(Handle* handle, uint64_t cookie, mx_signals_t signals, uint32_t options);
+    status_t RemoveEntry(uint64_t cookie);
+
+    // Reports up to |*count| ready entries in |results|, blocking until at
+    // least one is ready or |deadline| passes. On success |*count| is set
+    // to the number of results.
+    status_t Wait(lk_time_t deadline, mx_waitset_result_t* results, uint32_t* count);
+
+private:
+    class Entry final : public StateObserver,
+                        public mxtl::RefCounted<Entry>,
+                        public mxtl::DoublyLinkedListable<Entry*>,
+                        public mxtl::WAVLTreeContainable<mxtl::RefPtr<Entry>> {
+    public:
+        Entry(WaitSetDispatcher* wait_set, Handle* handle, uint64_t cookie,
+              mx_signals_t signals, bool edge);
+
+        uint64_t GetKey() const { return cookie_; }
+        bool is_ready() const { return mxtl::DoublyLinkedListable<Entry*>::InContainer(); }
+
+        // StateObserver implementation:
+        mx_signals_t watched_signals() const final { return signals_; }
+        Flags OnInitialize(mx_signals_t initial_state, const CountInfo* cinfo) final;
+        Flags OnStateChange(mx_signals_t new_state) final;
+        Flags OnCancel(Handle* handle) final;
+        void OnRemoved() final;
+
+    private:
+        friend class WaitSetDispatcher;
+
+        WaitSetDispatcher* const wait_set_;
+        // Only safe to use while |status_| is MX_OK; see the class comment.
+        Dispatcher* const dispatcher_;
+        // Guarded by |dispatcher_|'s StateTracker lock.
+        Handle* handle_;
+        const uint64_t cookie_;
+        const mx_signals_t signals_;
+        const bool edge_;
+
+        // These are guarded by |wait_set_->lock_|.
+        mx_signals_t observed_ = 0u;
+        mx_signals_t triggered_ = 0u;
+        mx_status_t status_ = MX_OK;
+        // Set once the entry has left the set.
+        bool removed_ = false;
+
+        // Keeps the entry alive while it is on the StateTracker, which may
+        // be after it has left the set. Dropped by OnRemoved() or by
+        // DetachEntry(), whichever takes the entry off the StateTracker.
+        mxtl::RefPtr<Entry> registration_;
+    };
+
+    // The most entries a single wait set may hold.
+    static constexpr size_t kMaxMembers = 1024u;
+
+    WaitSetDispatcher();
+
+    void DetachEntry(Entry* entry) TA_REQ(members_lock_);
+    StateObserver::Flags UpdateEntry(Entry* entry, mx_signals_t state);
+    StateObserver::Flags CancelEntry(Entry* entry);
+    StateObserver::Flags QueueLocked(Entry* entry) TA_REQ(lock_);
+    void DequeueLocked(Entry* entry) TA_REQ(lock_);
+
+    mxtl::Canary<mxtl::magic("WSET")> canary_;
+
+    mxtl::Mutex members_lock_;
+    mxtl::WAVLTree<uint64_t, mxtl::RefPtr<Entry>> members_ TA_GUARDED(members_lock_);
+
+    mxtl::Mutex lock_;
+    mxtl::DoublyLinkedList<Entry*> ready_ TA_GUARDED(lock_);
+    // Signaled while |ready_| is not empty.
+    Event event_;
+
+    StateTracker state_tracker_;
+};
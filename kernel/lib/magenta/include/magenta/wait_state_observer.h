@@ -38,6 +38,7 @@ private:
     WaitStateObserver& operator=(const WaitStateObserver&) = delete;
 
     // StateObserver implementation:
+    mx_signals_t watched_signals() const final { return watched_signals_; }
     Flags OnInitialize(mx_signals_t initial_state, const StateObserver::CountInfo* cinfo) final;
     Flags OnStateChange(mx_signals_t new_state) final;
     Flags OnCancel(Handle* handle) final;
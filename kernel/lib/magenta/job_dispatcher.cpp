@@ -402,6 +402,13 @@ status_t JobDispatcher::set_importance(mx_job_importance_t importance) {
     return MX_OK;
 }
 
+void JobDispatcher::RecordSyscall(uint cpu, uint64_t num, lk_time_t duration) {
+    // Jobs hold their parents, and the calling process its job, so the
+    // chain cannot go away underneath.
+    for (JobDispatcher* job = this; job != nullptr; job = job->parent_.get())
+        job->syscall_stats_.Record(cpu, num, duration);
+}
+
 // Global importance ranking. Note that this is independent of
 // mx_task_importance_t-style importance as far as JobDispatcher is concerned;
 // some other entity will choose how to order importance_list_.
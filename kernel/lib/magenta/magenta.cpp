@@ -21,6 +21,7 @@
 #include <magenta/excp_port.h>
 #include <magenta/handle.h>
 #include <magenta/job_dispatcher.h>
+#include <magenta/message_packet.h>
 #include <magenta/policy_manager.h>
 #include <magenta/port_dispatcher.h>
 #include <magenta/process_dispatcher.h>
@@ -492,6 +493,7 @@ void magenta_init(uint level) TA_NO_THREAD_SAFETY_ANALYSIS {
     root_job = JobDispatcher::CreateRootJob();
     policy_manager = PolicyManager::Create();
     PortDispatcher::Init();
+    MessagePacket::Init();
     // Be sure to update kernel_cmdline.md if any of these defaults change.
     oom_init(cmdline_get_bool("kernel.oom.enable", true),
              LK_SEC(cmdline_get_uint64("kernel.oom.sleep-sec", 1)),
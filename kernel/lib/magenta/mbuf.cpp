@@ -6,74 +6,143 @@
 
 #include <magenta/mbuf.h>
 
+#include <assert.h>
+
+#include <kernel/vm.h>
+#include <kernel/vm/pmm.h>
+#include <kernel/vm/vm_object.h>
 #include <lib/user_copy/user_ptr.h>
+#include <magenta/user_copy.h>
 
 #include <mxtl/algorithm.h>
 #include <mxtl/alloc_checker.h>
+#include <mxtl/ref_ptr.h>
 
 #define LOCAL_TRACE 0
 
-constexpr size_t MBufChain::MBuf::kHeaderSize;
-constexpr size_t MBufChain::MBuf::kMallocSize;
 constexpr size_t MBufChain::MBuf::kPayloadSize;
 constexpr size_t MBufChain::kSizeMax;
+constexpr size_t MBufChain::kMBufMax;
+constexpr size_t MBufChain::kFreeListMax;
+constexpr size_t MBufChain::kMinMovedPages;
+
+// IovecCursor walks the bytes described by an array of user buffers.
+class MBufChain::IovecCursor {
+public:
+    IovecCursor(const mx_iovec_t* iov, size_t num_iov)
+        : iov_(iov), num_iov_(num_iov) {
+        for (size_t i = 0; i < num_iov_; i++)
+            remaining_ += iov_[i].size;
+        SkipEmpty();
+    }
+
+    size_t remaining() const { return remaining_; }
+
+    // The number of bytes left in the current buffer.
+    size_t span() const { return remaining_ ? iov_[index_].size - offset_ : 0u; }
+
+    // True if nothing has been consumed from the current buffer yet.
+    bool at_buffer_start() const { return offset_ == 0u; }
+
+    vaddr_t va() const {
+        return reinterpret_cast<vaddr_t>(iov_[index_].buffer) + offset_;
+    }
+    user_ptr<void> ptr() const { return user_ptr<void>(reinterpret_cast<void*>(va())); }
+
+    void Advance(size_t len) {
+        DEBUG_ASSERT(len <= span());
+        offset_ += len;
+        remaining_ -= len;
+        SkipEmpty();
+    }
+
+private:
+    void SkipEmpty() {
+        while (index_ < num_iov_ && offset_ == iov_[index_].size) {
+            index_++;
+            offset_ = 0u;
+        }
+    }
+
+    const mx_iovec_t* const iov_;
+    const size_t num_iov_;
+    size_t index_ = 0u;
+    size_t offset_ = 0u;
+    size_t remaining_ = 0u;
+};
 
 size_t MBufChain::MBuf::rem() const {
     return kPayloadSize - (off_ + len_);
 }
 
+char* MBufChain::MBuf::data() const {
+    return static_cast<char*>(paddr_to_kvaddr(vm_page_to_paddr(page_)));
+}
+
 MBufChain::~MBufChain() {
     while (!tail_.is_empty())
-        delete tail_.pop_front();
-    while (!freelist_.is_empty())
-        delete freelist_.pop_front();
+        FreeMBuf(tail_.pop_front());
+    while (!freelist_.is_empty()) {
+        MBuf* buf = freelist_.pop_front();
+        pmm_free_page(buf->page_);
+        delete buf;
+    }
 }
 
 bool MBufChain::is_full() const {
-    return size_ >= kSizeMax;
+    return size_ >= kSizeMax || mbuf_count_ >= kMBufMax;
 }
 
 bool MBufChain::is_empty() const {
     return size_ == 0;
 }
 
-size_t MBufChain::Read(user_ptr<void> dst, size_t len, bool datagram) {
+size_t MBufChain::Read(const mx_iovec_t* iov, size_t num_iov, bool datagram) {
+    IovecCursor dst(iov, num_iov);
+    size_t len = dst.remaining();
     if (datagram && len > tail_.front().pkt_len_)
         len = tail_.front().pkt_len_;
 
     size_t pos = 0;
     while (pos < len && !tail_.is_empty()) {
+        if (!datagram && dst.at_buffer_start()) {
+            size_t moved = MoveOutPages(&dst);
+            if (moved > 0u) {
+                pos += moved;
+                continue;
+            }
+        }
+
         MBuf& cur = tail_.front();
-        char* src = cur.data_ + cur.off_;
-        size_t copy_len = MIN(cur.len_, len - pos);
-        if (dst.byte_offset(pos).copy_array_to_user(src, copy_len) != MX_OK)
+        char* src = cur.data() + cur.off_;
+        size_t copy_len = mxtl::min(mxtl::min<size_t>(cur.len_, len - pos), dst.span());
+        if (dst.ptr().copy_array_to_user(src, copy_len) != MX_OK)
             return pos;
+        dst.Advance(copy_len);
         pos += copy_len;
         cur.off_ += static_cast<uint32_t>(copy_len);
         cur.len_ -= static_cast<uint32_t>(copy_len);
         size_ -= copy_len;
-        if (cur.len_ == 0 || datagram) {
+        if (cur.len_ == 0 || (datagram && pos == len)) {
             size_ -= cur.len_;
-            if (head_ == &cur)
-                head_ = nullptr;
-            FreeMBuf(tail_.pop_front());
+            FreeMBuf(PopMBuf());
         }
     }
     if (datagram) {
         // Drain any leftover mbufs in the datagram packet.
         while (!tail_.is_empty() && tail_.front().pkt_len_ == 0) {
-            MBuf* cur = tail_.pop_front();
+            MBuf* cur = PopMBuf();
             size_ -= cur->len_;
-            if (head_ == cur)
-                head_ = nullptr;
             FreeMBuf(cur);
         }
     }
     return pos;
 }
 
-mx_status_t MBufChain::WriteDatagram(user_ptr<const void> src,
-                                     size_t len, size_t* written) {
+mx_status_t MBufChain::WriteDatagram(const mx_iovec_t* iov, size_t num_iov,
+                                     size_t* written) {
+    IovecCursor src(iov, num_iov);
+    const size_t len = src.remaining();
     if (len + size_ > kSizeMax)
         return MX_ERR_SHOULD_WAIT;
 
@@ -88,63 +157,60 @@ mx_status_t MBufChain::WriteDatagram(user_ptr<const void> src,
         bufs.push_front(buf);
     }
 
-    size_t pos = 0;
     for (auto& buf : bufs) {
-        size_t copy_len = mxtl::min(MBuf::kPayloadSize, len - pos);
-        if (src.byte_offset(pos).copy_array_from_user(buf.data_, copy_len) != MX_OK) {
-            while (!bufs.is_empty())
-                FreeMBuf(bufs.pop_front());
-            return MX_ERR_INVALID_ARGS; // Bad user buffer.
+        while (buf.rem() > 0 && src.remaining() > 0) {
+            size_t copy_len = mxtl::min(buf.rem(), src.span());
+            if (src.ptr().copy_array_from_user(buf.data() + buf.len_, copy_len) != MX_OK) {
+                while (!bufs.is_empty())
+                    FreeMBuf(bufs.pop_front());
+                return MX_ERR_INVALID_ARGS; // Bad user buffer.
+            }
+            src.Advance(copy_len);
+            buf.len_ += static_cast<uint32_t>(copy_len);
         }
-        pos += copy_len;
-        buf.len_ += static_cast<uint32_t>(copy_len);
     }
 
     bufs.front().pkt_len_ = static_cast<uint32_t>(len);
 
     // Successfully built the packet mbufs. Put it on the socket.
-    while (!bufs.is_empty()) {
-        auto next = bufs.pop_front();
-        if (head_ == nullptr) {
-            tail_.push_front(next);
-        } else {
-            tail_.insert_after(tail_.make_iterator(*head_), next);
-        }
-        head_ = next;
-    }
+    while (!bufs.is_empty())
+        AppendMBuf(bufs.pop_front());
 
     *written = len;
     size_ += len;
     return MX_OK;
 }
 
-mx_status_t MBufChain::WriteStream(user_ptr<const void> src,
-                                   size_t len, size_t* written) {
-    if (head_ == nullptr) {
-        head_ = AllocMBuf();
-        if (head_ == nullptr)
-            return MX_ERR_SHOULD_WAIT;
-        tail_.push_front(head_);
-    }
+mx_status_t MBufChain::WriteStream(const mx_iovec_t* iov, size_t num_iov, bool move_pages,
+                                   size_t* written) {
+    IovecCursor src(iov, num_iov);
 
     size_t pos = 0;
-    while (pos < len) {
-        if (head_->rem() == 0) {
+    while (src.remaining() > 0) {
+        if (move_pages && src.at_buffer_start()) {
+            size_t moved = MoveInPages(&src);
+            if (moved > 0u) {
+                pos += moved;
+                continue;
+            }
+        }
+
+        if (head_ == nullptr || head_->rem() == 0) {
             auto next = AllocMBuf();
             if (next == nullptr)
                 break;
-            tail_.insert_after(tail_.make_iterator(*head_), next);
-            head_ = next;
+            AppendMBuf(next);
         }
-        void* dst = head_->data_ + head_->off_ + head_->len_;
-        size_t copy_len = mxtl::min(head_->rem(), len - pos);
+        void* dst = head_->data() + head_->off_ + head_->len_;
+        size_t copy_len = mxtl::min(head_->rem(), src.span());
         if (size_ + copy_len > kSizeMax) {
             copy_len = kSizeMax - size_;
             if (copy_len == 0)
                 break;
         }
-        if (src.byte_offset(pos).copy_array_from_user(dst, copy_len) != MX_OK)
+        if (src.ptr().copy_array_from_user(dst, copy_len) != MX_OK)
             break;
+        src.Advance(copy_len);
         pos += copy_len;
         head_->len_ += static_cast<uint32_t>(copy_len);
         size_ += copy_len;
@@ -157,17 +223,146 @@ mx_status_t MBufChain::WriteStream(user_ptr<const void> src,
     return MX_OK;
 }
 
-MBufChain::MBuf* MBufChain::AllocMBuf() {
-    if (freelist_.is_empty()) {
+// Takes the whole pages at the start of the current source buffer out of
+// the writer's VMO and queues them as they are. Returns the number of bytes
+// moved, which is 0 if the buffer does not qualify.
+size_t MBufChain::MoveInPages(IovecCursor* src) {
+    if (!IS_PAGE_ALIGNED(src->va()))
+        return 0u;
+    size_t count = mxtl::min(src->span(), kSizeMax - size_) / PAGE_SIZE;
+    count = mxtl::min(count, kMBufMax - mbuf_count_);
+    if (count < kMinMovedPages)
+        return 0u;
+
+    mxtl::SinglyLinkedList<MBuf*> bufs;
+    for (size_t i = 0; i < count; i++) {
+        auto buf = AllocMBuf(false);
+        if (buf == nullptr) {
+            while (!bufs.is_empty())
+                FreeMBuf(bufs.pop_front());
+            return 0u;
+        }
+        bufs.push_front(buf);
+    }
+
+    const size_t len = count * PAGE_SIZE;
+    mxtl::RefPtr<VmObject> vmo;
+    uint64_t vmo_offset;
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    if (magenta_lookup_user_range(src->va(), len, &vmo, &vmo_offset) != MX_OK ||
+        vmo->TakePages(vmo_offset, len, &pages) != MX_OK) {
+        while (!bufs.is_empty())
+            FreeMBuf(bufs.pop_front());
+        return 0u;
+    }
+
+    // Every pmm arena is in the physmap, so the pages stay readable through
+    // data() if the reader ends up copying them out.
+    while (!bufs.is_empty()) {
+        MBuf* buf = bufs.pop_front();
+        buf->page_ = list_remove_head_type(&pages, vm_page_t, free.node);
+        buf->len_ = static_cast<uint32_t>(PAGE_SIZE);
+        buf->moved_ = true;
+        AppendMBuf(buf);
+    }
+    src->Advance(len);
+    size_ += len;
+    return len;
+}
+
+// Hands the run of moved pages at the front of the chain to the reader's
+// VMO, as far as the current destination buffer has room for whole pages.
+// Returns the number of bytes moved, which is 0 if either side does not
+// qualify.
+size_t MBufChain::MoveOutPages(IovecCursor* dst) {
+    if (!IS_PAGE_ALIGNED(dst->va()))
+        return 0u;
+
+    const size_t limit = dst->span() / PAGE_SIZE;
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    size_t count = 0u;
+    for (auto& buf : tail_) {
+        if (count == limit || !buf.moved_ || buf.off_ != 0u || buf.len_ != PAGE_SIZE)
+            break;
+        list_add_tail(&pages, &buf.page_->free.node);
+        count++;
+    }
+    if (count < kMinMovedPages)
+        return 0u;
+
+    // SupplyPages only consumes the pages on success, and until then they
+    // still belong to their mbufs.
+    const size_t len = count * PAGE_SIZE;
+    mxtl::RefPtr<VmObject> vmo;
+    uint64_t vmo_offset;
+    if (magenta_lookup_user_range(dst->va(), len, &vmo, &vmo_offset) != MX_OK ||
+        vmo->SupplyPages(vmo_offset, len, &pages) != MX_OK)
+        return 0u;
+
+    for (size_t i = 0; i < count; i++) {
+        MBuf* buf = PopMBuf();
+        buf->page_ = nullptr;
+        FreeMBuf(buf);
+    }
+    dst->Advance(len);
+    size_ -= len;
+    return len;
+}
+
+MBufChain::MBuf* MBufChain::AllocMBuf(bool with_page) {
+    if (mbuf_count_ >= kMBufMax)
+        return nullptr;
+
+    MBuf* buf;
+    if (with_page && !freelist_.is_empty()) {
+        buf = freelist_.pop_front();
+        freelist_size_--;
+    } else {
         mxtl::AllocChecker ac;
-        MBuf* buf = new (&ac) MBuf();
-        return (!ac.check()) ? nullptr : buf;
+        buf = new (&ac) MBuf();
+        if (!ac.check())
+            return nullptr;
+        if (with_page) {
+            paddr_t pa;
+            buf->page_ = pmm_alloc_page(PMM_ALLOC_FLAG_KMAP, &pa);
+            if (buf->page_ == nullptr) {
+                delete buf;
+                return nullptr;
+            }
+        }
     }
-    return freelist_.pop_front();
+    mbuf_count_++;
+    return buf;
 }
 
 void MBufChain::FreeMBuf(MBuf* buf) {
-    buf->off_ = 0u;
-    buf->len_ = 0u;
-    freelist_.push_front(buf);
+    mbuf_count_--;
+    if (buf->page_ != nullptr && freelist_size_ < kFreeListMax) {
+        buf->off_ = 0u;
+        buf->len_ = 0u;
+        buf->pkt_len_ = 0u;
+        buf->moved_ = false;
+        freelist_.push_front(buf);
+        freelist_size_++;
+        return;
+    }
+    if (buf->page_ != nullptr)
+        pmm_free_page(buf->page_);
+    delete buf;
+}
+
+void MBufChain::AppendMBuf(MBuf* buf) {
+    if (head_ == nullptr) {
+        tail_.push_front(buf);
+    } else {
+        tail_.insert_after(tail_.make_iterator(*head_), buf);
+    }
+    head_ = buf;
+}
+
+MBufChain::MBuf* MBufChain::PopMBuf() {
+    MBuf* buf = tail_.pop_front();
+    if (head_ == buf)
+        head_ = nullptr;
+    return buf;
 }
@@ -8,41 +8,209 @@
 
 #include <err.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <kernel/vm.h>
+#include <kernel/vm/pmm.h>
+#include <kernel/vm/vm_object.h>
 #include <magenta/handle_reaper.h>
 #include <magenta/magenta.h>
+#include <magenta/process_dispatcher.h>
+#include <magenta/user_copy.h>
 #include <mxcpp/new.h>
+#include <mxtl/algorithm.h>
+#include <mxtl/arena.h>
+#include <mxtl/auto_lock.h>
+#include <mxtl/mutex.h>
+
+using mxtl::AutoLock;
+
+namespace {
+
+// Channel messages are allocated from dedicated size-bucketed arenas
+// rather than from the general heap. A packet's header and handle array
+// always share a single slot; the payload follows them inline when the
+// whole thing fits in the largest slot, and is otherwise stored in whole
+// pages taken directly from the PMM. When a bucket's arena is used up,
+// the packet goes in a larger bucket, and failing that on the heap.
+struct PacketBucket {
+    const char* name;
+    size_t slot_size;
+    size_t max_count;
+};
+
+constexpr PacketBucket kBuckets[] = {
+    {"msg-256", 256u, 64 * 1024u},
+    {"msg-1k", 1024u, 16 * 1024u},
+    {"msg-4k", PAGE_SIZE, 8 * 1024u},
+};
+constexpr size_t kBucketCount = countof(kBuckets);
+constexpr size_t kMaxInlineSize = kBuckets[kBucketCount - 1].slot_size;
+
+struct PacketArena {
+    mxtl::Mutex lock;
+    mxtl::Arena arena TA_GUARDED(lock);
+    // Copies of the arena bounds, fixed after Init(), so that
+    // operator delete can find a slot's arena without locking.
+    char* start = nullptr;
+    char* end = nullptr;
+};
+
+PacketArena packet_arenas[kBucketCount];
+
+// Returns the index of the smallest bucket that can hold |size| bytes.
+size_t BucketFor(size_t size) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        if (size <= kBuckets[i].slot_size)
+            return i;
+    }
+    PANIC("message packet slot of %zu bytes is too large\n", size);
+}
+
+// Returns the size of the slot a packet needs, and sets |is_inline| if
+// its payload goes in the slot too.
+size_t SlotSize(uint32_t data_size, uint32_t num_handles, bool moved, bool* is_inline) {
+    const size_t header_size = sizeof(MessagePacket) + num_handles * sizeof(Handle*);
+    *is_inline = !moved && header_size + data_size <= kMaxInlineSize;
+    return *is_inline ? header_size + data_size : header_size;
+}
+
+// The number of bytes charged against the writing process: the whole
+// slot, even for an empty message, plus the pages of the payload.
+size_t ChargeSize(uint32_t data_size, uint32_t num_handles, bool moved) {
+    bool is_inline;
+    const size_t slot_size = kBuckets[BucketFor(SlotSize(data_size, num_handles, moved,
+                                                         &is_inline))].slot_size;
+    return is_inline ? slot_size : slot_size + ROUNDUP(data_size, PAGE_SIZE);
+}
+
+void* AllocSlot(size_t bucket) {
+    for (size_t i = bucket; i < kBucketCount; ++i) {
+        AutoLock lock(&packet_arenas[i].lock);
+        void* ptr = packet_arenas[i].arena.Alloc();
+        if (ptr != nullptr)
+            return ptr;
+    }
+    return malloc(kBuckets[bucket].slot_size);
+}
+
+// Payloads smaller than this are always copied; moving a handful of pages
+// costs more in TLB shootdowns than copying them does.
+constexpr size_t kMinMovedSize = 4 * PAGE_SIZE;
+
+} // namespace
+
+// static
+void MessagePacket::Init() TA_NO_THREAD_SAFETY_ANALYSIS {
+    // The largest possible header and handle array must fit in a slot.
+    static_assert(sizeof(MessagePacket) + kMaxMessageHandles * sizeof(Handle*) <= kMaxInlineSize,
+                  "");
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        auto& pa = packet_arenas[i];
+        status_t status = pa.arena.Init(kBuckets[i].name, kBuckets[i].slot_size,
+                                        kBuckets[i].max_count);
+        if (status != MX_OK)
+            panic("unable to create message packet arena '%s' (%d)\n", kBuckets[i].name, status);
+        pa.start = static_cast<char*>(pa.arena.start());
+        pa.end = static_cast<char*>(pa.arena.end());
+    }
+}
+
+// static
+void MessagePacket::DumpArenas() {
+    for (auto& pa : packet_arenas) {
+        AutoLock lock(&pa.lock);
+        pa.arena.Dump();
+    }
+}
+
+// static
+void MessagePacket::operator delete(void* ptr) {
+    for (auto& pa : packet_arenas) {
+        if (ptr >= pa.start && ptr < pa.end) {
+            AutoLock lock(&pa.lock);
+            pa.arena.Free(ptr);
+            return;
+        }
+    }
+    // The arenas were full when it was allocated.
+    free(ptr);
+}
 
 // static
 mx_status_t MessagePacket::NewPacket(uint32_t data_size, uint32_t num_handles,
+                                     ProcessCharges* charge, bool moved,
                                      mxtl::unique_ptr<MessagePacket>* msg) {
     // Although the API uses uint32_t, we pack the handle count into a smaller
     // field internally. Make sure it fits.
     static_assert(kMaxMessageHandles <= UINT16_MAX, "");
-    if (data_size > kMaxMessageSize || num_handles > kMaxMessageHandles) {
+    const uint32_t max_size = moved ? kMaxMovedMessageSize : kMaxMessageSize;
+    if (data_size > max_size || num_handles > kMaxMessageHandles) {
         return MX_ERR_OUT_OF_RANGE;
     }
 
-    // Allocate space for the MessagePacket object followed by num_handles
-    // Handle*s followed by data_size bytes.
-    // TODO(dbort): Use mbuf-style memory for data_size, ideally allocating from
-    // somewhere other than the heap. Lets us better track and isolate channel
-    // memory usage.
-    char* ptr = static_cast<char*>(malloc(sizeof(MessagePacket) +
-                                          num_handles * sizeof(Handle*) +
-                                          data_size));
+    const size_t header_size = sizeof(MessagePacket) + num_handles * sizeof(Handle*);
+    bool is_inline;
+    const size_t bucket = BucketFor(SlotSize(data_size, num_handles, moved, &is_inline));
+    const size_t charge_size = ChargeSize(data_size, num_handles, moved);
+
+    if (charge != nullptr) {
+        mx_status_t status = charge->ChargeChannelMemory(charge_size);
+        if (status != MX_OK)
+            return status;
+    }
+
+    char* ptr = static_cast<char*>(AllocSlot(bucket));
     if (ptr == nullptr) {
+        if (charge != nullptr)
+            charge->UnchargeChannelMemory(charge_size);
         return MX_ERR_NO_MEMORY;
     }
 
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    if (!is_inline && !moved) {
+        const size_t page_count = ROUNDUP(data_size, PAGE_SIZE) / PAGE_SIZE;
+        if (pmm_alloc_pages(page_count, PMM_ALLOC_FLAG_KMAP, &pages) != page_count) {
+            pmm_free(&pages);
+            MessagePacket::operator delete(ptr);
+            if (charge != nullptr)
+                charge->UnchargeChannelMemory(charge_size);
+            return MX_ERR_NO_MEMORY;
+        }
+    }
+
     // The storage space for the Handle*s is not initialized because
     // the only creators of MessagePackets (sys_channel_write and
     // _call, and userboot) fill that array immediately after creation
     // of the object.
-    msg->reset(new (ptr) MessagePacket(
-        data_size, num_handles,
-        reinterpret_cast<Handle**>(ptr + sizeof(MessagePacket))));
+    auto handles = reinterpret_cast<Handle**>(ptr + sizeof(MessagePacket));
+    auto packet = new (ptr) MessagePacket(data_size, num_handles, handles,
+                                          is_inline ? ptr + header_size : nullptr);
+    list_move(&pages, &packet->pages_);
+    if (charge != nullptr)
+        packet->charges_ = mxtl::WrapRefPtr(charge);
+    packet->moved_pages_ = moved;
+
+    msg->reset(packet);
+    return MX_OK;
+}
+
+template <typename F>
+mx_status_t MessagePacket::ForEachChunk(F func) const {
+    if (inline_data_ != nullptr)
+        return (data_size_ > 0u) ? func(inline_data_, 0u, data_size_) : MX_OK;
+
+    size_t offset = 0u;
+    vm_page_t* page;
+    list_for_every_entry (&pages_, page, vm_page_t, free.node) {
+        size_t len = mxtl::min<size_t>(PAGE_SIZE, data_size_ - offset);
+        char* chunk = static_cast<char*>(paddr_to_kvaddr(vm_page_to_paddr(page)));
+        mx_status_t status = func(chunk, offset, len);
+        if (status != MX_OK)
+            return status;
+        offset += len;
+    }
     return MX_OK;
 }
 
@@ -50,15 +218,17 @@ mx_status_t MessagePacket::NewPacket(uint32_t data_size, uint32_t num_handles,
 mx_status_t MessagePacket::Create(user_ptr<const void> data, uint32_t data_size,
                                   uint32_t num_handles,
                                   mxtl::unique_ptr<MessagePacket>* msg) {
-    mx_status_t status = NewPacket(data_size, num_handles, msg);
+    mx_status_t status = NewPacket(data_size, num_handles,
+                                   ProcessDispatcher::GetCurrent()->charges().get(), false, msg);
     if (status != MX_OK) {
         return status;
     }
-    if (data_size > 0u) {
-        if (data.copy_array_from_user((*msg)->data(), data_size) != MX_OK) {
-            msg->reset();
-            return MX_ERR_INVALID_ARGS;
-        }
+    status = (*msg)->ForEachChunk([data](char* chunk, size_t offset, size_t len) {
+        return data.byte_offset(offset).copy_array_from_user(chunk, len);
+    });
+    if (status != MX_OK) {
+        msg->reset();
+        return MX_ERR_INVALID_ARGS;
     }
     return MX_OK;
 }
@@ -67,27 +237,134 @@ mx_status_t MessagePacket::Create(user_ptr<const void> data, uint32_t data_size,
 mx_status_t MessagePacket::Create(const void* data, uint32_t data_size,
                                   uint32_t num_handles,
                                   mxtl::unique_ptr<MessagePacket>* msg) {
-    mx_status_t status = NewPacket(data_size, num_handles, msg);
+    mx_status_t status = NewPacket(data_size, num_handles, nullptr, false, msg);
     if (status != MX_OK) {
         return status;
     }
-    if (data_size > 0u) {
-        memcpy((*msg)->data(), data, data_size);
+    (*msg)->ForEachChunk([data](char* chunk, size_t offset, size_t len) {
+        memcpy(chunk, static_cast<const char*>(data) + offset, len);
+        return MX_OK;
+    });
+    return MX_OK;
+}
+
+// static
+mx_status_t MessagePacket::CreateMovingPages(user_ptr<const void> data, uint32_t data_size,
+                                             uint32_t num_handles,
+                                             mxtl::unique_ptr<MessagePacket>* msg) {
+    if (data_size < kMinMovedSize)
+        return Create(data, data_size, num_handles, msg);
+
+    mx_status_t status = NewPacket(data_size, num_handles,
+                                   ProcessDispatcher::GetCurrent()->charges().get(), true, msg);
+    if (status != MX_OK) {
+        return status;
+    }
+    MessagePacket* packet = msg->get();
+
+    // Take as many whole pages as we can from the writer...
+    const vaddr_t va = reinterpret_cast<vaddr_t>(data.get());
+    const size_t whole_pages_size = ROUNDDOWN(data_size, PAGE_SIZE);
+    size_t moved = 0u;
+    mxtl::RefPtr<VmObject> vmo;
+    uint64_t vmo_offset;
+    if (IS_PAGE_ALIGNED(va) &&
+        magenta_lookup_user_range(va, whole_pages_size, &vmo, &vmo_offset) == MX_OK &&
+        vmo->TakePages(vmo_offset, whole_pages_size, &packet->pages_) == MX_OK) {
+        // Every pmm arena is in the physmap, so the kernel can still read
+        // these pages if the reader ends up copying them out.
+        moved = whole_pages_size;
+    }
+
+    // ...and copy the rest into fresh ones.
+    const size_t page_count = (ROUNDUP(data_size, PAGE_SIZE) - moved) / PAGE_SIZE;
+    if (page_count > 0u) {
+        list_node pages = LIST_INITIAL_VALUE(pages);
+        if (pmm_alloc_pages(page_count, PMM_ALLOC_FLAG_KMAP, &pages) != page_count) {
+            pmm_free(&pages);
+            msg->reset();
+            return MX_ERR_NO_MEMORY;
+        }
+        list_node* node;
+        while ((node = list_remove_head(&pages)) != nullptr)
+            list_add_tail(&packet->pages_, node);
+    }
+
+    status = packet->ForEachChunk([data, moved](char* chunk, size_t offset, size_t len) {
+        if (offset < moved)
+            return MX_OK;
+        return data.byte_offset(offset).copy_array_from_user(chunk, len);
+    });
+    if (status != MX_OK) {
+        msg->reset();
+        return MX_ERR_INVALID_ARGS;
+    }
+    return MX_OK;
+}
+
+mx_status_t MessagePacket::CopyDataTo(user_ptr<void> buf) const {
+    return ForEachChunk([buf](char* chunk, size_t offset, size_t len) {
+        return buf.byte_offset(offset).copy_array_to_user(chunk, len);
+    });
+}
+
+mx_status_t MessagePacket::MoveDataTo(user_ptr<void> buf) {
+    const vaddr_t va = reinterpret_cast<vaddr_t>(buf.get());
+    const size_t whole_pages_size = ROUNDDOWN(data_size_, PAGE_SIZE);
+    if (!moved_pages_ || !IS_PAGE_ALIGNED(va) || whole_pages_size < kMinMovedSize)
+        return CopyDataTo(buf);
+
+    mxtl::RefPtr<VmObject> vmo;
+    uint64_t vmo_offset;
+    if (magenta_lookup_user_range(va, whole_pages_size, &vmo, &vmo_offset) != MX_OK)
+        return CopyDataTo(buf);
+
+    // Copy out the partial last page first, so that a bad buffer leaves
+    // the packet intact.
+    if (data_size_ > whole_pages_size) {
+        mx_status_t status = ForEachChunk(
+            [buf, whole_pages_size](char* chunk, size_t offset, size_t len) {
+                if (offset < whole_pages_size)
+                    return MX_OK;
+                return buf.byte_offset(offset).copy_array_to_user(chunk, len);
+            });
+        if (status != MX_OK)
+            return status;
     }
+
+    // Hand the whole pages over. This only fails before consuming any of
+    // them, in which case copying is still an option.
+    if (vmo->SupplyPages(vmo_offset, whole_pages_size, &pages_) != MX_OK)
+        return CopyDataTo(buf);
     return MX_OK;
 }
 
+mx_txid_t MessagePacket::get_txid() const {
+    if (data_size_ < sizeof(mx_txid_t))
+        return 0;
+    if (inline_data_ != nullptr)
+        return *(reinterpret_cast<const mx_txid_t*>(inline_data_));
+    const vm_page_t* page = containerof(pages_.next, vm_page_t, free.node);
+    return *(reinterpret_cast<const mx_txid_t*>(paddr_to_kvaddr(vm_page_to_paddr(page))));
+}
+
 MessagePacket::~MessagePacket() {
     if (owns_handles_) {
         // Delete handles out-of-band to avoid the worst case recursive
         // destruction behavior.
         ReapHandles(handles_, num_handles_);
     }
+    if (!list_is_empty(&pages_))
+        pmm_free(&pages_);
+    if (charges_)
+        charges_->UnchargeChannelMemory(ChargeSize(data_size_, num_handles_, moved_pages_));
 }
 
-MessagePacket::MessagePacket(uint32_t data_size,
-                             uint32_t num_handles, Handle** handles)
-    : handles_(handles), data_size_(data_size),
+MessagePacket::MessagePacket(uint32_t data_size, uint32_t num_handles,
+                             Handle** handles, char* inline_data)
+    : handles_(handles), inline_data_(inline_data), data_size_(data_size),
       // NewPacket ensures that num_handles fits in 16 bits.
-      num_handles_(static_cast<uint16_t>(num_handles)), owns_handles_(false) {
+      num_handles_(static_cast<uint16_t>(num_handles)), owns_handles_(false),
+      moved_pages_(false) {
+    list_initialize(&pages_);
 }
@@ -6,13 +6,16 @@
 
 #include <magenta/port_dispatcher.h>
 
+#include <arch/ops.h>
 #include <assert.h>
 #include <err.h>
+#include <kernel/spinlock.h>
 #include <platform.h>
 #include <pow2.h>
 
 #include <magenta/compiler.h>
 #include <magenta/excp_port.h>
+#include <magenta/process_dispatcher.h>
 #include <magenta/rights.h>
 #include <magenta/state_tracker.h>
 #include <magenta/syscalls/port.h>
@@ -26,30 +29,141 @@ using mxtl::AutoLock;
 namespace {
 constexpr size_t kMaxPendingPacketCount = 16 * 1024u;
 
+static_assert(kMaxUserPortPacketsPerProcess <= kMaxPendingPacketCount / 8, "");
+
+bool IsUserPacket(const PortPacket* port_packet) {
+    return port_packet->type() == (MX_PKT_TYPE_USER | PKT_FLAG_EPHEMERAL);
+}
+
+// Each cpu keeps a small stack of free packet slots so that Make() and
+// Delete() rarely touch the shared arena. A cache is refilled with
+// kCacheBatch slots when it runs dry and gives kCacheBatch slots back
+// when it holds more than kCacheMax.
+constexpr size_t kCacheBatch = 16u;
+constexpr size_t kCacheMax = 4 * kCacheBatch;
+
 mxtl::Mutex arena_mutex;
 mxtl::Arena TA_GUARDED(arena_mutex) packet_arena;
 
+// Overlays a free packet slot.
+struct FreeSlot {
+    FreeSlot* next;
+};
+
+// The lock only ever contends when a thread migrates between picking
+// a cache and locking it; it is taken with interrupts disabled so it is
+// never held across a reschedule.
+struct PacketCache {
+    SpinLock lock;
+    FreeSlot* head = nullptr;   // guarded by |lock|.
+    size_t count = 0u;          // guarded by |lock|.
+};
+
+PacketCache packet_caches[SMP_MAX_CPUS];
+
+PacketCache& CurrentCache() {
+    return packet_caches[arch_curr_cpu_num()];
+}
+
+// Pops a slot from the cache, or returns nullptr if it is empty.
+void* CachePop(PacketCache& cache) {
+    spin_lock_saved_state_t state;
+    cache.lock.AcquireIrqSave(state);
+    FreeSlot* slot = cache.head;
+    if (slot) {
+        cache.head = slot->next;
+        --cache.count;
+    }
+    cache.lock.ReleaseIrqRestore(state);
+    return slot;
+}
+
+// Pushes the |count| slots chained from |first| to |last| onto the cache.
+// If the cache is then over kCacheMax, returns a chain of kCacheBatch
+// slots the caller must give back to the arena, otherwise nullptr.
+FreeSlot* CachePush(PacketCache& cache, FreeSlot* first, FreeSlot* last, size_t count) {
+    FreeSlot* excess = nullptr;
+    spin_lock_saved_state_t state;
+    cache.lock.AcquireIrqSave(state);
+    last->next = cache.head;
+    cache.head = first;
+    cache.count += count;
+    if (cache.count > kCacheMax) {
+        excess = cache.head;
+        FreeSlot* tail = excess;
+        for (size_t i = 1u; i < kCacheBatch; ++i)
+            tail = tail->next;
+        cache.head = tail->next;
+        cache.count -= kCacheBatch;
+        tail->next = nullptr;
+    }
+    cache.lock.ReleaseIrqRestore(state);
+    return excess;
+}
+
+// Frees a chain of slots returned by CachePush().
+void ReturnToArena(FreeSlot* chain) {
+    if (chain == nullptr)
+        return;
+    AutoLock lock(&arena_mutex);
+    while (chain) {
+        FreeSlot* next = chain->next;
+        packet_arena.Free(chain);
+        chain = next;
+    }
+}
+
 }  // namespace.
 
 
 PortPacket* PortPacket::Make() {
-    AutoLock lock(&arena_mutex);
-    void* addr = packet_arena.Alloc();
+    PacketCache& cache = CurrentCache();
+    void* addr = CachePop(cache);
     if (addr == nullptr) {
-        lock.release();
-        printf("WARNING: Could not allocate new port packet\n");
-        return nullptr;
+        // Take a batch from the arena: keep the first slot and cache the rest.
+        FreeSlot* first = nullptr;
+        FreeSlot* last = nullptr;
+        size_t count = 0u;
+        {
+            AutoLock lock(&arena_mutex);
+            addr = packet_arena.Alloc();
+            if (addr == nullptr) {
+                lock.release();
+                // The remaining free slots, if any, sit in other cpus' caches.
+                for (auto& other : packet_caches) {
+                    if ((addr = CachePop(other)) != nullptr)
+                        return new (addr) PortPacket(nullptr);
+                }
+                printf("WARNING: Could not allocate new port packet\n");
+                return nullptr;
+            }
+            for (; count < kCacheBatch - 1; ++count) {
+                auto slot = static_cast<FreeSlot*>(packet_arena.Alloc());
+                if (slot == nullptr)
+                    break;
+                slot->next = first;
+                first = slot;
+                if (last == nullptr)
+                    last = slot;
+            }
+        }
+        if (count > 0u) {
+            // The cache was empty a moment ago, so this cannot overflow it
+            // unless other threads refilled it concurrently.
+            ReturnToArena(CachePush(cache, first, last, count));
+        }
     }
     return new (addr) PortPacket(nullptr);
 }
 
 void PortPacket::Delete(PortPacket* packet) {
-    AutoLock lock(&arena_mutex);
-    packet_arena.Free(packet);
+    auto slot = reinterpret_cast<FreeSlot*>(packet);
+    ReturnToArena(CachePush(CurrentCache(), slot, slot, 1u));
 }
 
 
-PortPacket::PortPacket(const void* handle) : packet{}, handle(handle), observer(nullptr) {
+PortPacket::PortPacket(const void* handle)
+    : packet{}, handle(handle), observer(nullptr), queued(0u) {
     // Note that packet is initialized to zeros.
 }
 
@@ -112,6 +226,11 @@ StateObserver::Flags PortObserver::MaybeQueue(mx_signals_t new_state, uint64_t c
     if ((trigger_ & new_state) == 0u)
         return 0;
 
+    // A repeating wait whose last packet has not been read yet has nothing
+    // to add; the reader will see that packet after this change anyway.
+    if (packet_.queued.load() != 0u)
+        return 0;
+
     auto status = port_->Queue(&packet_, new_state, count);
 
     if ((type_ == MX_PKT_TYPE_SIGNAL_ONE) || (status < 0))
@@ -123,6 +242,7 @@ StateObserver::Flags PortObserver::MaybeQueue(mx_signals_t new_state, uint64_t c
 /////////////////////////////////////////////////////////////////////////////////////////
 
 void PortDispatcher::Init() {
+    static_assert(sizeof(FreeSlot) <= sizeof(PortPacket), "");
     packet_arena.Init("packets", sizeof(PortPacket), kMaxPendingPacketCount);
 }
 
@@ -172,16 +292,29 @@ void PortDispatcher::on_zero_handles() {
 mx_status_t PortDispatcher::QueueUser(const mx_port_packet_t& packet) {
     canary_.Assert();
 
+    // The packet is charged to the writing process, however many ports it
+    // spreads its packets over, until CopyLocked() dequeues it.
+    const auto& charges = ProcessDispatcher::GetCurrent()->charges();
+    mx_status_t status = charges->ChargePortPacket();
+    if (status != MX_OK)
+        return status;
+
     auto port_packet = PortPacket::Make();
-    if (!port_packet)
+    if (!port_packet) {
+        charges->UnchargePortPacket();
         return MX_ERR_NO_MEMORY;
+    }
 
     port_packet->packet = packet;
     port_packet->packet.type = MX_PKT_TYPE_USER | PKT_FLAG_EPHEMERAL;
+    port_packet->charges = charges;
 
-    auto status = Queue(port_packet, 0u, 0u);
-    if (status < 0)
+    status = Queue(port_packet, 0u, 0u);
+    if (status < 0) {
+        port_packet->charges.reset();
+        charges->UnchargePortPacket();
         PortPacket::Delete(port_packet);
+    }
     return status;
 }
 
@@ -201,6 +334,7 @@ mx_status_t PortDispatcher::Queue(PortPacket* port_packet,
                 return MX_OK;
             port_packet->packet.signal.observed = observed;
             port_packet->packet.signal.count = count;
+            port_packet->queued.store(1u);
         }
 
         packets_.push_back(port_packet);
@@ -243,10 +377,56 @@ wait:
     }
 }
 
+mx_status_t PortDispatcher::DeQueueMany(mx_time_t deadline, mx_port_packet_t* packets,
+                                        uint32_t count, uint32_t* actual) {
+    canary_.Assert();
+    DEBUG_ASSERT(count > 0u && count <= kMaxPortBatch);
+
+    PortPacket* port_packets[kMaxPortBatch];
+    PortObserver* observers[kMaxPortBatch];
+    uint32_t n = 0u;
+
+    while (true) {
+        {
+            AutoLock al(&lock_);
+            while (n < count && !packets_.is_empty()) {
+                port_packets[n] = packets_.pop_front();
+                observers[n] = CopyLocked(port_packets[n], &packets[n]);
+                ++n;
+            }
+        }
+
+        if (n == 0u) {
+            status_t st = sema_.Wait(deadline);
+            if (st != MX_OK)
+                return st;
+            continue;
+        }
+
+        // As in DeQueue(), observers and ephemeral packets are destroyed
+        // outside the lock.
+        for (uint32_t i = 0u; i < n; ++i) {
+            if (observers[i])
+                delete observers[i];
+            else if (packets[i].type & PKT_FLAG_EPHEMERAL)
+                PortPacket::Delete(port_packets[i]);
+        }
+
+        *actual = n;
+        return MX_OK;
+    }
+}
+
 PortObserver* PortDispatcher::CopyLocked(PortPacket* port_packet, mx_port_packet_t* packet) {
+    port_packet->queued.store(0u);
     if (packet)
         *packet = port_packet->packet;
 
+    if (IsUserPacket(port_packet)) {
+        port_packet->charges->UnchargePortPacket();
+        port_packet->charges.reset();
+    }
+
     return (port_packet->type() & PKT_FLAG_EPHEMERAL) ? nullptr : port_packet->observer;
 }
 
@@ -320,6 +500,7 @@ bool PortDispatcher::CancelQueued(const void* handle, uint64_t key) {
 
         if ((it->handle == handle) && (it->key() == key)) {
             auto to_remove = it++;
+            to_remove->queued.store(0u);
             delete packets_.erase(to_remove)->observer;
             packet_removed = true;
         } else {
@@ -0,0 +1,57 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <magenta/process_charges.h>
+
+#include <assert.h>
+#include <err.h>
+
+#include <magenta/message_packet.h>
+#include <magenta/port_dispatcher.h>
+#include <mxtl/algorithm.h>
+#include <mxtl/alloc_checker.h>
+
+// static
+mx_status_t ProcessCharges::Create(mxtl::RefPtr<ProcessCharges>* charges) {
+    mxtl::AllocChecker ac;
+    auto c = mxtl::AdoptRef(new (&ac) ProcessCharges());
+    if (!ac.check())
+        return MX_ERR_NO_MEMORY;
+    *charges = mxtl::move(c);
+    return MX_OK;
+}
+
+mx_status_t ProcessCharges::ChargeChannelMemory(size_t bytes) {
+    size_t current = channel_bytes_.load(mxtl::memory_order_relaxed);
+    do {
+        if (bytes > kMaxChannelBytesPerProcess - mxtl::min(current, kMaxChannelBytesPerProcess))
+            return MX_ERR_NO_RESOURCES;
+    } while (!channel_bytes_.compare_exchange_weak(&current, current + bytes,
+                                                   mxtl::memory_order_relaxed,
+                                                   mxtl::memory_order_relaxed));
+    return MX_OK;
+}
+
+void ProcessCharges::UnchargeChannelMemory(size_t bytes) {
+    __UNUSED size_t previous = channel_bytes_.fetch_sub(bytes, mxtl::memory_order_relaxed);
+    DEBUG_ASSERT(previous >= bytes);
+}
+
+mx_status_t ProcessCharges::ChargePortPacket() {
+    uint32_t current = port_packets_.load(mxtl::memory_order_relaxed);
+    do {
+        if (current >= kMaxUserPortPacketsPerProcess)
+            return MX_ERR_SHOULD_WAIT;
+    } while (!port_packets_.compare_exchange_weak(&current, current + 1u,
+                                                  mxtl::memory_order_relaxed,
+                                                  mxtl::memory_order_relaxed));
+    return MX_OK;
+}
+
+void ProcessCharges::UnchargePortPacket() {
+    __UNUSED uint32_t previous = port_packets_.fetch_sub(1u, mxtl::memory_order_relaxed);
+    DEBUG_ASSERT(previous > 0u);
+}
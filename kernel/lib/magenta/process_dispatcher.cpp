@@ -29,12 +29,14 @@
 #include <magenta/handle_reaper.h>
 #include <magenta/job_dispatcher.h>
 #include <magenta/magenta.h>
+#include <magenta/message_packet.h>
 #include <magenta/rights.h>
 #include <magenta/thread_dispatcher.h>
 #include <magenta/user_copy.h>
 #include <magenta/vm_address_region_dispatcher.h>
 #include <magenta/vm_object_dispatcher.h>
 
+#include <mxtl/algorithm.h>
 #include <mxtl/alloc_checker.h>
 #include <mxtl/auto_lock.h>
 
@@ -68,10 +70,14 @@ mx_status_t ProcessDispatcher::Create(
     if (!ac.check())
         return MX_ERR_NO_MEMORY;
 
+    status_t result = ProcessCharges::Create(&process->charges_);
+    if (result != MX_OK)
+        return result;
+
     if (!job->AddChildProcess(process.get()))
         return MX_ERR_BAD_STATE;
 
-    status_t result = process->Initialize();
+    result = process->Initialize();
     if (result != MX_OK)
         return result;
 
@@ -102,8 +108,7 @@ ProcessDispatcher::ProcessDispatcher(mxtl::RefPtr<JobDispatcher> job,
 
     // Generate handle XOR mask with top bit and bottom two bits cleared
     uint32_t secret;
-    auto prng = crypto::GlobalPRNG::GetInstance();
-    prng->Draw(&secret, sizeof(secret));
+    crypto::GlobalPRNG::Draw(&secret, sizeof(secret));
 
     // Handle values cannot be negative values, so we mask the high bit.
     handle_rand_ = (secret << 2) & INT_MAX;
@@ -734,6 +739,11 @@ mx_status_t ProcessDispatcher::set_debug_addr(uintptr_t addr) {
     return MX_OK;
 }
 
+void ProcessDispatcher::RecordSyscall(uint cpu, uint64_t num, lk_time_t duration) {
+    syscall_stats_.Record(cpu, num, duration);
+    job_->RecordSyscall(cpu, num, duration);
+}
+
 mx_status_t ProcessDispatcher::QueryPolicy(uint32_t condition) const {
     auto action = GetSystemPolicyManager()->QueryBasicPolicy(policy_, condition);
     if (action & MX_POL_ACTION_EXCEPTION) {
@@ -10,6 +10,7 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 MODULE := $(LOCAL_DIR)
 
 MODULE_SRCS := \
+    $(LOCAL_DIR)/call_ring_dispatcher.cpp \
     $(LOCAL_DIR)/channel_dispatcher.cpp \
     $(LOCAL_DIR)/diagnostics.cpp \
     $(LOCAL_DIR)/dispatcher.cpp \
@@ -33,17 +34,20 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/pci_interrupt_dispatcher.cpp \
     $(LOCAL_DIR)/policy_manager.cpp \
     $(LOCAL_DIR)/port_dispatcher.cpp \
+    $(LOCAL_DIR)/process_charges.cpp \
     $(LOCAL_DIR)/process_dispatcher.cpp \
     $(LOCAL_DIR)/resource_dispatcher.cpp \
     $(LOCAL_DIR)/semaphore.cpp \
     $(LOCAL_DIR)/socket_dispatcher.cpp \
     $(LOCAL_DIR)/state_tracker.cpp \
+    $(LOCAL_DIR)/syscall_stats.cpp \
     $(LOCAL_DIR)/thread_dispatcher.cpp \
     $(LOCAL_DIR)/timer_dispatcher.cpp \
     $(LOCAL_DIR)/user_copy.cpp \
     $(LOCAL_DIR)/vcpu_dispatcher.cpp \
     $(LOCAL_DIR)/vm_address_region_dispatcher.cpp \
     $(LOCAL_DIR)/vm_object_dispatcher.cpp \
+    $(LOCAL_DIR)/wait_set_dispatcher.cpp \
     $(LOCAL_DIR)/wait_state_observer.cpp \
 
 # Tests
@@ -150,8 +150,8 @@ status_t SocketDispatcher::HalfCloseOther() {
     return MX_OK;
 }
 
-mx_status_t SocketDispatcher::Write(user_ptr<const void> src, size_t len,
-                                    size_t* nwritten) {
+mx_status_t SocketDispatcher::WriteV(const mx_iovec_t* iov, size_t num_iov, bool move_pages,
+                                     size_t* nwritten) {
     canary_.Assert();
 
     mxtl::RefPtr<SocketDispatcher> other;
@@ -164,17 +164,18 @@ mx_status_t SocketDispatcher::Write(user_ptr<const void> src, size_t len,
         other = other_;
     }
 
+    size_t len;
+    if (!TotalSize(iov, num_iov, &len))
+        return MX_ERR_INVALID_ARGS;
     if (len == 0) {
         *nwritten = 0;
         return MX_OK;
     }
-    if (len != static_cast<size_t>(static_cast<uint32_t>(len)))
-        return MX_ERR_INVALID_ARGS;
 
-    return other->WriteSelf(src, len, nwritten);
+    return other->WriteSelf(iov, num_iov, move_pages, nwritten);
 }
 
-mx_status_t SocketDispatcher::WriteSelf(user_ptr<const void> src, size_t len,
+mx_status_t SocketDispatcher::WriteSelf(const mx_iovec_t* iov, size_t num_iov, bool move_pages,
                                         size_t* written) {
     canary_.Assert();
 
@@ -188,9 +189,9 @@ mx_status_t SocketDispatcher::WriteSelf(user_ptr<const void> src, size_t len,
     size_t st = 0u;
     mx_status_t status;
     if (flags_ == MX_SOCKET_DATAGRAM) {
-        status = data_.WriteDatagram(src, len, &st);
+        status = data_.WriteDatagram(iov, num_iov, &st);
     } else {
-        status = data_.WriteStream(src, len, &st);
+        status = data_.WriteStream(iov, num_iov, move_pages, &st);
     }
     if (status)
         return status;
@@ -211,17 +212,26 @@ mx_status_t SocketDispatcher::Read(user_ptr<void> dst, size_t len,
                                    size_t* nread) {
     canary_.Assert();
 
-    AutoLock lock(&lock_);
-
     // Just query for bytes outstanding.
     if (!dst && len == 0) {
+        AutoLock lock(&lock_);
         *nread = data_.size();
         return MX_OK;
     }
 
-    if (len != (size_t)((uint32_t)len))
+    mx_iovec_t iov = {dst.get(), len};
+    return ReadV(&iov, 1u, nread);
+}
+
+mx_status_t SocketDispatcher::ReadV(const mx_iovec_t* iov, size_t num_iov, size_t* nread) {
+    canary_.Assert();
+
+    size_t len;
+    if (!TotalSize(iov, num_iov, &len))
         return MX_ERR_INVALID_ARGS;
 
+    AutoLock lock(&lock_);
+
     bool closed = half_closed_[1] || !other_;
 
     if (is_empty())
@@ -229,7 +239,7 @@ mx_status_t SocketDispatcher::Read(user_ptr<void> dst, size_t len,
 
     bool was_full = is_full();
 
-    auto st = data_.Read(dst, len, flags_ == MX_SOCKET_DATAGRAM);
+    auto st = data_.Read(iov, num_iov, flags_ == MX_SOCKET_DATAGRAM);
 
     if (is_empty())
         state_tracker_.UpdateState(MX_SOCKET_READABLE, 0u);
@@ -240,3 +250,115 @@ mx_status_t SocketDispatcher::Read(user_ptr<void> dst, size_t len,
     *nread = static_cast<size_t>(st);
     return MX_OK;
 }
+
+mx_status_t SocketDispatcher::WriteMany(const mx_iovec_t* dgrams, size_t num_dgrams,
+                                       size_t* nwritten) {
+    canary_.Assert();
+
+    if (flags_ != MX_SOCKET_DATAGRAM)
+        return MX_ERR_NOT_SUPPORTED;
+
+    mxtl::RefPtr<SocketDispatcher> other;
+    {
+        AutoLock lock(&lock_);
+        if (!other_)
+            return MX_ERR_PEER_CLOSED;
+        if (half_closed_[0])
+            return MX_ERR_BAD_STATE;
+        other = other_;
+    }
+
+    size_t len;
+    for (size_t i = 0; i < num_dgrams; i++) {
+        if (!TotalSize(&dgrams[i], 1u, &len))
+            return MX_ERR_INVALID_ARGS;
+    }
+
+    return other->WriteManySelf(dgrams, num_dgrams, nwritten);
+}
+
+mx_status_t SocketDispatcher::WriteManySelf(const mx_iovec_t* dgrams, size_t num_dgrams,
+                                           size_t* nwritten) {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+
+    if (is_full())
+        return MX_ERR_SHOULD_WAIT;
+
+    bool was_empty = is_empty();
+
+    size_t count = 0u;
+    for (; count < num_dgrams; count++) {
+        // Empty datagrams are accepted and dropped, as by Write.
+        if (dgrams[count].size == 0u)
+            continue;
+        size_t st;
+        mx_status_t status = data_.WriteDatagram(&dgrams[count], 1u, &st);
+        if (status != MX_OK) {
+            if (count == 0u)
+                return status;
+            break;
+        }
+    }
+
+    if (was_empty && !is_empty())
+        state_tracker_.UpdateState(0u, MX_SOCKET_READABLE);
+
+    if (is_full())
+        other_->state_tracker_.UpdateState(MX_SOCKET_WRITABLE, 0u);
+
+    *nwritten = count;
+    return MX_OK;
+}
+
+mx_status_t SocketDispatcher::ReadMany(mx_iovec_t* dgrams, size_t num_dgrams, size_t* nread) {
+    canary_.Assert();
+
+    if (flags_ != MX_SOCKET_DATAGRAM)
+        return MX_ERR_NOT_SUPPORTED;
+
+    size_t len;
+    for (size_t i = 0; i < num_dgrams; i++) {
+        if (dgrams[i].size == 0u || !TotalSize(&dgrams[i], 1u, &len))
+            return MX_ERR_INVALID_ARGS;
+    }
+
+    AutoLock lock(&lock_);
+
+    bool closed = half_closed_[1] || !other_;
+
+    if (is_empty())
+        return closed ? MX_ERR_PEER_CLOSED : MX_ERR_SHOULD_WAIT;
+
+    bool was_full = is_full();
+
+    size_t count = 0u;
+    for (; count < num_dgrams && !is_empty(); count++)
+        dgrams[count].size = data_.Read(&dgrams[count], 1u, true);
+
+    if (is_empty())
+        state_tracker_.UpdateState(MX_SOCKET_READABLE, 0u);
+
+    if (!closed && was_full && !is_full())
+        other_->state_tracker_.UpdateState(0u, MX_SOCKET_WRITABLE);
+
+    *nread = count;
+    return MX_OK;
+}
+
+// static
+bool SocketDispatcher::TotalSize(const mx_iovec_t* iov, size_t num_iov, size_t* total) {
+    size_t len = 0u;
+    for (size_t i = 0; i < num_iov; i++) {
+        if (iov[i].size > 0u && iov[i].buffer == nullptr)
+            return false;
+        if (iov[i].size > SIZE_MAX - len)
+            return false;
+        len += iov[i].size;
+    }
+    if (len != static_cast<size_t>(static_cast<uint32_t>(len)))
+        return false;
+    *total = len;
+    return true;
+}
@@ -13,8 +13,29 @@ using mxtl::AutoLock;
 
 namespace {
 
+// Calls |f| on every observer of |observers| and moves the ones which ask
+// for it to |obs_to_remove|. Returns the combined flags.
 template <typename Func>
-StateObserver::Flags CancelWithFunc(StateTracker::ObserverList* observers,
+StateObserver::Flags WalkObservers(StateTracker::ObserverList* observers,
+                                   StateTracker::ObserverList* obs_to_remove, Func f) {
+    StateObserver::Flags flags = 0;
+
+    for (auto it = observers->begin(); it != observers->end();) {
+        StateObserver::Flags it_flags = f(it.CopyPointer());
+        flags |= it_flags;
+        if (it_flags & StateObserver::kNeedRemoval) {
+            auto to_remove = it;
+            ++it;
+            obs_to_remove->push_back(observers->erase(to_remove));
+        } else {
+            ++it;
+        }
+    }
+    return flags;
+}
+
+template <typename Func>
+StateObserver::Flags CancelWithFunc(StateTracker::ObserverList* observers, size_t num_lists,
                                     mxtl::Mutex* observer_lock, Func f) {
     StateObserver::Flags flags = 0;
 
@@ -22,17 +43,8 @@ StateObserver::Flags CancelWithFunc(StateTracker::ObserverList* observers,
 
     {
         AutoLock lock(observer_lock);
-        for (auto it = observers->begin(); it != observers->end();) {
-            StateObserver::Flags it_flags = f(it.CopyPointer());
-            flags |= it_flags;
-            if (it_flags & StateObserver::kNeedRemoval) {
-                auto to_remove = it;
-                ++it;
-                obs_to_remove.push_back(observers->erase(to_remove));
-            } else {
-                ++it;
-            }
-        }
+        for (size_t ix = 0; ix < num_lists; ++ix)
+            flags |= WalkObservers(&observers[ix], &obs_to_remove, f);
     }
 
     while (!obs_to_remove.is_empty()) {
@@ -54,8 +66,19 @@ void StateTracker::AddObserver(StateObserver* observer, const StateObserver::Cou
         AutoLock lock(&lock_);
 
         flags = observer->OnInitialize(signals_, cinfo);
-        if (!(flags & StateObserver::kNeedRemoval))
-            observers_.push_front(observer);
+        if (!(flags & StateObserver::kNeedRemoval)) {
+            // Observers watching every signal are kept on kOtherList, so
+            // they don't make the list for bit 0 match every change.
+            const mx_signals_t watched = observer->watched_signals();
+            uint32_t index = kOtherList;
+            if (watched != StateObserver::kAllSignals && watched != 0u &&
+                static_cast<uint32_t>(__builtin_ctz(watched)) < kIndexedSignals)
+                index = __builtin_ctz(watched);
+            watched_[index] = observers_[index].is_empty() ? watched : (watched_[index] | watched);
+            observer->tracked_signals_ = watched;
+            observer->list_index_ = index;
+            observers_[index].push_front(observer);
+        }
     }
     if (flags & StateObserver::kNeedRemoval)
         observer->OnRemoved();
@@ -63,18 +86,22 @@ void StateTracker::AddObserver(StateObserver* observer, const StateObserver::Cou
         thread_reschedule();
 }
 
-void StateTracker::RemoveObserver(StateObserver* observer) {
+bool StateTracker::RemoveObserver(StateObserver* observer) {
     canary_.Assert();
 
     AutoLock lock(&lock_);
     DEBUG_ASSERT(observer != nullptr);
-    observers_.erase(*observer);
+    if (!observer->state_observer_list_node_state_.InContainer())
+        return false;
+    observers_[observer->list_index_].erase(*observer);
+    return true;
 }
 
 bool StateTracker::Cancel(Handle* handle) {
     canary_.Assert();
 
-    StateObserver::Flags flags = CancelWithFunc(&observers_, &lock_, [handle](StateObserver* obs) {
+    StateObserver::Flags flags = CancelWithFunc(observers_, kNumLists, &lock_,
+                                                [handle](StateObserver* obs) {
         return obs->OnCancel(handle);
     });
 
@@ -87,7 +114,8 @@ bool StateTracker::Cancel(Handle* handle) {
 bool StateTracker::CancelByKey(Handle* handle, const void* port, uint64_t key) {
     canary_.Assert();
 
-    StateObserver::Flags flags = CancelWithFunc(&observers_, &lock_, [handle, port, key](StateObserver* obs) {
+    StateObserver::Flags flags = CancelWithFunc(observers_, kNumLists, &lock_,
+                                                [handle, port, key](StateObserver* obs) {
         return obs->OnCancelByKey(handle, port, key);
     });
 
@@ -113,7 +141,7 @@ void StateTracker::UpdateState(mx_signals_t clear_mask,
         if (previous_signals == signals_)
             return;
 
-        flags = UpdateInternalLocked(&obs_to_remove, signals_);
+        flags = UpdateInternalLocked(&obs_to_remove, signals_, previous_signals ^ signals_);
     }
 
     while (!obs_to_remove.is_empty()) {
@@ -133,8 +161,7 @@ void StateTracker::StrobeState(mx_signals_t notify_mask) {
     {
         AutoLock lock(&lock_);
         // include currently active signals as well
-        notify_mask |= signals_;
-        flags = UpdateInternalLocked(&obs_to_remove, notify_mask);
+        flags = UpdateInternalLocked(&obs_to_remove, notify_mask | signals_, notify_mask);
     }
 
     while (!obs_to_remove.is_empty()) {
@@ -167,7 +194,7 @@ void StateTracker::UpdateLastHandleSignal(uint32_t* count) {
         if (previous_signals == signals_)
             return;
 
-        flags = UpdateInternalLocked(&obs_to_remove, signals_);
+        flags = UpdateInternalLocked(&obs_to_remove, signals_, MX_SIGNAL_LAST_HANDLE);
     }
 
     while (!obs_to_remove.is_empty()) {
@@ -222,19 +249,23 @@ mx_status_t StateTracker::InvalidateCookie(CookieJar* cookiejar) {
     return MX_OK;
 }
 
-StateObserver::Flags StateTracker::UpdateInternalLocked(ObserverList* obs_to_remove, mx_signals_t signals) {
+StateObserver::Flags StateTracker::UpdateInternalLocked(ObserverList* obs_to_remove,
+                                                        mx_signals_t signals,
+                                                        mx_signals_t changed) {
     StateObserver::Flags flags = 0;
 
-    for (auto it = observers_.begin(); it != observers_.end();) {
-        StateObserver::Flags it_flags = it->OnStateChange(signals);
-        flags |= it_flags;
-        if (it_flags & StateObserver::kNeedRemoval) {
-            auto to_remove = it;
-            ++it;
-            obs_to_remove->push_back(observers_.erase(to_remove));
-        } else {
-            ++it;
-        }
+    // Lists with no observer watching the changed signals are skipped
+    // without looking at them. The rest may hold observers watching other
+    // signals, which are filtered one by one.
+    for (uint32_t ix = 0; ix < kNumLists; ++ix) {
+        if (!(watched_[ix] & changed))
+            continue;
+        flags |= WalkObservers(&observers_[ix], obs_to_remove,
+                               [signals, changed](StateObserver* obs) -> StateObserver::Flags {
+            if (!(obs->tracked_signals_ & changed))
+                return 0;
+            return obs->OnStateChange(signals);
+        });
     }
 
     // Filter out NeedRemoval flag because we processed that here
@@ -219,6 +219,148 @@ bool on_cancel_by_key(void* context) {
 
 } // namespace removal
 
+// Tests for notifying only the observers watching the changed signals
+namespace filtering {
+
+class CountingObserver : public StateObserver {
+public:
+    explicit CountingObserver(mx_signals_t watched = kAllSignals) : watched_(watched) {}
+
+    // The number of times OnStateChange() has been called.
+    int changes() const { return changes_; }
+    // The |new_state| of the last OnStateChange().
+    mx_signals_t last_state() const { return last_state_; }
+
+private:
+    mx_signals_t watched_signals() const override { return watched_; }
+    Flags OnInitialize(mx_signals_t initial_state,
+                       const StateObserver::CountInfo* cinfo) override {
+        return 0;
+    }
+    Flags OnStateChange(mx_signals_t new_state) override {
+        changes_++;
+        last_state_ = new_state;
+        return 0;
+    }
+    Flags OnCancel(Handle* handle) override { return 0; }
+
+    const mx_signals_t watched_;
+    int changes_ = 0;
+    mx_signals_t last_state_ = 0u;
+};
+
+bool only_watched_signals(void* context) {
+    BEGIN_TEST;
+
+    CountingObserver obs1(1u);
+    CountingObserver obs2(2u);
+    CountingObserver obs_all;
+
+    StateTracker st;
+    st.AddObserver(&obs1, nullptr);
+    st.AddObserver(&obs2, nullptr);
+    st.AddObserver(&obs_all, nullptr);
+
+    st.UpdateState(0u, 1u);
+    EXPECT_EQ(1, obs1.changes(), "");
+    EXPECT_EQ(0, obs2.changes(), "");
+    EXPECT_EQ(1, obs_all.changes(), "");
+
+    // The new state carries every signal, watched or not.
+    st.UpdateState(0u, 2u);
+    EXPECT_EQ(1, obs1.changes(), "");
+    EXPECT_EQ(1, obs2.changes(), "");
+    EXPECT_EQ(2, obs_all.changes(), "");
+    EXPECT_EQ(3u | MX_SIGNAL_LAST_HANDLE, obs2.last_state(), "");
+
+    st.StrobeState(2u);
+    EXPECT_EQ(1, obs1.changes(), "");
+    EXPECT_EQ(2, obs2.changes(), "");
+    EXPECT_EQ(3, obs_all.changes(), "");
+
+    uint32_t count = 2;
+    st.UpdateLastHandleSignal(&count);
+    EXPECT_EQ(1, obs1.changes(), "");
+    EXPECT_EQ(2, obs2.changes(), "");
+    EXPECT_EQ(4, obs_all.changes(), "");
+
+    st.RemoveObserver(&obs1);
+    st.RemoveObserver(&obs2);
+    st.RemoveObserver(&obs_all);
+
+    END_TEST;
+}
+
+bool many_watched_sets(void* context) {
+    BEGIN_TEST;
+
+    // Observers on every indexed signal, with some sharing a set.
+    constexpr int kCount = 8;
+    CountingObserver obs[kCount] = {
+        CountingObserver(1u), CountingObserver(2u), CountingObserver(4u), CountingObserver(8u),
+        CountingObserver(1u), CountingObserver(2u), CountingObserver(4u), CountingObserver(8u),
+    };
+
+    StateTracker st;
+    for (auto& o : obs)
+        st.AddObserver(&o, nullptr);
+
+    for (mx_signals_t signal = 1u; signal <= 8u; signal <<= 1)
+        st.UpdateState(0u, signal);
+    for (const auto& o : obs)
+        EXPECT_EQ(1, o.changes(), "");
+
+    // Removed observers are not called again, wherever they were kept.
+    for (int ix = 0; ix < kCount; ix += 2)
+        st.RemoveObserver(&obs[ix]);
+    st.UpdateState(0xfu, 0u);
+    for (int ix = 0; ix < kCount; ix++)
+        EXPECT_EQ((ix % 2) ? 2 : 1, obs[ix].changes(), "");
+
+    for (int ix = 1; ix < kCount; ix += 2)
+        st.RemoveObserver(&obs[ix]);
+
+    END_TEST;
+}
+
+bool multiple_watched_signals(void* context) {
+    BEGIN_TEST;
+
+    // Kept with the observers of their lowest signal, or apart from the
+    // indexed signals, but still told about changes to any signal they watch.
+    CountingObserver obs_low(1u | 4u);
+    CountingObserver obs_high(MX_USER_SIGNAL_0 | MX_USER_SIGNAL_1);
+    CountingObserver obs_mixed(2u | MX_USER_SIGNAL_1);
+
+    StateTracker st;
+    st.AddObserver(&obs_low, nullptr);
+    st.AddObserver(&obs_high, nullptr);
+    st.AddObserver(&obs_mixed, nullptr);
+
+    st.UpdateState(0u, 4u);
+    EXPECT_EQ(1, obs_low.changes(), "");
+    EXPECT_EQ(0, obs_high.changes(), "");
+    EXPECT_EQ(0, obs_mixed.changes(), "");
+
+    st.UpdateState(0u, MX_USER_SIGNAL_1);
+    EXPECT_EQ(1, obs_low.changes(), "");
+    EXPECT_EQ(1, obs_high.changes(), "");
+    EXPECT_EQ(1, obs_mixed.changes(), "");
+
+    st.UpdateState(0u, MX_USER_SIGNAL_0 | 8u);
+    EXPECT_EQ(1, obs_low.changes(), "");
+    EXPECT_EQ(2, obs_high.changes(), "");
+    EXPECT_EQ(1, obs_mixed.changes(), "");
+
+    st.RemoveObserver(&obs_low);
+    st.RemoveObserver(&obs_high);
+    st.RemoveObserver(&obs_mixed);
+
+    END_TEST;
+}
+
+} // namespace filtering
+
 #define ST_UNITTEST(fname) UNITTEST(#fname, fname)
 
 UNITTEST_START_TESTCASE(state_tracker_tests)
@@ -229,6 +371,9 @@ ST_UNITTEST(removal::on_state_change_via_strobe_state)
 ST_UNITTEST(removal::on_state_change_via_last_handle)
 ST_UNITTEST(removal::on_cancel)
 ST_UNITTEST(removal::on_cancel_by_key)
+ST_UNITTEST(filtering::only_watched_signals)
+ST_UNITTEST(filtering::many_watched_sets)
+ST_UNITTEST(filtering::multiple_watched_signals)
 
 UNITTEST_END_TESTCASE(
     state_tracker_tests, "statetracker", "StateTracker test", nullptr, nullptr);
@@ -0,0 +1,105 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <magenta/syscall_stats.h>
+
+#include <err.h>
+#include <string.h>
+
+#include <kernel/mp.h>
+#include <magenta/mx-syscall-numbers.h>
+#include <mxtl/algorithm.h>
+#include <mxtl/alloc_checker.h>
+#include <mxtl/auto_lock.h>
+
+namespace {
+
+// Generated table of syscall numbers and names.
+const struct {
+    uint32_t id;
+    uint32_t nargs;
+    const char* name;
+} kSyscallInfo[] = {
+#include <magenta/syscall-ktrace-info.inc>
+};
+
+uint32_t bucket(lk_time_t t) {
+    if (t < 256)
+        return 0;
+    uint32_t b = 63 - __builtin_clzll(t) - 7;
+    return mxtl::min(b, MX_INFO_SYSCALL_STATS_BUCKETS - 1);
+}
+
+} // namespace
+
+mxtl::atomic<int> SyscallStats::active_;
+
+SyscallStats::~SyscallStats() {
+    if (enabled())
+        active_.fetch_sub(1);
+}
+
+status_t SyscallStats::SetEnabled(bool enabled) {
+    mxtl::AutoLock lock(&lock_);
+
+    if (enabled == this->enabled())
+        return MX_OK;
+
+    if (enabled && !counters_) {
+        uint num_cpus = arch_max_num_cpus();
+        mxtl::AllocChecker ac;
+        counters_.reset(new (&ac) Counter[num_cpus * MX_SYS_COUNT]{});
+        if (!ac.check())
+            return MX_ERR_NO_MEMORY;
+        num_cpus_ = num_cpus;
+    }
+
+    enabled_.store(enabled ? 1 : 0, mxtl::memory_order_release);
+    active_.fetch_add(enabled ? 1 : -1);
+    return MX_OK;
+}
+
+void SyscallStats::Record(uint cpu, uint64_t num, lk_time_t duration) {
+    if (!enabled() || num >= MX_SYS_COUNT)
+        return;
+
+    Counter* c = &counters_[cpu * MX_SYS_COUNT + num];
+    c->count++;
+    c->total += duration;
+    if (duration > c->max)
+        c->max = duration;
+    c->histogram[bucket(duration)]++;
+}
+
+bool SyscallStats::GetInfo(uint32_t num, mx_info_syscall_stats_t* info) const {
+    if (num >= MX_SYS_COUNT)
+        return false;
+
+    mxtl::AutoLock lock(&lock_);
+    if (!counters_)
+        return false;
+
+    *info = {};
+    for (uint cpu = 0; cpu < num_cpus_; cpu++) {
+        const Counter* c = &counters_[cpu * MX_SYS_COUNT + num];
+        info->count += c->count;
+        info->total_time += c->total;
+        info->max_time = mxtl::max(info->max_time, c->max);
+        for (uint32_t i = 0; i < MX_INFO_SYSCALL_STATS_BUCKETS; i++)
+            info->histogram[i] += c->histogram[i];
+    }
+    if (info->count == 0)
+        return false;
+
+    info->id = num;
+    for (const auto& s : kSyscallInfo) {
+        if (s.id == num) {
+            strlcpy(info->name, s.name, sizeof(info->name));
+            break;
+        }
+    }
+    return true;
+}
@@ -8,7 +8,10 @@
 
 #include <stdint.h>
 
+#include <kernel/vm/vm_address_region.h>
+#include <kernel/vm/vm_aspace.h>
 #include <lib/user_copy.h>
+#include <magenta/process_dispatcher.h>
 
 status_t magenta_copy_from_user(const void* src, void* dest, size_t len) {
     if (src == nullptr) return MX_ERR_INVALID_ARGS;
@@ -33,3 +36,27 @@ status_t magenta_copy_user_string(const char* src, size_t src_len, char* buf, si
 
     return MX_OK;
 }
+
+mx_status_t magenta_lookup_user_range(vaddr_t va, size_t len, mxtl::RefPtr<VmObject>* vmo,
+                                      uint64_t* offset) {
+    auto aspace = ProcessDispatcher::GetCurrent()->aspace();
+    if (!aspace)
+        return MX_ERR_BAD_STATE;
+
+    auto region = aspace->FindRegion(va);
+    if (!region)
+        return MX_ERR_NOT_FOUND;
+
+    auto mapping = region->as_vm_mapping();
+    if (!mapping)
+        return MX_ERR_NOT_FOUND;
+
+    if (va + len < va || va + len > mapping->base() + mapping->size())
+        return MX_ERR_OUT_OF_RANGE;
+    if (!(mapping->arch_mmu_flags() & ARCH_MMU_FLAG_PERM_WRITE))
+        return MX_ERR_ACCESS_DENIED;
+
+    *vmo = mapping->vmo();
+    *offset = mapping->object_offset() + (va - mapping->base());
+    return MX_OK;
+}
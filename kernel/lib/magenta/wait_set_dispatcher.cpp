@@ -0,0 +1,241 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <magenta/wait_set_dispatcher.h>
+
+#include <assert.h>
+#include <err.h>
+
+#include <magenta/handle.h>
+#include <magenta/rights.h>
+#include <mxtl/alloc_checker.h>
+#include <mxtl/auto_lock.h>
+
+using mxtl::AutoLock;
+
+constexpr size_t WaitSetDispatcher::kMaxMembers;
+
+WaitSetDispatcher::Entry::Entry(WaitSetDispatcher* wait_set, Handle* handle, uint64_t cookie,
+                                mx_signals_t signals, bool edge)
+    : wait_set_(wait_set), dispatcher_(handle->dispatcher().get()), handle_(handle),
+      cookie_(cookie), signals_(signals), edge_(edge) {
+}
+
+StateObserver::Flags WaitSetDispatcher::Entry::OnInitialize(mx_signals_t initial_state,
+                                                            const CountInfo* cinfo) {
+    return wait_set_->UpdateEntry(this, initial_state);
+}
+
+StateObserver::Flags WaitSetDispatcher::Entry::OnStateChange(mx_signals_t new_state) {
+    return wait_set_->UpdateEntry(this, new_state);
+}
+
+StateObserver::Flags WaitSetDispatcher::Entry::OnCancel(Handle* handle) {
+    if (handle != handle_)
+        return 0;
+    handle_ = nullptr;
+    return kHandled | wait_set_->CancelEntry(this);
+}
+
+void WaitSetDispatcher::Entry::OnRemoved() {
+    // This may be the last reference to the entry.
+    auto self = mxtl::move(registration_);
+}
+
+status_t WaitSetDispatcher::Create(uint32_t options, mxtl::RefPtr<Dispatcher>* dispatcher,
+                                   mx_rights_t* rights) {
+    if (options != 0u)
+        return MX_ERR_INVALID_ARGS;
+
+    mxtl::AllocChecker ac;
+    auto disp = new (&ac) WaitSetDispatcher();
+    if (!ac.check())
+        return MX_ERR_NO_MEMORY;
+
+    *rights = MX_DEFAULT_WAIT_SET_RIGHTS;
+    *dispatcher = mxtl::AdoptRef<Dispatcher>(disp);
+    return MX_OK;
+}
+
+WaitSetDispatcher::WaitSetDispatcher()
+    : state_tracker_(0u) {
+}
+
+WaitSetDispatcher::~WaitSetDispatcher() {
+    AutoLock members_lock(&members_lock_);
+    // Once every entry is off its object's StateTracker nothing can touch
+    // the ready list any more.
+    for (auto& entry : members_)
+        DetachEntry(&entry);
+    members_.clear();
+}
+
+status_t WaitSetDispatcher::AddEntry(Handle* handle, uint64_t cookie, mx_signals_t signals,
+                                     uint32_t options) {
+    canary_.Assert();
+
+    if (options & ~MX_WAITSET_EDGE_TRIGGERED)
+        return MX_ERR_INVALID_ARGS;
+
+    auto dispatcher = handle->dispatcher();
+    // Wait sets do not nest, which keeps the lock ordering acyclic.
+    if (dispatcher->get_type() == MX_OBJ_TYPE_WAIT_SET)
+        return MX_ERR_NOT_SUPPORTED;
+    if (!dispatcher->get_state_tracker())
+        return MX_ERR_NOT_SUPPORTED;
+
+    AutoLock lock(&members_lock_);
+    if (members_.size() >= kMaxMembers)
+        return MX_ERR_NO_RESOURCES;
+    if (members_.find(cookie).IsValid())
+        return MX_ERR_ALREADY_EXISTS;
+
+    mxtl::AllocChecker ac;
+    auto entry = mxtl::AdoptRef(new (&ac) Entry(
+        this, handle, cookie, signals, (options & MX_WAITSET_EDGE_TRIGGERED) != 0u));
+    if (!ac.check())
+        return MX_ERR_NO_MEMORY;
+
+    // The entry may be queued as ready right away from OnInitialize(), and
+    // canceled as soon as add_observer() returns.
+    entry->registration_ = entry;
+    status_t status = dispatcher->add_observer(entry.get());
+    if (status != MX_OK) {
+        entry->registration_.reset();
+        return status;
+    }
+
+    members_.insert(mxtl::move(entry));
+    return MX_OK;
+}
+
+status_t WaitSetDispatcher::RemoveEntry(uint64_t cookie) {
+    canary_.Assert();
+
+    AutoLock members_lock(&members_lock_);
+    auto entry = members_.erase(cookie);
+    if (!entry)
+        return MX_ERR_NOT_FOUND;
+
+    DetachEntry(entry.get());
+    return MX_OK;
+}
+
+// Takes |entry|, which is leaving the set, off the ready list and off its
+// object's StateTracker, unless canceling its handle already did that.
+void WaitSetDispatcher::DetachEntry(Entry* entry) {
+    mxtl::RefPtr<Dispatcher> dispatcher;
+    {
+        AutoLock lock(&lock_);
+        entry->removed_ = true;
+        // Until the entry is canceled its handle keeps the object alive,
+        // so it is safe to take a reference here.
+        if (entry->status_ == MX_OK)
+            dispatcher = mxtl::WrapRefPtr(entry->dispatcher_);
+        if (entry->is_ready())
+            DequeueLocked(entry);
+    }
+
+    // The handle may be canceled in the meantime, in which case the
+    // StateTracker has removed the entry and calls OnRemoved() instead.
+    if (dispatcher && dispatcher->get_state_tracker()->RemoveObserver(entry))
+        entry->registration_.reset();
+}
+
+status_t WaitSetDispatcher::Wait(lk_time_t deadline, mx_waitset_result_t* results,
+                                 uint32_t* count) {
+    canary_.Assert();
+
+    for (;;) {
+        {
+            AutoLock lock(&lock_);
+
+            // Level-triggered entries go to the back of the list once
+            // reported, so that a busy member cannot starve the others.
+            mxtl::DoublyLinkedList<Entry*> requeue;
+            uint32_t num = 0u;
+            while (num < *count && !ready_.is_empty()) {
+                Entry* entry = ready_.pop_front();
+                results[num++] = {entry->cookie_, entry->status_, entry->observed_};
+                if (!entry->edge_)
+                    requeue.push_back(entry);
+            }
+            while (!requeue.is_empty())
+                ready_.push_back(requeue.pop_front());
+
+            if (num > 0u) {
+                if (ready_.is_empty()) {
+                    event_.Unsignal();
+                    state_tracker_.UpdateState(MX_WAITSET_READABLE, 0u);
+                }
+                *count = num;
+                return MX_OK;
+            }
+        }
+
+        // Another waiter may drain the list between the wakeup and taking
+        // the lock, in which case go back to waiting.
+        status_t status = event_.Wait(deadline);
+        if (status != MX_OK)
+            return status;
+    }
+}
+
+StateObserver::Flags WaitSetDispatcher::UpdateEntry(Entry* entry, mx_signals_t state) {
+    AutoLock lock(&lock_);
+
+    // A canceled entry stays as it was reported until it is removed.
+    if (entry->status_ != MX_OK || entry->removed_)
+        return 0;
+
+    entry->observed_ = state;
+    const mx_signals_t satisfied = state & entry->signals_;
+
+    if (entry->edge_) {
+        const mx_signals_t rising = satisfied & ~entry->triggered_;
+        entry->triggered_ = satisfied;
+        return rising ? QueueLocked(entry) : 0;
+    }
+
+    if (satisfied)
+        return QueueLocked(entry);
+    if (entry->is_ready())
+        DequeueLocked(entry);
+    return 0;
+}
+
+StateObserver::Flags WaitSetDispatcher::CancelEntry(Entry* entry) {
+    AutoLock lock(&lock_);
+
+    // Without its handle the entry may outlive the object, so it leaves the
+    // StateTracker now.
+    entry->status_ = MX_ERR_CANCELED;
+    if (entry->removed_)
+        return StateObserver::kNeedRemoval;
+    entry->observed_ |= MX_SIGNAL_HANDLE_CLOSED;
+    return StateObserver::kNeedRemoval | QueueLocked(entry);
+}
+
+StateObserver::Flags WaitSetDispatcher::QueueLocked(Entry* entry) {
+    if (entry->is_ready())
+        return 0;
+
+    const bool was_empty = ready_.is_empty();
+    ready_.push_back(entry);
+    if (!was_empty)
+        return 0;
+
+    state_tracker_.UpdateState(0u, MX_WAITSET_READABLE);
+    return (event_.Signal() > 0) ? StateObserver::kWokeThreads : 0;
+}
+
+void WaitSetDispatcher::DequeueLocked(Entry* entry) {
+    ready_.erase(*entry);
+    if (ready_.is_empty()) {
+        event_.Unsignal();
+        state_tracker_.UpdateState(MX_WAITSET_READABLE, 0u);
+    }
+}
@@ -0,0 +1,316 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+// A sampling profiler driven by the kernel timer. Each cpu's timer marks the
+// cpu as due for a sample, and the interrupt exit path of whatever it
+// interrupted calls mtrace_profile_sample(), which records the interrupted
+// pc and the return addresses found by following the frame pointers.
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "lib/mtrace.h"
+#include "trace.h"
+
+#include <arch/ops.h>
+#include <arch/user_copy.h>
+#include <kernel/mp.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <kernel/vm.h>
+#include <magenta/mtrace.h>
+#include <mxtl/alloc_checker.h>
+#include <mxtl/auto_lock.h>
+#include <mxtl/mutex.h>
+#include <mxtl/unique_ptr.h>
+#include <platform.h>
+
+#define LOCAL_TRACE 0
+
+bool mtrace_profile_pending[SMP_MAX_CPUS];
+
+namespace {
+
+// The samples kept for each cpu until they are read.
+constexpr uint32_t kSamplesPerCpu = 2048u;
+
+// Samples are copied out this many at a time, so that the copy to the
+// user is not made with a cpu's lock held.
+constexpr uint32_t kReadBatch = 16u;
+
+struct ProfileCpu {
+    spin_lock_t lock;
+    timer_t timer;
+    // A ring of kSamplesPerCpu samples, null while the buffers are freed.
+    mx_mtrace_profile_sample_t* samples;
+    uint32_t head;
+    uint32_t count;
+    uint32_t dropped;
+} __CPU_ALIGN;
+
+// Serializes mtrace_profile_control().
+mxtl::Mutex profile_lock;
+mxtl::unique_ptr<mx_mtrace_profile_sample_t[]> profile_buffer;
+ProfileCpu profile_cpus[SMP_MAX_CPUS];
+lk_time_t profile_period;
+// Read without |profile_lock| by the timers and the sampling path.
+int profile_running;
+
+bool profile_is_running() {
+    return __atomic_load_n(&profile_running, __ATOMIC_ACQUIRE) != 0;
+}
+
+enum handler_return profile_timer(timer_t* timer, lk_time_t now, void* arg) {
+    if (!profile_is_running())
+        return INT_NO_RESCHEDULE;
+
+    __atomic_store_n(&mtrace_profile_pending[arch_curr_cpu_num()], true, __ATOMIC_RELAXED);
+
+    // Keep to the original schedule unless we have fallen behind it.
+    lk_time_t deadline = timer->scheduled_time + profile_period;
+    if (deadline <= now)
+        deadline = now + profile_period;
+    timer_set(timer, deadline, TIMER_SLACK_CENTER, 0, profile_timer, arg);
+    return INT_NO_RESCHEDULE;
+}
+
+void profile_start_cpu(void* context) {
+    ProfileCpu* cpu = &profile_cpus[arch_curr_cpu_num()];
+    timer_set(&cpu->timer, current_time() + profile_period, TIMER_SLACK_CENTER, 0,
+              profile_timer, nullptr);
+}
+
+void profile_stop_cpu(void* context) {
+    uint cpu = arch_curr_cpu_num();
+    timer_cancel(&profile_cpus[cpu].timer);
+    __atomic_store_n(&mtrace_profile_pending[cpu], false, __ATOMIC_RELAXED);
+}
+
+// Follows the kernel frame pointers from |fp|, staying on the current
+// thread's stack. Returns the number of pcs added to |pcs|.
+uint32_t profile_walk_kernel(uintptr_t fp, uint64_t* pcs, uint32_t max) {
+    thread_t* t = get_current_thread();
+    uintptr_t stack = reinterpret_cast<uintptr_t>(t->stack);
+    uintptr_t stack_end = stack + t->stack_size;
+
+    uint32_t n = 0;
+    while (n < max) {
+        if (fp < stack || fp > stack_end - 2 * sizeof(uintptr_t) ||
+            fp % sizeof(uintptr_t) != 0)
+            break;
+        const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+        uintptr_t next = frame[0];
+        uintptr_t pc = frame[1];
+        if (pc == 0)
+            break;
+        pcs[n++] = pc;
+        // Frames move toward the top of the stack.
+        if (next <= fp)
+            break;
+        fp = next;
+    }
+    return n;
+}
+
+// As above for the user stack. Must be called with interrupts enabled, as
+// reading the user's stack may fault.
+uint32_t profile_walk_user(uintptr_t fp, uint64_t* pcs, uint32_t max) {
+    uint32_t n = 0;
+    while (n < max) {
+        uintptr_t frame[2];
+        if (fp % sizeof(uintptr_t) != 0 || !is_user_address_range(fp, sizeof(frame)))
+            break;
+        if (arch_copy_from_user(frame, reinterpret_cast<const void*>(fp), sizeof(frame)) != MX_OK)
+            break;
+        if (frame[1] == 0)
+            break;
+        pcs[n++] = frame[1];
+        if (frame[0] <= fp)
+            break;
+        fp = frame[0];
+    }
+    return n;
+}
+
+// Drops any samples kept and resets the counts. The cpus must not be
+// sampling.
+void profile_reset_buffers(mx_mtrace_profile_sample_t* buffer) {
+    for (uint i = 0; i < arch_max_num_cpus(); i++) {
+        ProfileCpu* cpu = &profile_cpus[i];
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&cpu->lock, state);
+        cpu->samples = buffer ? buffer + i * kSamplesPerCpu : nullptr;
+        cpu->head = 0;
+        cpu->count = 0;
+        cpu->dropped = 0;
+        spin_unlock_irqrestore(&cpu->lock, state);
+    }
+}
+
+status_t profile_start(uint32_t frequency) TA_REQ(profile_lock) {
+    if (profile_is_running())
+        return MX_ERR_BAD_STATE;
+    if (frequency < MTRACE_PROFILE_MIN_FREQUENCY || frequency > MTRACE_PROFILE_MAX_FREQUENCY)
+        return MX_ERR_INVALID_ARGS;
+
+    if (!profile_buffer) {
+        mxtl::AllocChecker ac;
+        profile_buffer.reset(
+            new (&ac) mx_mtrace_profile_sample_t[arch_max_num_cpus() * kSamplesPerCpu]);
+        if (!ac.check())
+            return MX_ERR_NO_MEMORY;
+    }
+    profile_reset_buffers(profile_buffer.get());
+
+    profile_period = LK_SEC(1) / frequency;
+    for (uint i = 0; i < arch_max_num_cpus(); i++)
+        timer_init(&profile_cpus[i].timer);
+
+    __atomic_store_n(&profile_running, 1, __ATOMIC_RELEASE);
+    mp_sync_exec(MP_CPU_ALL, profile_start_cpu, nullptr);
+    return MX_OK;
+}
+
+status_t profile_stop() TA_REQ(profile_lock) {
+    if (!profile_is_running())
+        return MX_ERR_BAD_STATE;
+
+    // A timer that fires before it is canceled sees this and stops.
+    __atomic_store_n(&profile_running, 0, __ATOMIC_RELEASE);
+    mp_sync_exec(MP_CPU_ALL, profile_stop_cpu, nullptr);
+    return MX_OK;
+}
+
+status_t profile_read_cpu(uint cpu_num, user_ptr<mx_mtrace_profile_sample_t> out,
+                          uint32_t max) TA_REQ(profile_lock) {
+    if (!profile_buffer)
+        return MX_ERR_BAD_STATE;
+
+    mxtl::AllocChecker ac;
+    mxtl::unique_ptr<mx_mtrace_profile_sample_t[]> batch(
+        new (&ac) mx_mtrace_profile_sample_t[kReadBatch]);
+    if (!ac.check())
+        return MX_ERR_NO_MEMORY;
+
+    ProfileCpu* cpu = &profile_cpus[cpu_num];
+    uint32_t done = 0;
+    while (done < max) {
+        uint32_t n = 0;
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&cpu->lock, state);
+        while (n < kReadBatch && done + n < max && cpu->count > 0) {
+            batch[n++] = cpu->samples[cpu->head];
+            cpu->head = (cpu->head + 1) % kSamplesPerCpu;
+            cpu->count--;
+        }
+        spin_unlock_irqrestore(&cpu->lock, state);
+
+        if (n == 0)
+            break;
+        if (out.copy_array_to_user(batch.get(), n, done) != MX_OK)
+            return MX_ERR_INVALID_ARGS;
+        done += n;
+    }
+
+    if (done < max) {
+        mx_mtrace_profile_sample_t end = {};
+        if (out.copy_array_to_user(&end, 1, done) != MX_OK)
+            return MX_ERR_INVALID_ARGS;
+    }
+    return MX_OK;
+}
+
+status_t profile_free() TA_REQ(profile_lock) {
+    if (profile_is_running())
+        return MX_ERR_BAD_STATE;
+
+    // A sample still being taken finds no buffer and is thrown away.
+    profile_reset_buffers(nullptr);
+    profile_buffer.reset();
+    return MX_OK;
+}
+
+} // namespace
+
+void mtrace_profile_sample(uintptr_t pc, uintptr_t fp, bool user) {
+    DEBUG_ASSERT(arch_ints_disabled());
+
+    __atomic_store_n(&mtrace_profile_pending[arch_curr_cpu_num()], false, __ATOMIC_RELAXED);
+    if (!profile_is_running())
+        return;
+
+    thread_t* t = get_current_thread();
+    mx_mtrace_profile_sample_t sample;
+    sample.time = current_time();
+    sample.pid = t->user_pid;
+    sample.tid = t->user_tid;
+    sample.cpu = arch_curr_cpu_num();
+    sample.flags = user ? MTRACE_PROFILE_SAMPLE_USER : 0u;
+    sample.dropped = 0;
+    sample.pcs[0] = pc;
+    if (user) {
+        arch_enable_ints();
+        sample.num_pcs = 1 + profile_walk_user(fp, &sample.pcs[1], MTRACE_PROFILE_MAX_PCS - 1);
+        arch_disable_ints();
+    } else {
+        sample.num_pcs = 1 + profile_walk_kernel(fp, &sample.pcs[1], MTRACE_PROFILE_MAX_PCS - 1);
+    }
+
+    // We may have moved while interrupts were enabled; keep the sample on
+    // the cpu we are on now so that only this cpu writes to its ring.
+    ProfileCpu* cpu = &profile_cpus[arch_curr_cpu_num()];
+    spin_lock(&cpu->lock);
+    if (cpu->samples != nullptr) {
+        if (cpu->count == kSamplesPerCpu) {
+            cpu->dropped++;
+        } else {
+            sample.dropped = cpu->dropped;
+            cpu->dropped = 0;
+            cpu->samples[(cpu->head + cpu->count) % kSamplesPerCpu] = sample;
+            cpu->count++;
+        }
+    }
+    spin_unlock(&cpu->lock);
+}
+
+status_t mtrace_profile_control(uint32_t action, uint32_t options,
+                                user_ptr<void> arg, uint32_t size) {
+    LTRACEF("action %u, options 0x%x, arg %p, size 0x%x\n",
+            action, options, arg.get(), size);
+
+    mxtl::AutoLock lock(&profile_lock);
+
+    switch (action) {
+    case MTRACE_PROFILE_START: {
+        uint32_t frequency;
+        if (options != 0 || size != sizeof(frequency))
+            return MX_ERR_INVALID_ARGS;
+        if (arg.reinterpret<uint32_t>().copy_from_user(&frequency) != MX_OK)
+            return MX_ERR_INVALID_ARGS;
+        return profile_start(frequency);
+    }
+
+    case MTRACE_PROFILE_STOP:
+        if (options != 0 || size != 0)
+            return MX_ERR_INVALID_ARGS;
+        return profile_stop();
+
+    case MTRACE_PROFILE_READ_CPU:
+        if (options >= arch_max_num_cpus() || size < sizeof(mx_mtrace_profile_sample_t))
+            return MX_ERR_INVALID_ARGS;
+        return profile_read_cpu(options, arg.reinterpret<mx_mtrace_profile_sample_t>(),
+                                size / (uint32_t)sizeof(mx_mtrace_profile_sample_t));
+
+    case MTRACE_PROFILE_FREE:
+        if (options != 0 || size != 0)
+            return MX_ERR_INVALID_ARGS;
+        return profile_free();
+
+    default:
+        return MX_ERR_INVALID_ARGS;
+    }
+}
@@ -21,6 +21,7 @@ MODULE_DEPS := \
 
 MODULE_SRCS := \
     $(LOCAL_DIR)/syscalls.cpp \
+    $(LOCAL_DIR)/syscalls_call_ring.cpp \
     $(LOCAL_DIR)/syscalls_channel.cpp \
     $(LOCAL_DIR)/syscalls_ddk.cpp \
     $(LOCAL_DIR)/syscalls_ddk_pci.cpp \
@@ -43,6 +44,7 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/syscalls_timer.cpp \
     $(LOCAL_DIR)/syscalls_vmar.cpp \
     $(LOCAL_DIR)/syscalls_vmo.cpp \
+    $(LOCAL_DIR)/syscalls_wait_set.cpp \
 
 # We need a header file generated by kernel/lib/vdso/rules.mk.
 MODULE_COMPILEFLAGS += -I$(BUILDDIR)/kernel/lib/vdso
@@ -30,6 +30,19 @@ int sys_invalid_syscall(uint64_t num, uint64_t pc,
     return MX_ERR_BAD_SYSCALL;
 }
 
+// Syscalls are only timed while some process or job is counting them.
+static inline lk_time_t syscall_stats_start() {
+    return unlikely(SyscallStats::Active()) ? current_time() : 0;
+}
+
+// Must be called with interrupts disabled.
+static inline void syscall_stats_finish(uint64_t syscall_num, lk_time_t start) {
+    if (unlikely(start != 0)) {
+        ProcessDispatcher::GetCurrent()->RecordSyscall(
+            arch_curr_cpu_num(), syscall_num, current_time() - start);
+    }
+}
+
 inline uint64_t invoke_syscall(
     uint64_t syscall_num, uint64_t pc,
     uint64_t arg1, uint64_t arg2, uint64_t arg3, uint64_t arg4,
@@ -69,6 +82,8 @@ extern "C" void arm64_syscall(struct arm64_iframe_long* frame, bool is_64bit, ui
 
     CPU_STATS_INC(syscalls);
 
+    const lk_time_t stats_start = syscall_stats_start();
+
     /* re-enable interrupts to maintain kernel preemptiveness
        This must be done after the above ktrace_tiny call, and after the
        above CPU_STATS_INC call as it also calls arch_curr_cpu_num. */
@@ -91,6 +106,8 @@ extern "C" void arm64_syscall(struct arm64_iframe_long* frame, bool is_64bit, ui
        This must be done before the below ktrace_tiny call. */
     arch_disable_ints();
 
+    syscall_stats_finish(syscall_num, stats_start);
+
     ktrace_tiny(TAG_SYSCALL_EXIT, ((uint32_t)syscall_num << 8) | arch_curr_cpu_num());
 }
 
@@ -110,6 +127,8 @@ inline x86_64_syscall_result do_syscall(uint64_t syscall_num, uint64_t ip,
 
     CPU_STATS_INC(syscalls);
 
+    const lk_time_t stats_start = syscall_stats_start();
+
     /* re-enable interrupts to maintain kernel preemptiveness
        This must be done after the above ktrace_tiny call, and after the
        above CPU_STATS_INC call as it also calls arch_curr_cpu_num. */
@@ -134,6 +153,8 @@ inline x86_64_syscall_result do_syscall(uint64_t syscall_num, uint64_t ip,
        This must be done before the below ktrace_tiny call. */
     arch_disable_ints();
 
+    syscall_stats_finish(syscall_num, stats_start);
+
     ktrace_tiny(TAG_SYSCALL_EXIT, (static_cast<uint32_t>(syscall_num << 8)) | arch_curr_cpu_num());
 
     // The assembler caller will re-disable interrupts at the appropriate time.
@@ -0,0 +1,161 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <err.h>
+#include <inttypes.h>
+#include <trace.h>
+
+#include <lib/user_copy/user_ptr.h>
+
+#include <magenta/call_ring_dispatcher.h>
+#include <magenta/handle_owner.h>
+#include <magenta/magenta.h>
+#include <magenta/process_dispatcher.h>
+#include <magenta/vm_address_region_dispatcher.h>
+
+#include <mxtl/auto_call.h>
+#include <mxtl/ref_ptr.h>
+
+#include "syscalls_priv.h"
+
+#define LOCAL_TRACE 0
+
+namespace {
+
+template <typename T>
+user_ptr<T> ArgPtr(uint64_t arg) {
+    return make_user_ptr(reinterpret_cast<T*>(static_cast<uintptr_t>(arg)));
+}
+
+mx_handle_t ArgHandle(uint64_t arg) {
+    return static_cast<mx_handle_t>(arg);
+}
+
+uint32_t ArgU32(uint64_t arg) {
+    return static_cast<uint32_t>(arg);
+}
+
+// Only calls that never block are accepted, since a submission that blocks
+// would hold up every one queued behind it.
+mx_status_t ExecCall(const mx_call_sqe_t& sqe) {
+    const uint64_t* a = sqe.args;
+    switch (sqe.opcode) {
+    case MX_CALL_OP_NOP:
+        return MX_OK;
+    case MX_CALL_OP_CHANNEL_WRITE:
+        return sys_channel_write(ArgHandle(a[0]), ArgU32(a[1]), ArgPtr<const void>(a[2]),
+                                 ArgU32(a[3]), ArgPtr<const mx_handle_t>(a[4]), ArgU32(a[5]));
+    case MX_CALL_OP_OBJECT_SIGNAL:
+        return sys_object_signal(ArgHandle(a[0]), ArgU32(a[1]), ArgU32(a[2]));
+    case MX_CALL_OP_OBJECT_SIGNAL_PEER:
+        return sys_object_signal_peer(ArgHandle(a[0]), ArgU32(a[1]), ArgU32(a[2]));
+    case MX_CALL_OP_PORT_QUEUE:
+        return sys_port_queue(ArgHandle(a[0]), ArgPtr<const void>(a[1]),
+                              static_cast<size_t>(a[2]));
+    case MX_CALL_OP_VMO_READ:
+        return sys_vmo_read(ArgHandle(a[0]), ArgPtr<void>(a[1]), a[2],
+                            static_cast<size_t>(a[3]), ArgPtr<size_t>(a[4]));
+    case MX_CALL_OP_VMO_WRITE:
+        return sys_vmo_write(ArgHandle(a[0]), ArgPtr<const void>(a[1]), a[2],
+                             static_cast<size_t>(a[3]), ArgPtr<size_t>(a[4]));
+    default:
+        return MX_ERR_NOT_SUPPORTED;
+    }
+}
+
+} // namespace
+
+mx_status_t sys_call_ring_create(uint32_t options, uint32_t entries,
+                                 user_ptr<mx_handle_t> _out) {
+    LTRACEF("options %u entries %u\n", options, entries);
+
+    mxtl::RefPtr<Dispatcher> dispatcher;
+    mx_rights_t rights;
+
+    mx_status_t result = CallRingDispatcher::Create(options, entries, &dispatcher, &rights);
+    if (result != MX_OK)
+        return result;
+
+    HandleOwner handle(MakeHandle(mxtl::move(dispatcher), rights));
+    if (!handle)
+        return MX_ERR_NO_MEMORY;
+
+    auto up = ProcessDispatcher::GetCurrent();
+    if (_out.copy_to_user(up->MapHandleToValue(handle)) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    up->AddHandle(mxtl::move(handle));
+    return MX_OK;
+}
+
+mx_status_t sys_call_ring_map(mx_handle_t handle, mx_handle_t vmar_handle, uint32_t options,
+                              user_ptr<uintptr_t> _mapped_addr) {
+    LTRACEF("handle %x vmar %x\n", handle, vmar_handle);
+
+    if (options != 0u)
+        return MX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<CallRingDispatcher> ring;
+    mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_READ | MX_RIGHT_WRITE,
+                                                     &ring);
+    if (status != MX_OK)
+        return status;
+
+    mxtl::RefPtr<VmAddressRegionDispatcher> vmar;
+    status = up->GetDispatcherWithRights(vmar_handle, MX_RIGHT_READ | MX_RIGHT_WRITE, &vmar);
+    if (status != MX_OK)
+        return status;
+
+    mxtl::RefPtr<VmObject> vmo = ring->vmo();
+    const size_t len = vmo->size();
+    const uint32_t map_flags = MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE |
+                               MX_VM_FLAG_CAN_MAP_READ | MX_VM_FLAG_CAN_MAP_WRITE;
+
+    mxtl::RefPtr<VmMapping> vm_mapping;
+    status = vmar->Map(0, mxtl::move(vmo), 0, len, map_flags, &vm_mapping);
+    if (status != MX_OK)
+        return status;
+
+    // Setup a handler to destroy the new mapping if the syscall is unsuccessful.
+    auto cleanup_handler = mxtl::MakeAutoCall([vm_mapping]() {
+        vm_mapping->Destroy();
+    });
+
+    // The ring is always committed; map it all now rather than fault it in.
+    status = vm_mapping->MapRange(0, len, false);
+    if (status != MX_OK)
+        return status;
+
+    if (_mapped_addr.copy_to_user(vm_mapping->base()) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    cleanup_handler.cancel();
+    return MX_OK;
+}
+
+mx_status_t sys_call_ring_enter(mx_handle_t handle, uint32_t count,
+                                user_ptr<uint32_t> _actual) {
+    LTRACEF("handle %x count %u\n", handle, count);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<CallRingDispatcher> ring;
+    mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_WRITE, &ring);
+    if (status != MX_OK)
+        return status;
+
+    uint32_t actual;
+    status = ring->Enter(count, ExecCall, &actual);
+    if (status != MX_OK)
+        return status;
+
+    if (_actual && _actual.copy_to_user(actual) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    return MX_OK;
+}
@@ -128,7 +128,7 @@ mx_status_t sys_channel_read(mx_handle_t handle_value, uint32_t options,
         return result;
 
     if (num_bytes > 0u) {
-        if (msg->CopyDataTo(bytes) != MX_OK)
+        if (msg->MoveDataTo(bytes) != MX_OK)
             return MX_ERR_INVALID_ARGS;
     }
 
@@ -142,6 +142,80 @@ mx_status_t sys_channel_read(mx_handle_t handle_value, uint32_t options,
     return result;
 }
 
+mx_status_t sys_channel_read_many(mx_handle_t handle_value, uint32_t options,
+                                  user_ptr<mx_channel_msg_t> user_msgs, uint32_t num_msgs,
+                                  user_ptr<uint32_t> actual_msgs) {
+    LTRACEF("handle %x msgs %p num_msgs %u\n", handle_value, user_msgs.get(), num_msgs);
+
+    // No options are currently supported; in particular MAY_DISCARD has no
+    // sensible meaning for a batch.
+    if (options || num_msgs == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (num_msgs > kMaxMessageBatch)
+        return MX_ERR_OUT_OF_RANGE;
+
+    mx_channel_msg_t msgs[kMaxMessageBatch];
+    if (user_msgs.copy_array_from_user(msgs, num_msgs) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<ChannelDispatcher> channel;
+    mx_status_t result = up->GetDispatcherWithRights(handle_value, MX_RIGHT_READ, &channel);
+    if (result != MX_OK)
+        return result;
+
+    void* bufs[kMaxMessageBatch];
+    uint32_t sizes[kMaxMessageBatch];
+    uint32_t handle_counts[kMaxMessageBatch];
+    for (uint32_t i = 0; i < num_msgs; ++i) {
+        bufs[i] = msgs[i].bytes;
+        sizes[i] = msgs[i].num_bytes;
+        handle_counts[i] = msgs[i].num_handles;
+    }
+
+    // The payloads are copied out by ReadMany(); a message whose payload
+    // could not be copied, and every message after it, remain queued.
+    ChannelDispatcher::MessageList packets;
+    result = channel->ReadMany(num_msgs, bufs, sizes, handle_counts, &packets);
+    if (result == MX_ERR_BUFFER_TOO_SMALL) {
+        // The first message remains queued; report its size.
+        msgs[0].num_bytes = sizes[0];
+        msgs[0].num_handles = handle_counts[0];
+        if (user_msgs.copy_array_to_user(msgs, 1u) != MX_OK)
+            return MX_ERR_INVALID_ARGS;
+        return result;
+    }
+    if (result != MX_OK)
+        return result;
+
+    // The documented public API states that that writing to the handles buffer
+    // must happen after writing to the data buffer.
+    uint32_t delivered = 0u;
+    while (!packets.is_empty()) {
+        auto msg = packets.pop_front();
+        const uint32_t ix = delivered;
+        if (handle_counts[ix] > 0u) {
+            msg_get_handles(up, msg.get(), make_user_ptr(msgs[ix].handles), handle_counts[ix]);
+        }
+        msgs[ix].num_bytes = sizes[ix];
+        msgs[ix].num_handles = handle_counts[ix];
+        ++delivered;
+
+        ktrace(TAG_CHANNEL_READ, (uint32_t)channel->get_koid(), sizes[ix], handle_counts[ix], 0);
+    }
+
+    if (delivered == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (user_msgs.copy_array_to_user(msgs, delivered) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+    if (actual_msgs) {
+        if (actual_msgs.copy_to_user(delivered) != MX_OK)
+            return MX_ERR_INVALID_ARGS;
+    }
+    return MX_OK;
+}
+
 static mx_status_t channel_read_out(ProcessDispatcher* up,
                                     mxtl::unique_ptr<MessagePacket> reply,
                                     mx_channel_call_args_t* args,
@@ -162,7 +236,7 @@ static mx_status_t channel_read_out(ProcessDispatcher* up,
     }
 
     if (num_bytes > 0u) {
-        if (reply->CopyDataTo(make_user_ptr(args->rd_bytes)) != MX_OK) {
+        if (reply->MoveDataTo(make_user_ptr(args->rd_bytes)) != MX_OK) {
             return MX_ERR_INVALID_ARGS;
         }
     }
@@ -255,7 +329,7 @@ mx_status_t sys_channel_write(mx_handle_t handle_value, uint32_t options,
     LTRACEF("handle %x bytes %p num_bytes %u handles %p num_handles %u options 0x%x\n",
             handle_value, user_bytes.get(), num_bytes, user_handles.get(), num_handles, options);
 
-    if (options)
+    if (options & ~MX_CHANNEL_WRITE_MOVE_PAGES)
         return MX_ERR_INVALID_ARGS;
 
     auto up = ProcessDispatcher::GetCurrent();
@@ -267,7 +341,11 @@ mx_status_t sys_channel_write(mx_handle_t handle_value, uint32_t options,
 
 
     mxtl::unique_ptr<MessagePacket> msg;
-    result = MessagePacket::Create(user_bytes, num_bytes, num_handles, &msg);
+    if (options & MX_CHANNEL_WRITE_MOVE_PAGES) {
+        result = MessagePacket::CreateMovingPages(user_bytes, num_bytes, num_handles, &msg);
+    } else {
+        result = MessagePacket::Create(user_bytes, num_bytes, num_handles, &msg);
+    }
     if (result != MX_OK)
         return result;
 
@@ -293,6 +371,78 @@ mx_status_t sys_channel_write(mx_handle_t handle_value, uint32_t options,
     return MX_OK;
 }
 
+mx_status_t sys_channel_write_many(mx_handle_t handle_value, uint32_t options,
+                                   user_ptr<const mx_channel_msg_t> user_msgs, uint32_t num_msgs,
+                                   user_ptr<uint32_t> actual_msgs) {
+    LTRACEF("handle %x msgs %p num_msgs %u options 0x%x\n",
+            handle_value, user_msgs.get(), num_msgs, options);
+
+    if (options || num_msgs == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (num_msgs > kMaxMessageBatch)
+        return MX_ERR_OUT_OF_RANGE;
+
+    mx_channel_msg_t msgs[kMaxMessageBatch];
+    if (user_msgs.copy_array_from_user(msgs, num_msgs) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<ChannelDispatcher> channel;
+    mx_status_t result = up->GetDispatcherWithRights(handle_value, MX_RIGHT_WRITE, &channel);
+    if (result != MX_OK)
+        return result;
+
+    // Build packets in order, stopping at the first message that cannot be
+    // built. That message and all later ones are not written and keep their
+    // handles.
+    ChannelDispatcher::MessageList packets;
+    mx_handle_t handles[kMaxMessageHandles];
+    uint32_t built = 0u;
+    for (; built < num_msgs; ++built) {
+        mxtl::unique_ptr<MessagePacket> msg;
+        result = MessagePacket::Create(make_user_ptr<const void>(msgs[built].bytes),
+                                       msgs[built].num_bytes, msgs[built].num_handles, &msg);
+        if (result != MX_OK)
+            break;
+
+        if (msgs[built].num_handles > 0u) {
+            result = msg_put_handles(up, msg.get(), handles,
+                                     make_user_ptr<const mx_handle_t>(msgs[built].handles),
+                                     msgs[built].num_handles,
+                                     static_cast<Dispatcher*>(channel.get()));
+            if (result != MX_OK)
+                break;
+        }
+        packets.push_back(mxtl::move(msg));
+    }
+    if (built == 0u)
+        return result;
+
+    result = channel->WriteMany(&packets);
+    if (result != MX_OK) {
+        // Write failed, put back the handles into this process.
+        AutoLock lock(up->handle_table_lock());
+        for (const auto& msg : packets) {
+            for (uint32_t ix = 0; ix != msg.num_handles(); ++ix) {
+                up->UndoRemoveHandleLocked(up->MapHandleToValue(msg.handles()[ix]));
+            }
+        }
+        return result;
+    }
+
+    for (uint32_t ix = 0; ix != built; ++ix) {
+        ktrace(TAG_CHANNEL_WRITE, (uint32_t)channel->get_koid(),
+               msgs[ix].num_bytes, msgs[ix].num_handles, 0);
+    }
+
+    if (actual_msgs) {
+        if (actual_msgs.copy_to_user(built) != MX_OK)
+            return MX_ERR_INVALID_ARGS;
+    }
+    return MX_OK;
+}
+
 mx_status_t sys_channel_call_noretry(mx_handle_t handle_value, uint32_t options,
                                      mx_time_t deadline,
                                      user_ptr<const mx_channel_call_args_t> user_args,
@@ -21,10 +21,15 @@
 
 #include <platform/debug.h>
 
+#include <kernel/vm/vm_object.h>
+#include <magenta/event_dispatcher.h>
 #include <magenta/handle_owner.h>
 #include <magenta/process_dispatcher.h>
 #include <magenta/syscalls/debug.h>
 #include <magenta/user_copy.h>
+#include <magenta/vm_address_region_dispatcher.h>
+
+#include <mxtl/auto_call.h>
 
 #include "syscalls_priv.h"
 
@@ -145,14 +150,82 @@ mx_status_t sys_ktrace_write(mx_handle_t handle, uint32_t event_id, uint32_t arg
         return MX_ERR_INVALID_ARGS;
     }
 
-    uint32_t* args = static_cast<uint32_t*>(ktrace_open(TAG_PROBE_24(event_id)));
-    if (!args) {
-        //  There is not a single reason for failure. Assume it reached the end.
-        return MX_ERR_UNAVAILABLE;
+    //  There is not a single reason for failure. Assume it reached the end.
+    const uint32_t args[2] = { arg0, arg1 };
+    return ktrace_write(TAG_PROBE_24(event_id), args, 2);
+}
+
+mx_status_t sys_ktrace_stream(mx_handle_t handle, mx_handle_t vmar_handle,
+                              uint32_t size, uint32_t watermark,
+                              user_ptr<uintptr_t> _mapped_addr, user_ptr<mx_handle_t> _event) {
+    // TODO(MG-971): finer grained validation
+    mx_status_t status;
+    if ((status = validate_resource(handle, MX_RSRC_KIND_ROOT)) < 0) {
+        return status;
+    }
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<VmAddressRegionDispatcher> vmar;
+    status = up->GetDispatcherWithRights(vmar_handle, MX_RIGHT_READ | MX_RIGHT_WRITE, &vmar);
+    if (status != MX_OK) {
+        return status;
+    }
+
+    mxtl::RefPtr<Dispatcher> event;
+    mx_rights_t event_rights;
+    status = EventDispatcher::Create(0u, &event, &event_rights);
+    if (status != MX_OK) {
+        return status;
+    }
+
+    HandleOwner event_handle(MakeHandle(event, event_rights));
+    if (!event_handle) {
+        return MX_ERR_NO_MEMORY;
+    }
+
+    mxtl::RefPtr<VmObject> vmo;
+    status = ktrace_stream_start(size, watermark, mxtl::move(event), &vmo);
+    if (status != MX_OK) {
+        return status;
+    }
+
+    // As with call rings, the consumer only gets a mapping of the ring,
+    // never the VMO, which must stay committed for the kernel's mapping.
+    const size_t len = vmo->size();
+    const uint32_t map_flags = MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE |
+                               MX_VM_FLAG_CAN_MAP_READ | MX_VM_FLAG_CAN_MAP_WRITE;
+
+    mxtl::RefPtr<VmMapping> vm_mapping;
+    status = vmar->Map(0, mxtl::move(vmo), 0, len, map_flags, &vm_mapping);
+    if (status != MX_OK) {
+        ktrace_stream_stop();
+        return status;
+    }
+
+    // Setup a handler to destroy the new mapping and the stream
+    // if the syscall is unsuccessful.
+    auto cleanup_handler = mxtl::MakeAutoCall([vm_mapping]() {
+        vm_mapping->Destroy();
+        ktrace_stream_stop();
+    });
+
+    // The ring is always committed; map it all now rather than fault it in.
+    status = vm_mapping->MapRange(0, len, false);
+    if (status != MX_OK) {
+        return status;
+    }
+
+    if (_mapped_addr.copy_to_user(vm_mapping->base()) != MX_OK) {
+        return MX_ERR_INVALID_ARGS;
+    }
+
+    if (_event.copy_to_user(up->MapHandleToValue(event_handle)) != MX_OK) {
+        return MX_ERR_INVALID_ARGS;
     }
 
-    args[0] = arg0;
-    args[1] = arg1;
+    up->AddHandle(mxtl::move(event_handle));
+    cleanup_handler.cancel();
     return MX_OK;
 }
 
@@ -20,7 +20,9 @@
 #include <magenta/process_dispatcher.h>
 #include <magenta/syscalls/policy.h>
 #include <magenta/user_copy.h>
+#include <magenta/vm_address_region_dispatcher.h>
 
+#include <mxtl/auto_call.h>
 #include <mxtl/ref_ptr.h>
 
 #include "syscalls_priv.h"
@@ -100,3 +102,72 @@ mx_status_t sys_fifo_read(mx_handle_t handle, user_ptr<void> entries, size_t len
 
     return MX_OK;
 }
+
+mx_status_t sys_fifo_map(mx_handle_t handle, mx_handle_t vmar_handle, uint32_t options,
+                         user_ptr<uintptr_t> _mapped_addr) {
+    if (options != MX_FIFO_MAP_READ_RING && options != MX_FIFO_MAP_WRITE_RING)
+        return MX_ERR_INVALID_ARGS;
+    const bool write_ring = (options == MX_FIFO_MAP_WRITE_RING);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<FifoDispatcher> fifo;
+    mx_rights_t rights;
+    mx_status_t status = up->GetDispatcherWithRights(
+        handle, write_ring ? MX_RIGHT_WRITE : MX_RIGHT_READ, &fifo, &rights);
+    if (status != MX_OK)
+        return status;
+
+    // Both sides update the ring's control block, so a ring is normally
+    // mapped readable and writable. A handle without MX_RIGHT_WRITE may
+    // look at its read ring but not consume from it, lest it corrupt the
+    // ring the writer relies on; it gets a read-only mapping.
+    const bool writable = (rights & MX_RIGHT_WRITE) != 0;
+    mxtl::RefPtr<VmAddressRegionDispatcher> vmar;
+    status = up->GetDispatcherWithRights(
+        vmar_handle, writable ? MX_RIGHT_READ | MX_RIGHT_WRITE : MX_RIGHT_READ, &vmar);
+    if (status != MX_OK)
+        return status;
+
+    mxtl::RefPtr<VmObject> vmo;
+    status = fifo->GetRingVmo(write_ring, &vmo);
+    if (status != MX_OK)
+        return status;
+
+    const size_t len = vmo->size();
+    const uint32_t map_flags = writable ? MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE |
+                                          MX_VM_FLAG_CAN_MAP_READ | MX_VM_FLAG_CAN_MAP_WRITE
+                                        : MX_VM_FLAG_PERM_READ | MX_VM_FLAG_CAN_MAP_READ;
+
+    mxtl::RefPtr<VmMapping> vm_mapping;
+    status = vmar->Map(0, mxtl::move(vmo), 0, len, map_flags, &vm_mapping);
+    if (status != MX_OK)
+        return status;
+
+    // Setup a handler to destroy the new mapping if the syscall is unsuccessful.
+    auto cleanup_handler = mxtl::MakeAutoCall([vm_mapping]() {
+        vm_mapping->Destroy();
+    });
+
+    // The ring is always committed; map it all now rather than fault it in.
+    status = vm_mapping->MapRange(0, len, false);
+    if (status != MX_OK)
+        return status;
+
+    if (_mapped_addr.copy_to_user(vm_mapping->base()) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    cleanup_handler.cancel();
+    return MX_OK;
+}
+
+mx_status_t sys_fifo_doorbell(mx_handle_t handle) {
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<FifoDispatcher> fifo;
+    mx_status_t status = up->GetDispatcher(handle, &fifo);
+    if (status != MX_OK)
+        return status;
+
+    return fifo->Doorbell();
+}
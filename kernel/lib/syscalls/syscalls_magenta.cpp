@@ -20,6 +20,7 @@
 #include <lib/crypto/global_prng.h>
 #include <lib/user_copy.h>
 #include <lib/user_copy/user_ptr.h>
+#include <lib/vdso.h>
 
 #include <magenta/event_dispatcher.h>
 #include <magenta/event_pair_dispatcher.h>
@@ -34,6 +35,8 @@
 
 #include <mxtl/alloc_checker.h>
 #include <mxtl/atomic.h>
+#include <mxtl/auto_lock.h>
+#include <mxtl/mutex.h>
 #include <mxtl/ref_ptr.h>
 
 #include "syscalls_priv.h"
@@ -59,7 +62,12 @@ mx_status_t sys_nanosleep(mx_time_t deadline) {
 // This must be accessed atomically from any given thread.
 static mxtl::atomic<int64_t> utc_offset;
 
-uint64_t sys_time_get(uint32_t clock_id) {
+// Serializes updates of |utc_offset| and of its copy in the vDSO.
+static mxtl::Mutex utc_offset_lock;
+
+// mx_time_get() is computed in the vDSO when the platform allows and ends
+// up here otherwise.
+uint64_t sys_time_get_kernel(uint32_t clock_id) {
     switch (clock_id) {
     case MX_CLOCK_MONOTONIC:
         return current_time();
@@ -83,9 +91,12 @@ mx_status_t sys_clock_adjust(mx_handle_t hrsrc, uint32_t clock_id, int64_t offse
     switch (clock_id) {
     case MX_CLOCK_MONOTONIC:
         return MX_ERR_ACCESS_DENIED;
-    case MX_CLOCK_UTC:
+    case MX_CLOCK_UTC: {
+        mxtl::AutoLock lock(&utc_offset_lock);
         utc_offset.store(offset);
+        VDso::SetUtcOffset(offset);
         return MX_OK;
+    }
     default:
         return MX_ERR_INVALID_ARGS;
     }
@@ -246,9 +257,8 @@ mx_status_t sys_cprng_draw(user_ptr<void> _buffer, size_t len, user_ptr<size_t>
     // returns.
     explicit_memory::ZeroDtor<uint8_t> zero_guard(kernel_buf, sizeof(kernel_buf));
 
-    auto prng = crypto::GlobalPRNG::GetInstance();
-    ASSERT(prng->is_thread_safe());
-    prng->Draw(kernel_buf, static_cast<int>(len));
+    ASSERT(crypto::GlobalPRNG::GetInstance()->is_thread_safe());
+    crypto::GlobalPRNG::Draw(kernel_buf, len);
 
     if (_buffer.copy_array_to_user(kernel_buf, len) != MX_OK)
         return MX_ERR_INVALID_ARGS;
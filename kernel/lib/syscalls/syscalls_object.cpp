@@ -12,12 +12,14 @@
 #include <kernel/stats.h>
 #include <kernel/vm/pmm.h>
 #include <lib/heap.h>
+#include <lib/lockstat.h>
 #include <platform.h>
 
 #include <magenta/diagnostics.h>
 #include <magenta/handle_owner.h>
 #include <magenta/job_dispatcher.h>
 #include <magenta/magenta.h>
+#include <magenta/mx-syscall-numbers.h>
 #include <magenta/process_dispatcher.h>
 #include <magenta/resource_dispatcher.h>
 #include <magenta/thread_dispatcher.h>
@@ -99,6 +101,16 @@ mx_status_t single_record_result(user_ptr<void> _buffer, size_t buffer_size,
     return MX_OK;
 }
 
+// Returns the syscall counting of a process or job, or null for other
+// objects. The caller's reference keeps it alive.
+SyscallStats* get_syscall_stats(mxtl::RefPtr<Dispatcher> dispatcher) {
+    if (auto process = DownCastDispatcher<ProcessDispatcher>(&dispatcher))
+        return process->syscall_stats();
+    if (auto job = DownCastDispatcher<JobDispatcher>(&dispatcher))
+        return job->syscall_stats();
+    return nullptr;
+}
+
 } // namespace
 
 // actual is an optional return parameter for the number of records returned
@@ -476,6 +488,74 @@ mx_status_t sys_object_get_info(mx_handle_t handle, uint32_t topic,
             return single_record_result(
                 _buffer, buffer_size, _actual, _avail, &stats, sizeof(stats));
         }
+        case MX_INFO_LOCK_STATS: {
+#if WITH_LIB_LOCKSTAT
+            auto status = validate_resource(handle, MX_RSRC_KIND_ROOT);
+            if (status != MX_OK)
+                return status;
+
+            size_t num_space_for = buffer_size / sizeof(mx_info_lock_stats_t);
+            user_ptr<mx_info_lock_stats_t> lock_buf(
+                static_cast<mx_info_lock_stats_t *>(_buffer.get()));
+
+            // Classes come and go in arbitrary slots, so report the ones in
+            // use as found and count them all for |avail|.
+            size_t num_copied = 0;
+            size_t num_classes = 0;
+            for (uint32_t slot = 0; slot < LOCKSTAT_CLASSES; slot++) {
+                mx_info_lock_stats_t stats;
+                if (!lockstat_get_class(slot, &stats))
+                    continue;
+                if (num_copied < num_space_for) {
+                    if (lock_buf.copy_array_to_user(&stats, 1, num_copied) != MX_OK)
+                        return MX_ERR_INVALID_ARGS;
+                    num_copied++;
+                }
+                num_classes++;
+            }
+
+            if (_actual && (_actual.copy_to_user(num_copied) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            if (_avail && (_avail.copy_to_user(num_classes) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            return MX_OK;
+#else
+            return MX_ERR_NOT_SUPPORTED;
+#endif
+        }
+        case MX_INFO_SYSCALL_STATS: {
+            mxtl::RefPtr<Dispatcher> dispatcher;
+            auto error = up->GetDispatcherWithRights(handle, MX_RIGHT_READ, &dispatcher);
+            if (error < 0)
+                return error;
+            SyscallStats* syscall_stats = get_syscall_stats(dispatcher);
+            if (!syscall_stats)
+                return MX_ERR_WRONG_TYPE;
+
+            size_t num_space_for = buffer_size / sizeof(mx_info_syscall_stats_t);
+            user_ptr<mx_info_syscall_stats_t> stats_buf(
+                static_cast<mx_info_syscall_stats_t *>(_buffer.get()));
+
+            size_t num_copied = 0;
+            size_t num_syscalls = 0;
+            for (uint32_t num = 0; num < MX_SYS_COUNT; num++) {
+                mx_info_syscall_stats_t stats;
+                if (!syscall_stats->GetInfo(num, &stats))
+                    continue;
+                if (num_copied < num_space_for) {
+                    if (stats_buf.copy_array_to_user(&stats, 1, num_copied) != MX_OK)
+                        return MX_ERR_INVALID_ARGS;
+                    num_copied++;
+                }
+                num_syscalls++;
+            }
+
+            if (_actual && (_actual.copy_to_user(num_copied) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            if (_avail && (_avail.copy_to_user(num_syscalls) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            return MX_OK;
+        }
         case MX_INFO_RESOURCE: {
             // grab a reference to the dispatcher
             mxtl::RefPtr<ResourceDispatcher> resource;
@@ -567,6 +647,17 @@ mx_status_t sys_object_get_property(mx_handle_t handle_value, uint32_t property,
             }
             return MX_OK;
         }
+        case MX_PROP_SYSCALL_STATS: {
+            if (size != sizeof(uint32_t))
+                return MX_ERR_BUFFER_TOO_SMALL;
+            SyscallStats* syscall_stats = get_syscall_stats(dispatcher);
+            if (!syscall_stats)
+                return MX_ERR_WRONG_TYPE;
+            uint32_t value = syscall_stats->enabled() ? 1u : 0u;
+            if (_value.reinterpret<uint32_t>().copy_to_user(value) != MX_OK)
+                return MX_ERR_INVALID_ARGS;
+            return MX_OK;
+        }
         default:
             return MX_ERR_INVALID_ARGS;
     }
@@ -645,6 +736,17 @@ mx_status_t sys_object_set_property(mx_handle_t handle_value, uint32_t property,
             return job->set_importance(
                 static_cast<mx_job_importance_t>(value));
         }
+        case MX_PROP_SYSCALL_STATS: {
+            if (size != sizeof(uint32_t))
+                return MX_ERR_BUFFER_TOO_SMALL;
+            SyscallStats* syscall_stats = get_syscall_stats(dispatcher);
+            if (!syscall_stats)
+                return MX_ERR_WRONG_TYPE;
+            uint32_t value = 0;
+            if (_value.reinterpret<const uint32_t>().copy_from_user(&value) != MX_OK)
+                return MX_ERR_INVALID_ARGS;
+            return syscall_stats->SetEnabled(value != 0);
+        }
     }
 
     return MX_ERR_INVALID_ARGS;
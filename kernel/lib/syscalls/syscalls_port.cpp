@@ -114,6 +114,49 @@ mx_status_t sys_port_wait(mx_handle_t handle, mx_time_t deadline,
     return MX_OK;
 }
 
+mx_status_t sys_port_wait_many(mx_handle_t handle, mx_time_t deadline,
+                               user_ptr<mx_port_packet_t> _packets, uint32_t count,
+                               user_ptr<uint32_t> _actual) {
+    LTRACEF("handle %x count %u\n", handle, count);
+
+    if (count == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (count > kMaxPortBatch)
+        return MX_ERR_OUT_OF_RANGE;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<PortDispatcher> port;
+    mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_READ, &port);
+    if (status != MX_OK)
+        return status;
+
+    ktrace(TAG_PORT_WAIT, (uint32_t)port->get_koid(), 0, 0, 0);
+
+    mx_port_packet_t pp[kMaxPortBatch];
+    uint32_t actual = 0u;
+    mx_status_t st = port->DeQueueMany(deadline, pp, count, &actual);
+
+    ktrace(TAG_PORT_WAIT_DONE, (uint32_t)port->get_koid(), st, actual, 0);
+
+    if (st != MX_OK)
+        return st;
+
+    // remove internal flag bits
+    for (uint32_t i = 0u; i < actual; ++i)
+        pp[i].type &= PKT_FLAG_MASK;
+
+    // The packets have already left the port; as with port_wait() a bad
+    // buffer loses them.
+    if (_packets.copy_array_to_user(pp, actual) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    if (_actual && _actual.copy_to_user(actual) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    return MX_OK;
+}
+
 mx_status_t sys_port_cancel(mx_handle_t handle, mx_handle_t source, uint64_t key) {
     auto up = ProcessDispatcher::GetCurrent();
 
@@ -80,9 +80,11 @@ mx_status_t sys_socket_write(mx_handle_t handle, uint32_t options,
         return status;
 
     switch (options) {
-    case 0: {
+    case 0:
+    case MX_SOCKET_WRITE_MOVE_PAGES: {
+        mx_iovec_t iov = {const_cast<void*>(_buffer.get()), size};
         size_t nwritten;
-        status = socket->Write(_buffer, size, &nwritten);
+        status = socket->WriteV(&iov, 1u, options == MX_SOCKET_WRITE_MOVE_PAGES, &nwritten);
 
         // Caller may ignore results if desired.
         if (status == MX_OK && _actual)
@@ -126,3 +128,135 @@ mx_status_t sys_socket_read(mx_handle_t handle, uint32_t options,
 
     return status;
 }
+
+mx_status_t sys_socket_writev(mx_handle_t handle, uint32_t options,
+                              user_ptr<const mx_iovec_t> _iov, uint32_t num_iov,
+                              user_ptr<size_t> _actual) {
+    LTRACEF("handle %x num_iov %u\n", handle, num_iov);
+
+    if (options & ~MX_SOCKET_WRITE_MOVE_PAGES)
+        return MX_ERR_INVALID_ARGS;
+    if (num_iov == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (num_iov > MX_SOCKET_MAX_IOVECS)
+        return MX_ERR_OUT_OF_RANGE;
+
+    mx_iovec_t iov[MX_SOCKET_MAX_IOVECS];
+    if (_iov.copy_array_from_user(iov, num_iov) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<SocketDispatcher> socket;
+    mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_WRITE, &socket);
+    if (status != MX_OK)
+        return status;
+
+    size_t nwritten;
+    status = socket->WriteV(iov, num_iov, options == MX_SOCKET_WRITE_MOVE_PAGES, &nwritten);
+
+    // Caller may ignore results if desired.
+    if (status == MX_OK && _actual)
+        status = _actual.copy_to_user(nwritten);
+
+    return status;
+}
+
+mx_status_t sys_socket_readv(mx_handle_t handle, uint32_t options,
+                             user_ptr<const mx_iovec_t> _iov, uint32_t num_iov,
+                             user_ptr<size_t> _actual) {
+    LTRACEF("handle %x num_iov %u\n", handle, num_iov);
+
+    if (options)
+        return MX_ERR_INVALID_ARGS;
+    if (num_iov == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (num_iov > MX_SOCKET_MAX_IOVECS)
+        return MX_ERR_OUT_OF_RANGE;
+
+    mx_iovec_t iov[MX_SOCKET_MAX_IOVECS];
+    if (_iov.copy_array_from_user(iov, num_iov) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<SocketDispatcher> socket;
+    mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_READ, &socket);
+    if (status != MX_OK)
+        return status;
+
+    size_t nread;
+    status = socket->ReadV(iov, num_iov, &nread);
+
+    // Caller may ignore results if desired.
+    if (status == MX_OK && _actual)
+        status = _actual.copy_to_user(nread);
+
+    return status;
+}
+
+mx_status_t sys_socket_write_many(mx_handle_t handle, uint32_t options,
+                                  user_ptr<const mx_iovec_t> _dgrams, uint32_t num_dgrams,
+                                  user_ptr<uint32_t> _actual) {
+    LTRACEF("handle %x num_dgrams %u\n", handle, num_dgrams);
+
+    if (options || num_dgrams == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (num_dgrams > MX_SOCKET_MAX_BATCH)
+        return MX_ERR_OUT_OF_RANGE;
+
+    mx_iovec_t dgrams[MX_SOCKET_MAX_BATCH];
+    if (_dgrams.copy_array_from_user(dgrams, num_dgrams) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<SocketDispatcher> socket;
+    mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_WRITE, &socket);
+    if (status != MX_OK)
+        return status;
+
+    size_t nwritten;
+    status = socket->WriteMany(dgrams, num_dgrams, &nwritten);
+
+    // Caller may ignore results if desired.
+    if (status == MX_OK && _actual)
+        status = _actual.copy_to_user(static_cast<uint32_t>(nwritten));
+
+    return status;
+}
+
+mx_status_t sys_socket_read_many(mx_handle_t handle, uint32_t options,
+                                 user_ptr<mx_iovec_t> _dgrams, uint32_t num_dgrams,
+                                 user_ptr<uint32_t> _actual) {
+    LTRACEF("handle %x num_dgrams %u\n", handle, num_dgrams);
+
+    if (options || num_dgrams == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (num_dgrams > MX_SOCKET_MAX_BATCH)
+        return MX_ERR_OUT_OF_RANGE;
+
+    mx_iovec_t dgrams[MX_SOCKET_MAX_BATCH];
+    if (_dgrams.copy_array_from_user(dgrams, num_dgrams) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<SocketDispatcher> socket;
+    mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_READ, &socket);
+    if (status != MX_OK)
+        return status;
+
+    size_t nread;
+    status = socket->ReadMany(dgrams, num_dgrams, &nread);
+    if (status != MX_OK)
+        return status;
+
+    if (_dgrams.copy_array_to_user(dgrams, nread) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+    if (_actual) {
+        if (_actual.copy_to_user(static_cast<uint32_t>(nread)) != MX_OK)
+            return MX_ERR_INVALID_ARGS;
+    }
+    return MX_OK;
+}
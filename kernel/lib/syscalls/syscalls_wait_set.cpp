@@ -0,0 +1,115 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <err.h>
+#include <inttypes.h>
+#include <trace.h>
+
+#include <magenta/handle_owner.h>
+#include <magenta/magenta.h>
+#include <magenta/process_dispatcher.h>
+#include <magenta/user_copy.h>
+#include <magenta/wait_set_dispatcher.h>
+
+#include <mxtl/auto_lock.h>
+#include <mxtl/ref_ptr.h>
+
+#include "syscalls_priv.h"
+
+#define LOCAL_TRACE 0
+
+mx_status_t sys_waitset_create(uint32_t options, user_ptr<mx_handle_t> _out) {
+    LTRACEF("options %u\n", options);
+
+    mxtl::RefPtr<Dispatcher> dispatcher;
+    mx_rights_t rights;
+
+    mx_status_t result = WaitSetDispatcher::Create(options, &dispatcher, &rights);
+
+    if (result != MX_OK)
+        return result;
+
+    HandleOwner handle(MakeHandle(mxtl::move(dispatcher), rights));
+    if (!handle)
+        return MX_ERR_NO_MEMORY;
+
+    auto up = ProcessDispatcher::GetCurrent();
+    mx_handle_t hv = up->MapHandleToValue(handle);
+
+    if (_out.copy_to_user(hv) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    up->AddHandle(mxtl::move(handle));
+    return MX_OK;
+}
+
+mx_status_t sys_waitset_add(mx_handle_t waitset_handle, uint64_t cookie,
+                            mx_handle_t handle_value, mx_signals_t signals, uint32_t options) {
+    LTRACEF("waitset %x cookie %" PRIu64 " handle %x\n", waitset_handle, cookie, handle_value);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<WaitSetDispatcher> wait_set;
+    mx_status_t status = up->GetDispatcherWithRights(waitset_handle, MX_RIGHT_WRITE, &wait_set);
+    if (status != MX_OK)
+        return status;
+
+    mxtl::AutoLock lock(up->handle_table_lock());
+    Handle* handle = up->GetHandleLocked(handle_value);
+    if (!handle)
+        return MX_ERR_BAD_HANDLE;
+    if (!magenta_rights_check(handle, MX_RIGHT_READ))
+        return MX_ERR_ACCESS_DENIED;
+
+    return wait_set->AddEntry(handle, cookie, signals, options);
+}
+
+mx_status_t sys_waitset_remove(mx_handle_t waitset_handle, uint64_t cookie) {
+    LTRACEF("waitset %x cookie %" PRIu64 "\n", waitset_handle, cookie);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<WaitSetDispatcher> wait_set;
+    mx_status_t status = up->GetDispatcherWithRights(waitset_handle, MX_RIGHT_WRITE, &wait_set);
+    if (status != MX_OK)
+        return status;
+
+    return wait_set->RemoveEntry(cookie);
+}
+
+mx_status_t sys_waitset_wait(mx_handle_t waitset_handle, mx_time_t deadline,
+                             user_ptr<mx_waitset_result_t> _results, uint32_t count,
+                             user_ptr<uint32_t> _actual) {
+    LTRACEF("waitset %x count %u\n", waitset_handle, count);
+
+    if (count == 0u)
+        return MX_ERR_INVALID_ARGS;
+    if (count > MX_WAITSET_MAX_BATCH)
+        return MX_ERR_OUT_OF_RANGE;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    mxtl::RefPtr<WaitSetDispatcher> wait_set;
+    mx_status_t status = up->GetDispatcherWithRights(waitset_handle, MX_RIGHT_READ, &wait_set);
+    if (status != MX_OK)
+        return status;
+
+    mx_waitset_result_t results[MX_WAITSET_MAX_BATCH];
+    uint32_t actual = count;
+    status = wait_set->Wait(deadline, results, &actual);
+    if (status != MX_OK)
+        return status;
+
+    // Edge-triggered results have already left the ready list; as with
+    // port_wait_many() a bad buffer loses them.
+    if (_results.copy_array_to_user(results, actual) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    if (_actual && _actual.copy_to_user(actual) != MX_OK)
+        return MX_ERR_INVALID_ARGS;
+
+    return MX_OK;
+}
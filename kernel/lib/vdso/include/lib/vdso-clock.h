@@ -0,0 +1,61 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+// This file is used both in the kernel and in the vDSO implementation.
+// So it must be compatible with both the kernel and userland header
+// environments.  It must use only the basic types so that struct
+// layouts match exactly in both contexts.
+
+#define VDSO_CLOCK_SIZE (6 * 4 + 8)
+#define VDSO_CLOCK_ALIGN 8
+
+// The clock data sits alone in its own page of the vDSO image, so that
+// the copy-on-write clones made for vDSO variants never copy it and
+// keep seeing the kernel's updates.
+#define VDSO_CLOCK_PAGE_SIZE 4096
+
+// vdso_clock::flags bits.
+
+// MX_CLOCK_MONOTONIC is mx_ticks_get() scaled by ns_per_tick.
+#define VDSO_CLOCK_TICKS_VALID 1u
+
+#ifndef ASSEMBLY
+
+#include <stdint.h>
+
+// This struct holds the clock parameters the vDSO needs to compute
+// mx_time_get() without entering the kernel.  Unlike vdso_constants,
+// the kernel updates it while processes run, so it is protected by a
+// sequence lock: the kernel makes |seq| odd before changing any other
+// member and even again afterwards, and readers retry if they see an
+// odd |seq| or if |seq| changed while they read.
+struct vdso_clock {
+    uint32_t seq;
+
+    // VDSO_CLOCK_* bits.  If VDSO_CLOCK_TICKS_VALID is clear, the vDSO
+    // must ask the kernel for the time.
+    uint32_t flags;
+
+    // Nanoseconds per tick as a 32.64 fixed point number; the kernel's
+    // struct fp_32_64.
+    uint32_t ns_per_tick_l0;
+    uint32_t ns_per_tick_l32;
+    uint32_t ns_per_tick_l64;
+
+    uint32_t reserved;
+
+    // MX_CLOCK_UTC minus MX_CLOCK_MONOTONIC, as set by mx_clock_adjust().
+    int64_t utc_offset;
+};
+
+static_assert(VDSO_CLOCK_SIZE == sizeof(vdso_clock),
+              "Need to adjust VDSO_CLOCK_SIZE");
+static_assert(VDSO_CLOCK_ALIGN == alignof(vdso_clock),
+              "Need to adjust VDSO_CLOCK_ALIGN");
+
+#endif // ASSEMBLY
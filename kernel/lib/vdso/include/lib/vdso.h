@@ -50,6 +50,9 @@ public:
     // Return a handle to the VMO for the given variant.
     HandleOwner vmo_handle(Variant) const;
 
+    // Publish a new MX_CLOCK_UTC offset to the vDSO's mx_time_get().
+    static void SetUtcOffset(int64_t offset);
+
 private:
     VDso();
     void CreateVariant(Variant);
@@ -5,6 +5,7 @@
 // https://opensource.org/licenses/MIT
 
 #include <lib/vdso.h>
+#include <lib/vdso-clock.h>
 #include <lib/vdso-constants.h>
 
 #include <kernel/cmdline.h>
@@ -12,9 +13,13 @@
 #include <kernel/vm/pmm.h>
 #include <kernel/vm/vm_aspace.h>
 #include <kernel/vm/vm_object.h>
+#include <lib/fixed_point.h>
 #include <mxtl/alloc_checker.h>
+#include <mxtl/auto_lock.h>
+#include <mxtl/mutex.h>
 #include <mxtl/type_support.h>
 #include <platform.h>
+#include <platform/timer.h>
 
 #include "vdso-code.h"
 
@@ -158,6 +163,56 @@ private:
     KernelVmoWindow<CodeBuffer> window_;
 };
 
+// The vdso_clock struct stays mapped for the life of the system, since the
+// kernel keeps updating it.  The writer side of its sequence lock is here.
+class VDsoClockWindow {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(VDsoClockWindow);
+
+    static_assert(sizeof(vdso_clock) == VDSO_DATA_CLOCK_SIZE,
+                  "gen-rodso-code.sh is suspect");
+    static_assert(VDSO_DATA_CLOCK % VDSO_CLOCK_PAGE_SIZE == 0,
+                  "vDSO clock data must be alone in its page");
+
+    explicit VDsoClockWindow(mxtl::RefPtr<VmObject> vmo) :
+        window_("vDSO clock", mxtl::move(vmo), VDSO_DATA_CLOCK) {}
+
+    void set_ticks_to_nanos(const fp_32_64& ns_per_tick) {
+        mxtl::AutoLock lock(&lock_);
+        vdso_clock* clock = Begin();
+        __atomic_store_n(&clock->ns_per_tick_l0, ns_per_tick.l0, __ATOMIC_RELAXED);
+        __atomic_store_n(&clock->ns_per_tick_l32, ns_per_tick.l32, __ATOMIC_RELAXED);
+        __atomic_store_n(&clock->ns_per_tick_l64, ns_per_tick.l64, __ATOMIC_RELAXED);
+        __atomic_store_n(&clock->flags, clock->flags | VDSO_CLOCK_TICKS_VALID,
+                         __ATOMIC_RELAXED);
+        End(clock);
+    }
+
+    void set_utc_offset(int64_t offset) {
+        mxtl::AutoLock lock(&lock_);
+        vdso_clock* clock = Begin();
+        __atomic_store_n(&clock->utc_offset, offset, __ATOMIC_RELAXED);
+        End(clock);
+    }
+
+private:
+    vdso_clock* Begin() TA_REQ(lock_) {
+        vdso_clock* clock = window_.data();
+        __atomic_store_n(&clock->seq, clock->seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        return clock;
+    }
+
+    void End(vdso_clock* clock) TA_REQ(lock_) {
+        __atomic_store_n(&clock->seq, clock->seq + 1, __ATOMIC_RELEASE);
+    }
+
+    mxtl::Mutex lock_;
+    KernelVmoWindow<vdso_clock> window_;
+};
+
+static VDsoClockWindow* clock_window;
+
 #define REDIRECT_SYSCALL(dynsym_window, symbol, target)         \
     do {                                                        \
         dynsym_window.set_symbol(symbol, target);               \
@@ -243,6 +298,14 @@ const VDso* VDso::Create() {
         REDIRECT_SYSCALL(dynsym_window, mx_ticks_get, soft_ticks_get);
     }
 
+    // The variants made below are copy-on-write clones, but they never
+    // write to the clock's page and so keep sharing it.
+    clock_window = new(&ac) VDsoClockWindow(vdso->vmo()->vmo());
+    ASSERT(ac.check());
+    fp_32_64 ns_per_tick;
+    if (platform_user_ticks_to_nanos(&ns_per_tick))
+        clock_window->set_ticks_to_nanos(ns_per_tick);
+
     for (size_t v = static_cast<size_t>(Variant::FULL) + 1;
          v < static_cast<size_t>(Variant::COUNT);
          ++v)
@@ -252,6 +315,10 @@ const VDso* VDso::Create() {
     return instance_;
 }
 
+void VDso::SetUtcOffset(int64_t offset) {
+    clock_window->set_utc_offset(offset);
+}
+
 uintptr_t VDso::base_address(const mxtl::RefPtr<VmMapping>& code_mapping) {
     return code_mapping ? code_mapping->base() - VDSO_CODE_START : 0;
 }
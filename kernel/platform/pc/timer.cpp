@@ -163,6 +163,15 @@ lk_time_t ticks_to_nanos(uint64_t ticks) {
     return u64_mul_u64_fp32_64(ticks, ns_per_tsc);
 }
 
+bool platform_user_ticks_to_nanos(struct fp_32_64* ns_per_tick)
+{
+    // mx_ticks_get() reads the TSC.
+    if (wall_clock != CLOCK_TSC)
+        return false;
+    *ns_per_tick = ns_per_tsc;
+    return true;
+}
+
 // The PIT timer will keep track of wall time if we aren't using the TSC
 static enum handler_return pit_timer_tick(void *arg)
 {
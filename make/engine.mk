@@ -25,6 +25,7 @@ ENABLE_BUILD_SYSROOT := $(call TOBOOL,$(ENABLE_BUILD_SYSROOT))
 ENABLE_NEW_FB := true
 ENABLE_ACPI_BUS ?= true
 DISABLE_UTEST ?= false
+ENABLE_LOCK_STATS ?= false
 ENABLE_ULIB_ONLY ?= false
 USE_ASAN ?= false
 USE_SANCOV ?= false
@@ -370,6 +371,12 @@ MDI_INCLUDES := system/public/magenta/mdi/magenta.mdi
 KERNEL_DEFINES += WITH_PANIC_BACKTRACE=1 WITH_FRAME_POINTERS=1
 KERNEL_COMPILEFLAGS += $(KEEP_FRAME_POINTER_COMPILEFLAGS)
 
+# Lock statistics add some work to every lock and unlock, so they are
+# only built when asked for.
+ifeq ($(call TOBOOL,$(ENABLE_LOCK_STATS)),true)
+MODULES += kernel/lib/lockstat
+endif
+
 # userspace boot file system generated by the build system
 USER_BOOTDATA := $(BUILDDIR)/bootdata.bin
 USER_FS := $(BUILDDIR)/user.fs
@@ -0,0 +1,804 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// ktracedump decodes a ktrace dump, as read from /dev/misc/ktrace or
+// mx_ktrace_read(), or a copy of an mx_ktrace_stream() ring, into the
+// Chrome trace event JSON format (which Perfetto's UI also loads) or into
+// one line of text per record, and can print summary statistics.
+//
+// The dump is decoded in two passes. The first walks the record headers,
+// collects the names and the metadata, and cuts the records into chunks,
+// noting which thread each cpu was running at the start of each chunk.
+// The second decodes the chunks in parallel. Output is written in chunk
+// order, and begin/end pairs that straddle chunks are matched up as each
+// chunk is written.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <magenta/ktrace.h>
+
+namespace {
+
+// The records decoded by one worker at a time.
+constexpr size_t kChunkSize = 16u << 20;
+
+// cpu numbers are 8 bits in the records that carry them.
+constexpr uint32_t kMaxCpus = 256;
+
+// Pseudo process and thread ids for the per-cpu tracks.
+constexpr uint32_t kCpuPid = 0xffffffffu;
+constexpr uint32_t kIrqTrackBit = 0x100u;
+
+enum class Format {
+    kJson,
+    kText,
+    kNone,
+};
+
+uint32_t rd32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t rd64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Tags with the size bits cleared, which is how records are told apart.
+uint32_t tag_kind(uint32_t tag) {
+    return tag & ~0xFu;
+}
+
+#define KTRACE_DEF(num, type, name, group) {TAG_##name & ~0xFu, #name},
+const struct {
+    uint32_t kind;
+    const char* name;
+} kEventNames[] = {
+#include <magenta/ktrace-def.h>
+};
+
+const char* event_name(uint32_t tag) {
+    for (const auto& e : kEventNames) {
+        if (e.kind == tag_kind(tag))
+            return e.name;
+    }
+    return nullptr;
+}
+
+bool is_probe(uint32_t tag) {
+    return KTRACE_GROUP(tag) == KTRACE_GRP_PROBE && (KTRACE_EVENT(tag) & 0x800) != 0;
+}
+
+// A thread as shown in the trace: a user thread is (pid, koid) and a
+// kernel thread is (0, low bits of its thread_t address).
+struct ThreadId {
+    uint32_t pid = 0;
+    uint32_t tid = 0;
+    bool valid = false;
+
+    uint64_t key() const { return ((uint64_t)pid << 32) | tid; }
+};
+
+struct CpuSnapshot {
+    ThreadId current[kMaxCpus];
+};
+
+struct Chunk {
+    size_t begin;
+    size_t end;
+    CpuSnapshot start;
+};
+
+// Everything the first pass learns.
+struct TraceInfo {
+    uint32_t version = 0;
+    uint64_t ticks_per_ms = 0;
+    uint64_t first_ts = 0;
+    uint64_t last_ts = 0;
+    uint64_t records = 0;
+    uint32_t num_cpus = 0;
+
+    std::unordered_map<uint32_t, std::string> syscall_names;
+    std::unordered_map<uint32_t, std::string> irq_names;
+    std::unordered_map<uint32_t, std::string> probe_names;
+    std::unordered_map<uint32_t, std::string> proc_names;
+    std::unordered_map<uint32_t, std::string> kthread_names;
+    std::unordered_map<uint32_t, std::string> thread_names;
+    std::unordered_map<uint32_t, uint32_t> thread_pids;
+
+    std::vector<Chunk> chunks;
+
+    uint32_t pid_of(uint32_t tid) const {
+        auto it = thread_pids.find(tid);
+        return it == thread_pids.end() ? 0 : it->second;
+    }
+
+    std::string name(const std::unordered_map<uint32_t, std::string>& names,
+                     const char* what, uint32_t id) const {
+        auto it = names.find(id);
+        if (it != names.end())
+            return it->second;
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%s %u", what, id);
+        return buf;
+    }
+};
+
+struct Times {
+    uint64_t count = 0;
+    uint64_t ticks = 0;
+    uint64_t max = 0;
+
+    void add(uint64_t t) {
+        ticks += t;
+        max = std::max(max, t);
+    }
+    void merge(const Times& other) {
+        count += other.count;
+        ticks += other.ticks;
+        max = std::max(max, other.max);
+    }
+};
+
+struct Stats {
+    uint64_t context_switches[kMaxCpus] = {};
+    Times irqs[kMaxCpus];
+    Times syscalls_per_cpu[kMaxCpus];
+    std::unordered_map<uint32_t, Times> syscalls;
+    uint64_t unknown = 0;
+
+    void merge(const Stats& other) {
+        for (uint32_t i = 0; i < kMaxCpus; i++) {
+            context_switches[i] += other.context_switches[i];
+            irqs[i].merge(other.irqs[i]);
+            syscalls_per_cpu[i].merge(other.syscalls_per_cpu[i]);
+        }
+        for (const auto& s : other.syscalls)
+            syscalls[s.first].merge(s.second);
+        unknown += other.unknown;
+    }
+};
+
+// A begin or end whose other half is in another chunk.
+struct Dangling {
+    uint32_t cpu;
+    uint32_t num;
+    uint64_t ts;
+    ThreadId thread;
+    // For an end: its output, written only if the begin is found.
+    std::string out;
+};
+
+struct ChunkResult {
+    std::string out;
+    Stats stats;
+    std::vector<Dangling> irq_begins;
+    std::vector<Dangling> irq_ends;
+    std::vector<Dangling> syscall_begins;
+    std::vector<Dangling> syscall_ends;
+};
+
+void appendf(std::string* out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void appendf(std::string* out, const char* fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        out->append(buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            appendf(&out, "\\u%04x", c);
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Formats the output of one chunk's records.
+class Decoder {
+public:
+    Decoder(const TraceInfo& info, Format format, const uint8_t* data, ChunkResult* result)
+        : info_(info), format_(format), data_(data), result_(result) {
+        scale_ = 1000.0 / (double)info.ticks_per_ms;
+    }
+
+    void Decode(const Chunk& chunk) {
+        cpus_ = chunk.start;
+        for (size_t off = chunk.begin; off < chunk.end;) {
+            const uint8_t* rec = data_ + off;
+            uint32_t tag = rd32(rec);
+            off += KTRACE_LEN(tag);
+            DecodeRecord(tag, rec);
+        }
+        // Whatever is still open is closed in a later chunk.
+        for (uint32_t cpu = 0; cpu < kMaxCpus; cpu++) {
+            for (const auto& d : irq_stack_[cpu])
+                result_->irq_begins.push_back(d);
+        }
+        for (const auto& s : open_syscalls_)
+            result_->syscall_begins.push_back(s.second);
+    }
+
+private:
+    double Micros(uint64_t ts) const {
+        return (double)(ts - info_.first_ts) * scale_;
+    }
+
+    void Event(std::string* out, char phase, const char* name, uint64_t ts,
+               uint32_t pid, uint32_t tid, const char* args) {
+        if (format_ == Format::kJson) {
+            appendf(out, ",\n{\"ph\":\"%c\",\"name\":\"%s\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u%s%s%s}",
+                    phase, json_escape(name).c_str(), Micros(ts), pid, tid,
+                    phase == 'i' ? ",\"s\":\"t\"" : "",
+                    args ? ",\"args\":" : "", args ? args : "");
+        } else if (format_ == Format::kText) {
+            appendf(out, "%.3f %c %u %u %s%s%s\n", Micros(ts), phase, pid, tid, name,
+                    args ? " " : "", args ? args : "");
+        }
+    }
+
+    void Args(char* buf, size_t size, const uint32_t* args, uint32_t n) {
+        size_t len = 0;
+        if (format_ == Format::kJson) {
+            len += snprintf(buf, size, "{");
+            for (uint32_t i = 0; i < n && len < size; i++) {
+                len += snprintf(buf + len, size - len, "%s\"%c\":\"0x%x\"",
+                                i ? "," : "", 'a' + i, args[i]);
+            }
+            if (len < size)
+                snprintf(buf + len, size - len, "}");
+        } else {
+            buf[0] = '\0';
+            for (uint32_t i = 0; i < n && len < size; i++)
+                len += snprintf(buf + len, size - len, "%s0x%x", i ? " " : "", args[i]);
+        }
+    }
+
+    void DecodeRecord(uint32_t tag, const uint8_t* rec) {
+        uint32_t kind = tag_kind(tag);
+        uint32_t len = KTRACE_LEN(tag);
+        uint32_t tid = rd32(rec + 4);
+        uint64_t ts = rd64(rec + 8);
+
+        // Metadata and names carry no timestamp; the first pass took them.
+        if (KTRACE_GROUP(tag) == KTRACE_GRP_META)
+            return;
+
+        switch (kind) {
+        case TAG_IRQ_ENTER & ~0xFu:
+        case TAG_IRQ_EXIT & ~0xFu:
+            Irq(kind == (TAG_IRQ_ENTER & ~0xFu), tid & 0xff, tid >> 8, ts);
+            return;
+        case TAG_SYSCALL_ENTER & ~0xFu:
+        case TAG_SYSCALL_EXIT & ~0xFu:
+            Syscall(kind == (TAG_SYSCALL_ENTER & ~0xFu), tid & 0xff, tid >> 8, ts);
+            return;
+        case TAG_CONTEXT_SWITCH & ~0xFu:
+            ContextSwitch(rec, ts);
+            return;
+        }
+
+        uint32_t args[4] = {};
+        uint32_t num_args = 0;
+        if (len > KTRACE_HDRSIZE) {
+            num_args = std::min((len - KTRACE_HDRSIZE) / 4, 4u);
+            for (uint32_t i = 0; i < num_args; i++)
+                args[i] = rd32(rec + KTRACE_HDRSIZE + 4 * i);
+        }
+
+        std::string name;
+        if (is_probe(tag)) {
+            name = info_.name(info_.probe_names, "probe", KTRACE_EVENT(tag) & 0x7ff);
+        } else if (const char* n = event_name(tag)) {
+            name = n;
+        } else {
+            result_->stats.unknown++;
+            char buf[32];
+            snprintf(buf, sizeof(buf), "0x%08x", tag);
+            name = buf;
+        }
+
+        char argbuf[128];
+        Args(argbuf, sizeof(argbuf), args, num_args);
+        Event(&result_->out, 'i', name.c_str(), ts, info_.pid_of(tid), tid,
+              num_args ? argbuf : nullptr);
+    }
+
+    void Irq(bool enter, uint32_t cpu, uint32_t irq, uint64_t ts) {
+        std::string name = info_.name(info_.irq_names, "irq", irq);
+        uint32_t track = cpu | kIrqTrackBit;
+        std::vector<Dangling>* stack = &irq_stack_[cpu];
+        if (enter) {
+            result_->stats.irqs[cpu].count++;
+            stack->push_back(Dangling{cpu, irq, ts, ThreadId(), std::string()});
+            Event(&result_->out, 'B', name.c_str(), ts, kCpuPid, track, nullptr);
+            return;
+        }
+        if (stack->empty()) {
+            Dangling d{cpu, irq, ts, ThreadId(), std::string()};
+            Event(&d.out, 'E', name.c_str(), ts, kCpuPid, track, nullptr);
+            result_->irq_ends.push_back(std::move(d));
+            return;
+        }
+        result_->stats.irqs[cpu].add(ts - stack->back().ts);
+        stack->pop_back();
+        Event(&result_->out, 'E', name.c_str(), ts, kCpuPid, track, nullptr);
+    }
+
+    void Syscall(bool enter, uint32_t cpu, uint32_t num, uint64_t ts) {
+        const ThreadId& thread = cpus_.current[cpu];
+        std::string name = info_.name(info_.syscall_names, "syscall", num);
+        if (enter) {
+            result_->stats.syscalls[num].count++;
+            result_->stats.syscalls_per_cpu[cpu].count++;
+            open_syscalls_[thread.key()] = Dangling{cpu, num, ts, thread, std::string()};
+            Event(&result_->out, 'B', name.c_str(), ts, thread.pid, thread.tid, nullptr);
+            return;
+        }
+        auto it = open_syscalls_.find(thread.key());
+        if (it == open_syscalls_.end()) {
+            Dangling d{cpu, num, ts, thread, std::string()};
+            Event(&d.out, 'E', name.c_str(), ts, thread.pid, thread.tid, nullptr);
+            result_->syscall_ends.push_back(std::move(d));
+            return;
+        }
+        if (it->second.num == num) {
+            result_->stats.syscalls[num].add(ts - it->second.ts);
+            result_->stats.syscalls_per_cpu[cpu].add(ts - it->second.ts);
+            Event(&result_->out, 'E', name.c_str(), ts, thread.pid, thread.tid, nullptr);
+        }
+        open_syscalls_.erase(it);
+    }
+
+    void ContextSwitch(const uint8_t* rec, uint64_t ts) {
+        uint32_t to_tid = rd32(rec + 16);
+        uint32_t cpu = rd32(rec + 20) & 0xff;
+        uint32_t to_kt = rd32(rec + 28);
+        result_->stats.context_switches[cpu]++;
+
+        ThreadId* current = &cpus_.current[cpu];
+        if (current->valid)
+            Event(&result_->out, 'E', "running", ts, kCpuPid, cpu, nullptr);
+
+        current->valid = true;
+        if (to_tid != 0) {
+            current->pid = info_.pid_of(to_tid);
+            current->tid = to_tid;
+        } else {
+            current->pid = 0;
+            current->tid = to_kt;
+        }
+
+        std::string name = current->pid != 0
+            ? info_.name(info_.thread_names, "thread", current->tid)
+            : info_.name(info_.kthread_names, "kthread", current->tid);
+        if (format_ == Format::kJson) {
+            char args[96];
+            snprintf(args, sizeof(args), "{\"pid\":%u,\"tid\":%u}", current->pid, current->tid);
+            Event(&result_->out, 'B', name.c_str(), ts, kCpuPid, cpu, args);
+        } else {
+            Event(&result_->out, 'B', name.c_str(), ts, kCpuPid, cpu, nullptr);
+        }
+    }
+
+    const TraceInfo& info_;
+    const Format format_;
+    const uint8_t* const data_;
+    ChunkResult* const result_;
+    double scale_;
+
+    CpuSnapshot cpus_;
+    std::vector<Dangling> irq_stack_[kMaxCpus];
+    std::unordered_map<uint64_t, Dangling> open_syscalls_;
+};
+
+// The first pass. Returns false if the dump is malformed before its end.
+bool scan(const uint8_t* data, size_t size, TraceInfo* info) {
+    CpuSnapshot cpus;
+    size_t chunk_begin = 0;
+    info->chunks.push_back(Chunk{0, 0, cpus});
+
+    size_t off = 0;
+    while (off + KTRACE_HDRSIZE <= size) {
+        const uint8_t* rec = data + off;
+        uint32_t tag = rd32(rec);
+        uint32_t len = KTRACE_LEN(tag);
+        if (tag == 0) {
+            // The unused rest of a buffer.
+            break;
+        }
+        if (len < KTRACE_HDRSIZE || off + len > size) {
+            fprintf(stderr, "ktracedump: bad record 0x%08x at offset %zu\n", tag, off);
+            return false;
+        }
+
+        if (off - chunk_begin >= kChunkSize) {
+            info->chunks.back().end = off;
+            info->chunks.push_back(Chunk{off, 0, cpus});
+            chunk_begin = off;
+        }
+
+        uint32_t kind = tag_kind(tag);
+        uint32_t a = len >= 20 ? rd32(rec + 16) : 0;
+        uint32_t b = len >= 24 ? rd32(rec + 20) : 0;
+        uint32_t id = rd32(rec + 4);
+        uint32_t arg = rd32(rec + 8);
+        auto name = [rec, len]() {
+            const char* s = reinterpret_cast<const char*>(rec + KTRACE_NAMESIZE);
+            return std::string(s, strnlen(s, len - KTRACE_NAMESIZE));
+        };
+
+        info->records++;
+        if (KTRACE_GROUP(tag) != KTRACE_GRP_META) {
+            uint64_t ts = rd64(rec + 8);
+            if (ts != 0 && (info->first_ts == 0 || ts < info->first_ts))
+                info->first_ts = ts;
+            info->last_ts = std::max(info->last_ts, ts);
+        }
+
+        switch (kind) {
+        case TAG_VERSION & ~0xFu:
+            info->version = a;
+            break;
+        case TAG_TICKS_PER_MS & ~0xFu:
+            info->ticks_per_ms = ((uint64_t)b << 32) | a;
+            break;
+        case TAG_KTHREAD_NAME & ~0xFu:
+            info->kthread_names[id] = name();
+            break;
+        case TAG_THREAD_NAME & ~0xFu:
+            info->thread_names[id] = name();
+            info->thread_pids[id] = arg;
+            break;
+        case TAG_PROC_NAME & ~0xFu:
+            info->proc_names[id] = name();
+            break;
+        case TAG_SYSCALL_NAME & ~0xFu:
+            info->syscall_names[id] = name();
+            break;
+        case TAG_IRQ_NAME & ~0xFu:
+            info->irq_names[id] = name();
+            break;
+        case TAG_PROBE_NAME & ~0xFu:
+            info->probe_names[id] = name();
+            break;
+        case TAG_THREAD_CREATE & ~0xFu:
+        case TAG_PROC_START & ~0xFu:
+            info->thread_pids[a] = b;
+            break;
+        case TAG_IRQ_ENTER & ~0xFu:
+        case TAG_SYSCALL_ENTER & ~0xFu:
+            info->num_cpus = std::max(info->num_cpus, (id & 0xff) + 1);
+            break;
+        case TAG_CONTEXT_SWITCH & ~0xFu: {
+            uint32_t cpu = b & 0xff;
+            info->num_cpus = std::max(info->num_cpus, cpu + 1);
+            ThreadId* current = &cpus.current[cpu];
+            current->valid = true;
+            // The pid is filled in by the decoder, once all names are known.
+            current->pid = a != 0 ? 1 : 0;
+            current->tid = a != 0 ? a : rd32(rec + 28);
+            break;
+        }
+        }
+        off += len;
+    }
+    info->chunks.back().end = off;
+
+    // Now that every thread's process is known, fix up the snapshots.
+    for (auto& chunk : info->chunks) {
+        for (auto& t : chunk.start.current) {
+            if (t.valid && t.pid != 0)
+                t.pid = info->pid_of(t.tid);
+        }
+    }
+    return true;
+}
+
+void write_metadata(FILE* out, const TraceInfo& info) {
+    fprintf(out, "{\"traceEvents\":[\n");
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":0,\"tid\":0,"
+            "\"args\":{\"name\":\"kernel\"}}");
+    fprintf(out, ",\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%u,\"tid\":0,"
+            "\"args\":{\"name\":\"cpus\"}}", kCpuPid);
+    for (uint32_t cpu = 0; cpu < info.num_cpus; cpu++) {
+        fprintf(out, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,\"tid\":%u,"
+                "\"args\":{\"name\":\"cpu %u\"}}", kCpuPid, cpu, cpu);
+        fprintf(out, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,\"tid\":%u,"
+                "\"args\":{\"name\":\"cpu %u irq\"}}", kCpuPid, cpu | kIrqTrackBit, cpu);
+    }
+    for (const auto& p : info.proc_names) {
+        fprintf(out, ",\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%u,\"tid\":0,"
+                "\"args\":{\"name\":\"%s\"}}", p.first, json_escape(p.second).c_str());
+    }
+    for (const auto& t : info.thread_names) {
+        fprintf(out, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,\"tid\":%u,"
+                "\"args\":{\"name\":\"%s\"}}", info.pid_of(t.first), t.first,
+                json_escape(t.second).c_str());
+    }
+    for (const auto& t : info.kthread_names) {
+        fprintf(out, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,"
+                "\"args\":{\"name\":\"%s\"}}", t.first, json_escape(t.second).c_str());
+    }
+}
+
+// Matches the ends of |result| that had no begin in their own chunk with
+// the begins left open by earlier chunks, then leaves its own open begins
+// for the chunks after it.
+void match_dangling(ChunkResult* result, Stats* stats, FILE* out,
+                    std::vector<Dangling> (*irqs)[kMaxCpus],
+                    std::unordered_map<uint64_t, Dangling>* syscalls) {
+    for (const auto& end : result->irq_ends) {
+        std::vector<Dangling>* stack = &(*irqs)[end.cpu];
+        if (stack->empty())
+            continue;
+        stats->irqs[end.cpu].add(end.ts - stack->back().ts);
+        stack->pop_back();
+        fwrite(end.out.data(), 1, end.out.size(), out);
+    }
+    for (auto& begin : result->irq_begins)
+        (*irqs)[begin.cpu].push_back(std::move(begin));
+
+    for (const auto& end : result->syscall_ends) {
+        auto it = syscalls->find(end.thread.key());
+        if (it == syscalls->end())
+            continue;
+        if (it->second.num == end.num) {
+            stats->syscalls[end.num].add(end.ts - it->second.ts);
+            stats->syscalls_per_cpu[end.cpu].add(end.ts - it->second.ts);
+            fwrite(end.out.data(), 1, end.out.size(), out);
+        }
+        syscalls->erase(it);
+    }
+    for (auto& begin : result->syscall_begins)
+        (*syscalls)[begin.thread.key()] = std::move(begin);
+}
+
+void print_stats(const TraceInfo& info, const Stats& stats) {
+    double ms_per_tick = 1.0 / (double)info.ticks_per_ms;
+    double span = (double)(info.last_ts - info.first_ts) * ms_per_tick;
+    fprintf(stderr, "%" PRIu64 " records over %.3f ms", info.records, span);
+    if (stats.unknown)
+        fprintf(stderr, ", %" PRIu64 " of unknown kinds", stats.unknown);
+    fprintf(stderr, "\n\n%-4s %10s %10s %12s %10s %12s\n",
+            "cpu", "switches", "irqs", "irq ms", "syscalls", "syscall ms");
+    for (uint32_t cpu = 0; cpu < info.num_cpus; cpu++) {
+        fprintf(stderr, "%-4u %10" PRIu64 " %10" PRIu64 " %12.3f %10" PRIu64 " %12.3f\n", cpu,
+                stats.context_switches[cpu],
+                stats.irqs[cpu].count, (double)stats.irqs[cpu].ticks * ms_per_tick,
+                stats.syscalls_per_cpu[cpu].count,
+                (double)stats.syscalls_per_cpu[cpu].ticks * ms_per_tick);
+    }
+
+    std::vector<std::pair<uint32_t, Times>> syscalls(stats.syscalls.begin(),
+                                                     stats.syscalls.end());
+    std::sort(syscalls.begin(), syscalls.end(), [](const auto& a, const auto& b) {
+        return a.second.ticks > b.second.ticks;
+    });
+    fprintf(stderr, "\n%-28s %10s %12s %12s\n", "syscall", "calls", "total ms", "max us");
+    for (const auto& s : syscalls) {
+        fprintf(stderr, "%-28s %10" PRIu64 " %12.3f %12.1f\n",
+                info.name(info.syscall_names, "syscall", s.first).c_str(), s.second.count,
+                (double)s.second.ticks * ms_per_tick,
+                (double)s.second.max * ms_per_tick * 1000.0);
+    }
+}
+
+void usage(FILE* f) {
+    fprintf(f, "usage: ktracedump [options] <ktrace file>\n");
+    fprintf(f, "Decodes a ktrace dump, or a copy of a ktrace stream ring.\n");
+    fprintf(f, "Options:\n");
+    fprintf(f, " -o <file>       Write the output here (default stdout)\n");
+    fprintf(f, " -f <format>     json: Chrome trace events (default)\n");
+    fprintf(f, "                 text: one line per record\n");
+    fprintf(f, "                 none: no output, for use with -s\n");
+    fprintf(f, " -s              Print summary statistics to stderr\n");
+    fprintf(f, " -j <threads>    Decode with this many threads\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* out_path = nullptr;
+    Format format = Format::kJson;
+    bool print_summary = false;
+    unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    int c;
+    while ((c = getopt(argc, argv, "o:f:sj:h")) > 0) {
+        switch (c) {
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'f':
+            if (!strcmp(optarg, "json")) {
+                format = Format::kJson;
+            } else if (!strcmp(optarg, "text")) {
+                format = Format::kText;
+            } else if (!strcmp(optarg, "none")) {
+                format = Format::kNone;
+            } else {
+                fprintf(stderr, "ktracedump: unknown format '%s'\n", optarg);
+                usage(stderr);
+                return 1;
+            }
+            break;
+        case 's':
+            print_summary = true;
+            break;
+        case 'j':
+            num_threads = (unsigned)atoi(optarg);
+            if (num_threads == 0) {
+                fprintf(stderr, "ktracedump: bad -j value '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(stderr);
+        return 1;
+    }
+
+    const char* path = argv[optind];
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "ktracedump: cannot open '%s': %s\n", path, strerror(errno));
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    const uint8_t* data = nullptr;
+    if (size != 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "ktracedump: cannot map '%s': %s\n", path, strerror(errno));
+            return 1;
+        }
+        data = static_cast<const uint8_t*>(p);
+    }
+    close(fd);
+
+    // A copy of a stream ring is unwrapped into the records it holds.
+    std::vector<uint8_t> unwrapped;
+    if (size > KTRACE_STREAM_DATA_OFFSET && rd32(data) != TAG_VERSION) {
+        ktrace_stream_header_t hdr;
+        memcpy(&hdr, data, sizeof(hdr));
+        if (hdr.size != 0 && size == KTRACE_STREAM_DATA_OFFSET + (size_t)hdr.size &&
+            hdr.head >= hdr.tail && hdr.head - hdr.tail <= hdr.size) {
+            const uint8_t* ring = data + KTRACE_STREAM_DATA_OFFSET;
+            size_t start = (size_t)(hdr.tail % hdr.size);
+            size_t count = (size_t)(hdr.head - hdr.tail);
+            size_t first = std::min(count, (size_t)hdr.size - start);
+            unwrapped.assign(ring + start, ring + start + first);
+            unwrapped.insert(unwrapped.end(), ring, ring + (count - first));
+            if (hdr.dropped)
+                fprintf(stderr, "ktracedump: %" PRIu64 " records were dropped\n", hdr.dropped);
+            data = unwrapped.data();
+            size = unwrapped.size();
+        }
+    }
+
+    TraceInfo info;
+    bool complete = scan(data, size, &info);
+    if (info.ticks_per_ms == 0) {
+        fprintf(stderr, "ktracedump: no TICKS_PER_MS record, assuming nanoseconds\n");
+        info.ticks_per_ms = 1000000;
+    }
+    if (info.version != 0 && (info.version >> 16) != (KTRACE_VERSION >> 16))
+        fprintf(stderr, "ktracedump: unexpected version 0x%08x\n", info.version);
+
+    FILE* out = stdout;
+    if (out_path != nullptr && format != Format::kNone) {
+        out = fopen(out_path, "w");
+        if (out == nullptr) {
+            fprintf(stderr, "ktracedump: cannot create '%s': %s\n", out_path, strerror(errno));
+            return 1;
+        }
+    }
+    if (format == Format::kJson)
+        write_metadata(out, info);
+
+    // Workers decode at most a few chunks ahead of the writer, so that
+    // memory use does not grow with the size of the dump.
+    size_t num_chunks = info.chunks.size();
+    size_t window = 2 * num_threads;
+    std::vector<ChunkResult> results(num_chunks);
+    std::vector<bool> done(num_chunks);
+    std::mutex lock;
+    std::condition_variable cv;
+    size_t next = 0;
+    size_t written = 0;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> l(lock);
+                cv.wait(l, [&]() { return next >= num_chunks || next < written + window; });
+                if (next >= num_chunks)
+                    return;
+                i = next++;
+            }
+            Decoder decoder(info, format, data, &results[i]);
+            decoder.Decode(info.chunks[i]);
+            {
+                std::lock_guard<std::mutex> l(lock);
+                done[i] = true;
+            }
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < num_threads; i++)
+        threads.emplace_back(worker);
+
+    Stats stats;
+    std::vector<Dangling> open_irqs[kMaxCpus];
+    std::unordered_map<uint64_t, Dangling> open_syscalls;
+    for (size_t i = 0; i < num_chunks; i++) {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            cv.wait(l, [&]() { return done[i]; });
+        }
+        ChunkResult* result = &results[i];
+        fwrite(result->out.data(), 1, result->out.size(), out);
+        stats.merge(result->stats);
+        match_dangling(result, &stats, out, &open_irqs, &open_syscalls);
+        *result = ChunkResult();
+        {
+            std::lock_guard<std::mutex> l(lock);
+            written = i + 1;
+        }
+        cv.notify_all();
+    }
+    for (auto& t : threads)
+        t.join();
+
+    if (format == Format::kJson)
+        fprintf(out, "\n],\n\"displayTimeUnit\":\"ns\"}\n");
+    if (out != stdout)
+        fclose(out);
+
+    if (print_summary)
+        print_stats(info, stats);
+    return complete ? 0 : 1;
+}
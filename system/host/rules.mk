@@ -8,6 +8,7 @@ HOSTAPPS := \
 	$(LOCAL_DIR)/bootserver/rules.mk \
 	$(LOCAL_DIR)/fidl/rules.mk \
 	$(LOCAL_DIR)/kernel-buildsig/rules.mk \
+	$(LOCAL_DIR)/ktracedump/rules.mk \
 	$(LOCAL_DIR)/loglistener/rules.mk \
 	$(LOCAL_DIR)/mdi/rules.mk \
 	$(LOCAL_DIR)/merkleroot/rules.mk \
@@ -88,5 +88,33 @@ enum {
 #define KTRACE_ACTION_STOP      2 // options ignored
 #define KTRACE_ACTION_REWIND    3 // options ignored
 #define KTRACE_ACTION_NEW_PROBE 4 // options ignored, ptr = name
+#define KTRACE_ACTION_START_CIRCULAR 5 // as START, but keep only the newest records
+
+// Ring mapped by mx_ktrace_stream(). The kernel appends records, in the
+// format mx_ktrace_read() returns, to the data that starts at
+// KTRACE_STREAM_DATA_OFFSET in the mapping, wrapping around from its end to
+// its start. A record may be split across the wrap. head and tail count
+// bytes since the stream started, so that the byte at count n is at
+// n % size in the data. The kernel only writes head, and the consumer
+// only writes tail, after taking the records before it.
+#define KTRACE_STREAM_DATA_OFFSET 4096
+#define KTRACE_STREAM_MAX_SIZE    (64u << 20)
+
+typedef struct ktrace_stream_header {
+    uint64_t head;
+    uint64_t reserved0[7];
+    uint64_t tail;
+    uint64_t reserved1[7];
+
+    // size of the data, and the fill level from which the
+    // stream's event is signaled
+    uint32_t size;
+    uint32_t watermark;
+
+    // records dropped because a cpu's share of the trace
+    // buffer, or the share names go to, filled up before
+    // they could be streamed
+    uint64_t dropped;
+} ktrace_stream_header_t;
 
 __END_CDECLS
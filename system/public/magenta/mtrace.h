@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <magenta/types.h>
+
 __BEGIN_CDECLS
 
 // mtrace_control() can operate on a range of features, for now just IPT.
@@ -17,6 +19,7 @@ __BEGIN_CDECLS
 // before it's useful; it's here in the interests of hackability in the
 // interim.
 #define MTRACE_KIND_IPT 0
+#define MTRACE_KIND_PROFILE 1
 
 // Actions for perf_control
 
@@ -45,4 +48,49 @@ __BEGIN_CDECLS
 
 #define MTRACE_IPT_OPTIONS_CPU(options) ((options) & MTRACE_IPT_OPTIONS_CPU_MASK)
 
+// Actions for the sampling profiler, MTRACE_KIND_PROFILE.
+// It takes a sample of each cpu at a fixed frequency from the kernel timer,
+// so it needs no performance counters.
+
+// Start sampling. |arg| is a uint32_t, the frequency in Hz. Any samples
+// left from before are discarded.
+#define MTRACE_PROFILE_START 0
+
+// Stop sampling. The samples taken can still be read.
+#define MTRACE_PROFILE_STOP 1
+
+// Read, and remove, the oldest samples of the cpu in |options|. |arg| is an
+// array of mx_mtrace_profile_sample_t. If it is not filled the sample after
+// the last one read has a |time| of zero.
+#define MTRACE_PROFILE_READ_CPU 2
+
+// Free the sample buffers. Sampling must be stopped.
+#define MTRACE_PROFILE_FREE 3
+
+#define MTRACE_PROFILE_MIN_FREQUENCY 1u
+#define MTRACE_PROFILE_MAX_FREQUENCY 10000u
+
+// The most pcs kept for one sample.
+#define MTRACE_PROFILE_MAX_PCS 30u
+
+// The pcs are user addresses rather than kernel addresses.
+#define MTRACE_PROFILE_SAMPLE_USER (1u << 0)
+
+typedef struct mx_mtrace_profile_sample {
+    mx_time_t time;
+    // The process and thread that were interrupted, or 0 for a kernel thread.
+    mx_koid_t pid;
+    mx_koid_t tid;
+    uint32_t cpu;
+    // Bitwise OR of MTRACE_PROFILE_SAMPLE_* values.
+    uint32_t flags;
+    uint32_t num_pcs;
+    // The number of samples lost just before this one because the buffer
+    // was full.
+    uint32_t dropped;
+    // The interrupted pc, followed by the return addresses found by
+    // following the frame pointers, innermost first.
+    uint64_t pcs[MTRACE_PROFILE_MAX_PCS];
+} mx_mtrace_profile_sample_t;
+
 __END_CDECLS
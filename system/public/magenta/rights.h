@@ -80,3 +80,9 @@
   (MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ | MX_RIGHT_WRITE | \
    MX_RIGHT_EXECUTE | MX_RIGHT_MAP | MX_RIGHT_GET_PROPERTY |                 \
    MX_RIGHT_SET_PROPERTY | MX_RIGHT_SIGNAL)
+
+#define MX_DEFAULT_WAIT_SET_RIGHTS \
+  (MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ | MX_RIGHT_WRITE)
+
+#define MX_DEFAULT_CALL_RING_RIGHTS \
+  (MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ | MX_RIGHT_WRITE)
@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <magenta/types.h>
+
+__BEGIN_CDECLS
+
+// Largest number of entries of a call ring.
+#define MX_CALL_RING_MAX_ENTRIES    1024u
+
+// Byte offset of the submission queue from the start of a mapped ring. The
+// completion queue follows at mx_call_ring_t::cq_offset.
+#define MX_CALL_RING_SQ_OFFSET      4096u
+
+// mx_call_sqe_t::opcode values. The arguments of each operation are those
+// of the syscall of the same name, in the same order, in |args|.
+#define MX_CALL_OP_NOP                  0u
+#define MX_CALL_OP_CHANNEL_WRITE        1u
+#define MX_CALL_OP_OBJECT_SIGNAL        2u
+#define MX_CALL_OP_OBJECT_SIGNAL_PEER   3u
+#define MX_CALL_OP_PORT_QUEUE           4u
+#define MX_CALL_OP_VMO_READ             5u
+#define MX_CALL_OP_VMO_WRITE            6u
+
+// A submission queue entry.
+typedef struct mx_call_sqe {
+    uint32_t opcode;
+    uint32_t flags;                 // must be zero
+    uint64_t user_data;             // copied to the completion
+    uint64_t args[6];
+} mx_call_sqe_t;
+
+// A completion queue entry.
+typedef struct mx_call_cqe {
+    uint64_t user_data;
+    mx_status_t status;
+    uint32_t reserved;
+} mx_call_cqe_t;
+
+// The control block at the start of a mapped call ring. The submission and
+// completion queues both have |entries| slots, and the four indices are
+// free-running counters; slot n of a queue holds entry n & (entries - 1).
+// Userspace produces submissions by advancing |sq_tail| and consumes
+// completions by advancing |cq_head|, in both cases with a release store
+// after writing or reading the entry. The kernel advances the other two.
+typedef struct mx_call_ring {
+    uint32_t entries;               // read only
+    uint32_t cq_offset;             // read only
+    uint32_t reserved0[14];
+    uint32_t sq_head;               // own cache line; written by the kernel
+    uint32_t reserved1[15];
+    uint32_t sq_tail;               // own cache line; written by userspace
+    uint32_t reserved2[15];
+    uint32_t cq_head;               // own cache line; written by userspace
+    uint32_t reserved3[15];
+    uint32_t cq_tail;               // own cache line; written by the kernel
+    uint32_t reserved4[15];
+} mx_call_ring_t;
+
+__END_CDECLS
@@ -0,0 +1,47 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <magenta/types.h>
+
+__BEGIN_CDECLS
+
+// mx_fifo_create() options
+#define MX_FIFO_SHARED              1u
+
+// mx_fifo_map() options
+#define MX_FIFO_MAP_READ_RING       0u  // the ring this endpoint reads from
+#define MX_FIFO_MAP_WRITE_RING      1u  // the ring this endpoint writes to
+
+// Largest elem_count * elem_size of a fifo created with MX_FIFO_SHARED.
+#define MX_FIFO_MAX_SHARED_SIZE     (256u * 1024u)
+
+// Byte offset of the first element from the start of a mapped ring.
+#define MX_FIFO_RING_DATA_OFFSET    4096u
+
+// mx_fifo_ring_t::flags bits. The kernel never reads or writes these;
+// they let each side of a shared ring learn whether the other side is
+// about to sleep and so needs a call to mx_fifo_doorbell().
+#define MX_FIFO_RING_READER_WAITING 1u
+#define MX_FIFO_RING_WRITER_WAITING 2u
+
+// The control block at the start of a shared fifo ring. |head| and |tail|
+// are free-running element counters; the slot for counter n is at
+// MX_FIFO_RING_DATA_OFFSET + (n & (elem_count - 1)) * elem_size. Only the
+// writer advances |head| and only the reader advances |tail|, each with a
+// release store after the element itself has been written or read.
+typedef struct mx_fifo_ring {
+    uint32_t elem_count;            // read only
+    uint32_t elem_size;             // read only
+    uint32_t reserved0[14];
+    uint32_t head;                  // own cache line; written by the writer
+    uint32_t reserved1[15];
+    uint32_t tail;                  // own cache line; written by the reader
+    uint32_t reserved2[15];
+    uint32_t flags;                 // MX_FIFO_RING_* bits
+    uint32_t reserved3[15];
+} mx_fifo_ring_t;
+
+__END_CDECLS
@@ -30,6 +30,8 @@ typedef enum {
     MX_INFO_CPU_STATS                  = 16, // mx_info_cpu_stats_t[n]
     MX_INFO_KMEM_STATS                 = 17, // mx_info_kmem_stats_t[1]
     MX_INFO_RESOURCE                   = 18, // mx_info_resource_t[1]
+    MX_INFO_LOCK_STATS                 = 19, // mx_info_lock_stats_t[n]
+    MX_INFO_SYSCALL_STATS              = 20, // mx_info_syscall_stats_t[n]
     MX_INFO_LAST
 } mx_object_info_topic_t;
 
@@ -53,6 +55,8 @@ typedef enum {
     MX_OBJ_TYPE_GUEST               = 20,
     MX_OBJ_TYPE_VCPU                = 21,
     MX_OBJ_TYPE_TIMER               = 22,
+    MX_OBJ_TYPE_WAIT_SET            = 23,
+    MX_OBJ_TYPE_CALL_RING           = 24,
     MX_OBJ_TYPE_LAST
 } mx_obj_type_t;
 
@@ -348,6 +352,70 @@ typedef struct mx_info_resource {
 
 #define MX_INFO_CPU_STATS_FLAG_ONLINE       (1u<<0)
 
+// Values and types used by MX_INFO_LOCK_STATS.
+
+#define MX_INFO_LOCK_KIND_MUTEX             1u
+#define MX_INFO_LOCK_KIND_SPIN              2u
+
+// Set if |key| is the call site acquiring the locks of the class, rather
+// than the address of its one lock.
+#define MX_INFO_LOCK_STATS_FLAG_SITE        (1u<<0)
+
+// Histogram bucket 0 counts times below 256ns, bucket n counts times from
+// 128ns << n up to 256ns << n, and the last bucket counts everything above.
+#define MX_INFO_LOCK_STATS_BUCKETS          16u
+
+// The number of top contending call sites kept for each class.
+#define MX_INFO_LOCK_STATS_SITES            4u
+
+typedef struct mx_info_lock_stats {
+    // Kernel address of the lock or of the call site, see
+    // MX_INFO_LOCK_STATS_FLAG_SITE.
+    uint64_t key;
+    // One of MX_INFO_LOCK_KIND_*.
+    uint32_t kind;
+    // Bitwise OR of MX_INFO_LOCK_STATS_FLAG_* values.
+    uint32_t flags;
+
+    uint64_t acquisitions;
+    // Acquisitions that found the lock held.
+    uint64_t contentions;
+
+    // Time spent waiting for and holding the locks.
+    mx_duration_t wait_total;
+    mx_duration_t wait_max;
+    mx_duration_t hold_total;
+    mx_duration_t hold_max;
+    // Only contended acquisitions are counted in the wait histogram.
+    uint64_t wait_histogram[MX_INFO_LOCK_STATS_BUCKETS];
+    uint64_t hold_histogram[MX_INFO_LOCK_STATS_BUCKETS];
+
+    // The call sites that most often found the locks held, and how often
+    // they did. Unused entries are 0.
+    uint64_t contending_sites[MX_INFO_LOCK_STATS_SITES];
+    uint64_t contending_counts[MX_INFO_LOCK_STATS_SITES];
+} mx_info_lock_stats_t;
+
+// Latency histogram buckets for mx_info_syscall_stats_t. Bucket 0 counts
+// calls that took under 256ns, bucket n those that took [128ns<<n, 256ns<<n),
+// and the last bucket everything longer.
+#define MX_INFO_SYSCALL_STATS_BUCKETS       16u
+
+// One record per syscall made since counting was started with
+// MX_PROP_SYSCALL_STATS. Syscalls never made are left out.
+typedef struct mx_info_syscall_stats {
+    // The syscall number, and its name without the mx_ prefix.
+    uint32_t id;
+    uint32_t reserved;
+    char name[MX_MAX_NAME_LEN];
+
+    uint64_t count;
+    // Time spent in the kernel by these calls.
+    mx_duration_t total_time;
+    mx_duration_t max_time;
+    uint64_t histogram[MX_INFO_SYSCALL_STATS_BUCKETS];
+} mx_info_syscall_stats_t;
+
 // Object properties.
 
 // Argument is a uint32_t.
@@ -369,6 +437,11 @@ typedef struct mx_info_resource {
 // Argument is an mx_job_importance_t value.
 #define MX_PROP_JOB_IMPORTANCE             7u
 
+// Argument is a uint32_t, nonzero while the syscalls made by the threads of
+// a process, or of every process under a job, are being counted. See
+// MX_INFO_SYSCALL_STATS.
+#define MX_PROP_SYSCALL_STATS               8u
+
 // Describes how important a job is.
 typedef int32_t mx_job_importance_t;
 
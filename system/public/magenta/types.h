@@ -148,6 +148,9 @@ typedef uint32_t mx_signals_t;
 // Timer
 #define MX_TIMER_SIGNALED           __MX_OBJECT_SIGNALED
 
+// Wait set
+#define MX_WAITSET_READABLE         __MX_OBJECT_READABLE
+
 // global kernel object id.
 typedef uint64_t mx_koid_t;
 #define MX_KOID_INVALID ((uint64_t) 0)
@@ -167,6 +170,23 @@ typedef struct {
     uint32_t rd_num_handles;
 } mx_channel_call_args_t;
 
+// Message descriptor for mx_channel_read_many() and mx_channel_write_many().
+// On read, |num_bytes| and |num_handles| give the buffer capacities and are
+// overwritten with the actual size of the message received.
+typedef struct {
+    void* bytes;
+    mx_handle_t* handles;
+    uint32_t num_bytes;
+    uint32_t num_handles;
+} mx_channel_msg_t;
+
+// Buffer descriptor for mx_socket_writev() and mx_socket_readv(), and
+// datagram descriptor for mx_socket_write_many() and mx_socket_read_many().
+typedef struct {
+    void* buffer;
+    size_t size;
+} mx_iovec_t;
+
 // Structure for mx_object_wait_many():
 typedef struct {
     mx_handle_t handle;
@@ -174,6 +194,13 @@ typedef struct {
     mx_signals_t pending;
 } mx_wait_item_t;
 
+// Structure for mx_waitset_wait():
+typedef struct {
+    uint64_t cookie;
+    mx_status_t status;
+    mx_signals_t observed;
+} mx_waitset_result_t;
+
 typedef uint32_t mx_rights_t;
 #define MX_RIGHT_NONE             ((mx_rights_t)0u)
 #define MX_RIGHT_DUPLICATE        ((mx_rights_t)1u << 0)
@@ -247,14 +274,27 @@ typedef int64_t mx_rel_off_t;
 
 // Channel options and limits.
 #define MX_CHANNEL_READ_MAY_DISCARD         1u
+#define MX_CHANNEL_WRITE_MOVE_PAGES         1u
 
 #define MX_CHANNEL_MAX_MSG_BYTES            65536u
+#define MX_CHANNEL_MAX_MOVED_MSG_BYTES      1048576u
 #define MX_CHANNEL_MAX_MSG_HANDLES          64u
 
+#define MX_CHANNEL_MAX_BATCH                16u
+
 // Socket options and limits.
 #define MX_SOCKET_HALF_CLOSE                1u
 #define MX_SOCKET_STREAM                    0u
 #define MX_SOCKET_DATAGRAM                  1u
+#define MX_SOCKET_WRITE_MOVE_PAGES          2u
+
+#define MX_SOCKET_MAX_IOVECS                16u
+#define MX_SOCKET_MAX_BATCH                 16u
+
+// Wait set options and limits.
+#define MX_WAITSET_EDGE_TRIGGERED           1u
+
+#define MX_WAITSET_MAX_BATCH                16u
 
 // Flags which can be used to to control cache policy for APIs which map memory.
 typedef enum {
@@ -6,6 +6,7 @@
 #include <errno.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,7 +25,8 @@ void argument_error(const char* argv0, const char* message) {
 
 void duplicate_handles(uint32_t n, mx_handle_t src, mx_handle_t* dest) {
     for (uint32_t i = 0; i < n; i++) {
-        assert(mx_handle_duplicate(src, MX_RIGHT_SAME_RIGHTS, &dest[i]) == 0);
+        __UNUSED mx_status_t status = mx_handle_duplicate(src, MX_RIGHT_SAME_RIGHTS, &dest[i]);
+        assert(status == MX_OK);
     }
 }
 
@@ -34,6 +36,126 @@ struct TestArgs {
     uint32_t queue;
 };
 
+struct CallServerArgs {
+    mx_handle_t channel;
+    uint32_t size;
+    uint32_t handles;
+};
+
+// Echoes every message received on |channel| back to the caller until the
+// other end is closed.
+void* call_server(void* arg) {
+    const CallServerArgs* args = static_cast<const CallServerArgs*>(arg);
+    __UNUSED mx_status_t status;
+
+    mxtl::unique_ptr<uint8_t[]> data(new uint8_t[args->size]);
+    mxtl::unique_ptr<mx_handle_t[]> handles;
+    if (args->handles)
+        handles.reset(new mx_handle_t[args->handles]);
+
+    for (;;) {
+        mx_signals_t pending;
+        status = mx_object_wait_one(args->channel, MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED,
+                                    MX_TIME_INFINITE, &pending);
+        assert(status == MX_OK);
+        if (!(pending & MX_CHANNEL_READABLE))
+            break;
+
+        uint32_t r_size = args->size;
+        uint32_t r_handles = args->handles;
+        status = mx_channel_read(args->channel, 0u, data.get(), handles.get(), r_size,
+                                 r_handles, &r_size, &r_handles);
+        assert(status == MX_OK);
+
+        // The reply carries the same transaction id, so echoing is enough.
+        status = mx_channel_write(args->channel, 0u, data.get(), r_size, handles.get(),
+                                  r_handles);
+        assert(status == MX_OK);
+    }
+    return nullptr;
+}
+
+// Measures mx_channel_call() round trips against a server thread.
+void do_call_test(uint32_t duration, const TestArgs& test_args) {
+    __UNUSED mx_status_t status;
+
+    uint64_t duration_ns = duration * 1000000000ull;
+
+    mx_handle_t mp[2] = {MX_HANDLE_INVALID, MX_HANDLE_INVALID};
+    status = mx_channel_create(0u, &mp[0], &mp[1]);
+    assert(status == MX_OK);
+
+    // Each message starts with the transaction id, so it's at least that big.
+    uint32_t size = mxtl::max(test_args.size, static_cast<uint32_t>(sizeof(mx_txid_t)));
+
+    CallServerArgs server_args = {mp[1], size, test_args.handles};
+    pthread_t server;
+    __UNUSED int r = pthread_create(&server, nullptr, call_server, &server_args);
+    assert(r == 0);
+
+    mx_handle_t event;
+    status = mx_event_create(0u, &event);
+    assert(status == MX_OK);
+    mxtl::unique_ptr<uint8_t[]> wr_data(new uint8_t[size]);
+    mxtl::unique_ptr<uint8_t[]> rd_data(new uint8_t[size]);
+    for (uint32_t i = 0; i < size; i++)
+        wr_data[i] = static_cast<uint8_t>(i);
+    mxtl::unique_ptr<mx_handle_t[]> handles;
+    if (test_args.handles)
+        handles.reset(new mx_handle_t[test_args.handles]);
+
+    mx_channel_call_args_t args = {};
+    args.wr_bytes = wr_data.get();
+    args.wr_handles = handles.get();
+    args.rd_bytes = rd_data.get();
+    args.rd_handles = handles.get();
+    args.wr_num_bytes = size;
+    args.wr_num_handles = test_args.handles;
+    args.rd_num_bytes = size;
+    args.rd_num_handles = test_args.handles;
+
+    duplicate_handles(test_args.handles, event, handles.get());
+
+    static constexpr uint32_t big_it_size = 10000;
+    uint64_t big_its = 0;
+    uint64_t start_ns = mx_time_get(MX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        big_its++;
+        for (uint32_t i = 0; i < big_it_size; i++) {
+            uint32_t r_size, r_handles;
+            status = mx_channel_call(mp[0], 0u, MX_TIME_INFINITE, &args, &r_size, &r_handles,
+                                     nullptr);
+            assert(status == MX_OK);
+            assert(r_size == size);
+            assert(r_handles == test_args.handles);
+        }
+
+        end_ns = mx_time_get(MX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    status = mx_handle_close(mp[0]);
+    assert(status == MX_OK);
+    r = pthread_join(server, nullptr);
+    assert(r == 0);
+
+    for (uint32_t i = 0; i < test_args.handles; i++) {
+        status = mx_handle_close(handles[i]);
+        assert(status == MX_OK);
+    }
+    status = mx_handle_close(event);
+    assert(status == MX_OK);
+    status = mx_handle_close(mp[1]);
+    assert(status == MX_OK);
+
+    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
+    double its_per_second = static_cast<double>(big_its) * big_it_size / real_duration;
+    printf("call %" PRIu32 " bytes, %" PRIu32 " handles: %.0f round trips/second\n",
+           size, test_args.handles, its_per_second);
+}
+
 void do_test(uint32_t duration, const TestArgs& test_args) {
     __UNUSED mx_status_t status;
 
@@ -46,7 +168,8 @@ void do_test(uint32_t duration, const TestArgs& test_args) {
 
     // We'll send/receive duplicates of this handle.
     mx_handle_t event;
-    assert(mx_event_create(0u, &event) == MX_OK);
+    status = mx_event_create(0u, &event);
+    assert(status == MX_OK);
 
     // Storage space for our messages' stuff.
     mxtl::unique_ptr<uint8_t[]> data;
@@ -122,6 +245,7 @@ int main(int argc, char** argv) {
         "  -h    show help (this)\n"
         "  -o    run single test (default)\n"
         "  -s    run suite (ignores -S/-H/-Q)\n"
+        "  -c    measure mx_channel_call() round trips (ignores -Q)\n"
         "  -n N  set test repetition count to N (default: 1)\n"
         "  -d N  set test duration to N seconds (default: 5)\n"
         "  -S N  set message size to N bytes (default: 10)\n"
@@ -129,6 +253,7 @@ int main(int argc, char** argv) {
         "  -Q N  set message pre-queue count to N messages (default: 0)\n";
 
     bool run_suite = false;  // -o/-s
+    bool call = false;       // -c
     uint32_t duration = 5;   // -d
     uint32_t repeats = 1;    // -n
     // Ignored when running a suite:
@@ -139,7 +264,7 @@ int main(int argc, char** argv) {
     };
 
     int opt;
-    while ((opt = getopt(argc, argv, "+hosn:d:S:H:Q:")) != -1) {
+    while ((opt = getopt(argc, argv, "+hoscn:d:S:H:Q:")) != -1) {
         // Our option values are always unsigned numbers.
         uint32_t value = 0;
         if (optarg) {
@@ -161,6 +286,9 @@ int main(int argc, char** argv) {
             case 's':
                 run_suite = true;
                 break;
+            case 'c':
+                call = true;
+                break;
             case 'n':
                 assert(optarg);
                 repeats = value;
@@ -215,8 +343,16 @@ int main(int argc, char** argv) {
                 {100, 0, 1},
                 {1000, 0, 1},
             };
-            for (size_t i = 0; i < mxtl::count_of(suite); i++)
-                do_test(duration, suite[i]);
+            for (size_t i = 0; i < mxtl::count_of(suite); i++) {
+                if (call) {
+                    if (suite[i].queue == 0u)
+                        do_call_test(duration, suite[i]);
+                } else {
+                    do_test(duration, suite[i]);
+                }
+            }
+        } else if (call) {
+            do_call_test(duration, test_args);
         } else {
             do_test(duration, test_args);
         }
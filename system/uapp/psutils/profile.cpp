@@ -0,0 +1,277 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// profile samples what every cpu is running at a fixed frequency and prints
+// the stacks seen, one line per distinct stack with the number of times it
+// was seen, in the "folded" format taken by flame graph tools:
+//
+//   <process>;<outermost frame>;...;<innermost frame> <count>
+//
+// User frames are printed as <dso>+0x<offset>, which can be resolved with
+// the debug files of the dsos. Kernel frames are printed as addresses.
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <magenta/mtrace.h>
+#include <magenta/status.h>
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/object.h>
+#include <task-utils/get.h>
+
+#include "dso-list.h"
+#include "resources.h"
+
+namespace {
+
+// How often the kernel's sample buffers are emptied. They hold a couple of
+// seconds of samples at the highest frequency.
+constexpr mx_duration_t kDrainPeriod = MX_MSEC(100);
+
+constexpr size_t kReadBatch = 64;
+
+// What we know about a process seen in the samples. The dso list is
+// fetched when the process is first seen, so that it can still be named
+// if it has exited by the end.
+struct Process {
+    Process* next;
+    mx_koid_t koid;
+    char name[MX_MAX_NAME_LEN];
+    dsoinfo_t* dsos;
+};
+
+Process* processes;
+
+Process* get_process(mx_koid_t koid) {
+    for (Process* p = processes; p != nullptr; p = p->next) {
+        if (p->koid == koid)
+            return p;
+    }
+
+    Process* p = static_cast<Process*>(calloc(1, sizeof(Process)));
+    if (p == nullptr)
+        return nullptr;
+    p->koid = koid;
+    snprintf(p->name, sizeof(p->name), "pid:%" PRIu64, koid);
+
+    mx_obj_type_t type;
+    mx_handle_t h;
+    if (get_task_by_koid(koid, &type, &h) == MX_OK) {
+        if (type == MX_OBJ_TYPE_PROCESS) {
+            char name[MX_MAX_NAME_LEN];
+            if (mx_object_get_property(h, MX_PROP_NAME, name, sizeof(name)) == MX_OK &&
+                name[0] != '\0')
+                strlcpy(p->name, name, sizeof(p->name));
+            p->dsos = dso_fetch_list(h, p->name);
+        }
+        mx_handle_close(h);
+    }
+
+    p->next = processes;
+    processes = p;
+    return p;
+}
+
+// A distinct folded stack and the number of times it was seen.
+struct Stack {
+    Stack* next;
+    uint64_t count;
+    char folded[];
+};
+
+constexpr size_t kNumBuckets = 4096;
+Stack* stacks[kNumBuckets];
+
+size_t hash_string(const char* s) {
+    // FNV-1a
+    size_t h = 2166136261u;
+    for (; *s != '\0'; s++)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+void count_stack(const char* folded) {
+    Stack** bucket = &stacks[hash_string(folded) % kNumBuckets];
+    for (Stack* s = *bucket; s != nullptr; s = s->next) {
+        if (strcmp(s->folded, folded) == 0) {
+            s->count++;
+            return;
+        }
+    }
+
+    size_t len = strlen(folded);
+    Stack* s = static_cast<Stack*>(malloc(sizeof(Stack) + len + 1));
+    if (s == nullptr)
+        return;
+    s->count = 1;
+    memcpy(s->folded, folded, len + 1);
+    s->next = *bucket;
+    *bucket = s;
+}
+
+struct Totals {
+    uint64_t samples;
+    uint64_t user_samples;
+    uint64_t dropped;
+};
+
+Totals totals;
+
+void add_frame(char* buf, size_t size, size_t* len, const Process* p, bool user, uint64_t pc) {
+    if (*len >= size)
+        return;
+    char* out = buf + *len;
+    size_t avail = size - *len;
+    int n;
+    const dsoinfo_t* dso = (user && p != nullptr) ? dso_lookup(p->dsos, pc) : nullptr;
+    if (dso != nullptr)
+        n = snprintf(out, avail, ";%s+0x%" PRIx64, dso->name, pc - dso->base);
+    else
+        n = snprintf(out, avail, ";0x%" PRIx64, pc);
+    *len += (n < 0) ? 0 : (size_t)n;
+}
+
+void process_sample(const mx_mtrace_profile_sample_t* sample) {
+    bool user = (sample->flags & MTRACE_PROFILE_SAMPLE_USER) != 0;
+    totals.samples++;
+    if (user)
+        totals.user_samples++;
+    totals.dropped += sample->dropped;
+
+    Process* p = sample->pid != 0 ? get_process(sample->pid) : nullptr;
+
+    char folded[4096];
+    size_t len = (size_t)snprintf(folded, sizeof(folded), "%s",
+                                  p != nullptr ? p->name : "kernel");
+    // Kernel frames of a user thread sit under a marker frame.
+    if (!user && p != nullptr)
+        len += (size_t)snprintf(folded + len, sizeof(folded) - len, ";[kernel]");
+
+    uint32_t num_pcs = sample->num_pcs;
+    if (num_pcs > MTRACE_PROFILE_MAX_PCS)
+        num_pcs = MTRACE_PROFILE_MAX_PCS;
+    for (uint32_t i = num_pcs; i > 0; i--)
+        add_frame(folded, sizeof(folded), &len, p, user, sample->pcs[i - 1]);
+
+    count_stack(folded);
+}
+
+mx_status_t drain(mx_handle_t root, uint32_t num_cpus) {
+    static mx_mtrace_profile_sample_t samples[kReadBatch];
+
+    for (uint32_t cpu = 0; cpu < num_cpus; cpu++) {
+        for (;;) {
+            mx_status_t status = mx_mtrace_control(root, MTRACE_KIND_PROFILE,
+                                                   MTRACE_PROFILE_READ_CPU, cpu,
+                                                   samples, sizeof(samples));
+            if (status != MX_OK) {
+                fprintf(stderr, "reading cpu %u samples: %d (%s)\n",
+                        cpu, status, mx_status_get_string(status));
+                return status;
+            }
+            size_t i = 0;
+            for (; i < kReadBatch && samples[i].time != 0; i++)
+                process_sample(&samples[i]);
+            if (i < kReadBatch)
+                break;
+        }
+    }
+    return MX_OK;
+}
+
+void print_help(FILE* f) {
+    fprintf(f, "Usage: profile [options]\n");
+    fprintf(f, "Samples the stacks running on every cpu and prints them in the\n");
+    fprintf(f, "folded format taken by flame graph tools.\n");
+    fprintf(f, "Options:\n");
+    fprintf(f, " -f <hz>         Samples per second per cpu (default 1000)\n");
+    fprintf(f, " -d <seconds>    How long to sample for (default 5 seconds)\n");
+    fprintf(f, "\nOnly code built with frame pointers shows more than its innermost frame.\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t frequency = 1000;
+    mx_duration_t duration = MX_SEC(5);
+
+    int c;
+    while ((c = getopt(argc, argv, "f:d:h")) > 0) {
+        switch (c) {
+        case 'f':
+            frequency = (uint32_t)atoi(optarg);
+            if (frequency < MTRACE_PROFILE_MIN_FREQUENCY ||
+                frequency > MTRACE_PROFILE_MAX_FREQUENCY) {
+                fprintf(stderr, "Bad -f value '%s'\n", optarg);
+                print_help(stderr);
+                return 1;
+            }
+            break;
+        case 'd':
+            duration = MX_SEC(atoi(optarg));
+            if (duration == 0) {
+                fprintf(stderr, "Bad -d value '%s'\n", optarg);
+                print_help(stderr);
+                return 1;
+            }
+            break;
+        case 'h':
+            print_help(stdout);
+            return 0;
+        default:
+            fprintf(stderr, "Unknown option\n");
+            print_help(stderr);
+            return 1;
+        }
+    }
+    if (optind != argc) {
+        print_help(stderr);
+        return 1;
+    }
+
+    mx_handle_t root;
+    mx_status_t status = get_root_resource(&root);
+    if (status != MX_OK)
+        return 1;
+
+    uint32_t num_cpus = mx_system_get_num_cpus();
+    status = mx_mtrace_control(root, MTRACE_KIND_PROFILE, MTRACE_PROFILE_START, 0,
+                               &frequency, sizeof(frequency));
+    if (status != MX_OK) {
+        fprintf(stderr, "cannot start profiling: %d (%s)\n",
+                status, mx_status_get_string(status));
+        mx_handle_close(root);
+        return 1;
+    }
+
+    mx_time_t end = mx_deadline_after(duration);
+    while (status == MX_OK && mx_time_get(MX_CLOCK_MONOTONIC) < end) {
+        mx_nanosleep(mx_deadline_after(kDrainPeriod));
+        status = drain(root, num_cpus);
+    }
+
+    mx_mtrace_control(root, MTRACE_KIND_PROFILE, MTRACE_PROFILE_STOP, 0, nullptr, 0);
+    if (status == MX_OK)
+        status = drain(root, num_cpus);
+    mx_mtrace_control(root, MTRACE_KIND_PROFILE, MTRACE_PROFILE_FREE, 0, nullptr, 0);
+    mx_handle_close(root);
+
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        for (const Stack* s = stacks[i]; s != nullptr; s = s->next)
+            printf("%s %" PRIu64 "\n", s->folded, s->count);
+    }
+    fprintf(stderr, "%" PRIu64 " samples (%" PRIu64 " in user mode), %" PRIu64 " dropped\n",
+            totals.samples, totals.user_samples, totals.dropped);
+
+    for (Process* p = processes; p != nullptr;) {
+        Process* next = p->next;
+        dso_free_list(p->dsos);
+        free(p);
+        p = next;
+    }
+    return status == MX_OK ? 0 : 1;
+}
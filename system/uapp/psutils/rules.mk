@@ -193,3 +193,49 @@ MODULE_STATIC_LIBS := \
     system/ulib/pretty
 
 include make/module.mk
+
+
+MODULE := $(LOCAL_DIR).systop
+
+MODULE_TYPE := userapp
+
+MODULE_SRCS += $(LOCAL_DIR)/systop.c
+
+MODULE_NAME := systop
+
+MODULE_LIBS := \
+    system/ulib/mxio \
+    system/ulib/magenta \
+    system/ulib/c
+
+MODULE_STATIC_LIBS := \
+    system/ulib/task-utils
+
+include make/module.mk
+
+
+MODULE := $(LOCAL_DIR).profile
+
+MODULE_TYPE := userapp
+
+# The dso list code is shared with crashlogger.
+MODULE_SRCS += \
+    $(LOCAL_DIR)/profile.cpp \
+    $(LOCAL_DIR)/resources.c \
+    system/core/crashlogger/dso-list.cpp \
+    system/core/crashlogger/utils.cpp
+
+MODULE_NAME := profile
+
+MODULE_COMPILEFLAGS += -Isystem/core/crashlogger
+
+MODULE_LIBS := \
+    system/ulib/mxio \
+    system/ulib/magenta \
+    system/ulib/c
+
+MODULE_STATIC_LIBS := \
+    system/ulib/mxcpp \
+    system/ulib/task-utils
+
+include make/module.mk
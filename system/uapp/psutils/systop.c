@@ -0,0 +1,255 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <magenta/status.h>
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/object.h>
+#include <task-utils/get.h>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Comfortably more than the number of syscalls.
+#define MAX_SYSCALLS 512
+
+typedef struct {
+    mx_info_syscall_stats_t stats;
+    // The change since the previous report.
+    uint64_t count;
+    mx_duration_t total_time;
+    uint64_t histogram[MX_INFO_SYSCALL_STATS_BUCKETS];
+} syscall_entry_t;
+
+static syscall_entry_t entries[MAX_SYSCALLS];
+static size_t num_entries;
+
+// The upper bound of the histogram bucket |b|, in nanoseconds.
+static mx_duration_t bucket_limit(uint32_t b) {
+    return 256ull << b;
+}
+
+// An upper bound on the latency that |fraction| of the calls stayed under,
+// or 0 if it falls in the last, open ended, bucket.
+static mx_duration_t percentile(const syscall_entry_t* e, double fraction) {
+    uint64_t want = (uint64_t)((double)e->count * fraction + 0.5);
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < MX_INFO_SYSCALL_STATS_BUCKETS - 1; b++) {
+        seen += e->histogram[b];
+        if (seen >= want)
+            return bucket_limit(b);
+    }
+    return 0;
+}
+
+static syscall_entry_t* find_entry(uint32_t id) {
+    for (size_t i = 0; i < num_entries; i++) {
+        if (entries[i].stats.id == id)
+            return &entries[i];
+    }
+    if (num_entries == MAX_SYSCALLS)
+        return NULL;
+    syscall_entry_t* e = &entries[num_entries++];
+    memset(e, 0, sizeof(*e));
+    return e;
+}
+
+static mx_status_t update(mx_handle_t task) {
+    static mx_info_syscall_stats_t stats[MAX_SYSCALLS];
+    size_t actual, avail;
+    mx_status_t status = mx_object_get_info(task, MX_INFO_SYSCALL_STATS, stats, sizeof(stats),
+                                            &actual, &avail);
+    if (status != MX_OK) {
+        fprintf(stderr, "MX_INFO_SYSCALL_STATS returns %d (%s)\n",
+                status, mx_status_get_string(status));
+        return status;
+    }
+
+    for (size_t i = 0; i < num_entries; i++)
+        entries[i].count = 0;
+
+    for (size_t i = 0; i < actual; i++) {
+        syscall_entry_t* e = find_entry(stats[i].id);
+        if (e == NULL)
+            break;
+        e->count = stats[i].count - e->stats.count;
+        e->total_time = stats[i].total_time - e->stats.total_time;
+        for (uint32_t b = 0; b < MX_INFO_SYSCALL_STATS_BUCKETS; b++)
+            e->histogram[b] = stats[i].histogram[b] - e->stats.histogram[b];
+        e->stats = stats[i];
+    }
+    return MX_OK;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const syscall_entry_t* ea = a;
+    const syscall_entry_t* eb = b;
+    if (ea->total_time != eb->total_time)
+        return ea->total_time > eb->total_time ? -1 : 1;
+    if (ea->count != eb->count)
+        return ea->count > eb->count ? -1 : 1;
+    return 0;
+}
+
+static void print_duration(mx_duration_t ns) {
+    if (ns == 0)
+        printf(" %9s", "-");
+    else if (ns < MX_MSEC(10))
+        printf(" %7" PRIu64 "us", ns / MX_USEC(1));
+    else
+        printf(" %7" PRIu64 "ms", ns / MX_MSEC(1));
+}
+
+static void print_report(mx_time_t delay, int max_lines) {
+    qsort(entries, num_entries, sizeof(entries[0]), compare_entries);
+
+    printf("%-28s %9s %9s %9s %9s %9s %9s\n",
+           "syscall", "calls/s", "time", "avg", "p50", "p99", "max");
+    for (size_t i = 0; i < num_entries && (max_lines < 0 || (int)i < max_lines); i++) {
+        const syscall_entry_t* e = &entries[i];
+        if (e->count == 0)
+            break;
+        printf("%-28s %9" PRIu64, e->stats.name, e->count * MX_SEC(1) / delay);
+        print_duration(e->total_time);
+        print_duration(e->total_time / e->count);
+        print_duration(percentile(e, 0.5));
+        print_duration(percentile(e, 0.99));
+        // The maximum is since counting began, not just this period.
+        print_duration(e->stats.max_time);
+        printf("\n");
+    }
+    printf("\n");
+}
+
+static void print_help(FILE* f) {
+    fprintf(f, "Usage: systop [options] <koid>\n");
+    fprintf(f, "Shows the syscalls made by a process, or by every process under a job,\n");
+    fprintf(f, "ordered by the time spent in them.\n");
+    fprintf(f, "Options:\n");
+    fprintf(f, " -d <delay>      Delay in seconds (default 1 second)\n");
+    fprintf(f, " -n <times>      Run this many times and then exit\n");
+    fprintf(f, " -l <lines>      Show at most this many syscalls (default 20)\n");
+    fprintf(f, " -k              Keep counting after exiting\n");
+    fprintf(f, "\nColumns:\n");
+    fprintf(f, "\tcalls/s:     calls per second over the last period\n");
+    fprintf(f, "\ttime:        time spent in the kernel over the last period\n");
+    fprintf(f, "\tavg:         average time per call\n");
+    fprintf(f, "\tp50, p99:    upper bounds on the median and 99th percentile time\n");
+    fprintf(f, "\tmax:         the longest call since counting began\n");
+}
+
+int main(int argc, char** argv) {
+    mx_time_t delay = MX_SEC(1);
+    int num_loops = -1;
+    int max_lines = 20;
+    bool keep = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "d:n:l:kh")) > 0) {
+        switch (c) {
+            case 'd':
+                delay = MX_SEC(atoi(optarg));
+                if (delay == 0) {
+                    fprintf(stderr, "Bad -d value '%s'\n", optarg);
+                    print_help(stderr);
+                    return 1;
+                }
+                break;
+            case 'n':
+                num_loops = atoi(optarg);
+                if (num_loops == 0) {
+                    fprintf(stderr, "Bad -n value '%s'\n", optarg);
+                    print_help(stderr);
+                    return 1;
+                }
+                break;
+            case 'l':
+                max_lines = atoi(optarg);
+                break;
+            case 'k':
+                keep = true;
+                break;
+            case 'h':
+                print_help(stdout);
+                return 0;
+            default:
+                fprintf(stderr, "Unknown option\n");
+                print_help(stderr);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        print_help(stderr);
+        return 1;
+    }
+
+    mx_koid_t koid = strtoull(argv[optind], NULL, 0);
+    mx_obj_type_t type;
+    mx_handle_t task;
+    mx_status_t status = get_task_by_koid(koid, &type, &task);
+    if (status != MX_OK) {
+        fprintf(stderr, "no task %" PRIu64 ": %s\n", koid, mx_status_get_string(status));
+        return 1;
+    }
+    if (type != MX_OBJ_TYPE_PROCESS && type != MX_OBJ_TYPE_JOB) {
+        fprintf(stderr, "%" PRIu64 " is not a process or job\n", koid);
+        mx_handle_close(task);
+        return 1;
+    }
+
+    // Leave counting as it was found, unless asked to keep it on.
+    uint32_t was_counting = 0;
+    mx_object_get_property(task, MX_PROP_SYSCALL_STATS, &was_counting, sizeof(was_counting));
+    uint32_t on = 1;
+    status = mx_object_set_property(task, MX_PROP_SYSCALL_STATS, &on, sizeof(on));
+    if (status != MX_OK) {
+        fprintf(stderr, "cannot count syscalls: %s\n", mx_status_get_string(status));
+        mx_handle_close(task);
+        return 1;
+    }
+
+    // set stdin to non blocking so we can intercept ctrl-c.
+    // TODO: remove once ctrl-c works in the shell
+    fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
+
+    // The first read only sets the baseline.
+    status = update(task);
+    while (status == MX_OK) {
+        mx_time_t next_deadline = mx_deadline_after(delay);
+        mx_nanosleep(next_deadline);
+
+        status = update(task);
+        if (status != MX_OK)
+            break;
+        print_report(delay, max_lines);
+
+        if (num_loops > 0) {
+            if (--num_loops == 0)
+                break;
+        } else {
+            // TODO: replace once ctrl-c works in the shell
+            char ch;
+            bool quit = false;
+            while (read(STDIN_FILENO, &ch, 1) > 0) {
+                if (ch == 0x3)
+                    quit = true;
+            }
+            if (quit)
+                break;
+        }
+    }
+
+    if (!was_counting && !keep) {
+        uint32_t off = 0;
+        mx_object_set_property(task, MX_PROP_SYSCALL_STATS, &off, sizeof(off));
+    }
+    mx_handle_close(task);
+    return status == MX_OK ? 0 : 1;
+}
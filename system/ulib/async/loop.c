@@ -7,10 +7,12 @@
 #include <assert.h>
 #include <stdatomic.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <magenta/assert.h>
 #include <magenta/listnode.h>
 #include <magenta/syscalls.h>
+#include <magenta/syscalls/port.h>
 
 // The port wait key associated with the dispatcher's control messages.
 #define KEY_CONTROL (0u)
@@ -43,8 +45,11 @@ typedef struct async_loop {
     _Atomic async_loop_state_t state;
     atomic_uint active_threads; // number of active dispatch threads
 
-    mtx_t lock; // guards the lists and the dispatching tasks flag
+    mtx_t lock; // guards the lists, the pending packets and the dispatching tasks flag
     bool dispatching_tasks; // true while the loop is busy dispatching tasks
+    mx_port_packet_t pending[MX_PORT_MAX_BATCH]; // dequeued but not yet dispatched
+    uint32_t pending_head; // index of the next pending packet to dispatch
+    uint32_t pending_count; // number of valid entries in |pending|
     list_node_t wait_list; // most recently added first
     list_node_t task_list; // pending tasks, earliest deadline first
     list_node_t due_list; // due tasks, earliest deadline first
@@ -52,6 +57,10 @@ typedef struct async_loop {
 } async_loop_t;
 
 static mx_status_t async_loop_run_once(async_loop_t* loop, mx_time_t deadline);
+static mx_status_t async_loop_dequeue(async_loop_t* loop, mx_time_t deadline,
+                                      mx_port_packet_t* packet);
+static mx_status_t async_loop_dispatch(async_loop_t* loop, const mx_port_packet_t* packet);
+static bool async_loop_drop_pending_locked(async_loop_t* loop, uint64_t key);
 static mx_status_t async_loop_dispatch_wait(async_loop_t* loop, async_wait_t* wait,
                                             mx_status_t status, const mx_packet_signal_t* signal);
 static mx_status_t async_loop_dispatch_tasks(async_loop_t* loop);
@@ -171,6 +180,13 @@ void async_loop_shutdown(async_t* async) {
             async_loop_invoke_task_handler(loop, task, MX_ERR_CANCELED);
     }
 
+    // Packets which were dequeued but never dispatched are discarded just
+    // like the ones still sitting in the port.
+    mtx_lock(&loop->lock);
+    loop->pending_head = 0u;
+    loop->pending_count = 0u;
+    mtx_unlock(&loop->lock);
+
     if (loop->config.make_default_for_current_thread) {
         MX_DEBUG_ASSERT(async_get_default() == async);
         async_set_default(NULL);
@@ -198,31 +214,73 @@ static mx_status_t async_loop_run_once(async_loop_t* loop, mx_time_t deadline) {
         return MX_ERR_CANCELED;
 
     mx_port_packet_t packet;
-    mx_status_t status = mx_port_wait(loop->port, deadline, &packet, 0);
+    mx_status_t status = async_loop_dequeue(loop, deadline, &packet);
+    if (status != MX_OK)
+        return status;
+
+    return async_loop_dispatch(loop, &packet);
+}
+
+static mx_status_t async_loop_dequeue(async_loop_t* loop, mx_time_t deadline,
+                                      mx_port_packet_t* packet) {
+    // Packets left over from an earlier batch are dispatched first, one per
+    // unit of work, so that quitting or canceling in between them behaves
+    // exactly as if they were still queued on the port.
+    mtx_lock(&loop->lock);
+    if (loop->pending_head < loop->pending_count) {
+        *packet = loop->pending[loop->pending_head++];
+        mtx_unlock(&loop->lock);
+        return MX_OK;
+    }
+    mtx_unlock(&loop->lock);
+
+    // Drain a whole batch only when this is the sole dispatch thread; with a
+    // thread pool one packet at a time keeps the work spread across threads.
+    uint32_t count = 1u;
+    if (atomic_load_explicit(&loop->active_threads, memory_order_acquire) == 1u)
+        count = MX_PORT_MAX_BATCH;
+
+    mx_port_packet_t packets[MX_PORT_MAX_BATCH];
+    uint32_t actual = 0u;
+    mx_status_t status = mx_port_wait_many(loop->port, deadline, packets, count, &actual);
     if (status != MX_OK)
         return status;
+    MX_DEBUG_ASSERT(actual > 0u);
+
+    *packet = packets[0];
+    if (actual > 1u) {
+        mtx_lock(&loop->lock);
+        MX_DEBUG_ASSERT(loop->pending_head == loop->pending_count);
+        loop->pending_head = 0u;
+        loop->pending_count = actual - 1u;
+        memcpy(loop->pending, packets + 1, (actual - 1u) * sizeof(mx_port_packet_t));
+        mtx_unlock(&loop->lock);
+    }
+    return MX_OK;
+}
 
-    if (packet.key == KEY_CONTROL) {
+static mx_status_t async_loop_dispatch(async_loop_t* loop, const mx_port_packet_t* packet) {
+    if (packet->key == KEY_CONTROL) {
         // Handle wake-up packets.
-        if (packet.type == MX_PKT_TYPE_USER)
+        if (packet->type == MX_PKT_TYPE_USER)
             return MX_OK;
 
         // Handle task timer expirations.
-        if (packet.type == MX_PKT_TYPE_SIGNAL_REP &&
-            packet.signal.observed & MX_TIMER_SIGNALED) {
+        if (packet->type == MX_PKT_TYPE_SIGNAL_REP &&
+            packet->signal.observed & MX_TIMER_SIGNALED) {
             return async_loop_dispatch_tasks(loop);
         }
     } else {
         // Handle wait completion packets.
-        if (packet.type == MX_PKT_TYPE_SIGNAL_ONE) {
-            async_wait_t* wait = (void*)(uintptr_t)packet.key;
-            return async_loop_dispatch_wait(loop, wait, packet.status, &packet.signal);
+        if (packet->type == MX_PKT_TYPE_SIGNAL_ONE) {
+            async_wait_t* wait = (void*)(uintptr_t)packet->key;
+            return async_loop_dispatch_wait(loop, wait, packet->status, &packet->signal);
         }
 
         // Handle queued user packets.
-        if (packet.type == MX_PKT_TYPE_USER) {
-            async_receiver_t* receiver = (void*)(uintptr_t)packet.key;
-            return async_loop_dispatch_packet(loop, receiver, packet.status, &packet.user);
+        if (packet->type == MX_PKT_TYPE_USER) {
+            async_receiver_t* receiver = (void*)(uintptr_t)packet->key;
+            return async_loop_dispatch_packet(loop, receiver, packet->status, &packet->user);
         }
     }
 
@@ -230,6 +288,21 @@ static mx_status_t async_loop_run_once(async_loop_t* loop, mx_time_t deadline) {
     return MX_ERR_INTERNAL;
 }
 
+static bool async_loop_drop_pending_locked(async_loop_t* loop, uint64_t key) {
+    bool dropped = false;
+    uint32_t out = loop->pending_head;
+    for (uint32_t i = loop->pending_head; i < loop->pending_count; i++) {
+        const mx_port_packet_t* packet = &loop->pending[i];
+        if (packet->key == key && packet->type == MX_PKT_TYPE_SIGNAL_ONE) {
+            dropped = true;
+            continue;
+        }
+        loop->pending[out++] = *packet;
+    }
+    loop->pending_count = out;
+    return dropped;
+}
+
 static mx_status_t async_loop_dispatch_wait(async_loop_t* loop, async_wait_t* wait,
                                             mx_status_t status, const mx_packet_signal_t* signal) {
     // We must dequeue the handler before invoking it since it might destroy itself.
@@ -412,11 +485,15 @@ static mx_status_t async_loop_cancel_wait(async_t* async, async_wait_t* wait) {
     // invoked again past this point.
     mx_status_t status = mx_port_cancel(loop->port, wait->object,
                                         (uintptr_t)wait);
-    if (status == MX_OK && (wait->flags & ASYNC_HANDLE_SHUTDOWN)) {
-        mtx_lock(&loop->lock);
+
+    // The completion packet may already have been dequeued as part of a
+    // batch without having been dispatched yet.
+    mtx_lock(&loop->lock);
+    if (async_loop_drop_pending_locked(loop, (uintptr_t)wait) && status == MX_ERR_NOT_FOUND)
+        status = MX_OK;
+    if (status == MX_OK && (wait->flags & ASYNC_HANDLE_SHUTDOWN))
         list_delete(wait_to_node(wait));
-        mtx_unlock(&loop->lock);
-    }
+    mtx_unlock(&loop->lock);
     return status;
 }
 
@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <magenta/syscalls.h>
+
+#include "private.h"
+
+namespace {
+
+// This must give the same results as u64_mul_u64_fp32_64() in the
+// kernel's lib/fixed_point, so that the time computed here agrees with
+// the kernel's current_time() to the nanosecond.
+uint64_t ticks_to_ns(uint64_t ticks, uint32_t l0, uint32_t l32, uint32_t l64) {
+    uint32_t a_r32 = static_cast<uint32_t>(ticks >> 32);
+    uint32_t a_0 = static_cast<uint32_t>(ticks);
+    uint64_t tmp;
+
+    uint64_t res_0 = (static_cast<uint64_t>(a_r32) * l0) << 32;
+    res_0 += static_cast<uint64_t>(a_0) * l0;
+    res_0 += static_cast<uint64_t>(a_r32) * l32;
+    tmp = static_cast<uint64_t>(a_0) * l32;
+    res_0 += tmp >> 32;
+    uint64_t res_l32 = static_cast<uint32_t>(tmp);
+    tmp = static_cast<uint64_t>(a_r32) * l64;
+    res_0 += tmp >> 32;
+    res_l32 += static_cast<uint32_t>(tmp);
+    res_l32 += (static_cast<uint64_t>(a_0) * l64) >> 32;
+    res_0 += res_l32 >> 32;
+    return res_0 + (static_cast<uint32_t>(res_l32) >> 31);
+}
+
+} // anonymous namespace
+
+mx_time_t _mx_time_get(uint32_t clock_id) {
+    if (clock_id != MX_CLOCK_MONOTONIC && clock_id != MX_CLOCK_UTC)
+        return SYSCALL_mx_time_get_kernel(clock_id);
+
+    uint32_t seq, flags, l0, l32, l64;
+    int64_t utc_offset;
+    uint64_t ticks;
+    do {
+        seq = __atomic_load_n(&DATA_CLOCK.seq, __ATOMIC_ACQUIRE);
+        flags = __atomic_load_n(&DATA_CLOCK.flags, __ATOMIC_RELAXED);
+        l0 = __atomic_load_n(&DATA_CLOCK.ns_per_tick_l0, __ATOMIC_RELAXED);
+        l32 = __atomic_load_n(&DATA_CLOCK.ns_per_tick_l32, __ATOMIC_RELAXED);
+        l64 = __atomic_load_n(&DATA_CLOCK.ns_per_tick_l64, __ATOMIC_RELAXED);
+        utc_offset = __atomic_load_n(&DATA_CLOCK.utc_offset, __ATOMIC_RELAXED);
+        ticks = VDSO_mx_ticks_get();
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (unlikely((seq & 1) != 0) ||
+             unlikely(seq != __atomic_load_n(&DATA_CLOCK.seq, __ATOMIC_RELAXED)));
+
+    if (unlikely(!(flags & VDSO_CLOCK_TICKS_VALID)))
+        return SYSCALL_mx_time_get_kernel(clock_id);
+
+    mx_time_t now = ticks_to_ns(ticks, l0, l32, l64);
+    if (clock_id == MX_CLOCK_UTC)
+        now += utc_offset;
+    return now;
+}
+
+VDSO_INTERFACE_FUNCTION(mx_time_get);
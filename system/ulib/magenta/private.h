@@ -7,11 +7,15 @@
 #include <magenta/compiler.h>
 #include <magenta/syscalls.h>
 
-// This defines the struct shared with the kernel.
+// These define the structs shared with the kernel.
+#include <lib/vdso-clock.h>
 #include <lib/vdso-constants.h>
 
 extern __LOCAL const struct vdso_constants DATA_CONSTANTS;
 
+// The kernel writes this while processes run; see vdso-clock.h.
+extern __LOCAL const struct vdso_clock DATA_CLOCK;
+
 extern "C" {
 
 // This declares the VDSO_mx_* aliases for the vDSO entry points.
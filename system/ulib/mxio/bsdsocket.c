@@ -436,3 +436,50 @@ static ssize_t mxio_recvmsg(mxio_t* io, struct msghdr* msg, int flags) {
         return ERRNO(EISCONN);
     return STATUS(r);
 }
+
+int recvmmsg(int fd, struct mmsghdr* msgvec, unsigned int vlen, unsigned int flags,
+             struct timespec* timeout) {
+    mxio_t* io = fd_to_io(fd);
+    if (io == NULL) {
+        return ERRNO(EBADF);
+    }
+    if (!(io->flags & MXIO_FLAG_SOCKET)) {
+        mxio_release(io);
+        return ERRNO(ENOTSOCK);
+    }
+    // We never block once the first message has arrived, so there is
+    // nothing for |timeout| to cut short.
+    ssize_t r = mxio_socket_recvmmsg(io, msgvec, vlen, flags);
+    if (r == MX_ERR_NOT_SUPPORTED && vlen > 0) {
+        // No batching for this socket; return one message at a time.
+        r = io->ops->recvmsg(io, &msgvec[0].msg_hdr, flags & ~MSG_WAITFORONE);
+        if (r >= 0) {
+            msgvec[0].msg_len = r;
+            r = 1;
+        }
+    }
+    mxio_release(io);
+    return r < 0 ? STATUS(r) : r;
+}
+
+int sendmmsg(int fd, struct mmsghdr* msgvec, unsigned int vlen, unsigned int flags) {
+    mxio_t* io = fd_to_io(fd);
+    if (io == NULL) {
+        return ERRNO(EBADF);
+    }
+    if (!(io->flags & MXIO_FLAG_SOCKET)) {
+        mxio_release(io);
+        return ERRNO(ENOTSOCK);
+    }
+    ssize_t r = mxio_socket_sendmmsg(io, msgvec, vlen, flags);
+    if (r == MX_ERR_NOT_SUPPORTED && vlen > 0) {
+        // No batching for this socket; send one message at a time.
+        r = io->ops->sendmsg(io, &msgvec[0].msg_hdr, flags);
+        if (r >= 0) {
+            msgvec[0].msg_len = r;
+            r = 1;
+        }
+    }
+    mxio_release(io);
+    return r < 0 ? STATUS(r) : r;
+}
@@ -97,52 +97,64 @@ static void disconnect_handler(mxio_dispatcher_t* md, handler_t* handler, bool n
 #endif
 }
 
+// Processes a single packet. With USE_WAIT_ONCE each handler has at most
+// one packet outstanding, so a handler destroyed here never shows up again
+// later in the same batch.
+static void dispatch_packet(mxio_dispatcher_t* md, const mx_port_packet_t* packet) {
+    mx_status_t r;
+    handler_t* handler = (void*)(uintptr_t)packet->key;
+#if !USE_WAIT_ONCE
+    if (handler->flags & FLAG_DISCONNECTED) {
+        // handler is awaiting gc
+        // ignore events for it until we get the synthetic "destroy" event
+        if (packet->type == MX_PKT_TYPE_USER) {
+            destroy_handler(md, handler, packet->signal.observed & SIGNAL_NEEDS_CLOSE_CB);
+            printf("dispatcher: destroy %p\n", handler);
+        } else {
+            printf("dispatcher: spurious packet for %p\n", handler);
+        }
+        return;
+    }
+#endif
+    if (packet->signal.observed & MX_CHANNEL_READABLE) {
+        if ((r = handler->cb(handler->h, handler->func, handler->cookie)) != 0) {
+            if (r == ERR_DISPATCHER_NO_WORK) {
+                printf("mxio: dispatcher found no work to do!\n");
+            } else {
+                disconnect_handler(md, handler, r != ERR_DISPATCHER_DONE);
+                return;
+            }
+        }
+#if USE_WAIT_ONCE
+        if ((r = mx_object_wait_async(handler->h, md->port, (uint64_t)(uintptr_t)handler,
+                                      MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED,
+                                      MX_WAIT_ASYNC_ONCE)) < 0) {
+            printf("dispatcher: could not re-arm: %p\n", handler);
+        }
+#endif
+        return;
+    }
+    if (packet->signal.observed & MX_CHANNEL_PEER_CLOSED) {
+        // synthesize a close
+        disconnect_handler(md, handler, true);
+    }
+}
+
 static int mxio_dispatcher_thread(void* _md) {
     mxio_dispatcher_t* md = _md;
     mx_status_t r;
     xprintf("dispatcher: start %p\n", md);
 
     for (;;) {
-        mx_port_packet_t packet;
-        if ((r = mx_port_wait(md->port, MX_TIME_INFINITE, &packet, 0)) < 0) {
+        mx_port_packet_t packets[MX_PORT_MAX_BATCH];
+        uint32_t count;
+        if ((r = mx_port_wait_many(md->port, MX_TIME_INFINITE, packets,
+                                   MX_PORT_MAX_BATCH, &count)) < 0) {
             printf("dispatcher: port wait failed %d\n", r);
             break;
         }
-        handler_t* handler = (void*)(uintptr_t)packet.key;
-#if !USE_WAIT_ONCE
-        if (handler->flags & FLAG_DISCONNECTED) {
-            // handler is awaiting gc
-            // ignore events for it until we get the synthetic "destroy" event
-            if (packet.type == MX_PKT_TYPE_USER) {
-                destroy_handler(md, handler, packet.signal.observed & SIGNAL_NEEDS_CLOSE_CB);
-                printf("dispatcher: destroy %p\n", handler);
-            } else {
-                printf("dispatcher: spurious packet for %p\n", handler);
-            }
-            continue;
-        }
-#endif
-        if (packet.signal.observed & MX_CHANNEL_READABLE) {
-            if ((r = handler->cb(handler->h, handler->func, handler->cookie)) != 0) {
-                if (r == ERR_DISPATCHER_NO_WORK) {
-                    printf("mxio: dispatcher found no work to do!\n");
-                } else {
-                    disconnect_handler(md, handler, r != ERR_DISPATCHER_DONE);
-                    continue;
-                }
-            }
-#if USE_WAIT_ONCE
-            if ((r = mx_object_wait_async(handler->h, md->port, (uint64_t)(uintptr_t)handler,
-                                          MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED,
-                                          MX_WAIT_ASYNC_ONCE)) < 0) {
-                printf("dispatcher: could not re-arm: %p\n", handler);
-            }
-#endif
-            continue;
-        }
-        if (packet.signal.observed & MX_CHANNEL_PEER_CLOSED) {
-            // synthesize a close
-            disconnect_handler(md, handler, true);
+        for (uint32_t n = 0; n < count; n++) {
+            dispatch_packet(md, &packets[n]);
         }
     }
 
@@ -169,6 +169,10 @@ void mxio_socket_set_dgram_ops(mxio_t* io);
 
 mx_status_t mxio_socket_posix_ioctl(mxio_t* io, int req, va_list va);
 mx_status_t mxio_socket_shutdown(mxio_t* io, int how);
+// Batched recvmmsg() and sendmmsg() for datagram sockets. Return
+// MX_ERR_NOT_SUPPORTED for other sockets.
+ssize_t mxio_socket_recvmmsg(mxio_t* io, struct mmsghdr* msgvec, unsigned int vlen, int flags);
+ssize_t mxio_socket_sendmmsg(mxio_t* io, struct mmsghdr* msgvec, unsigned int vlen, int flags);
 mx_status_t mxio_socketpair_shutdown(mxio_t* io, int how);
 
 // unsupported / do-nothing hooks shared by implementations
@@ -363,11 +363,9 @@ static ssize_t mxsio_write_dgram(mxio_t* io, const void* data, size_t len) {
     return mxsio_sendmsg_dgram(io, &msg, 0);
 }
 
-static ssize_t mxsio_recvmsg_dgram(mxio_t* io, struct msghdr* msg, int flags) {
-    if (flags != 0) {
-        // TODO: support MSG_OOB
-        return MX_ERR_NOT_SUPPORTED;
-    }
+// Returns the size of the buffer that carries |msg| over the socket, or an
+// error if |msg| has an empty iovec.
+static ssize_t mxsio_dgram_size(const struct msghdr* msg) {
     size_t mlen = 0;
     for (int i = 0; i < msg->msg_iovlen; i++) {
         struct iovec *iov = &msg->msg_iov[i];
@@ -376,17 +374,27 @@ static ssize_t mxsio_recvmsg_dgram(mxio_t* io, struct msghdr* msg, int flags) {
         }
         mlen += iov->iov_len;
     }
-    mlen += MXIO_SOCKET_MSG_HEADER_SIZE;
+    return mlen + MXIO_SOCKET_MSG_HEADER_SIZE;
+}
 
-    // TODO: avoid malloc
-    mxio_socket_msg_t* m = malloc(mlen);
-    ssize_t n = mxsio_rx_dgram(io, m, mlen);
-    if (n < 0) {
-        free(m);
-        return n;
+static void mxsio_pack_dgram(mxio_socket_msg_t* m, const struct msghdr* msg, int flags) {
+    if (msg->msg_name != NULL) {
+        memcpy(&m->addr, msg->msg_name, msg->msg_namelen);
     }
-    if ((size_t)n < MXIO_SOCKET_MSG_HEADER_SIZE) {
-        free(m);
+    m->addrlen = msg->msg_namelen;
+    m->flags = flags;
+    char* data = m->data;
+    for (int i = 0; i < msg->msg_iovlen; i++) {
+        struct iovec *iov = &msg->msg_iov[i];
+        memcpy(data, iov->iov_base, iov->iov_len);
+        data += iov->iov_len;
+    }
+}
+
+// Unpacks the |n| bytes received into |m| into |msg|, and returns the
+// number of payload bytes.
+static ssize_t mxsio_unpack_dgram(mxio_socket_msg_t* m, size_t n, struct msghdr* msg) {
+    if (n < MXIO_SOCKET_MSG_HEADER_SIZE) {
         return MX_ERR_INTERNAL;
     }
     n -= MXIO_SOCKET_MSG_HEADER_SIZE;
@@ -410,6 +418,28 @@ static ssize_t mxsio_recvmsg_dgram(mxio_t* io, struct msghdr* msg, int flags) {
             resid -= iov->iov_len;
         }
     }
+    return n;
+}
+
+static ssize_t mxsio_recvmsg_dgram(mxio_t* io, struct msghdr* msg, int flags) {
+    if (flags != 0) {
+        // TODO: support MSG_OOB
+        return MX_ERR_NOT_SUPPORTED;
+    }
+    ssize_t mlen = mxsio_dgram_size(msg);
+    if (mlen < 0) {
+        return mlen;
+    }
+
+    // TODO: avoid malloc
+    mxio_socket_msg_t* m = malloc(mlen);
+    if (m == NULL) {
+        return MX_ERR_NO_MEMORY;
+    }
+    ssize_t n = mxsio_rx_dgram(io, m, mlen);
+    if (n >= 0) {
+        n = mxsio_unpack_dgram(m, n, msg);
+    }
     free(m);
     return n;
 }
@@ -426,32 +456,107 @@ static ssize_t mxsio_sendmsg_dgram(mxio_t* io, const struct msghdr* msg, int fla
             return MX_ERR_ALREADY_EXISTS;
         }
     }
-    ssize_t n = 0;
-    for (int i = 0; i < msg->msg_iovlen; i++) {
-        struct iovec *iov = &msg->msg_iov[i];
-        if (iov->iov_len <= 0) {
-            return MX_ERR_INVALID_ARGS;
-        }
-        n += iov->iov_len;
+    ssize_t mlen = mxsio_dgram_size(msg);
+    if (mlen < 0) {
+        return mlen;
     }
-    size_t mlen = n + MXIO_SOCKET_MSG_HEADER_SIZE;
 
     // TODO: avoid malloc m
     mxio_socket_msg_t* m = malloc(mlen);
-    if (msg->msg_name != NULL) {
-        memcpy(&m->addr, msg->msg_name, msg->msg_namelen);
-    }
-    m->addrlen = msg->msg_namelen;
-    m->flags = flags;
-    char* data = m->data;
-    for (int i = 0; i < msg->msg_iovlen; i++) {
-        struct iovec *iov = &msg->msg_iov[i];
-        memcpy(data, iov->iov_base, iov->iov_len);
-        data += iov->iov_len;
+    if (m == NULL) {
+        return MX_ERR_NO_MEMORY;
     }
+    mxsio_pack_dgram(m, msg, flags);
     ssize_t r = mxsio_tx_dgram(io, m, mlen);
     free(m);
-    return r == MX_OK ? n : r;
+    return r == MX_OK ? (ssize_t)(mlen - MXIO_SOCKET_MSG_HEADER_SIZE) : r;
+}
+
+// The space a datagram of |mlen| bytes takes in a batch buffer. Each one
+// starts with an mxio_socket_msg_t, so each starts suitably aligned for it.
+static size_t mxsio_dgram_slot(size_t mlen) {
+    const size_t align = _Alignof(mxio_socket_msg_t);
+    return (mlen + align - 1) & ~(align - 1);
+}
+
+// Receives up to |count| datagrams into |msgvec| with one mx_socket_read_many
+// call, and returns how many were received.
+static ssize_t mxsio_recvmmsg_batch(mxrio_t* rio, struct mmsghdr* msgvec, uint32_t count) {
+    mx_iovec_t dgrams[MX_SOCKET_MAX_BATCH];
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        ssize_t mlen = mxsio_dgram_size(&msgvec[i].msg_hdr);
+        if (mlen < 0) {
+            return mlen;
+        }
+        dgrams[i].size = mlen;
+        total += mxsio_dgram_slot(mlen);
+    }
+    char* buf = malloc(total);
+    if (buf == NULL) {
+        return MX_ERR_NO_MEMORY;
+    }
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        dgrams[i].buffer = buf + off;
+        off += mxsio_dgram_slot(dgrams[i].size);
+    }
+
+    uint32_t actual;
+    mx_status_t r = mx_socket_read_many(rio->h2, 0, dgrams, count, &actual);
+    if (r != MX_OK) {
+        free(buf);
+        return r;
+    }
+    for (uint32_t i = 0; i < actual; i++) {
+        ssize_t n = mxsio_unpack_dgram(dgrams[i].buffer, dgrams[i].size, &msgvec[i].msg_hdr);
+        msgvec[i].msg_len = (n < 0) ? 0 : n;
+    }
+    free(buf);
+    return actual;
+}
+
+// Sends up to |count| datagrams from |msgvec| with one mx_socket_write_many
+// call, and returns how many were sent.
+static ssize_t mxsio_sendmmsg_batch(mxrio_t* rio, struct mmsghdr* msgvec, uint32_t count) {
+    mx_iovec_t dgrams[MX_SOCKET_MAX_BATCH];
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const struct msghdr* msg = &msgvec[i].msg_hdr;
+        if (rio->io.flags & MXIO_FLAG_SOCKET_CONNECTED) {
+            // if connected, can't specify address
+            if (msg->msg_name != NULL || msg->msg_namelen != 0) {
+                return MX_ERR_ALREADY_EXISTS;
+            }
+        }
+        ssize_t mlen = mxsio_dgram_size(msg);
+        if (mlen < 0) {
+            return mlen;
+        }
+        dgrams[i].size = mlen;
+        total += mxsio_dgram_slot(mlen);
+    }
+    char* buf = malloc(total);
+    if (buf == NULL) {
+        return MX_ERR_NO_MEMORY;
+    }
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        dgrams[i].buffer = buf + off;
+        mxsio_pack_dgram(dgrams[i].buffer, &msgvec[i].msg_hdr, 0);
+        off += mxsio_dgram_slot(dgrams[i].size);
+    }
+
+    uint32_t actual;
+    mx_status_t r = mx_socket_write_many(rio->h2, 0, dgrams, count, &actual);
+    free(buf);
+    if (r != MX_OK) {
+        return r;
+    }
+    for (uint32_t i = 0; i < actual; i++) {
+        msgvec[i].msg_len = dgrams[i].size - MXIO_SOCKET_MSG_HEADER_SIZE;
+    }
+    return actual;
 }
 
 static void mxsio_wait_begin_dgram(mxio_t* io, uint32_t events, mx_handle_t* handle, mx_signals_t* _signals) {
@@ -574,3 +679,104 @@ mx_status_t mxio_socket_shutdown(mxio_t* io, int how) {
     }
     return MX_OK;
 }
+
+ssize_t mxio_socket_recvmmsg(mxio_t* io, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+    if (io->ops != &mxio_socket_dgram_ops) {
+        return MX_ERR_NOT_SUPPORTED;
+    }
+    if (flags & ~(MSG_DONTWAIT | MSG_WAITFORONE)) {
+        return MX_ERR_NOT_SUPPORTED;
+    }
+    mxrio_t* rio = (mxrio_t*)io;
+    int nonblock = (rio->io.flags & MXIO_FLAG_NONBLOCK) || (flags & MSG_DONTWAIT);
+
+    // Only wait for the first datagram, as if MSG_WAITFORONE were always
+    // given; after that, take whatever the socket already holds.
+    unsigned int done = 0;
+    while (done < vlen) {
+        uint32_t count = vlen - done;
+        if (count > MX_SOCKET_MAX_BATCH) {
+            count = MX_SOCKET_MAX_BATCH;
+        }
+        ssize_t r = mxsio_recvmmsg_batch(rio, msgvec + done, count);
+        if (r >= 0) {
+            done += r;
+            if ((uint32_t)r < count) {
+                break;
+            }
+            continue;
+        }
+        if (done > 0) {
+            break;
+        }
+        if (r == MX_ERR_PEER_CLOSED) {
+            return 0;
+        }
+        if (r == MX_ERR_SHOULD_WAIT && !nonblock) {
+            mx_signals_t pending;
+            r = mx_object_wait_one(rio->h2,
+                                   MX_SOCKET_READABLE | MX_SOCKET_PEER_CLOSED,
+                                   MX_TIME_INFINITE, &pending);
+            if (r < 0) {
+                return r;
+            }
+            if (pending & MX_SOCKET_READABLE) {
+                continue;
+            }
+            if (pending & MX_SOCKET_PEER_CLOSED) {
+                return 0;
+            }
+            // impossible
+            return MX_ERR_INTERNAL;
+        }
+        return r;
+    }
+    return done;
+}
+
+ssize_t mxio_socket_sendmmsg(mxio_t* io, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+    if (io->ops != &mxio_socket_dgram_ops) {
+        return MX_ERR_NOT_SUPPORTED;
+    }
+    if (flags & ~MSG_DONTWAIT) {
+        return MX_ERR_NOT_SUPPORTED;
+    }
+    mxrio_t* rio = (mxrio_t*)io;
+    int nonblock = (rio->io.flags & MXIO_FLAG_NONBLOCK) || (flags & MSG_DONTWAIT);
+
+    // Like mxsio_write_stream, only wait for room for the first datagram.
+    unsigned int done = 0;
+    while (done < vlen) {
+        uint32_t count = vlen - done;
+        if (count > MX_SOCKET_MAX_BATCH) {
+            count = MX_SOCKET_MAX_BATCH;
+        }
+        ssize_t r = mxsio_sendmmsg_batch(rio, msgvec + done, count);
+        if (r >= 0) {
+            done += r;
+            if ((uint32_t)r < count) {
+                break;
+            }
+            continue;
+        }
+        if (done > 0) {
+            break;
+        }
+        if (r == MX_ERR_SHOULD_WAIT && !nonblock) {
+            mx_signals_t pending;
+            r = mx_object_wait_one(rio->h2,
+                                   MX_SOCKET_WRITABLE,
+                                   MX_TIME_INFINITE, &pending);
+            if (r < 0) {
+                return r;
+            }
+            if (pending & MX_SOCKET_WRITABLE) {
+                continue;
+            }
+            // impossible
+            return MX_ERR_INTERNAL;
+        }
+        return r;
+    }
+    return done;
+}
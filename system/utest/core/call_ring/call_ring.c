@@ -0,0 +1,267 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <magenta/process.h>
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/call_ring.h>
+#include <magenta/syscalls/port.h>
+#include <unittest/unittest.h>
+
+typedef struct {
+    mx_handle_t handle;
+    uintptr_t addr;
+    size_t len;
+    mx_call_ring_t* ctl;
+    mx_call_sqe_t* sq;
+    mx_call_cqe_t* cq;
+} ring_t;
+
+static bool ring_open(ring_t* r, uint32_t entries) {
+    if (mx_call_ring_create(0u, entries, &r->handle) != MX_OK)
+        return false;
+    if (mx_call_ring_map(r->handle, mx_vmar_root_self(), 0u, &r->addr) != MX_OK)
+        return false;
+    r->ctl = (mx_call_ring_t*)r->addr;
+    r->sq = (mx_call_sqe_t*)(r->addr + MX_CALL_RING_SQ_OFFSET);
+    r->cq = (mx_call_cqe_t*)(r->addr + r->ctl->cq_offset);
+    r->len = r->ctl->cq_offset + entries * sizeof(mx_call_cqe_t);
+    return r->ctl->entries == entries;
+}
+
+static void ring_close(ring_t* r) {
+    mx_vmar_unmap(mx_vmar_root_self(), r->addr, r->len);
+    mx_handle_close(r->handle);
+}
+
+static void push(ring_t* r, uint32_t opcode, uint64_t user_data,
+                 uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3, uint64_t a4,
+                 uint64_t a5) {
+    uint32_t tail = r->ctl->sq_tail;
+    mx_call_sqe_t* sqe = &r->sq[tail & (r->ctl->entries - 1)];
+    *sqe = (mx_call_sqe_t){opcode, 0u, user_data, {a0, a1, a2, a3, a4, a5}};
+    atomic_store_explicit((_Atomic uint32_t*)&r->ctl->sq_tail, tail + 1,
+                          memory_order_release);
+}
+
+static bool pop(ring_t* r, mx_call_cqe_t* cqe) {
+    uint32_t head = r->ctl->cq_head;
+    if (atomic_load_explicit((_Atomic uint32_t*)&r->ctl->cq_tail,
+                             memory_order_acquire) == head)
+        return false;
+    *cqe = r->cq[head & (r->ctl->entries - 1)];
+    atomic_store_explicit((_Atomic uint32_t*)&r->ctl->cq_head, head + 1,
+                          memory_order_release);
+    return true;
+}
+
+static bool create_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t h;
+    EXPECT_EQ(mx_call_ring_create(0u, 0u, &h), MX_ERR_OUT_OF_RANGE, "");
+    EXPECT_EQ(mx_call_ring_create(0u, 3u, &h), MX_ERR_OUT_OF_RANGE, "");
+    EXPECT_EQ(mx_call_ring_create(0u, MX_CALL_RING_MAX_ENTRIES * 2, &h),
+              MX_ERR_OUT_OF_RANGE, "");
+    EXPECT_EQ(mx_call_ring_create(1u, 8u, &h), MX_ERR_INVALID_ARGS, "");
+
+    ASSERT_EQ(mx_call_ring_create(0u, 8u, &h), MX_OK, "");
+    uintptr_t addr;
+    EXPECT_EQ(mx_call_ring_map(h, mx_vmar_root_self(), 1u, &addr), MX_ERR_INVALID_ARGS, "");
+
+    mx_handle_t ro;
+    ASSERT_EQ(mx_handle_duplicate(h, MX_RIGHT_READ, &ro), MX_OK, "");
+    EXPECT_EQ(mx_call_ring_map(ro, mx_vmar_root_self(), 0u, &addr), MX_ERR_ACCESS_DENIED, "");
+    EXPECT_EQ(mx_call_ring_enter(ro, 1u, NULL), MX_ERR_ACCESS_DENIED, "");
+
+    mx_handle_close(ro);
+    mx_handle_close(h);
+
+    END_TEST;
+}
+
+static bool batch_test(void) {
+    BEGIN_TEST;
+
+    ring_t r;
+    ASSERT_TRUE(ring_open(&r, 8u), "");
+
+    mx_handle_t event, ch[2], port, vmo;
+    ASSERT_EQ(mx_event_create(0u, &event), MX_OK, "");
+    ASSERT_EQ(mx_channel_create(0u, &ch[0], &ch[1]), MX_OK, "");
+    ASSERT_EQ(mx_port_create(0u, &port), MX_OK, "");
+    ASSERT_EQ(mx_vmo_create(PAGE_SIZE, 0u, &vmo), MX_OK, "");
+
+    static const char msg[] = "hello";
+    mx_port_packet_t packet = {.key = 42u, .type = MX_PKT_TYPE_USER};
+    char out[sizeof(msg)] = {};
+    size_t written = 0u, read = 0u;
+
+    push(&r, MX_CALL_OP_NOP, 1u, 0u, 0u, 0u, 0u, 0u, 0u);
+    push(&r, MX_CALL_OP_OBJECT_SIGNAL, 2u, event, 0u, MX_EVENT_SIGNALED, 0u, 0u, 0u);
+    push(&r, MX_CALL_OP_CHANNEL_WRITE, 3u, ch[0], 0u, (uintptr_t)msg, sizeof(msg), 0u, 0u);
+    push(&r, MX_CALL_OP_PORT_QUEUE, 4u, port, (uintptr_t)&packet, sizeof(packet), 0u, 0u, 0u);
+    push(&r, MX_CALL_OP_VMO_WRITE, 5u, vmo, (uintptr_t)msg, 0u, sizeof(msg),
+         (uintptr_t)&written, 0u);
+    push(&r, MX_CALL_OP_VMO_READ, 6u, vmo, (uintptr_t)out, 0u, sizeof(out),
+         (uintptr_t)&read, 0u);
+
+    uint32_t actual = 0u;
+    EXPECT_EQ(mx_call_ring_enter(r.handle, UINT32_MAX, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 6u, "");
+
+    // Completions come back in submission order.
+    mx_call_cqe_t cqe;
+    for (uint64_t i = 1u; i <= 6u; i++) {
+        ASSERT_TRUE(pop(&r, &cqe), "");
+        EXPECT_EQ(cqe.user_data, i, "");
+        EXPECT_EQ(cqe.status, MX_OK, "");
+    }
+    EXPECT_FALSE(pop(&r, &cqe), "");
+
+    mx_signals_t pending;
+    EXPECT_EQ(mx_object_wait_one(event, MX_EVENT_SIGNALED, 0u, &pending), MX_OK, "");
+
+    char buf[sizeof(msg)];
+    uint32_t bytes;
+    EXPECT_EQ(mx_channel_read(ch[1], 0u, buf, NULL, sizeof(buf), 0u, &bytes, NULL), MX_OK, "");
+    EXPECT_EQ(memcmp(buf, msg, sizeof(msg)), 0, "");
+
+    mx_port_packet_t received;
+    EXPECT_EQ(mx_port_wait(port, 0u, &received, 0u), MX_OK, "");
+    EXPECT_EQ(received.key, 42u, "");
+
+    EXPECT_EQ(written, sizeof(msg), "");
+    EXPECT_EQ(read, sizeof(msg), "");
+    EXPECT_EQ(memcmp(out, msg, sizeof(msg)), 0, "");
+
+    mx_handle_close(vmo);
+    mx_handle_close(port);
+    mx_handle_close(ch[0]);
+    mx_handle_close(ch[1]);
+    mx_handle_close(event);
+    ring_close(&r);
+
+    END_TEST;
+}
+
+static bool errors_test(void) {
+    BEGIN_TEST;
+
+    ring_t r;
+    ASSERT_TRUE(ring_open(&r, 4u), "");
+
+    // Failed calls complete with the status the syscall would return.
+    push(&r, MX_CALL_OP_OBJECT_SIGNAL, 1u, MX_HANDLE_INVALID, 0u, 0u, 0u, 0u, 0u);
+    push(&r, 1000u, 2u, 0u, 0u, 0u, 0u, 0u, 0u);
+    push(&r, MX_CALL_OP_NOP, 3u, 0u, 0u, 0u, 0u, 0u, 0u);
+    r.sq[2].flags = 1u;
+
+    uint32_t actual = 0u;
+    EXPECT_EQ(mx_call_ring_enter(r.handle, 3u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 3u, "");
+
+    mx_call_cqe_t cqe;
+    ASSERT_TRUE(pop(&r, &cqe), "");
+    EXPECT_EQ(cqe.status, MX_ERR_BAD_HANDLE, "");
+    ASSERT_TRUE(pop(&r, &cqe), "");
+    EXPECT_EQ(cqe.status, MX_ERR_NOT_SUPPORTED, "");
+    ASSERT_TRUE(pop(&r, &cqe), "");
+    EXPECT_EQ(cqe.status, MX_ERR_INVALID_ARGS, "");
+
+    // Nothing queued.
+    EXPECT_EQ(mx_call_ring_enter(r.handle, 4u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 0u, "");
+
+    // Submissions wait while the completion queue is full.
+    for (uint64_t i = 0u; i < 4u; i++)
+        push(&r, MX_CALL_OP_NOP, i, 0u, 0u, 0u, 0u, 0u, 0u);
+    EXPECT_EQ(mx_call_ring_enter(r.handle, 4u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 4u, "");
+    push(&r, MX_CALL_OP_NOP, 4u, 0u, 0u, 0u, 0u, 0u, 0u);
+    EXPECT_EQ(mx_call_ring_enter(r.handle, 4u, &actual), MX_ERR_SHOULD_WAIT, "");
+    ASSERT_TRUE(pop(&r, &cqe), "");
+    EXPECT_EQ(mx_call_ring_enter(r.handle, 4u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 1u, "");
+
+    // A corrupt index is reported rather than trusted.
+    r.ctl->sq_tail += 100u;
+    EXPECT_EQ(mx_call_ring_enter(r.handle, 4u, &actual), MX_ERR_BAD_STATE, "");
+
+    ring_close(&r);
+
+    END_TEST;
+}
+
+// The kernel writes completions through its own mapping of the ring, so a
+// moving channel write out of it copies the pages instead of taking them.
+static bool move_pages_test(void) {
+    BEGIN_TEST;
+
+    const uint32_t kEntries = 256u;
+    const uint32_t kSize = kEntries * sizeof(mx_call_sqe_t);
+
+    ring_t r;
+    ASSERT_TRUE(ring_open(&r, kEntries), "");
+    uint8_t* sq = (uint8_t*)r.sq;
+    for (uint32_t i = 0u; i < kSize; i++)
+        sq[i] = (uint8_t)(i * 7u + 1u);
+
+    mx_handle_t ch[2];
+    ASSERT_EQ(mx_channel_create(0u, &ch[0], &ch[1]), MX_OK, "");
+    ASSERT_EQ(mx_channel_write(ch[0], MX_CHANNEL_WRITE_MOVE_PAGES, sq, kSize, NULL, 0u),
+              MX_OK, "");
+
+    // The ring still holds what was written to it...
+    bool same = true;
+    for (uint32_t i = 0u; i < kSize; i++) {
+        if (sq[i] != (uint8_t)(i * 7u + 1u)) {
+            same = false;
+            break;
+        }
+    }
+    EXPECT_TRUE(same, "ring pages were moved out");
+
+    // ...and so does the message.
+    static uint8_t buf[256u * sizeof(mx_call_sqe_t)];
+    uint32_t bytes = 0u;
+    ASSERT_EQ(mx_channel_read(ch[1], 0u, buf, NULL, sizeof(buf), 0u, &bytes, NULL), MX_OK, "");
+    EXPECT_EQ(bytes, kSize, "");
+    EXPECT_EQ(memcmp(buf, sq, kSize), 0, "");
+
+    // The kernel's view of the ring is intact too.
+    memset(sq, 0, kSize);
+    push(&r, MX_CALL_OP_NOP, 7u, 0u, 0u, 0u, 0u, 0u, 0u);
+    uint32_t actual = 0u;
+    EXPECT_EQ(mx_call_ring_enter(r.handle, 1u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 1u, "");
+    mx_call_cqe_t cqe;
+    ASSERT_TRUE(pop(&r, &cqe), "");
+    EXPECT_EQ(cqe.user_data, 7u, "");
+    EXPECT_EQ(cqe.status, MX_OK, "");
+
+    mx_handle_close(ch[0]);
+    mx_handle_close(ch[1]);
+    ring_close(&r);
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(call_ring_tests)
+RUN_TEST(create_test)
+RUN_TEST(batch_test)
+RUN_TEST(errors_test)
+RUN_TEST(move_pages_test)
+END_TEST_CASE(call_ring_tests)
+
+#ifndef BUILD_COMBINED_TESTS
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
+#endif
@@ -3,7 +3,9 @@
 // found in the LICENSE file.
 
 #include <assert.h>
+#include <limits.h>
 #include <magenta/compiler.h>
+#include <magenta/process.h>
 #include <magenta/syscalls.h>
 #include <magenta/syscalls/object.h>
 #include <unittest/unittest.h>
@@ -855,6 +857,181 @@ static bool channel_disallow_write_to_self(void) {
     END_TEST;
 }
 
+static bool channel_write_read_many(void) {
+    BEGIN_TEST;
+
+    mx_handle_t channel[2];
+    ASSERT_EQ(mx_channel_create(0, &channel[0], &channel[1]), MX_OK, "");
+
+    mx_handle_t event;
+    ASSERT_EQ(mx_event_create(0u, &event), MX_OK, "");
+
+    uint32_t data[4] = {0u, 1u, 2u, 3u};
+    mx_handle_t dup;
+    ASSERT_EQ(mx_handle_duplicate(event, MX_RIGHT_SAME_RIGHTS, &dup), MX_OK, "");
+
+    mx_channel_msg_t out[4] = {
+        {&data[0], NULL, sizeof(uint32_t), 0u},
+        {&data[1], &dup, sizeof(uint32_t), 1u},
+        {&data[2], NULL, sizeof(uint32_t), 0u},
+        {&data[3], NULL, 2 * sizeof(uint32_t), 0u},
+    };
+    uint32_t actual = 0u;
+    EXPECT_EQ(mx_channel_write_many(channel[0], 0u, out, 0u, &actual), MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(mx_channel_write_many(channel[0], 0u, out, MX_CHANNEL_MAX_BATCH + 1, &actual),
+              MX_ERR_OUT_OF_RANGE, "");
+
+    // The last message has a bad buffer, so only the first three are written.
+    out[3].bytes = (void*)1;
+    EXPECT_EQ(mx_channel_write_many(channel[0], 0u, out, 4u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 3u, "");
+
+    uint32_t in_data[4] = {};
+    mx_handle_t in_handle = MX_HANDLE_INVALID;
+
+    // The first message doesn't fit; it must stay queued.
+    mx_channel_msg_t in[4] = {
+        {&in_data[0], NULL, 0u, 0u},
+    };
+    EXPECT_EQ(mx_channel_read_many(channel[1], 1u, in, 1u, &actual), MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(mx_channel_read_many(channel[1], 0u, in, 1u, &actual), MX_ERR_BUFFER_TOO_SMALL, "");
+    EXPECT_EQ(in[0].num_bytes, sizeof(uint32_t), "");
+    EXPECT_EQ(in[0].num_handles, 0u, "");
+
+    // The third message doesn't fit its buffer, so the read stops there.
+    in[0] = (mx_channel_msg_t){&in_data[0], NULL, sizeof(uint32_t), 0u};
+    in[1] = (mx_channel_msg_t){&in_data[1], &in_handle, sizeof(uint32_t), 1u};
+    in[2] = (mx_channel_msg_t){&in_data[2], NULL, 0u, 0u};
+    in[3] = (mx_channel_msg_t){&in_data[3], NULL, sizeof(uint32_t), 0u};
+    EXPECT_EQ(mx_channel_read_many(channel[1], 0u, in, 4u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 2u, "");
+    EXPECT_EQ(in_data[0], 0u, "");
+    EXPECT_EQ(in_data[1], 1u, "");
+    EXPECT_EQ(in[1].num_handles, 1u, "");
+    EXPECT_NEQ(in_handle, MX_HANDLE_INVALID, "");
+    // Only the entries of the messages read are written back.
+    EXPECT_EQ(in[2].num_bytes, 0u, "");
+    EXPECT_EQ(mx_object_wait_one(channel[1], MX_CHANNEL_READABLE, 0u, NULL), MX_OK, "");
+
+    in[0] = (mx_channel_msg_t){&in_data[2], NULL, sizeof(uint32_t), 0u};
+    EXPECT_EQ(mx_channel_read_many(channel[1], 0u, in, 4u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 1u, "");
+    EXPECT_EQ(in_data[2], 2u, "");
+    EXPECT_EQ(mx_channel_read_many(channel[1], 0u, in, 4u, &actual), MX_ERR_SHOULD_WAIT, "");
+
+    // Writing to a closed peer fails and leaves the handles with the caller.
+    ASSERT_EQ(mx_handle_duplicate(event, MX_RIGHT_SAME_RIGHTS, &dup), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(channel[1]), MX_OK, "");
+    EXPECT_EQ(mx_channel_write_many(channel[0], 0u, out, 2u, &actual), MX_ERR_PEER_CLOSED, "");
+    EXPECT_EQ(mx_handle_close(dup), MX_OK, "");
+
+    EXPECT_EQ(mx_handle_close(in_handle), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(event), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(channel[0]), MX_OK, "");
+
+    END_TEST;
+}
+
+static bool channel_write_move_pages(void) {
+    BEGIN_TEST;
+
+    // Room for the largest moved message and then some.
+    const size_t kSize = MX_CHANNEL_MAX_MOVED_MSG_BYTES + PAGE_SIZE;
+    const uint32_t kMsgSize = 16u * PAGE_SIZE - 100u;
+
+    mx_handle_t channel[2];
+    ASSERT_EQ(mx_channel_create(0, &channel[0], &channel[1]), MX_OK, "");
+
+    mx_handle_t vmo[2];
+    uintptr_t addr[2];
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQ(mx_vmo_create(kSize, 0u, &vmo[i]), MX_OK, "");
+        ASSERT_EQ(mx_vmar_map(mx_vmar_root_self(), 0u, vmo[i], 0u, kSize,
+                              MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE, &addr[i]),
+                  MX_OK, "");
+    }
+
+    uint8_t* out = (uint8_t*)addr[0];
+    uint8_t* in = (uint8_t*)addr[1];
+    for (size_t i = 0; i < kSize; ++i)
+        out[i] = (uint8_t)(i * 7);
+
+    ASSERT_EQ(mx_channel_write(channel[0], MX_CHANNEL_WRITE_MOVE_PAGES, out, kMsgSize, NULL, 0u),
+              MX_OK, "");
+
+    // The moved pages read as zeros; the rest of the buffer is untouched.
+    EXPECT_EQ(out[0], 0u, "");
+    EXPECT_EQ(out[kMsgSize - 2 * PAGE_SIZE], 0u, "");
+    EXPECT_EQ(out[kMsgSize - 1], (uint8_t)((kMsgSize - 1) * 7), "");
+
+    // Writes after the fact don't change the message.
+    out[1] = 0xff;
+
+    uint32_t actual_bytes = 0u;
+    ASSERT_EQ(mx_channel_read(channel[1], 0u, in, NULL, (uint32_t)kSize, 0u, &actual_bytes, NULL),
+              MX_OK, "");
+    EXPECT_EQ(actual_bytes, kMsgSize, "");
+    bool same = true;
+    for (size_t i = 0; i < kMsgSize; ++i) {
+        if (in[i] != (uint8_t)(i * 7)) {
+            same = false;
+            break;
+        }
+    }
+    EXPECT_TRUE(same, "received payload differs from what was written");
+
+    // Without the option, oversized messages are still rejected.
+    EXPECT_EQ(mx_channel_write(channel[0], 0u, in, MX_CHANNEL_MAX_MSG_BYTES + 1u, NULL, 0u),
+              MX_ERR_OUT_OF_RANGE, "");
+
+    // With it, messages up to MX_CHANNEL_MAX_MOVED_MSG_BYTES are accepted.
+    EXPECT_EQ(mx_channel_write(channel[0], MX_CHANNEL_WRITE_MOVE_PAGES, out,
+                               MX_CHANNEL_MAX_MOVED_MSG_BYTES, NULL, 0u),
+              MX_OK, "");
+    actual_bytes = 0u;
+    EXPECT_EQ(mx_channel_read(channel[1], 0u, in, NULL, (uint32_t)kSize, 0u, &actual_bytes, NULL),
+              MX_OK, "");
+    EXPECT_EQ(actual_bytes, MX_CHANNEL_MAX_MOVED_MSG_BYTES, "");
+    EXPECT_EQ(mx_channel_write(channel[0], MX_CHANNEL_WRITE_MOVE_PAGES, out,
+                               MX_CHANNEL_MAX_MOVED_MSG_BYTES + 1u, NULL, 0u),
+              MX_ERR_OUT_OF_RANGE, "");
+
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_EQ(mx_vmar_unmap(mx_vmar_root_self(), addr[i], kSize), MX_OK, "");
+        EXPECT_EQ(mx_handle_close(vmo[i]), MX_OK, "");
+    }
+    EXPECT_EQ(mx_handle_close(channel[0]), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(channel[1]), MX_OK, "");
+
+    END_TEST;
+}
+
+// Empty messages still take up kernel memory, so they count against the
+// writer's quota, and running out of them is reported as such.
+static bool channel_empty_message_quota(void) {
+    BEGIN_TEST;
+
+    mx_handle_t channel[2];
+    ASSERT_EQ(mx_channel_create(0, &channel[0], &channel[1]), MX_OK, "");
+
+    mx_status_t status;
+    uint32_t count = 0u;
+    while ((status = mx_channel_write(channel[0], 0u, NULL, 0u, NULL, 0u)) == MX_OK)
+        ++count;
+    EXPECT_EQ(status, MX_ERR_NO_RESOURCES, "");
+    EXPECT_GT(count, 0u, "");
+
+    // Closing the channel returns the quota.
+    EXPECT_EQ(mx_handle_close(channel[1]), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(channel[0]), MX_OK, "");
+    ASSERT_EQ(mx_channel_create(0, &channel[0], &channel[1]), MX_OK, "");
+    EXPECT_EQ(mx_channel_write(channel[0], 0u, NULL, 0u, NULL, 0u), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(channel[0]), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(channel[1]), MX_OK, "");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(channel_tests)
 RUN_TEST(channel_test)
 RUN_TEST(channel_read_error_test)
@@ -868,6 +1045,9 @@ RUN_TEST(channel_call2)
 RUN_TEST(bad_channel_call_finish)
 RUN_TEST(channel_nest)
 RUN_TEST(channel_disallow_write_to_self)
+RUN_TEST(channel_write_read_many)
+RUN_TEST(channel_write_move_pages)
+RUN_TEST(channel_empty_message_quota)
 END_TEST_CASE(channel_tests)
 
 #ifndef BUILD_COMBINED_TESTS
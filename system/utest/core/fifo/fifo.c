@@ -3,13 +3,16 @@
 // found in the LICENSE file.
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <threads.h>
 #include <unistd.h>
 
+#include <magenta/process.h>
 #include <magenta/syscalls.h>
+#include <magenta/syscalls/fifo.h>
 #include <unittest/unittest.h>
 
 static mx_signals_t get_signals(mx_handle_t h) {
@@ -118,8 +121,98 @@ static bool options_test(void) {
     END_TEST;
 }
 
+static uint64_t* ring_slot(mx_fifo_ring_t* ring, uint32_t n) {
+    uintptr_t data = (uintptr_t)ring + MX_FIFO_RING_DATA_OFFSET;
+    return (uint64_t*)(data + (n & (ring->elem_count - 1)) * ring->elem_size);
+}
+
+static void write_to_addr(void* addr) {
+    *(volatile uint32_t*)addr = 42u;
+}
+
+static bool shared_test(void) {
+    BEGIN_TEST;
+    mx_handle_t a, b;
+
+    // shared fifos may be larger than a page
+    EXPECT_EQ(mx_fifo_create(1024, 8, MX_FIFO_SHARED | 2u, &a, &b), MX_ERR_INVALID_ARGS, "");
+    ASSERT_EQ(mx_fifo_create(1024, 8, MX_FIFO_SHARED, &a, &b), MX_OK, "");
+
+    uintptr_t addr;
+    EXPECT_EQ(mx_fifo_map(a, mx_vmar_root_self(), 2u, &addr), MX_ERR_INVALID_ARGS, "");
+    ASSERT_EQ(mx_fifo_map(a, mx_vmar_root_self(), MX_FIFO_MAP_WRITE_RING, &addr), MX_OK, "");
+    mx_fifo_ring_t* tx = (mx_fifo_ring_t*)addr;
+    ASSERT_EQ(mx_fifo_map(b, mx_vmar_root_self(), MX_FIFO_MAP_READ_RING, &addr), MX_OK, "");
+    mx_fifo_ring_t* rx = (mx_fifo_ring_t*)addr;
+    EXPECT_EQ(tx->elem_count, 1024u, "");
+    EXPECT_EQ(tx->elem_size, 8u, "");
+
+    // enqueue through the mapping; the kernel only notices on the doorbell
+    uint32_t head = atomic_load_explicit((_Atomic uint32_t*)&tx->head, memory_order_relaxed);
+    for (uint32_t i = 0; i < 4; i++)
+        *ring_slot(tx, head + i) = 100u + i;
+    atomic_store_explicit((_Atomic uint32_t*)&tx->head, head + 4, memory_order_release);
+    EXPECT_SIGNALS(b, MX_FIFO_WRITABLE | MX_SIGNAL_LAST_HANDLE);
+    EXPECT_EQ(mx_fifo_doorbell(a), MX_OK, "");
+    EXPECT_SIGNALS(b, MX_FIFO_READABLE | MX_FIFO_WRITABLE | MX_SIGNAL_LAST_HANDLE);
+
+    // the other endpoint's mapping and mx_fifo_read() both see them
+    EXPECT_EQ(atomic_load_explicit((_Atomic uint32_t*)&rx->head, memory_order_acquire),
+              head + 4, "");
+    EXPECT_EQ(*ring_slot(rx, rx->tail), 100u, "");
+    uint64_t n[2];
+    uint32_t actual;
+    ASSERT_EQ(mx_fifo_read(b, n, sizeof(n), &actual), MX_OK, "");
+    ASSERT_EQ(actual, 2u, "");
+    EXPECT_EQ(n[0], 100u, "");
+    EXPECT_EQ(n[1], 101u, "");
+
+    // dequeue the rest through the mapping
+    uint32_t tail = atomic_load_explicit((_Atomic uint32_t*)&rx->tail, memory_order_relaxed);
+    EXPECT_EQ(*ring_slot(rx, tail), 102u, "");
+    EXPECT_EQ(*ring_slot(rx, tail + 1), 103u, "");
+    atomic_store_explicit((_Atomic uint32_t*)&rx->tail, tail + 2, memory_order_release);
+    EXPECT_EQ(mx_fifo_doorbell(b), MX_OK, "");
+    EXPECT_SIGNALS(b, MX_FIFO_WRITABLE | MX_SIGNAL_LAST_HANDLE);
+
+    // a corrupted ring is rejected rather than trusted
+    atomic_store_explicit((_Atomic uint32_t*)&tx->head, tail + 2 + 4096, memory_order_release);
+    EXPECT_EQ(mx_fifo_read(b, n, sizeof(n), &actual), MX_ERR_BAD_STATE, "");
+
+    // a handle that may only read gets a mapping it cannot write to
+    mx_handle_t ro;
+    ASSERT_EQ(mx_handle_duplicate(b, MX_RIGHT_READ, &ro), MX_OK, "");
+    EXPECT_EQ(mx_fifo_map(ro, mx_vmar_root_self(), MX_FIFO_MAP_WRITE_RING, &addr),
+              MX_ERR_ACCESS_DENIED, "");
+    ASSERT_EQ(mx_fifo_map(ro, mx_vmar_root_self(), MX_FIFO_MAP_READ_RING, &addr), MX_OK, "");
+    mx_fifo_ring_t* ro_rx = (mx_fifo_ring_t*)addr;
+    EXPECT_EQ(ro_rx->elem_count, 1024u, "");
+    ASSERT_DEATH(write_to_addr, &ro_rx->tail, "write to a read-only ring mapping");
+    EXPECT_EQ(ro_rx->tail, rx->tail, "");
+    mx_handle_close(ro);
+
+    // plain fifos cannot be mapped
+    mx_handle_t c, d;
+    ASSERT_EQ(mx_fifo_create(8, 8, 0, &c, &d), MX_OK, "");
+    EXPECT_EQ(mx_fifo_map(c, mx_vmar_root_self(), MX_FIFO_MAP_READ_RING, &addr),
+              MX_ERR_NOT_SUPPORTED, "");
+    EXPECT_EQ(mx_fifo_doorbell(c), MX_ERR_NOT_SUPPORTED, "");
+    mx_handle_close(c);
+    mx_handle_close(d);
+
+    size_t len = MX_FIFO_RING_DATA_OFFSET + 1024 * 8;
+    EXPECT_EQ(mx_vmar_unmap(mx_vmar_root_self(), (uintptr_t)tx, len), MX_OK, "");
+    EXPECT_EQ(mx_vmar_unmap(mx_vmar_root_self(), (uintptr_t)rx, len), MX_OK, "");
+    EXPECT_EQ(mx_vmar_unmap(mx_vmar_root_self(), (uintptr_t)ro_rx, len), MX_OK, "");
+    mx_handle_close(a);
+    mx_handle_close(b);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(fifo_tests)
 RUN_TEST(basic_test)
+RUN_TEST(shared_test)
 END_TEST_CASE(fifo_tests)
 
 #ifndef BUILD_COMBINED_TESTS
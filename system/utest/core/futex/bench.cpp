@@ -0,0 +1,161 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <threads.h>
+
+#include <magenta/syscalls.h>
+#include <magenta/threads.h>
+
+#include "bench.h"
+
+namespace {
+
+constexpr uint32_t kIterations = 100000u;
+constexpr uint32_t kThreads = 8u;
+
+// spin the cpu a bit to make sure the frequency is cranked to the top
+void spin(mx_time_t nanosecs) {
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+
+    while (mx_time_get(MX_CLOCK_MONOTONIC) - t < nanosecs)
+        ;
+}
+
+template <typename T>
+inline mx_time_t time_it(T func) {
+    spin(MX_MSEC(10));
+
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+    func();
+    return mx_time_get(MX_CLOCK_MONOTONIC) - t;
+}
+
+struct MutexArgs {
+    mtx_t* mutex;
+    uint64_t* counter;
+};
+
+int mutex_thread(void* arg) {
+    auto args = static_cast<MutexArgs*>(arg);
+    for (uint32_t i = 0; i < kIterations; i++) {
+        mtx_lock(args->mutex);
+        (*args->counter)++;
+        mtx_unlock(args->mutex);
+    }
+    return 0;
+}
+
+// Runs kThreads threads hammering |num_mutexes| mutexes, with the threads
+// spread evenly over them.
+mx_time_t time_mutexes(uint32_t num_mutexes) {
+    mtx_t mutexes[kThreads];
+    uint64_t counters[kThreads] = {};
+    MutexArgs args[kThreads];
+    thrd_t threads[kThreads];
+
+    for (uint32_t i = 0; i < num_mutexes; i++)
+        mtx_init(&mutexes[i], mtx_plain);
+    for (uint32_t i = 0; i < kThreads; i++)
+        args[i] = {&mutexes[i % num_mutexes], &counters[i % num_mutexes]};
+
+    return time_it([&]() {
+        for (uint32_t i = 0; i < kThreads; i++)
+            thrd_create_with_name(&threads[i], mutex_thread, &args[i], "futex-bench");
+        for (uint32_t i = 0; i < kThreads; i++)
+            thrd_join(threads[i], NULL);
+    });
+}
+
+struct CondArgs {
+    mtx_t mutex;
+    cnd_t cond;
+    uint32_t generation;
+    uint32_t waiting;
+    bool done;
+};
+
+int cond_thread(void* arg) {
+    auto args = static_cast<CondArgs*>(arg);
+    mtx_lock(&args->mutex);
+    uint32_t generation = args->generation;
+    while (!args->done) {
+        args->waiting++;
+        while (generation == args->generation && !args->done)
+            cnd_wait(&args->cond, &args->mutex);
+        generation = args->generation;
+    }
+    mtx_unlock(&args->mutex);
+    return 0;
+}
+
+} // namespace
+
+int futex_run_benchmark() {
+    mx_time_t t;
+    mx_futex_t futex = 0;
+    mx_futex_t futex2 = 0;
+
+    printf("starting futex benchmark\n");
+
+    t = time_it([&]() {
+        for (uint32_t i = 0; i < kIterations; i++)
+            mx_futex_wake(&futex, 1);
+    });
+    printf("\ttook %" PRIu64 " nsecs to wake a futex with no waiters %u times\n",
+           t, kIterations);
+
+    t = time_it([&]() {
+        for (uint32_t i = 0; i < kIterations; i++)
+            mx_futex_requeue(&futex, 0, 0, &futex2, 1);
+    });
+    printf("\ttook %" PRIu64 " nsecs to requeue from a futex with no waiters %u times\n",
+           t, kIterations);
+
+    t = time_mutexes(1u);
+    printf("\ttook %" PRIu64 " nsecs for %u threads to lock one mutex %u times each\n",
+           t, kThreads, kIterations);
+
+    t = time_mutexes(kThreads);
+    printf("\ttook %" PRIu64 " nsecs for %u threads to lock their own mutex %u times each\n",
+           t, kThreads, kIterations);
+
+    // Broadcast to a crowd of condition variable waiters, which wakes one
+    // of them and requeues the rest onto the mutex.
+    CondArgs cond_args = {};
+    mtx_init(&cond_args.mutex, mtx_plain);
+    cnd_init(&cond_args.cond);
+    thrd_t threads[kThreads];
+    for (uint32_t i = 0; i < kThreads; i++)
+        thrd_create_with_name(&threads[i], cond_thread, &cond_args, "futex-bench");
+
+    constexpr uint32_t kBroadcasts = kIterations / 100u;
+    t = time_it([&]() {
+        for (uint32_t i = 0; i < kBroadcasts; i++) {
+            mtx_lock(&cond_args.mutex);
+            while (cond_args.waiting < kThreads) {
+                mtx_unlock(&cond_args.mutex);
+                thrd_yield();
+                mtx_lock(&cond_args.mutex);
+            }
+            cond_args.waiting = 0u;
+            cond_args.generation++;
+            cnd_broadcast(&cond_args.cond);
+            mtx_unlock(&cond_args.mutex);
+        }
+    });
+    printf("\ttook %" PRIu64 " nsecs to broadcast to %u waiters %u times\n",
+           t, kThreads, kBroadcasts);
+
+    mtx_lock(&cond_args.mutex);
+    cond_args.done = true;
+    cnd_broadcast(&cond_args.cond);
+    mtx_unlock(&cond_args.mutex);
+    for (uint32_t i = 0; i < kThreads; i++)
+        thrd_join(threads[i], NULL);
+
+    printf("done with benchmark\n");
+    return 0;
+}
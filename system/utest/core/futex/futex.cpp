@@ -15,6 +15,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "bench.h"
 
 static bool test_futex_wait_value_mismatch() {
     BEGIN_TEST;
@@ -423,6 +424,60 @@ static bool test_futex_thread_suspended() {
     END_TEST;
 }
 
+// Test that futex_wait_owner() checks the owner it is given.
+static bool test_futex_wait_owner_bad_owner() {
+    BEGIN_TEST;
+    int futex_value = 1;
+
+    mx_handle_t event;
+    ASSERT_EQ(mx_event_create(0u, &event), MX_OK);
+    EXPECT_EQ(mx_futex_wait_owner(&futex_value, 1, event, MX_TIME_INFINITE),
+              MX_ERR_WRONG_TYPE);
+    ASSERT_EQ(mx_handle_close(event), MX_OK);
+
+    // A thread cannot wait for itself.
+    EXPECT_EQ(mx_futex_wait_owner(&futex_value, 1, thrd_get_mx_handle(thrd_current()),
+                                  MX_TIME_INFINITE),
+              MX_ERR_INVALID_ARGS);
+
+    // No owner is the same as futex_wait().
+    EXPECT_EQ(mx_futex_wait_owner(&futex_value, 1, MX_HANDLE_INVALID, 0), MX_ERR_TIMED_OUT);
+    END_TEST;
+}
+
+static thrd_t main_thread;
+
+static int owner_wait_thread(void* arg) {
+    auto futex_value = static_cast<volatile int*>(arg);
+    mx_status_t status = mx_futex_wait_owner(const_cast<int*>(futex_value), 1,
+                                             thrd_get_mx_handle(main_thread),
+                                             MX_TIME_INFINITE);
+    *futex_value = 2;
+    return status;
+}
+
+// Test that a thread waiting with an owner is woken as usual, and that
+// the owner can wake it.
+static bool test_futex_wait_owner_wake() {
+    BEGIN_TEST;
+    volatile int futex_value = 1;
+    main_thread = thrd_current();
+
+    thrd_t thread;
+    ASSERT_EQ(thrd_create_with_name(&thread, owner_wait_thread,
+                                    const_cast<int*>(&futex_value), "owner_wait_thread"),
+              thrd_success);
+    // Wake until the thread has left its wait.
+    while (futex_value == 1) {
+        ASSERT_EQ(mx_futex_wake(const_cast<int*>(&futex_value), 1), MX_OK);
+        mx_nanosleep(mx_deadline_after(MX_MSEC(1)));
+    }
+    int result;
+    ASSERT_EQ(thrd_join(thread, &result), thrd_success);
+    EXPECT_EQ(result, MX_OK);
+    END_TEST;
+}
+
 // Test that misaligned pointers cause futex syscalls to return a failure.
 static bool test_futex_misaligned() {
     BEGIN_TEST;
@@ -543,12 +598,17 @@ RUN_TEST(test_futex_requeue);
 RUN_TEST(test_futex_requeue_unqueued_on_timeout);
 RUN_TEST(test_futex_thread_killed);
 RUN_TEST(test_futex_thread_suspended);
+RUN_TEST(test_futex_wait_owner_bad_owner);
+RUN_TEST(test_futex_wait_owner_wake);
 RUN_TEST(test_futex_misaligned);
 RUN_TEST(test_event_signaling);
 END_TEST_CASE(futex_tests)
 
 #ifndef BUILD_COMBINED_TESTS
 int main(int argc, char** argv) {
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        return futex_run_benchmark();
+
     bool success = unittest_run_all_tests(argc, argv);
     return success ? 0 : -1;
 }
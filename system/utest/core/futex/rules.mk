@@ -11,6 +11,7 @@ MODULE_TYPE := usertest
 MODULE_USERTEST_GROUP := core
 
 MODULE_SRCS += \
+    $(LOCAL_DIR)/bench.cpp \
     $(LOCAL_DIR)/futex.cpp
 
 MODULE_NAME := futex-test
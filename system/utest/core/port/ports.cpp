@@ -77,6 +77,103 @@ static bool queue_and_close_test(void) {
     END_TEST;
 }
 
+static bool wait_many_test(void) {
+    BEGIN_TEST;
+    mx_status_t status;
+
+    mx_handle_t port;
+    status = mx_port_create(0, &port);
+    EXPECT_EQ(status, MX_OK, "could not create port");
+
+    mx_port_packet_t out[MX_PORT_MAX_BATCH] = {};
+    uint32_t actual = 0u;
+
+    status = mx_port_wait_many(port, 0ull, out, 0u, &actual);
+    EXPECT_EQ(status, MX_ERR_INVALID_ARGS);
+
+    status = mx_port_wait_many(port, 0ull, out, MX_PORT_MAX_BATCH + 1u, &actual);
+    EXPECT_EQ(status, MX_ERR_OUT_OF_RANGE);
+
+    status = mx_port_wait_many(port, mx_deadline_after(MX_USEC(1)), out, 4u, &actual);
+    EXPECT_EQ(status, MX_ERR_TIMED_OUT);
+
+    for (uint64_t ix = 0; ix != 6u; ++ix) {
+        const mx_port_packet_t in = { ix, MX_PKT_TYPE_USER, 0, { {} } };
+        status = mx_port_queue(port, &in, 0u);
+        EXPECT_EQ(status, MX_OK);
+    }
+
+    // The first call drains as many as asked for, in FIFO order.
+    status = mx_port_wait_many(port, MX_TIME_INFINITE, out, 4u, &actual);
+    EXPECT_EQ(status, MX_OK);
+    EXPECT_EQ(actual, 4u);
+    for (uint32_t ix = 0; ix != actual; ++ix) {
+        EXPECT_EQ(out[ix].key, ix);
+        EXPECT_EQ(out[ix].type, MX_PKT_TYPE_USER);
+    }
+
+    // The second one returns the remainder without waiting for more.
+    status = mx_port_wait_many(port, MX_TIME_INFINITE, out, MX_PORT_MAX_BATCH, &actual);
+    EXPECT_EQ(status, MX_OK);
+    EXPECT_EQ(actual, 2u);
+    EXPECT_EQ(out[0].key, 4u);
+    EXPECT_EQ(out[1].key, 5u);
+
+    status = mx_port_wait_many(port, 0ull, out, MX_PORT_MAX_BATCH, nullptr);
+    EXPECT_EQ(status, MX_ERR_TIMED_OUT);
+
+    status = mx_handle_close(port);
+    EXPECT_EQ(status, MX_OK);
+
+    END_TEST;
+}
+
+static bool queue_quota_test(void) {
+    BEGIN_TEST;
+    mx_status_t status;
+
+    mx_handle_t port;
+    status = mx_port_create(0, &port);
+    EXPECT_EQ(status, MX_OK, "could not create port");
+
+    const mx_port_packet_t in = { 1ull, MX_PKT_TYPE_USER, 0, { {} } };
+
+    // Fill the port until it pushes back. The limit is well below the
+    // number of packets in the system. Earlier tests leave nothing queued.
+    uint32_t queued = 0u;
+    while ((status = mx_port_queue(port, &in, 0u)) == MX_OK)
+        ++queued;
+    EXPECT_EQ(status, MX_ERR_SHOULD_WAIT);
+    EXPECT_GT(queued, 0u);
+
+    // The limit is per process, so another port does not get around it.
+    mx_handle_t port2;
+    status = mx_port_create(0, &port2);
+    EXPECT_EQ(status, MX_OK, "could not create port");
+    status = mx_port_queue(port2, &in, 0u);
+    EXPECT_EQ(status, MX_ERR_SHOULD_WAIT);
+
+    // Dequeuing a packet makes room for one more.
+    mx_port_packet_t out = {};
+    status = mx_port_wait(port, 0ull, &out, 0u);
+    EXPECT_EQ(status, MX_OK);
+    status = mx_port_queue(port, &in, 0u);
+    EXPECT_EQ(status, MX_OK);
+    status = mx_port_queue(port, &in, 0u);
+    EXPECT_EQ(status, MX_ERR_SHOULD_WAIT);
+
+    // Closing a port gives back the charges for the packets left on it.
+    EXPECT_EQ(mx_handle_close(port), MX_OK);
+    status = mx_port_queue(port2, &in, 0u);
+    EXPECT_EQ(status, MX_OK);
+    status = mx_port_wait(port2, 0ull, &out, 0u);
+    EXPECT_EQ(status, MX_OK);
+
+    EXPECT_EQ(mx_handle_close(port2), MX_OK);
+
+    END_TEST;
+}
+
 static bool async_wait_channel_test(void) {
     BEGIN_TEST;
     mx_status_t status;
@@ -300,6 +397,50 @@ static bool async_wait_event_test_repeat(void) {
     END_TEST;
 }
 
+static bool async_wait_event_test_repeat_coalesced(void) {
+    BEGIN_TEST;
+
+    mx_handle_t port;
+    EXPECT_EQ(mx_port_create(0, &port), MX_OK);
+
+    mx_handle_t ev;
+    EXPECT_EQ(mx_event_create(0u, &ev), MX_OK);
+
+    const uint64_t key0 = 3344ull;
+    EXPECT_EQ(mx_object_wait_async(
+        ev, port, key0, MX_EVENT_SIGNALED, MX_WAIT_ASYNC_REPEATING), MX_OK);
+
+    // Changes to signals the wait does not watch, and changes made while
+    // its packet is still queued, produce no more packets.
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK);
+    for (int ix = 0; ix != 4; ++ix) {
+        EXPECT_EQ(mx_object_signal(ev, 0u, MX_USER_SIGNAL_0), MX_OK);
+        EXPECT_EQ(mx_object_signal(ev, MX_USER_SIGNAL_0, 0u), MX_OK);
+    }
+    EXPECT_EQ(mx_object_signal(ev, MX_EVENT_SIGNALED, 0u), MX_OK);
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK);
+
+    mx_port_packet_t out = {};
+    ASSERT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_OK);
+    EXPECT_EQ(out.key, key0);
+    EXPECT_EQ(out.type, MX_PKT_TYPE_SIGNAL_REP);
+
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_USER_SIGNAL_0), MX_OK);
+    EXPECT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_ERR_TIMED_OUT);
+
+    // A new edge of a watched signal after the packet was read does.
+    EXPECT_EQ(mx_object_signal(ev, MX_EVENT_SIGNALED, 0u), MX_OK);
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK);
+    ASSERT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_OK);
+    EXPECT_EQ(out.key, key0);
+    EXPECT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_ERR_TIMED_OUT);
+
+    EXPECT_EQ(mx_handle_close(port), MX_OK);
+    EXPECT_EQ(mx_handle_close(ev), MX_OK);
+
+    END_TEST;
+}
+
 static bool pre_writes_channel_test(uint32_t mode) {
     BEGIN_TEST;
     mx_status_t status;
@@ -632,9 +773,12 @@ static bool cancel_stress() {
 BEGIN_TEST_CASE(port_tests)
 RUN_TEST(basic_test)
 RUN_TEST(queue_and_close_test)
+RUN_TEST(wait_many_test)
+RUN_TEST(queue_quota_test)
 RUN_TEST(async_wait_channel_test)
 RUN_TEST(async_wait_event_test_single)
 RUN_TEST(async_wait_event_test_repeat)
+RUN_TEST(async_wait_event_test_repeat_coalesced)
 RUN_TEST(async_wait_close_order_1)
 RUN_TEST(async_wait_close_order_2)
 RUN_TEST(async_wait_close_order_3)
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -320,12 +321,90 @@ static bool pthread_getstack_other_thread_explicit_size() {
     END_TEST;
 }
 
+struct PiMutexArgs {
+    pthread_mutex_t mutex;
+    int counter;
+};
+
+static void* pi_mutex_thread(void* arg) {
+    auto args = static_cast<PiMutexArgs*>(arg);
+    for (int i = 0; i < 1000; i++) {
+        pthread_mutex_lock(&args->mutex);
+        int value = args->counter;
+        if (i % 100 == 0)
+            sched_yield();
+        args->counter = value + 1;
+        pthread_mutex_unlock(&args->mutex);
+    }
+    return NULL;
+}
+
+// Check that PTHREAD_PRIO_INHERIT mutexes still exclude each other when
+// contended, which has them waiting with the owner named to the kernel.
+static bool pthread_mutex_prio_inherit_test() {
+    BEGIN_TEST;
+
+    pthread_mutexattr_t attr;
+    ASSERT_EQ(pthread_mutexattr_init(&attr), 0);
+    int protocol = -1;
+    ASSERT_EQ(pthread_mutexattr_getprotocol(&attr, &protocol), 0);
+    EXPECT_EQ(protocol, PTHREAD_PRIO_NONE);
+    ASSERT_EQ(pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT), 0);
+    ASSERT_EQ(pthread_mutexattr_getprotocol(&attr, &protocol), 0);
+    EXPECT_EQ(protocol, PTHREAD_PRIO_INHERIT);
+    EXPECT_EQ(pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_PROTECT), ENOTSUP);
+    ASSERT_EQ(pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK), 0);
+
+    PiMutexArgs args = {};
+    ASSERT_EQ(pthread_mutex_init(&args.mutex, &attr), 0);
+    pthread_mutexattr_destroy(&attr);
+
+    // The owner is tracked, so the usual errorcheck behavior applies.
+    ASSERT_EQ(pthread_mutex_lock(&args.mutex), 0);
+    EXPECT_EQ(pthread_mutex_lock(&args.mutex), EDEADLK);
+    ASSERT_EQ(pthread_mutex_unlock(&args.mutex), 0);
+    EXPECT_EQ(pthread_mutex_unlock(&args.mutex), EPERM);
+
+    constexpr int kNumThreads = 4;
+    pthread_t threads[kNumThreads];
+    for (auto& thread : threads)
+        ASSERT_EQ(pthread_create(&thread, NULL, pi_mutex_thread, &args), 0);
+    for (auto& thread : threads)
+        ASSERT_EQ(pthread_join(thread, NULL), 0);
+    EXPECT_EQ(args.counter, kNumThreads * 1000);
+
+    ASSERT_EQ(pthread_mutex_destroy(&args.mutex), 0);
+
+    // Relocking a normal mutex deadlocks, which a deadline lets us see.
+    ASSERT_EQ(pthread_mutexattr_init(&attr), 0);
+    ASSERT_EQ(pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT), 0);
+    ASSERT_EQ(pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL), 0);
+    pthread_mutex_t mutex;
+    ASSERT_EQ(pthread_mutex_init(&mutex, &attr), 0);
+    pthread_mutexattr_destroy(&attr);
+
+    ASSERT_EQ(pthread_mutex_lock(&mutex), 0);
+    struct timespec deadline;
+    ASSERT_EQ(clock_gettime(CLOCK_REALTIME, &deadline), 0);
+    deadline.tv_nsec += 10 * 1000 * 1000;
+    if (deadline.tv_nsec >= 1000 * 1000 * 1000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000 * 1000 * 1000;
+    }
+    EXPECT_EQ(pthread_mutex_timedlock(&mutex, &deadline), ETIMEDOUT);
+    ASSERT_EQ(pthread_mutex_unlock(&mutex), 0);
+
+    ASSERT_EQ(pthread_mutex_destroy(&mutex), 0);
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(pthread_tests)
 RUN_TEST(pthread_test)
 RUN_TEST(pthread_self_main_thread_test)
 RUN_TEST(pthread_big_stack_size)
 RUN_TEST(pthread_getstack_main_thread)
 RUN_TEST(pthread_getstack_other_thread)
+RUN_TEST(pthread_mutex_prio_inherit_test)
 END_TEST_CASE(pthread_tests)
 
 #ifndef BUILD_COMBINED_TESTS
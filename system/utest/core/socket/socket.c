@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 static mx_signals_t get_satisfied_signals(mx_handle_t handle) {
@@ -427,6 +428,221 @@ static bool socket_datagram_no_short_write(void) {
     END_TEST;
 }
 
+// Every datagram takes up a page however small it is, so a datagram
+// socket fills up after 256 of them.
+static bool socket_datagram_count_limit(void) {
+    BEGIN_TEST;
+
+    mx_handle_t h0, h1;
+    ASSERT_EQ(mx_socket_create(MX_SOCKET_DATAGRAM, &h0, &h1), MX_OK, "");
+
+    char c = 'x';
+    size_t written;
+    size_t count = 0u;
+    while (mx_socket_write(h0, 0u, &c, 1u, &written) == MX_OK && count <= 256u)
+        count++;
+    EXPECT_EQ(count, 256u, "");
+    mx_signals_t pending;
+    EXPECT_EQ(mx_object_wait_one(h0, MX_SOCKET_WRITABLE, 0u, &pending), MX_ERR_TIMED_OUT, "");
+
+    // Reading one makes room for another.
+    size_t read;
+    EXPECT_EQ(mx_socket_read(h1, 0u, &c, 1u, &read), MX_OK, "");
+    EXPECT_EQ(mx_socket_write(h0, 0u, &c, 1u, &written), MX_OK, "");
+
+    mx_handle_close(h0);
+    mx_handle_close(h1);
+
+    END_TEST;
+}
+
+static bool socket_writev_readv(void) {
+    BEGIN_TEST;
+
+    size_t count;
+    mx_status_t status;
+    mx_handle_t h0, h1;
+
+    char a[] = "gather";
+    char b[] = "-";
+    char c[] = "scatter";
+    mx_iovec_t wiov[] = {
+        { a, sizeof(a) - 1 },
+        { NULL, 0u },
+        { b, sizeof(b) - 1 },
+        { c, sizeof(c) - 1 },
+    };
+    const size_t total = sizeof(a) + sizeof(b) + sizeof(c) - 3;
+
+    char r0[4] = {0};
+    char r1[16] = {0};
+    mx_iovec_t riov[] = {
+        { r0, sizeof(r0) },
+        { r1, sizeof(r1) },
+    };
+
+    for (int i = 0; i < 2; ++i) {
+        uint32_t options = i ? MX_SOCKET_DATAGRAM : MX_SOCKET_STREAM;
+        status = mx_socket_create(options, &h0, &h1);
+        ASSERT_EQ(status, MX_OK, "");
+
+        status = mx_socket_writev(h0, 0u, wiov, countof(wiov), &count);
+        ASSERT_EQ(status, MX_OK, "");
+        EXPECT_EQ(count, total, "");
+
+        memset(r0, 0, sizeof(r0));
+        memset(r1, 0, sizeof(r1));
+        status = mx_socket_readv(h1, 0u, riov, countof(riov), &count);
+        ASSERT_EQ(status, MX_OK, "");
+        EXPECT_EQ(count, total, "");
+        EXPECT_EQ(memcmp(r0, "gath", 4), 0, "");
+        EXPECT_EQ(memcmp(r1, "er-scatter", 10), 0, "");
+
+        mx_handle_close(h0);
+        mx_handle_close(h1);
+    }
+
+    status = mx_socket_create(0, &h0, &h1);
+    ASSERT_EQ(status, MX_OK, "");
+    EXPECT_EQ(mx_socket_writev(h0, 0u, wiov, 0u, &count), MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(mx_socket_writev(h0, 0u, wiov, MX_SOCKET_MAX_IOVECS + 1, &count),
+              MX_ERR_OUT_OF_RANGE, "");
+    EXPECT_EQ(mx_socket_writev(h0, MX_SOCKET_HALF_CLOSE, wiov, countof(wiov), &count),
+              MX_ERR_INVALID_ARGS, "");
+    mx_iovec_t bad = { NULL, 1u };
+    EXPECT_EQ(mx_socket_writev(h0, 0u, &bad, 1u, &count), MX_ERR_INVALID_ARGS, "");
+    mx_handle_close(h0);
+    mx_handle_close(h1);
+
+    END_TEST;
+}
+
+static bool socket_write_move_pages(void) {
+    BEGIN_TEST;
+
+    const size_t kSize = 16 * PAGE_SIZE;
+    const size_t kWriteSize = kSize - 100u;
+
+    mx_handle_t h0, h1;
+    ASSERT_EQ(mx_socket_create(0, &h0, &h1), MX_OK, "");
+
+    mx_handle_t vmo[2];
+    uintptr_t addr[2];
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQ(mx_vmo_create(kSize, 0u, &vmo[i]), MX_OK, "");
+        ASSERT_EQ(mx_vmar_map(mx_vmar_root_self(), 0u, vmo[i], 0u, kSize,
+                              MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE, &addr[i]),
+                  MX_OK, "");
+    }
+
+    uint8_t* out = (uint8_t*)addr[0];
+    uint8_t* in = (uint8_t*)addr[1];
+    for (size_t i = 0; i < kSize; ++i)
+        out[i] = (uint8_t)(i * 7);
+
+    size_t count;
+    ASSERT_EQ(mx_socket_write(h0, MX_SOCKET_WRITE_MOVE_PAGES, out, kWriteSize, &count),
+              MX_OK, "");
+    EXPECT_EQ(count, kWriteSize, "");
+
+    // The moved pages read as zeros; the copied tail is untouched.
+    EXPECT_EQ(out[0], 0u, "");
+    EXPECT_EQ(out[kSize - 2 * PAGE_SIZE], 0u, "");
+    EXPECT_EQ(out[kWriteSize - 1], (uint8_t)((kWriteSize - 1) * 7), "");
+
+    ASSERT_EQ(mx_socket_read(h1, 0u, in, kSize, &count), MX_OK, "");
+    EXPECT_EQ(count, kWriteSize, "");
+    bool same = true;
+    for (size_t i = 0; i < kWriteSize; ++i) {
+        if (in[i] != (uint8_t)(i * 7)) {
+            same = false;
+            break;
+        }
+    }
+    EXPECT_TRUE(same, "received data differs from what was written");
+
+    // Moved pages that the reader can't take whole are copied out instead.
+    for (size_t i = 0; i < kSize; ++i)
+        out[i] = (uint8_t)(i * 3);
+    ASSERT_EQ(mx_socket_write(h0, MX_SOCKET_WRITE_MOVE_PAGES, out, kSize, &count), MX_OK, "");
+    EXPECT_EQ(count, kSize, "");
+    ASSERT_EQ(mx_socket_read(h1, 0u, in + 1, kSize - 1, &count), MX_OK, "");
+    EXPECT_EQ(count, kSize - 1, "");
+    same = true;
+    for (size_t i = 0; i < kSize - 1; ++i) {
+        if (in[i + 1] != (uint8_t)(i * 3)) {
+            same = false;
+            break;
+        }
+    }
+    EXPECT_TRUE(same, "received data differs from what was written");
+
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_EQ(mx_vmar_unmap(mx_vmar_root_self(), addr[i], kSize), MX_OK, "");
+        EXPECT_EQ(mx_handle_close(vmo[i]), MX_OK, "");
+    }
+    mx_handle_close(h0);
+    mx_handle_close(h1);
+
+    END_TEST;
+}
+
+static bool socket_read_write_many(void) {
+    BEGIN_TEST;
+
+    mx_handle_t h0, h1;
+    ASSERT_EQ(mx_socket_create(MX_SOCKET_DATAGRAM, &h0, &h1), MX_OK, "");
+
+    char a[] = "one";
+    char b[] = "datagram";
+    char c[] = "at a time";
+    mx_iovec_t out[] = {
+        { a, sizeof(a) },
+        { b, sizeof(b) },
+        { c, sizeof(c) },
+    };
+    uint32_t count = 0u;
+    ASSERT_EQ(mx_socket_write_many(h0, 0u, out, countof(out), &count), MX_OK, "");
+    EXPECT_EQ(count, countof(out), "");
+
+    // The second buffer is too small for its datagram, which is truncated;
+    // the fourth is left untouched since only three datagrams are queued.
+    char r[4][16];
+    memset(r, 0, sizeof(r));
+    mx_iovec_t in[] = {
+        { r[0], sizeof(r[0]) },
+        { r[1], 4u },
+        { r[2], sizeof(r[2]) },
+        { r[3], sizeof(r[3]) },
+    };
+    ASSERT_EQ(mx_socket_read_many(h1, 0u, in, countof(in), &count), MX_OK, "");
+    EXPECT_EQ(count, 3u, "");
+    EXPECT_EQ(in[0].size, sizeof(a), "");
+    EXPECT_EQ(memcmp(r[0], a, sizeof(a)), 0, "");
+    EXPECT_EQ(in[1].size, 4u, "");
+    EXPECT_EQ(memcmp(r[1], b, 4u), 0, "");
+    EXPECT_EQ(in[2].size, sizeof(c), "");
+    EXPECT_EQ(memcmp(r[2], c, sizeof(c)), 0, "");
+    EXPECT_EQ(in[3].size, sizeof(r[3]), "");
+
+    EXPECT_EQ(mx_socket_read_many(h1, 0u, in, countof(in), &count), MX_ERR_SHOULD_WAIT, "");
+    EXPECT_EQ(mx_socket_read_many(h1, 0u, in, 0u, &count), MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(mx_socket_write_many(h0, 0u, out, MX_SOCKET_MAX_BATCH + 1, &count),
+              MX_ERR_OUT_OF_RANGE, "");
+
+    mx_handle_close(h0);
+    mx_handle_close(h1);
+
+    // Stream sockets have no datagrams to batch.
+    ASSERT_EQ(mx_socket_create(MX_SOCKET_STREAM, &h0, &h1), MX_OK, "");
+    EXPECT_EQ(mx_socket_write_many(h0, 0u, out, countof(out), &count),
+              MX_ERR_NOT_SUPPORTED, "");
+    mx_handle_close(h0);
+    mx_handle_close(h1);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(socket_tests)
 RUN_TEST(socket_basic)
 RUN_TEST(socket_signals)
@@ -436,6 +652,10 @@ RUN_TEST(socket_bytes_outstanding_half_close)
 RUN_TEST(socket_short_write)
 RUN_TEST(socket_datagram)
 RUN_TEST(socket_datagram_no_short_write)
+RUN_TEST(socket_datagram_count_limit)
+RUN_TEST(socket_writev_readv)
+RUN_TEST(socket_write_move_pages)
+RUN_TEST(socket_read_write_many)
 END_TEST_CASE(socket_tests)
 
 #ifndef BUILD_COMBINED_TESTS
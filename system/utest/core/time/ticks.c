@@ -25,8 +25,31 @@ static bool elapsed_time_using_ticks(void) {
     END_TEST;
 }
 
+// mx_time_get() is computed in the vDSO where it can be; it must agree with
+// the kernel's own clock.
+static bool time_get_matches_kernel(void) {
+    BEGIN_TEST;
+
+    static const uint32_t clocks[] = {MX_CLOCK_MONOTONIC, MX_CLOCK_UTC};
+    for (size_t i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++) {
+        for (int j = 0; j < 1000; j++) {
+            mx_time_t before = mx_time_get_kernel(clocks[i]);
+            mx_time_t now = mx_time_get(clocks[i]);
+            mx_time_t after = mx_time_get_kernel(clocks[i]);
+            ASSERT_LE(before, now, "vDSO clock behind the kernel's");
+            ASSERT_LE(now, after, "vDSO clock ahead of the kernel's");
+        }
+    }
+
+    EXPECT_GT(mx_time_get(MX_CLOCK_THREAD), 0u, "");
+    EXPECT_EQ(mx_time_get(0xffffffffu), 0u, "Invalid clock");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(ticks_tests)
 RUN_TEST(elapsed_time_using_ticks)
+RUN_TEST(time_get_matches_kernel)
 END_TEST_CASE(ticks_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -0,0 +1,269 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include <magenta/syscalls.h>
+#include <unittest/unittest.h>
+
+static mx_signals_t get_signals(mx_handle_t h) {
+    mx_signals_t pending;
+    mx_status_t status = mx_object_wait_one(h, 0xFFFFFFFF, 0u, &pending);
+    if ((status != MX_OK) && (status != MX_ERR_TIMED_OUT)) {
+        return 0xFFFFFFFF;
+    }
+    return pending;
+}
+
+static bool level_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t ws, ev[2];
+    ASSERT_EQ(mx_waitset_create(0u, &ws), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev[0]), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev[1]), MX_OK, "");
+
+    EXPECT_EQ(mx_waitset_add(ws, 1u, ev[0], MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_waitset_add(ws, 2u, ev[1], MX_EVENT_SIGNALED, 0u), MX_OK, "");
+
+    mx_waitset_result_t results[MX_WAITSET_MAX_BATCH];
+    uint32_t actual = 0u;
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, results, MX_WAITSET_MAX_BATCH, &actual),
+              MX_ERR_TIMED_OUT, "");
+    EXPECT_EQ(get_signals(ws) & MX_WAITSET_READABLE, 0u, "");
+
+    EXPECT_EQ(mx_object_signal(ev[1], 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(get_signals(ws) & MX_WAITSET_READABLE, MX_WAITSET_READABLE, "");
+
+    // A level-triggered entry is reported for as long as it is signaled.
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(mx_waitset_wait(ws, 0u, results, MX_WAITSET_MAX_BATCH, &actual), MX_OK, "");
+        EXPECT_EQ(actual, 1u, "");
+        EXPECT_EQ(results[0].cookie, 2u, "");
+        EXPECT_EQ(results[0].status, MX_OK, "");
+        EXPECT_EQ(results[0].observed & MX_EVENT_SIGNALED, MX_EVENT_SIGNALED, "");
+    }
+
+    EXPECT_EQ(mx_object_signal(ev[1], MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(get_signals(ws) & MX_WAITSET_READABLE, 0u, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, results, MX_WAITSET_MAX_BATCH, &actual),
+              MX_ERR_TIMED_OUT, "");
+
+    mx_handle_close(ev[0]);
+    mx_handle_close(ev[1]);
+    mx_handle_close(ws);
+
+    END_TEST;
+}
+
+static bool rotation_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t ws, ev[2];
+    ASSERT_EQ(mx_waitset_create(0u, &ws), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev[0]), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev[1]), MX_OK, "");
+
+    EXPECT_EQ(mx_object_signal(ev[0], 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(mx_object_signal(ev[1], 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(mx_waitset_add(ws, 1u, ev[0], MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_waitset_add(ws, 2u, ev[1], MX_EVENT_SIGNALED, 0u), MX_OK, "");
+
+    // Reported entries go to the back of the ready list.
+    mx_waitset_result_t result;
+    uint64_t expected[4] = {1u, 2u, 1u, 2u};
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_OK, "");
+        EXPECT_EQ(result.cookie, expected[i], "");
+    }
+
+    mx_waitset_result_t results[2];
+    uint32_t actual = 0u;
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, results, 2u, &actual), MX_OK, "");
+    EXPECT_EQ(actual, 2u, "");
+
+    mx_handle_close(ev[0]);
+    mx_handle_close(ev[1]);
+    mx_handle_close(ws);
+
+    END_TEST;
+}
+
+static bool edge_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t ws, ev;
+    ASSERT_EQ(mx_waitset_create(0u, &ws), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev), MX_OK, "");
+
+    // An entry already signaled when added is reported once.
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(mx_waitset_add(ws, 7u, ev, MX_EVENT_SIGNALED, MX_WAITSET_EDGE_TRIGGERED),
+              MX_OK, "");
+
+    mx_waitset_result_t result;
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_OK, "");
+    EXPECT_EQ(result.cookie, 7u, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_ERR_TIMED_OUT, "");
+
+    // Staying signaled is not a new edge.
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_USER_SIGNAL_0), MX_OK, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_ERR_TIMED_OUT, "");
+
+    EXPECT_EQ(mx_object_signal(ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_OK, "");
+    EXPECT_EQ(result.cookie, 7u, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_ERR_TIMED_OUT, "");
+
+    mx_handle_close(ev);
+    mx_handle_close(ws);
+
+    END_TEST;
+}
+
+static bool membership_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t ws, other_ws, ev;
+    ASSERT_EQ(mx_waitset_create(0u, &ws), MX_OK, "");
+    ASSERT_EQ(mx_waitset_create(0u, &other_ws), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev), MX_OK, "");
+
+    EXPECT_EQ(mx_waitset_create(1u, &other_ws), MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(mx_waitset_add(ws, 1u, ev, MX_EVENT_SIGNALED, 0x80u), MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(mx_waitset_add(ws, 1u, other_ws, MX_WAITSET_READABLE, 0u),
+              MX_ERR_NOT_SUPPORTED, "");
+    EXPECT_EQ(mx_waitset_add(ev, 1u, ws, MX_WAITSET_READABLE, 0u), MX_ERR_WRONG_TYPE, "");
+
+    EXPECT_EQ(mx_waitset_add(ws, 1u, ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_waitset_add(ws, 1u, ev, MX_EVENT_SIGNALED, 0u), MX_ERR_ALREADY_EXISTS, "");
+    EXPECT_EQ(mx_waitset_remove(ws, 2u), MX_ERR_NOT_FOUND, "");
+
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(get_signals(ws) & MX_WAITSET_READABLE, MX_WAITSET_READABLE, "");
+
+    // Removing a ready entry takes it off the ready list.
+    EXPECT_EQ(mx_waitset_remove(ws, 1u), MX_OK, "");
+    EXPECT_EQ(get_signals(ws) & MX_WAITSET_READABLE, 0u, "");
+    mx_waitset_result_t result;
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_ERR_TIMED_OUT, "");
+    EXPECT_EQ(mx_waitset_remove(ws, 1u), MX_ERR_NOT_FOUND, "");
+
+    // The cookie can be reused once removed.
+    EXPECT_EQ(mx_waitset_add(ws, 1u, ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_OK, "");
+    EXPECT_EQ(result.cookie, 1u, "");
+
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 0u, NULL), MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, MX_WAITSET_MAX_BATCH + 1u, NULL),
+              MX_ERR_OUT_OF_RANGE, "");
+
+    mx_handle_close(ev);
+    mx_handle_close(other_ws);
+    mx_handle_close(ws);
+
+    END_TEST;
+}
+
+static bool handle_close_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t ws, ev;
+    ASSERT_EQ(mx_waitset_create(0u, &ws), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev), MX_OK, "");
+
+    EXPECT_EQ(mx_waitset_add(ws, 3u, ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    mx_handle_close(ev);
+
+    // The entry reports the cancellation until it is removed.
+    mx_waitset_result_t result;
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_OK, "");
+        EXPECT_EQ(result.cookie, 3u, "");
+        EXPECT_EQ(result.status, MX_ERR_CANCELED, "");
+    }
+    EXPECT_EQ(mx_waitset_remove(ws, 3u), MX_OK, "");
+    EXPECT_EQ(mx_waitset_wait(ws, 0u, &result, 1u, NULL), MX_ERR_TIMED_OUT, "");
+
+    mx_handle_close(ws);
+
+    END_TEST;
+}
+
+static int signaler_thread(void* arg) {
+    mx_nanosleep(mx_deadline_after(MX_MSEC(10)));
+    mx_object_signal(*(mx_handle_t*)arg, 0u, MX_EVENT_SIGNALED);
+    return 0;
+}
+
+static bool handle_cycle_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t ws, ch[2], x[2];
+    ASSERT_EQ(mx_waitset_create(0u, &ws), MX_OK, "");
+    ASSERT_EQ(mx_channel_create(0u, &ch[0], &ch[1]), MX_OK, "");
+    ASSERT_EQ(mx_channel_create(0u, &x[0], &x[1]), MX_OK, "");
+
+    EXPECT_EQ(mx_waitset_add(ws, 1u, ch[0], MX_CHANNEL_READABLE, 0u), MX_OK, "");
+
+    // Queue the wait set on its own member, together with a witness whose
+    // peer is closed once the message is destroyed.
+    mx_handle_t handles[2] = {ws, x[0]};
+    EXPECT_EQ(mx_channel_write(ch[1], 0u, NULL, 0u, handles, 2u), MX_OK, "");
+
+    mx_handle_close(ch[1]);
+    mx_handle_close(ch[0]);
+
+    mx_signals_t pending;
+    EXPECT_EQ(mx_object_wait_one(x[1], MX_CHANNEL_PEER_CLOSED,
+                                 mx_deadline_after(MX_SEC(5)), &pending), MX_OK, "");
+    EXPECT_EQ(pending & MX_CHANNEL_PEER_CLOSED, MX_CHANNEL_PEER_CLOSED, "");
+
+    mx_handle_close(x[1]);
+
+    END_TEST;
+}
+
+static bool blocking_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t ws, ev;
+    ASSERT_EQ(mx_waitset_create(0u, &ws), MX_OK, "");
+    ASSERT_EQ(mx_event_create(0u, &ev), MX_OK, "");
+    EXPECT_EQ(mx_waitset_add(ws, 5u, ev, MX_EVENT_SIGNALED, MX_WAITSET_EDGE_TRIGGERED),
+              MX_OK, "");
+
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, signaler_thread, &ev), thrd_success, "");
+
+    mx_waitset_result_t result;
+    EXPECT_EQ(mx_waitset_wait(ws, MX_TIME_INFINITE, &result, 1u, NULL), MX_OK, "");
+    EXPECT_EQ(result.cookie, 5u, "");
+
+    EXPECT_EQ(thrd_join(thread, NULL), thrd_success, "");
+
+    mx_handle_close(ev);
+    mx_handle_close(ws);
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(waitset_tests)
+RUN_TEST(level_test)
+RUN_TEST(rotation_test)
+RUN_TEST(edge_test)
+RUN_TEST(membership_test)
+RUN_TEST(handle_close_test)
+RUN_TEST(handle_cycle_test)
+RUN_TEST(blocking_test)
+END_TEST_CASE(waitset_tests)
+
+#ifndef BUILD_COMBINED_TESTS
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
+#endif
@@ -0,0 +1,187 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include <magenta/device/sysinfo.h>
+#include <magenta/ktrace.h>
+#include <magenta/syscalls.h>
+#include <unittest/unittest.h>
+
+static mx_handle_t get_root_resource(void) {
+    int fd = open("/dev/misc/sysinfo", O_RDWR);
+    if (fd < 0)
+        return MX_HANDLE_INVALID;
+
+    mx_handle_t root_resource;
+    ssize_t n = ioctl_sysinfo_get_root_resource(fd, &root_resource);
+    close(fd);
+    return (n == sizeof(root_resource)) ? root_resource : MX_HANDLE_INVALID;
+}
+
+// Checks that the records returned by mx_ktrace_read() are well formed.
+static bool check_records(mx_handle_t root) {
+    BEGIN_HELPER;
+
+    uint32_t size;
+    ASSERT_EQ(mx_ktrace_read(root, NULL, 0u, 0u, &size), MX_OK, "");
+    uint8_t* buf = malloc(size);
+    ASSERT_NONNULL(buf, "");
+    uint32_t actual;
+    EXPECT_EQ(mx_ktrace_read(root, buf, 0u, size, &actual), MX_OK, "");
+    EXPECT_LE(actual, size, "");
+
+    uint32_t off = 0u;
+    while (off + sizeof(uint32_t) <= actual) {
+        uint32_t tag;
+        memcpy(&tag, buf + off, sizeof(tag));
+        uint32_t len = KTRACE_LEN(tag);
+        ASSERT_GE(len, (uint32_t)KTRACE_HDRSIZE, "truncated record");
+        ASSERT_LE(off + len, actual, "record past the end of the trace");
+        off += len;
+    }
+    EXPECT_EQ(off, actual, "");
+    free(buf);
+
+    END_HELPER;
+}
+
+static atomic_bool tracing;
+
+static int trace_thread(void* arg) {
+    mx_handle_t root = *(mx_handle_t*)arg;
+    for (uint32_t i = 0u; atomic_load(&tracing); i++)
+        mx_ktrace_write(root, 1u, i, 0u);
+    return 0;
+}
+
+// Changing modes and rewinding empties the trace buffer while other
+// threads keep writing records to it.
+static bool mode_change_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t root = get_root_resource();
+    ASSERT_NE(root, MX_HANDLE_INVALID, "no root resource");
+
+    atomic_store(&tracing, true);
+    thrd_t threads[4];
+    for (int i = 0; i < 4; i++)
+        ASSERT_EQ(thrd_create(&threads[i], trace_thread, &root), thrd_success, "");
+
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_START_CIRCULAR, 0u, NULL), MX_OK, "");
+        EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_REWIND, 0u, NULL), MX_OK, "");
+        EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_START, 0u, NULL), MX_OK, "");
+        EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_REWIND, 0u, NULL), MX_OK, "");
+    }
+
+    atomic_store(&tracing, false);
+    for (int i = 0; i < 4; i++)
+        EXPECT_EQ(thrd_join(threads[i], NULL), thrd_success, "");
+
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_STOP, 0u, NULL), MX_OK, "");
+    EXPECT_TRUE(check_records(root), "");
+
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_REWIND, 0u, NULL), MX_OK, "");
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_START, 0u, NULL), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(root), MX_OK, "");
+
+    END_TEST;
+}
+
+// Streams the records of a few mx_ktrace_write() calls.
+static bool stream_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t root = get_root_resource();
+    ASSERT_NE(root, MX_HANDLE_INVALID, "no root resource");
+
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_STOP, 0u, NULL), MX_OK, "");
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_REWIND, 0u, NULL), MX_OK, "");
+    // Only probes, so that nothing else fills the stream behind our back.
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_START, KTRACE_GRP_PROBE, NULL), MX_OK, "");
+
+    const uint32_t kSize = 1024u * 1024u;
+    const uint32_t kWatermark = 4096u;
+    uintptr_t addr;
+    mx_handle_t event;
+    ASSERT_EQ(mx_ktrace_stream(root, mx_vmar_root_self(), kSize, kWatermark, &addr, &event),
+              MX_OK, "");
+
+    // A second stream cannot start while this one runs.
+    uintptr_t addr2;
+    mx_handle_t event2;
+    EXPECT_EQ(mx_ktrace_stream(root, mx_vmar_root_self(), kSize, kWatermark, &addr2, &event2),
+              MX_ERR_BAD_STATE, "");
+
+    // The trace is only read through the stream while it runs.
+    uint32_t size;
+    EXPECT_EQ(mx_ktrace_read(root, NULL, 0u, 0u, &size), MX_ERR_BAD_STATE, "");
+
+    ktrace_stream_header_t* header = (ktrace_stream_header_t*)addr;
+    const uint8_t* data = (const uint8_t*)addr + KTRACE_STREAM_DATA_OFFSET;
+    EXPECT_EQ(header->size, kSize, "");
+    EXPECT_EQ(header->watermark, kWatermark, "");
+
+    const uint32_t kCount = 1000u;
+    for (uint32_t i = 0u; i < kCount; i++)
+        EXPECT_EQ(mx_ktrace_write(root, 1u, i, 0u), MX_OK, "");
+
+    // Nothing takes the records, so they fill the stream past the
+    // watermark, but not up to where it wraps around.
+    mx_signals_t pending;
+    EXPECT_EQ(mx_object_wait_one(event, MX_EVENT_SIGNALED, mx_deadline_after(MX_SEC(5)),
+                                 &pending), MX_OK, "");
+    uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    EXPECT_GE(head, (uint64_t)kWatermark, "");
+    ASSERT_LE(head, (uint64_t)kSize, "");
+
+    uint32_t found = 0u;
+    uint32_t off = 0u;
+    while (off + sizeof(uint32_t) <= head) {
+        uint32_t tag;
+        memcpy(&tag, data + off, sizeof(tag));
+        uint32_t len = KTRACE_LEN(tag);
+        ASSERT_GE(len, (uint32_t)KTRACE_HDRSIZE, "truncated record");
+        ASSERT_LE(off + len, head, "record past the head");
+        if (tag == TAG_PROBE_24(1u)) {
+            ktrace_rec_32b_t rec;
+            memcpy(&rec, data + off, len);
+            EXPECT_EQ(rec.a, found, "records out of order");
+            found++;
+        }
+        off += len;
+    }
+    EXPECT_GT(found, 0u, "");
+
+    // Taking the records lowers the fill level below the watermark.
+    __atomic_store_n(&header->tail, head, __ATOMIC_RELEASE);
+    EXPECT_EQ(mx_object_wait_one(event, MX_EVENT_SIGNALED, mx_deadline_after(MX_MSEC(100)),
+                                 &pending), MX_ERR_TIMED_OUT, "");
+
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_STOP, 0u, NULL), MX_OK, "");
+    EXPECT_EQ(mx_vmar_unmap(mx_vmar_root_self(), addr, KTRACE_STREAM_DATA_OFFSET + kSize),
+              MX_OK, "");
+    EXPECT_EQ(mx_handle_close(event), MX_OK, "");
+
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_REWIND, 0u, NULL), MX_OK, "");
+    EXPECT_EQ(mx_ktrace_control(root, KTRACE_ACTION_START, 0u, NULL), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(root), MX_OK, "");
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(ktrace_tests)
+RUN_TEST(mode_change_test)
+RUN_TEST(stream_test)
+END_TEST_CASE(ktrace_tests)
+
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
@@ -0,0 +1,102 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <magenta/device/sysinfo.h>
+#include <magenta/mtrace.h>
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/object.h>
+#include <unittest/unittest.h>
+
+static mx_handle_t get_root_resource(void) {
+    int fd = open("/dev/misc/sysinfo", O_RDWR);
+    if (fd < 0)
+        return MX_HANDLE_INVALID;
+
+    mx_handle_t root_resource;
+    ssize_t n = ioctl_sysinfo_get_root_resource(fd, &root_resource);
+    close(fd);
+    return (n == sizeof(root_resource)) ? root_resource : MX_HANDLE_INVALID;
+}
+
+static mx_status_t profile_control(mx_handle_t root, uint32_t action, uint32_t options,
+                                   void* arg, uint32_t size) {
+    return mx_mtrace_control(root, MTRACE_KIND_PROFILE, action, options, arg, size);
+}
+
+// Samples a thread that spins for a while, and finds it in the samples.
+static bool profile_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t root = get_root_resource();
+    ASSERT_NE(root, MX_HANDLE_INVALID, "no root resource");
+
+    mx_info_handle_basic_t info;
+    ASSERT_EQ(mx_object_get_info(mx_process_self(), MX_INFO_HANDLE_BASIC, &info, sizeof(info),
+                                 NULL, NULL), MX_OK, "");
+
+    uint32_t frequency = MTRACE_PROFILE_MAX_FREQUENCY + 1u;
+    EXPECT_EQ(profile_control(root, MTRACE_PROFILE_START, 0u, &frequency, sizeof(frequency)),
+              MX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(profile_control(root, MTRACE_PROFILE_STOP, 0u, NULL, 0u), MX_ERR_BAD_STATE, "");
+
+    frequency = 1000u;
+    ASSERT_EQ(profile_control(root, MTRACE_PROFILE_START, 0u, &frequency, sizeof(frequency)),
+              MX_OK, "");
+    EXPECT_EQ(profile_control(root, MTRACE_PROFILE_START, 0u, &frequency, sizeof(frequency)),
+              MX_ERR_BAD_STATE, "");
+    EXPECT_EQ(profile_control(root, MTRACE_PROFILE_FREE, 0u, NULL, 0u), MX_ERR_BAD_STATE, "");
+
+    mx_time_t deadline = mx_deadline_after(MX_MSEC(200));
+    while (mx_time_get(MX_CLOCK_MONOTONIC) < deadline)
+        ;
+
+    EXPECT_EQ(profile_control(root, MTRACE_PROFILE_STOP, 0u, NULL, 0u), MX_OK, "");
+
+    const uint32_t kBatch = 64u;
+    mx_mtrace_profile_sample_t* samples = malloc(kBatch * sizeof(*samples));
+    ASSERT_NONNULL(samples, "");
+
+    uint32_t total = 0u;
+    uint32_t ours = 0u;
+    uint32_t num_cpus = mx_system_get_num_cpus();
+    for (uint32_t cpu = 0u; cpu < num_cpus; cpu++) {
+        for (;;) {
+            ASSERT_EQ(profile_control(root, MTRACE_PROFILE_READ_CPU, cpu, samples,
+                                      kBatch * sizeof(*samples)), MX_OK, "");
+            uint32_t n = 0u;
+            while (n < kBatch && samples[n].time != 0) {
+                EXPECT_GE(samples[n].num_pcs, 1u, "");
+                EXPECT_LE(samples[n].num_pcs, MTRACE_PROFILE_MAX_PCS, "");
+                if (samples[n].pid == info.koid &&
+                    (samples[n].flags & MTRACE_PROFILE_SAMPLE_USER))
+                    ours++;
+                n++;
+            }
+            total += n;
+            if (n < kBatch)
+                break;
+        }
+    }
+    free(samples);
+
+    EXPECT_GT(total, 0u, "no samples");
+    EXPECT_GT(ours, 0u, "no samples of the spinning thread");
+
+    EXPECT_EQ(profile_control(root, MTRACE_PROFILE_FREE, 0u, NULL, 0u), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(root), MX_OK, "");
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(mtrace_tests)
+RUN_TEST(profile_test)
+END_TEST_CASE(mtrace_tests)
+
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
@@ -283,12 +283,63 @@ static bool bad_importance_value_fails(void) {
     END_TEST;
 }
 
+static bool syscall_stats_test(void) {
+    BEGIN_TEST;
+
+    mx_handle_t self = mx_process_self();
+    uint32_t value = 1;
+    ASSERT_EQ(mx_object_set_property(self, MX_PROP_SYSCALL_STATS, &value, sizeof(value)),
+              MX_OK, "");
+    value = 0;
+    EXPECT_EQ(mx_object_get_property(self, MX_PROP_SYSCALL_STATS, &value, sizeof(value)),
+              MX_OK, "");
+    EXPECT_EQ(value, 1u, "");
+
+    const uint32_t kCalls = 10;
+    for (uint32_t i = 0; i < kCalls; i++) {
+        mx_handle_t event;
+        ASSERT_EQ(mx_event_create(0u, &event), MX_OK, "");
+        mx_handle_close(event);
+    }
+
+    mx_info_syscall_stats_t stats[256];
+    size_t actual, avail;
+    ASSERT_EQ(mx_object_get_info(self, MX_INFO_SYSCALL_STATS, stats, sizeof(stats),
+                                 &actual, &avail), MX_OK, "");
+    EXPECT_EQ(actual, avail, "");
+    bool found = false;
+    for (size_t i = 0; i < actual; i++) {
+        if (strcmp(stats[i].name, "event_create") != 0)
+            continue;
+        found = true;
+        EXPECT_GE(stats[i].count, kCalls, "");
+        EXPECT_GE(stats[i].total_time, stats[i].max_time, "");
+        uint64_t histogram_total = 0;
+        for (uint32_t b = 0; b < MX_INFO_SYSCALL_STATS_BUCKETS; b++)
+            histogram_total += stats[i].histogram[b];
+        EXPECT_EQ(histogram_total, stats[i].count, "");
+    }
+    EXPECT_TRUE(found, "event_create not counted");
+
+    value = 0;
+    EXPECT_EQ(mx_object_set_property(self, MX_PROP_SYSCALL_STATS, &value, sizeof(value)),
+              MX_OK, "");
+
+    // Only processes and jobs count syscalls.
+    EXPECT_EQ(mx_object_set_property(mx_thread_self(), MX_PROP_SYSCALL_STATS,
+                                     &value, sizeof(value)),
+              MX_ERR_WRONG_TYPE, "");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(property_tests)
 RUN_TEST(process_name_test);
 RUN_TEST(thread_name_test);
 RUN_TEST(vmo_name_test);
 RUN_TEST(importance_smoke_test);
 RUN_TEST(bad_importance_value_fails);
+RUN_TEST(syscall_stats_test);
 END_TEST_CASE(property_tests)
 
 int main(int argc, char** argv) {
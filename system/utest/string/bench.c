@@ -0,0 +1,99 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <magenta/compiler.h>
+#include <magenta/syscalls.h>
+
+#include "c-string.h"
+
+#define BUFFER_SIZE (64 * 1024)
+
+static const size_t sizes[] = {8, 16, 32, 64, 128, 256, 1024, 4096, BUFFER_SIZE};
+
+// spin the cpu a bit to make sure the frequency is cranked to the top
+static void spin(mx_time_t nanosecs) {
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+
+    while (mx_time_get(MX_CLOCK_MONOTONIC) - t < nanosecs)
+        ;
+}
+
+// Calls are made through these so the compiler cannot see which function
+// it is calling, or that the result is unused.
+typedef void* (*memchr_fn)(const void*, int, size_t);
+typedef int (*memcmp_fn)(const void*, const void*, size_t);
+typedef size_t (*strlen_fn)(const char*);
+
+static volatile uintptr_t sink;
+
+// Returns the nanoseconds per call of |fn| on inputs of |len| bytes that
+// are scanned to the end.
+static mx_time_t time_memchr(memchr_fn fn, const uint8_t* buf, size_t len, size_t iters) {
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+    for (size_t i = 0; i < iters; i++)
+        sink += (uintptr_t)fn(buf, 1, len);
+    return (mx_time_get(MX_CLOCK_MONOTONIC) - t) / iters;
+}
+
+static mx_time_t time_memcmp(memcmp_fn fn, const uint8_t* a, const uint8_t* b, size_t len,
+                             size_t iters) {
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+    for (size_t i = 0; i < iters; i++)
+        sink += fn(a, b, len);
+    return (mx_time_get(MX_CLOCK_MONOTONIC) - t) / iters;
+}
+
+static mx_time_t time_strlen(strlen_fn fn, const char* s, size_t iters) {
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+    for (size_t i = 0; i < iters; i++)
+        sink += fn(s);
+    return (mx_time_get(MX_CLOCK_MONOTONIC) - t) / iters;
+}
+
+static void report(const char* name, size_t len, mx_time_t libc, mx_time_t c) {
+    printf("%-8s %6zu bytes: libc %8" PRIu64 " ns, C %8" PRIu64 " ns\n", name, len, libc, c);
+}
+
+int string_run_benchmark(void) {
+    uint8_t* a = malloc(BUFFER_SIZE + 1);
+    uint8_t* b = malloc(BUFFER_SIZE + 1);
+    if (a == NULL || b == NULL) {
+        printf("out of memory\n");
+        free(a);
+        free(b);
+        return -1;
+    }
+    memset(a, 'x', BUFFER_SIZE + 1);
+    memset(b, 'x', BUFFER_SIZE + 1);
+
+    printf("starting string benchmark\n");
+    spin(MX_MSEC(10));
+
+    for (size_t i = 0; i < countof(sizes); i++) {
+        size_t len = sizes[i];
+        size_t iters = (64 * 1024 * 1024) / len;
+        if (iters > 1000000)
+            iters = 1000000;
+
+        report("memchr", len, time_memchr(memchr, a, len, iters),
+               time_memchr(c_memchr, a, len, iters));
+        report("memcmp", len, time_memcmp(memcmp, a, b, len, iters),
+               time_memcmp(c_memcmp, a, b, len, iters));
+
+        a[len] = '\0';
+        report("strlen", len, time_strlen(strlen, (const char*)a, iters),
+               time_strlen(c_strlen, (const char*)a, iters));
+        a[len] = 'x';
+    }
+
+    printf("done with benchmark\n");
+    free(a);
+    free(b);
+    return 0;
+}
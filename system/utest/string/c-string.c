@@ -0,0 +1,27 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Builds musl's portable string routines under other names, so that they
+// can run alongside the versions libc picked for this machine.
+
+#include <string.h>
+
+#include "c-string.h"
+
+#define memchr c_memchr
+#include "../../../third_party/ulib/musl/src/string/memchr.c"
+#undef memchr
+#undef SS
+#undef ALIGN
+#undef ONES
+#undef HIGHS
+#undef HASZERO
+
+#define memcmp c_memcmp
+#include "../../../third_party/ulib/musl/src/string/memcmp.c"
+#undef memcmp
+
+#define strlen c_strlen
+#include "../../../third_party/ulib/musl/src/string/strlen.c"
+#undef strlen
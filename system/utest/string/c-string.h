@@ -0,0 +1,15 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+
+// The portable C versions of the libc string routines, which the tests and
+// the benchmark compare libc's own against.
+void* c_memchr(const void* src, int c, size_t n);
+int c_memcmp(const void* vl, const void* vr, size_t n);
+size_t c_strlen(const char* s);
+
+int string_run_benchmark(void);
@@ -0,0 +1,171 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <unittest/unittest.h>
+
+#include "c-string.h"
+
+// libc's string routines read their inputs a vector at a time. Each test
+// puts its inputs at every alignment and length at the end of a page that
+// is followed by an inaccessible one, so a read past the end faults.
+#define MAX_LEN 300
+#define ITERATIONS 20000
+
+static uint8_t* guarded;
+static size_t page_size;
+
+static bool map_guarded(void) {
+    BEGIN_HELPER;
+    page_size = sysconf(_SC_PAGESIZE);
+    void* p = mmap(NULL, 2 * page_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(p, MAP_FAILED, "mmap");
+    ASSERT_EQ(mprotect((uint8_t*)p + page_size, page_size, PROT_NONE), 0, "mprotect");
+    guarded = p;
+    END_HELPER;
+}
+
+static void unmap_guarded(void) {
+    munmap(guarded, 2 * page_size);
+    guarded = NULL;
+}
+
+// Returns |len| bytes ending right at the guard page, filled with random
+// bytes drawn from a small alphabet so that matches are common.
+static uint8_t* random_buffer(size_t len) {
+    uint8_t* buf = guarded + page_size - len;
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(rand() % 8 * 37);
+    return buf;
+}
+
+static void* ref_memchr(const void* s, int c, size_t n) {
+    const uint8_t* p = s;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == (uint8_t)c)
+            return (void*)(p + i);
+    }
+    return NULL;
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+static bool memchr_test(void) {
+    BEGIN_TEST;
+    ASSERT_TRUE(map_guarded(), "");
+    srand(1);
+    for (int i = 0; i < ITERATIONS; i++) {
+        size_t len = rand() % MAX_LEN;
+        uint8_t* buf = random_buffer(len);
+        int c = rand() % 8 * 37;
+        size_t n = rand() % 4 ? len : rand() % (len + 1);
+        if (memchr(buf, c, n) != ref_memchr(buf, c, n)) {
+            unittest_printf("len %zu n %zu c %d\n", len, n, c);
+            EXPECT_TRUE(false, "memchr");
+            break;
+        }
+        EXPECT_EQ(c_memchr(buf, c, n), ref_memchr(buf, c, n), "c_memchr");
+    }
+    unmap_guarded();
+    END_TEST;
+}
+
+static bool memcmp_test(void) {
+    BEGIN_TEST;
+    ASSERT_TRUE(map_guarded(), "");
+    uint8_t* other = malloc(MAX_LEN + 64);
+    ASSERT_NONNULL(other, "");
+    srand(2);
+    for (int i = 0; i < ITERATIONS; i++) {
+        size_t len = rand() % MAX_LEN;
+        uint8_t* buf = random_buffer(len);
+        uint8_t* r = other + rand() % 64;
+        memcpy(r, buf, len);
+        // Change at most one byte, most often near the end.
+        if (len > 0 && rand() % 4) {
+            size_t at = rand() % 2 ? len - 1 - rand() % (len < 20 ? len : 20) : rand() % len;
+            r[at] = (uint8_t)rand();
+        }
+        int ref = sign(c_memcmp(buf, r, len));
+        if (sign(memcmp(buf, r, len)) != ref || sign(memcmp(r, buf, len)) != -ref) {
+            unittest_printf("len %zu\n", len);
+            EXPECT_TRUE(false, "memcmp");
+            break;
+        }
+    }
+    free(other);
+    unmap_guarded();
+    END_TEST;
+}
+
+static bool strlen_test(void) {
+    BEGIN_TEST;
+    ASSERT_TRUE(map_guarded(), "");
+    srand(3);
+    for (int i = 0; i < ITERATIONS; i++) {
+        size_t len = rand() % MAX_LEN + 1;
+        uint8_t* buf = random_buffer(len);
+        for (size_t j = 0; j < len; j++)
+            buf[j] |= 1;
+        buf[len - 1] = '\0';
+        size_t at = rand() % len;
+        if (rand() % 2)
+            buf[at] = '\0';
+        else
+            at = len - 1;
+        const char* s = (const char*)buf;
+        if (strlen(s) != at || strnlen(s, len) != at || strnlen(s, at / 2) != at / 2) {
+            unittest_printf("len %zu at %zu\n", len, at);
+            EXPECT_TRUE(false, "strlen");
+            break;
+        }
+        EXPECT_EQ(c_strlen(s), at, "c_strlen");
+    }
+    unmap_guarded();
+    END_TEST;
+}
+
+static bool strchr_test(void) {
+    BEGIN_TEST;
+    ASSERT_TRUE(map_guarded(), "");
+    srand(4);
+    for (int i = 0; i < ITERATIONS; i++) {
+        size_t len = rand() % MAX_LEN + 1;
+        uint8_t* buf = random_buffer(len);
+        buf[len - 1] = '\0';
+        const char* s = (const char*)buf;
+        int c = rand() % 8 == 0 ? 0 : rand() % 8 * 37;
+        size_t end = strlen(s);
+        const char* found = ref_memchr(s, c, end + 1);
+        if (strchrnul(s, c) != (found != NULL ? found : s + end) || strchr(s, c) != found) {
+            unittest_printf("len %zu c %d\n", len, c);
+            EXPECT_TRUE(false, "strchr");
+            break;
+        }
+    }
+    unmap_guarded();
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(string_tests)
+RUN_TEST(memchr_test)
+RUN_TEST(memcmp_test)
+RUN_TEST(strlen_test)
+RUN_TEST(strchr_test)
+END_TEST_CASE(string_tests)
+
+int main(int argc, char** argv) {
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        return string_run_benchmark();
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
@@ -1865,6 +1865,9 @@ __NO_SAFESTACK NO_ASAN static void early_init(void) {
     // Inform the loader service that we prefer ASan-supporting libraries.
     loader_svc_config("asan");
 #endif
+#ifdef __x86_64__
+    __init_string_impls();
+#endif
 }
 
 static void set_global(struct dso* p, int global) {
@@ -1,7 +1,7 @@
 #include "pthread_impl.h"
 
 int pthread_mutex_timedlock(pthread_mutex_t* restrict m, const struct timespec* restrict at) {
-    if ((m->_m_type & PTHREAD_MUTEX_MASK) == PTHREAD_MUTEX_NORMAL &&
+    if (m->_m_type == PTHREAD_MUTEX_NORMAL &&
         !a_cas_shim(&m->_m_lock, 0, EBUSY))
         return 0;
 
@@ -18,14 +18,20 @@ int pthread_mutex_timedlock(pthread_mutex_t* restrict m, const struct timespec*
     while ((r = pthread_mutex_trylock(m)) == EBUSY) {
         if (!(r = atomic_load(&m->_m_lock)))
             continue;
-        if ((m->_m_type & PTHREAD_MUTEX_MASK) == PTHREAD_MUTEX_ERRORCHECK &&
-            (r & PTHREAD_MUTEX_OWNED_LOCK_MASK) == __thread_get_tid())
+        int self = (r & PTHREAD_MUTEX_OWNED_LOCK_MASK) == __thread_get_tid();
+        if ((m->_m_type & PTHREAD_MUTEX_MASK) == PTHREAD_MUTEX_ERRORCHECK && self)
             return EDEADLK;
 
         atomic_fetch_add(&m->_m_waiters, 1);
         t = r | PTHREAD_MUTEX_OWNED_LOCK_BIT;
         a_cas_shim(&m->_m_lock, r, t);
-        r = __timedwait(&m->_m_lock, t, CLOCK_REALTIME, at);
+        // The kernel refuses to make a thread wait on itself, so relocking
+        // a priority inheriting mutex we own deadlocks like any other.
+        if ((m->_m_type & PTHREAD_MUTEX_PRIO_INHERIT_BIT) && !self)
+            r = __timedwait_owner(&m->_m_lock, t, t & PTHREAD_MUTEX_OWNED_LOCK_MASK,
+                                  CLOCK_REALTIME, at);
+        else
+            r = __timedwait(&m->_m_lock, t, CLOCK_REALTIME, at);
         atomic_fetch_sub(&m->_m_waiters, 1);
         if (r)
             break;
@@ -7,7 +7,7 @@ int pthread_mutex_unlock(pthread_mutex_t* m) {
     int cont;
     int type = m->_m_type & PTHREAD_MUTEX_MASK;
 
-    if (type != PTHREAD_MUTEX_NORMAL) {
+    if (m->_m_type != PTHREAD_MUTEX_NORMAL) {
         if ((atomic_load(&m->_m_lock) & PTHREAD_MUTEX_OWNED_LOCK_MASK) != __thread_get_tid())
             return EPERM;
         if ((type & PTHREAD_MUTEX_MASK) == PTHREAD_MUTEX_RECURSIVE && m->_m_count)
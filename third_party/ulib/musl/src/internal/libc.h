@@ -48,6 +48,12 @@ extern char *__progname, *__progname_full;
 
 void __libc_start_init(void) ATTR_LIBC_VISIBILITY;
 
+#ifdef __x86_64__
+// Points the string routines that have several versions at the best one
+// for this cpu.  Called once by the dynamic linker at startup.
+void __init_string_impls(void) ATTR_LIBC_VISIBILITY;
+#endif
+
 void __funcs_on_exit(void) ATTR_LIBC_VISIBILITY;
 void __funcs_on_quick_exit(void) ATTR_LIBC_VISIBILITY;
 void __libc_exit_fini(void) ATTR_LIBC_VISIBILITY;
@@ -125,6 +125,9 @@ static inline struct pthread* tp_to_pthread(void* tp) {
 // The bit used in the recursive and errorchecking cases, which track thread owners.
 #define PTHREAD_MUTEX_OWNED_LOCK_BIT 0x80000000
 #define PTHREAD_MUTEX_OWNED_LOCK_MASK 0x7fffffff
+// Set in the attribute and type of PTHREAD_PRIO_INHERIT mutexes. These track
+// their owner whatever their type, and name it to the kernel when waiting.
+#define PTHREAD_MUTEX_PRIO_INHERIT_BIT 8
 
 extern void* __pthread_tsd_main[];
 extern volatile size_t __pthread_tsd_size;
@@ -155,6 +158,11 @@ void __private_cond_signal(void* condvar, int n);
 int __timedwait(atomic_int*, int, clockid_t, const struct timespec*)
     ATTR_LIBC_VISIBILITY;
 
+// As __timedwait, but while waiting the thread whose handle is |owner|
+// inherits the caller's priority.
+int __timedwait_owner(atomic_int*, int, mx_handle_t owner, clockid_t, const struct timespec*)
+    ATTR_LIBC_VISIBILITY;
+
 // Loading a library can introduce more thread_local variables. Thread
 // allocation bases bookkeeping decisions based on the current state
 // of thread_locals in the program, so thread creation needs to be
@@ -0,0 +1,45 @@
+#include <string.h>
+
+#include <magenta/compiler.h>
+
+#if __has_feature(address_sanitizer)
+
+// See strlen.c.
+#include "../memchr.c"
+
+#else
+
+#include "neon-mask.h"
+
+void* memchr(const void* src, int c, size_t n) {
+    if (!n)
+        return 0;
+    // Only aligned blocks are read, so we never touch a page that holds
+    // none of the buffer.
+    const uint8_t* s = src;
+    uintptr_t off = (uintptr_t)s % 16;
+    const uint8_t* p = s - off;
+    const uint8x16_t needle = vdupq_n_u8((uint8_t)c);
+    uint64_t mask = neon_nibble_mask(vceqq_u8(vld1q_u8(p), needle)) >> (off * 4);
+    if (mask) {
+        size_t i = neon_mask_index(mask);
+        return i < n ? (void*)(s + i) : 0;
+    }
+    if (n <= 16 - off)
+        return 0;
+    // From here on |n| counts the bytes left from |p|.
+    n -= 16 - off;
+    for (;;) {
+        p += 16;
+        mask = neon_nibble_mask(vceqq_u8(vld1q_u8(p), needle));
+        if (mask) {
+            size_t i = neon_mask_index(mask);
+            return i < n ? (void*)(p + i) : 0;
+        }
+        if (n <= 16)
+            return 0;
+        n -= 16;
+    }
+}
+
+#endif
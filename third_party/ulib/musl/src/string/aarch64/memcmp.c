@@ -0,0 +1,28 @@
+#include <string.h>
+
+#include "neon-mask.h"
+
+// This only reads bytes inside the buffers, so it is used under ASan too.
+int memcmp(const void* vl, const void* vr, size_t n) {
+    const unsigned char *l = vl, *r = vr;
+    if (n < 16) {
+        for (; n && *l == *r; n--, l++, r++)
+            ;
+        return n ? *l - *r : 0;
+    }
+    size_t i = 0;
+    for (;;) {
+        uint8x16_t ne = vmvnq_u8(vceqq_u8(vld1q_u8(l + i), vld1q_u8(r + i)));
+        uint64_t mask = neon_nibble_mask(ne);
+        if (mask) {
+            size_t d = i + neon_mask_index(mask);
+            return l[d] - r[d];
+        }
+        i += 16;
+        if (i >= n)
+            return 0;
+        // The last block may overlap bytes already found equal.
+        if (n - i < 16)
+            i = n - 16;
+    }
+}
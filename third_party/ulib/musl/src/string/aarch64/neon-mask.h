@@ -0,0 +1,19 @@
+#pragma once
+
+#include <arm_neon.h>
+#include <stdint.h>
+
+// NEON has no instruction that gathers one bit from each byte of a vector.
+// Instead, narrow each 16-bit lane by four bits, which leaves four bits in
+// the result for each byte of |v|.  For a vector of comparison results
+// (each byte 0 or 0xff), byte i is set when bits 4i..4i+3 are.
+static inline uint64_t neon_nibble_mask(uint8x16_t v) {
+    uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+}
+
+// The index of the first byte whose bits are set in |mask|, which must
+// not be zero.
+static inline unsigned neon_mask_index(uint64_t mask) {
+    return __builtin_ctzll(mask) / 4;
+}
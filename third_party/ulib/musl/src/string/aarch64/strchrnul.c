@@ -0,0 +1,37 @@
+#include "libc.h"
+#include <string.h>
+
+#include <magenta/compiler.h>
+
+#if __has_feature(address_sanitizer)
+
+// See strlen.c.
+#include "../strchrnul.c"
+
+#else
+
+#include "neon-mask.h"
+
+// This looks for either the terminator or |c|, so searching for 0 needs no
+// special case.
+char* __strchrnul(const char* s, int c) {
+    uintptr_t off = (uintptr_t)s % 16;
+    const uint8_t* p = (const uint8_t*)s - off;
+    const uint8x16_t needle = vdupq_n_u8((uint8_t)c);
+    uint8x16_t v = vld1q_u8(p);
+    uint64_t mask = neon_nibble_mask(vorrq_u8(vceqq_u8(v, vdupq_n_u8(0)),
+                                              vceqq_u8(v, needle))) >> (off * 4);
+    if (mask)
+        return (char*)s + neon_mask_index(mask);
+    for (;;) {
+        p += 16;
+        v = vld1q_u8(p);
+        mask = neon_nibble_mask(vorrq_u8(vceqq_u8(v, vdupq_n_u8(0)), vceqq_u8(v, needle)));
+        if (mask)
+            return (char*)p + neon_mask_index(mask);
+    }
+}
+
+weak_alias(__strchrnul, strchrnul);
+
+#endif
@@ -4,8 +4,6 @@ LOCAL_SRCS += \
     $(GET_LOCAL_DIR)/bzero.c \
     $(GET_LOCAL_DIR)/index.c \
     $(GET_LOCAL_DIR)/memccpy.c \
-    $(GET_LOCAL_DIR)/memchr.c \
-    $(GET_LOCAL_DIR)/memcmp.c \
     $(GET_LOCAL_DIR)/memmem.c \
     $(GET_LOCAL_DIR)/memrchr.c \
     $(GET_LOCAL_DIR)/rindex.c \
@@ -15,7 +13,6 @@ LOCAL_SRCS += \
     $(GET_LOCAL_DIR)/strcasestr.c \
     $(GET_LOCAL_DIR)/strcat.c \
     $(GET_LOCAL_DIR)/strchr.c \
-    $(GET_LOCAL_DIR)/strchrnul.c \
     $(GET_LOCAL_DIR)/strcmp.c \
     $(GET_LOCAL_DIR)/strcpy.c \
     $(GET_LOCAL_DIR)/strcspn.c \
@@ -23,7 +20,6 @@ LOCAL_SRCS += \
     $(GET_LOCAL_DIR)/strerror_r.c \
     $(GET_LOCAL_DIR)/strlcat.c \
     $(GET_LOCAL_DIR)/strlcpy.c \
-    $(GET_LOCAL_DIR)/strlen.c \
     $(GET_LOCAL_DIR)/strncasecmp.c \
     $(GET_LOCAL_DIR)/strncat.c \
     $(GET_LOCAL_DIR)/strncmp.c \
@@ -69,6 +65,10 @@ LOCAL_SRCS += \
 
 ifeq ($(ARCH),arm64)
 LOCAL_SRCS += \
+    $(GET_LOCAL_DIR)/aarch64/memchr.c \
+    $(GET_LOCAL_DIR)/aarch64/memcmp.c \
+    $(GET_LOCAL_DIR)/aarch64/strchrnul.c \
+    $(GET_LOCAL_DIR)/aarch64/strlen.c \
     $(GET_LOCAL_DIR)/memcpy.c \
     $(GET_LOCAL_DIR)/memmove.c \
     $(GET_LOCAL_DIR)/mempcpy.c \
@@ -76,6 +76,11 @@ LOCAL_SRCS += \
 
 else ifeq ($(SUBARCH),x86-64)
 LOCAL_SRCS += \
+    $(GET_LOCAL_DIR)/x86_64/memchr.c \
+    $(GET_LOCAL_DIR)/x86_64/memcmp.c \
+    $(GET_LOCAL_DIR)/x86_64/strchrnul.c \
+    $(GET_LOCAL_DIR)/x86_64/string-impls.c \
+    $(GET_LOCAL_DIR)/x86_64/strlen.c \
     $(GET_LOCAL_DIR)/x86_64/memcpy.S \
     $(GET_LOCAL_DIR)/x86_64/memmove.S \
     $(GET_LOCAL_DIR)/x86_64/mempcpy.S \
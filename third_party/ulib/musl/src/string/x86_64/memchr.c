@@ -0,0 +1,84 @@
+#include <string.h>
+
+#include <magenta/compiler.h>
+
+#if __has_feature(address_sanitizer)
+
+// See strlen.c.
+#include "../memchr.c"
+
+#else
+
+#include "string-impls.h"
+#include <immintrin.h>
+#include <stdint.h>
+
+static void* memchr_sse2(const void* src, int c, size_t n) {
+    if (!n)
+        return 0;
+    // Only aligned blocks are read, so we never touch a page that holds
+    // none of the buffer.
+    const unsigned char* s = src;
+    uintptr_t off = (uintptr_t)s % 16;
+    const unsigned char* p = s - off;
+    const __m128i needle = _mm_set1_epi8((char)c);
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)p), needle)) >> off;
+    if (mask) {
+        size_t i = __builtin_ctz(mask);
+        return i < n ? (void*)(s + i) : 0;
+    }
+    if (n <= 16 - off)
+        return 0;
+    // From here on |n| counts the bytes left from |p|.
+    n -= 16 - off;
+    for (;;) {
+        p += 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)p), needle));
+        if (mask) {
+            size_t i = __builtin_ctz(mask);
+            return i < n ? (void*)(p + i) : 0;
+        }
+        if (n <= 16)
+            return 0;
+        n -= 16;
+    }
+}
+
+__attribute__((target("avx2"))) void* __memchr_avx2(const void* src, int c, size_t n) {
+    if (!n)
+        return 0;
+    const unsigned char* s = src;
+    uintptr_t off = (uintptr_t)s % 32;
+    const unsigned char* p = s - off;
+    const __m256i needle = _mm256_set1_epi8((char)c);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)p), needle)) >> off;
+    if (mask) {
+        size_t i = __builtin_ctz(mask);
+        return i < n ? (void*)(s + i) : 0;
+    }
+    if (n <= 32 - off)
+        return 0;
+    n -= 32 - off;
+    for (;;) {
+        p += 32;
+        mask = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)p), needle));
+        if (mask) {
+            size_t i = __builtin_ctz(mask);
+            return i < n ? (void*)(p + i) : 0;
+        }
+        if (n <= 32)
+            return 0;
+        n -= 32;
+    }
+}
+
+void* (*__memchr_impl)(const void*, int, size_t) ATTR_RELRO = memchr_sse2;
+
+void* memchr(const void* src, int c, size_t n) {
+    return __memchr_impl(src, c, n);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "string-impls.h"
+#include <immintrin.h>
+
+// Unlike the other routines here, these only read bytes inside the buffers,
+// so they are used under ASan too.
+
+static int memcmp_bytes(const unsigned char* l, const unsigned char* r, size_t n) {
+    for (; n && *l == *r; n--, l++, r++)
+        ;
+    return n ? *l - *r : 0;
+}
+
+// Returns the index of the first of the 16 bytes at |l| and |r| that
+// differs, or 16.
+static inline unsigned diff16(const unsigned char* l, const unsigned char* r) {
+    __m128i x = _mm_loadu_si128((const __m128i*)l);
+    __m128i y = _mm_loadu_si128((const __m128i*)r);
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffffu;
+    return mask ? __builtin_ctz(mask) : 16;
+}
+
+static int memcmp_sse2(const void* vl, const void* vr, size_t n) {
+    const unsigned char *l = vl, *r = vr;
+    if (n < 16)
+        return memcmp_bytes(l, r, n);
+    size_t i = 0;
+    for (;;) {
+        unsigned d = diff16(l + i, r + i);
+        if (d < 16)
+            return l[i + d] - r[i + d];
+        i += 16;
+        if (i >= n)
+            return 0;
+        // The last block may overlap bytes already found equal.
+        if (n - i < 16)
+            i = n - 16;
+    }
+}
+
+static inline __attribute__((target("avx2")))
+unsigned diff32(const unsigned char* l, const unsigned char* r) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)l);
+    __m256i y = _mm256_loadu_si256((const __m256i*)r);
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+    return mask ? __builtin_ctz(mask) : 32;
+}
+
+__attribute__((target("avx2"))) int __memcmp_avx2(const void* vl, const void* vr, size_t n) {
+    const unsigned char *l = vl, *r = vr;
+    if (n < 32)
+        return memcmp_sse2(l, r, n);
+    size_t i = 0;
+    for (;;) {
+        unsigned d = diff32(l + i, r + i);
+        if (d < 32)
+            return l[i + d] - r[i + d];
+        i += 32;
+        if (i >= n)
+            return 0;
+        if (n - i < 32)
+            i = n - 32;
+    }
+}
+
+int (*__memcmp_impl)(const void*, const void*, size_t) ATTR_RELRO = memcmp_sse2;
+
+int memcmp(const void* vl, const void* vr, size_t n) {
+    return __memcmp_impl(vl, vr, n);
+}
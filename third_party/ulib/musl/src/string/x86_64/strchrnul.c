@@ -0,0 +1,68 @@
+#include "libc.h"
+#include <string.h>
+
+#include <magenta/compiler.h>
+
+#if __has_feature(address_sanitizer)
+
+// See strlen.c.
+#include "../strchrnul.c"
+
+#else
+
+#include "string-impls.h"
+#include <immintrin.h>
+#include <stdint.h>
+
+// These look for either the terminator or |c|, so searching for 0 needs no
+// special case.
+
+static char* strchrnul_sse2(const char* s, int c) {
+    uintptr_t off = (uintptr_t)s % 16;
+    const __m128i* p = (const __m128i*)(s - off);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i needle = _mm_set1_epi8((char)c);
+    __m128i v = _mm_load_si128(p);
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, needle))) >> off;
+    if (mask)
+        return (char*)s + __builtin_ctz(mask);
+    for (;;) {
+        ++p;
+        v = _mm_load_si128(p);
+        mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, needle)));
+        if (mask)
+            return (char*)p + __builtin_ctz(mask);
+    }
+}
+
+__attribute__((target("avx2"))) char* __strchrnul_avx2(const char* s, int c) {
+    uintptr_t off = (uintptr_t)s % 32;
+    const __m256i* p = (const __m256i*)(s - off);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i needle = _mm256_set1_epi8((char)c);
+    __m256i v = _mm256_load_si256(p);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, needle))) >> off;
+    if (mask)
+        return (char*)s + __builtin_ctz(mask);
+    for (;;) {
+        ++p;
+        v = _mm256_load_si256(p);
+        mask = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, needle)));
+        if (mask)
+            return (char*)p + __builtin_ctz(mask);
+    }
+}
+
+char* (*__strchrnul_impl)(const char*, int) ATTR_RELRO = strchrnul_sse2;
+
+char* __strchrnul(const char* s, int c) {
+    return __strchrnul_impl(s, c);
+}
+
+weak_alias(__strchrnul, strchrnul);
+
+#endif
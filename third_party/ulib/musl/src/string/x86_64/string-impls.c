@@ -0,0 +1,33 @@
+#include "string-impls.h"
+
+#include <cpuid.h>
+#include <magenta/compiler.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static __NO_SAFESTACK bool have_avx2(void) {
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_OSXSAVE) || !(c & bit_AVX))
+        return false;
+    // The kernel must have enabled saving of the xmm and ymm state.
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6)
+        return false;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return false;
+    __cpuid_count(7, 0, a, b, c, d);
+    return (b & bit_AVX2) != 0;
+}
+
+__NO_SAFESTACK void __init_string_impls(void) {
+    if (!have_avx2())
+        return;
+    __memcmp_impl = __memcmp_avx2;
+#if !__has_feature(address_sanitizer)
+    // Under ASan these use the portable code; see memchr.c.
+    __memchr_impl = __memchr_avx2;
+    __strchrnul_impl = __strchrnul_avx2;
+    __strlen_impl = __strlen_avx2;
+#endif
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "libc.h"
+#include <stddef.h>
+
+// memchr, memcmp, strlen and __strchrnul each have a version using SSE2,
+// which every x86-64 cpu has, and one using AVX2.  The public functions
+// jump through these pointers, which start out at the SSE2 versions.
+// __init_string_impls() points them at the AVX2 versions at startup if the
+// cpu has AVX2 and the kernel saves the ymm registers.
+extern void* (*__memchr_impl)(const void*, int, size_t) ATTR_LIBC_VISIBILITY;
+extern int (*__memcmp_impl)(const void*, const void*, size_t) ATTR_LIBC_VISIBILITY;
+extern char* (*__strchrnul_impl)(const char*, int) ATTR_LIBC_VISIBILITY;
+extern size_t (*__strlen_impl)(const char*) ATTR_LIBC_VISIBILITY;
+
+void* __memchr_avx2(const void*, int, size_t) ATTR_LIBC_VISIBILITY;
+int __memcmp_avx2(const void*, const void*, size_t) ATTR_LIBC_VISIBILITY;
+char* __strchrnul_avx2(const char*, int) ATTR_LIBC_VISIBILITY;
+size_t __strlen_avx2(const char*) ATTR_LIBC_VISIBILITY;
@@ -0,0 +1,57 @@
+#include <string.h>
+
+#include <magenta/compiler.h>
+
+#if __has_feature(address_sanitizer)
+
+// The vector code reads the whole aligned block holding the end of the
+// string, which is OK since it won't cross a page boundary.  But under ASan,
+// even one byte past the actual end is diagnosed.
+#include "../strlen.c"
+
+#else
+
+#include "string-impls.h"
+#include <immintrin.h>
+#include <stdint.h>
+
+static size_t strlen_sse2(const char* s) {
+    // Only aligned blocks are read, so we never touch a page that holds
+    // none of the string.
+    uintptr_t off = (uintptr_t)s % 16;
+    const __m128i* p = (const __m128i*)(s - off);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero)) >> off;
+    if (mask)
+        return __builtin_ctz(mask);
+    for (;;) {
+        ++p;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero));
+        if (mask)
+            return (const char*)p + __builtin_ctz(mask) - s;
+    }
+}
+
+__attribute__((target("avx2"))) size_t __strlen_avx2(const char* s) {
+    uintptr_t off = (uintptr_t)s % 32;
+    const __m256i* p = (const __m256i*)(s - off);
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_load_si256(p), zero)) >> off;
+    if (mask)
+        return __builtin_ctz(mask);
+    for (;;) {
+        ++p;
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(p), zero));
+        if (mask)
+            return (const char*)p + __builtin_ctz(mask) - s;
+    }
+}
+
+size_t (*__strlen_impl)(const char*) ATTR_RELRO = strlen_sse2;
+
+size_t strlen(const char* s) {
+    return __strlen_impl(s);
+}
+
+#endif
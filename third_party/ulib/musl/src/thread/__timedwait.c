@@ -5,10 +5,11 @@
 
 #include "clock_impl.h"
 
-int __timedwait(atomic_int* futex, int val, clockid_t clk, const struct timespec* at) {
+// Converts the absolute time |at| on |clk| to a deadline for a futex wait.
+static int futex_deadline(clockid_t clk, const struct timespec* at, mx_time_t* deadline) {
     struct timespec to;
-    mx_time_t deadline = MX_TIME_INFINITE;
 
+    *deadline = MX_TIME_INFINITE;
     if (at) {
         if (at->tv_nsec >= MX_SEC(1))
             return EINVAL;
@@ -21,8 +22,16 @@ int __timedwait(atomic_int* futex, int val, clockid_t clk, const struct timespec
         }
         if (to.tv_sec < 0)
             return ETIMEDOUT;
-        deadline = _mx_deadline_after(MX_SEC(to.tv_sec) + to.tv_nsec);
+        *deadline = _mx_deadline_after(MX_SEC(to.tv_sec) + to.tv_nsec);
     }
+    return 0;
+}
+
+int __timedwait(atomic_int* futex, int val, clockid_t clk, const struct timespec* at) {
+    mx_time_t deadline;
+    int r = futex_deadline(clk, at, &deadline);
+    if (r)
+        return r;
 
     // mx_futex_wait will return MX_ERR_BAD_STATE if someone modifying *addr
     // races with this call. But this is indistinguishable from
@@ -39,3 +48,28 @@ int __timedwait(atomic_int* futex, int val, clockid_t clk, const struct timespec
         __builtin_trap();
     }
 }
+
+int __timedwait_owner(atomic_int* futex, int val, mx_handle_t owner,
+                      clockid_t clk, const struct timespec* at) {
+    mx_time_t deadline;
+    int r = futex_deadline(clk, at, &deadline);
+    if (r)
+        return r;
+
+    // As for __timedwait(), except that |owner| is read from the futex
+    // before waiting, so the thread may have exited and its handle been
+    // closed (or reused) since. The futex has changed in that case too, so
+    // that is a spurious wakeup as well.
+    switch (_mx_futex_wait_owner(futex, val, owner, deadline)) {
+    case MX_OK:
+    case MX_ERR_BAD_STATE:
+    case MX_ERR_BAD_HANDLE:
+    case MX_ERR_WRONG_TYPE:
+        return 0;
+    case MX_ERR_TIMED_OUT:
+        return ETIMEDOUT;
+    case MX_ERR_INVALID_ARGS:
+    default:
+        __builtin_trap();
+    }
+}